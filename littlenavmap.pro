@@ -56,6 +56,11 @@
 # Path to SimConnect SDK. SimConnect support will be omitted in build if not set.
 # Example: "C:\Program Files (x86)\Microsoft Games\Microsoft Flight Simulator X SDK\SDK\Core Utilities Kit\SimConnect SDK"
 #
+# ATOOLS_SQLITE_PATH
+# Optional. Base path of the SQLite library used by the Qt SQL driver having the folders "include" and "lib".
+# Set to "system" to use the system library. Qt has to be built with "-system-sqlite" in both cases.
+# Allows to interrupt outdated search queries. Interrupting will be omitted in build if not set.
+#
 # DEPLOY_BASE
 # Target folder for "make deploy". Optional. Default is "../deploy" plus project name ($$TARGET_NAME).
 #
@@ -94,6 +99,7 @@ INSTALL_MARBLE_DYLIB=$$(INSTALL_MARBLE_DYLIB)
 OPENSSL_PATH=$$(OPENSSL_PATH)
 GIT_PATH=$$(ATOOLS_GIT_PATH)
 SIMCONNECT_PATH=$$(ATOOLS_SIMCONNECT_PATH)
+SQLITE_PATH=$$(ATOOLS_SQLITE_PATH)
 DEPLOY_BASE=$$(DEPLOY_BASE)
 DATABASE_BASE=$$(DATABASE_BASE)
 HELP_BASE=$$(HELP_BASE)
@@ -169,6 +175,15 @@ isEmpty(GIT_PATH) {
   GIT_REVISION='\\"$$system('$$GIT_PATH' rev-parse --short HEAD)\\"'
 }
 
+!isEmpty(SQLITE_PATH) {
+  DEFINES += SQLITE_INTERRUPT
+  !isEqual(SQLITE_PATH, "system") {
+    INCLUDEPATH += $$SQLITE_PATH/include
+    LIBS += -L$$SQLITE_PATH/lib
+  }
+  LIBS += -lsqlite3
+}
+
 PRE_TARGETDEPS += $$ATOOLS_LIB_PATH/libatools.a
 DEPENDPATH += $$ATOOLS_INC_PATH $$MARBLE_INC_PATH
 INCLUDEPATH += $$PWD/src $$ATOOLS_INC_PATH $$MARBLE_INC_PATH
@@ -184,6 +199,7 @@ message(-----------------------------------)
 message(GIT_PATH: $$GIT_PATH)
 message(GIT_REVISION: $$GIT_REVISION)
 message(OPENSSL_PATH: $$OPENSSL_PATH)
+message(SQLITE_PATH: $$SQLITE_PATH)
 message(ATOOLS_INC_PATH: $$ATOOLS_INC_PATH)
 message(ATOOLS_LIB_PATH: $$ATOOLS_LIB_PATH)
 message(MARBLE_INC_PATH: $$MARBLE_INC_PATH)
@@ -208,6 +224,8 @@ message(-----------------------------------)
 
 SOURCES += \
   src/airspace/airspacecontroller.cpp \
+  src/airspace/airspacegeometrycache.cpp \
+  src/airspace/airspaceindex.cpp \
   src/airspace/airspacetoolbarhandler.cpp \
   src/common/aircrafttrack.cpp \
   src/common/airportfiles.cpp \
@@ -216,6 +234,7 @@ SOURCES += \
   src/common/dialogrecordhelper.cpp \
   src/common/elevationprovider.cpp \
   src/common/formatter.cpp \
+  src/common/globemappedreader.cpp \
   src/common/fueltool.cpp \
   src/common/htmlinfobuilder.cpp \
   src/common/jumpback.cpp \
@@ -225,16 +244,19 @@ SOURCES += \
   src/common/maptypes.cpp \
   src/common/maptypesfactory.cpp \
   src/common/proctypes.cpp \
+  src/common/screengrid.cpp \
   src/common/settingsmigrate.cpp \
   src/common/symbolpainter.cpp \
   src/common/tabindexes.cpp \
   src/common/textplacement.cpp \
+  src/common/trafficindex.cpp \
   src/common/unit.cpp \
   src/common/unitstringtool.cpp \
   src/common/updatehandler.cpp \
   src/common/vehicleicons.cpp \
   src/connect/connectclient.cpp \
   src/connect/connectdialog.cpp \
+  src/connect/simdatadispatcher.cpp \
   src/db/databasedialog.cpp \
   src/db/databasemanager.cpp \
   src/db/dbtypes.cpp \
@@ -284,8 +306,10 @@ SOURCES += \
   src/mappainter/mappainterweather.cpp \
   src/mappainter/mappainterwind.cpp \
   src/mappainter/mappaintlayer.cpp \
+  src/mappainter/mappaintprofiler.cpp \
   src/navapp.cpp \
   src/online/onlinedatacontroller.cpp \
+  src/online/onlinedatareader.cpp \
   src/options/optiondata.cpp \
   src/options/optionsdialog.cpp \
   src/perf/aircraftperfcontroller.cpp \
@@ -299,15 +323,21 @@ SOURCES += \
   src/query/airportquery.cpp \
   src/query/airspacequery.cpp \
   src/query/infoquery.cpp \
+  src/query/mapprefetcher.cpp \
   src/query/mapquery.cpp \
+  src/query/maptileloader.cpp \
+  src/query/procedurecache.cpp \
   src/query/procedurequery.cpp \
   src/query/querytypes.cpp \
   src/route/customproceduredialog.cpp \
   src/route/flightplanentrybuilder.cpp \
+  src/route/indexedheap.cpp \
   src/route/parkingdialog.cpp \
   src/route/route.cpp \
   src/route/routealtitude.cpp \
   src/route/routealtitudeleg.cpp \
+  src/route/routebenchmark.cpp \
+  src/route/routecalcrunner.cpp \
   src/route/routecommand.cpp \
   src/route/routecontroller.cpp \
   src/route/routeexport.cpp \
@@ -335,9 +365,11 @@ SOURCES += \
   src/search/proceduresearch.cpp \
   src/search/searchbasetable.cpp \
   src/search/searchcontroller.cpp \
+  src/search/searchindex.cpp \
   src/search/sqlcontroller.cpp \
   src/search/sqlmodel.cpp \
   src/search/sqlproxymodel.cpp \
+  src/search/sqlqueryworker.cpp \
   src/search/userdatasearch.cpp \
   src/search/usericondelegate.cpp \
   src/userdata/userdatacontroller.cpp \
@@ -349,12 +381,15 @@ SOURCES += \
   src/web/webcontroller.cpp \
   src/web/requesthandler.cpp \
   src/web/webmapcontroller.cpp \
+    src/web/webtilecache.cpp \
     src/web/webtools.cpp \
     src/web/webflags.cpp \
     src/web/webapp.cpp
 
 HEADERS  += \
   src/airspace/airspacecontroller.h \
+  src/airspace/airspacegeometrycache.h \
+  src/airspace/airspaceindex.h \
   src/airspace/airspacetoolbarhandler.h \
   src/common/aircrafttrack.h \
   src/common/airportfiles.h \
@@ -363,6 +398,7 @@ HEADERS  += \
   src/common/dialogrecordhelper.h \
   src/common/elevationprovider.h \
   src/common/formatter.h \
+  src/common/globemappedreader.h \
   src/common/fueltool.h \
   src/common/htmlinfobuilder.h \
   src/common/jumpback.h \
@@ -372,16 +408,19 @@ HEADERS  += \
   src/common/maptypes.h \
   src/common/maptypesfactory.h \
   src/common/proctypes.h \
+  src/common/screengrid.h \
   src/common/settingsmigrate.h \
   src/common/symbolpainter.h \
   src/common/tabindexes.h \
   src/common/textplacement.h \
+  src/common/trafficindex.h \
   src/common/unit.h \
   src/common/unitstringtool.h \
   src/common/updatehandler.h \
   src/common/vehicleicons.h \
   src/connect/connectclient.h \
   src/connect/connectdialog.h \
+  src/connect/simdatadispatcher.h \
   src/db/databasedialog.h \
   src/db/databasemanager.h \
   src/db/dbtypes.h \
@@ -430,8 +469,10 @@ HEADERS  += \
   src/mappainter/mappainterweather.h \
   src/mappainter/mappainterwind.h \
   src/mappainter/mappaintlayer.h \
+  src/mappainter/mappaintprofiler.h \
   src/navapp.h \
   src/online/onlinedatacontroller.h \
+  src/online/onlinedatareader.h \
   src/options/optiondata.h \
   src/options/optionsdialog.h \
   src/perf/aircraftperfcontroller.h \
@@ -445,15 +486,21 @@ HEADERS  += \
   src/query/airportquery.h \
   src/query/airspacequery.h \
   src/query/infoquery.h \
+  src/query/mapprefetcher.h \
   src/query/mapquery.h \
+  src/query/maptileloader.h \
+  src/query/procedurecache.h \
   src/query/procedurequery.h \
   src/query/querytypes.h \
   src/route/customproceduredialog.h \
   src/route/flightplanentrybuilder.h \
+  src/route/indexedheap.h \
   src/route/parkingdialog.h \
   src/route/route.h \
   src/route/routealtitude.h \
   src/route/routealtitudeleg.h \
+  src/route/routebenchmark.h \
+  src/route/routecalcrunner.h \
   src/route/routecommand.h \
   src/route/routecontroller.h \
   src/route/routeexport.h \
@@ -481,9 +528,11 @@ HEADERS  += \
   src/search/proceduresearch.h \
   src/search/searchbasetable.h \
   src/search/searchcontroller.h \
+  src/search/searchindex.h \
   src/search/sqlcontroller.h \
   src/search/sqlmodel.h \
   src/search/sqlproxymodel.h \
+  src/search/sqlqueryworker.h \
   src/search/userdatasearch.h \
   src/search/usericondelegate.h \
   src/userdata/userdatacontroller.h \
@@ -495,6 +544,7 @@ HEADERS  += \
   src/web/webcontroller.h \
   src/web/requesthandler.h \
   src/web/webmapcontroller.h \
+    src/web/webtilecache.h \
     src/web/webtools.h \
     src/web/webflags.h \
     src/web/webapp.h
@@ -0,0 +1,103 @@
+#*****************************************************************************
+# Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#****************************************************************************
+
+# =============================================================================
+# Headless route calculation benchmark. Build with "qmake routebench.pro && make".
+# Uses the same environment variables ATOOLS_INC_PATH, ATOOLS_LIB_PATH and
+# ATOOLS_QUIET as littlenavmap.pro. Marble is not needed.
+#
+# Usage: routebench [options] navdata.sqlite
+# Prints wall time, expanded nodes, SQL queries, cache size and route distance
+# for each airport pair and mode as JSON. Run "routebench --help" for options.
+# =============================================================================
+
+QT += core gui sql
+
+CONFIG += build_all c++14 console
+CONFIG -= debug_and_release debug_and_release_target app_bundle
+
+TARGET = routebench
+TEMPLATE = app
+
+# =======================================================================
+# Copy environment variables into qmake variables
+ATOOLS_INC_PATH=$$(ATOOLS_INC_PATH)
+ATOOLS_LIB_PATH=$$(ATOOLS_LIB_PATH)
+QUIET=$$(ATOOLS_QUIET)
+
+# =======================================================================
+# Fill defaults for unset
+
+CONFIG(debug, debug|release) : CONF_TYPE=debug
+CONFIG(release, debug|release) : CONF_TYPE=release
+
+isEmpty(ATOOLS_INC_PATH) : ATOOLS_INC_PATH=$$PWD/../atools/src
+isEmpty(ATOOLS_LIB_PATH) : ATOOLS_LIB_PATH=$$PWD/../build-atools-$$CONF_TYPE
+
+# =======================================================================
+# Set compiler flags and paths
+
+unix:!macx {
+  QMAKE_LFLAGS += -no-pie
+  LIBS += -L$$ATOOLS_LIB_PATH -latools -lz
+}
+
+win32 {
+  DEFINES += _USE_MATH_DEFINES
+  LIBS += -L$$ATOOLS_LIB_PATH -latools -lz
+}
+
+macx {
+  QMAKE_MACOSX_DEPLOYMENT_TARGET = 10.10
+  LIBS += -L$$ATOOLS_LIB_PATH -latools -lz
+}
+
+PRE_TARGETDEPS += $$ATOOLS_LIB_PATH/libatools.a
+DEPENDPATH += $$ATOOLS_INC_PATH
+INCLUDEPATH += $$PWD/src $$ATOOLS_INC_PATH
+DEFINES += QT_NO_CAST_FROM_BYTEARRAY
+DEFINES += QT_NO_CAST_TO_ASCII
+
+!isEqual(QUIET, "true") {
+message(-----------------------------------)
+message(ATOOLS_INC_PATH: $$ATOOLS_INC_PATH)
+message(ATOOLS_LIB_PATH: $$ATOOLS_LIB_PATH)
+message(INCLUDEPATH: $$INCLUDEPATH)
+message(LIBS: $$LIBS)
+message(CONFIG: $$CONFIG)
+message(-----------------------------------)
+}
+
+# =====================================================================
+# Files
+
+SOURCES += \
+  src/route/indexedheap.cpp \
+  src/route/routebenchmark.cpp \
+  src/route/routefinder.cpp \
+  src/route/routenetwork.cpp \
+  src/route/routenetworkairway.cpp \
+  src/route/routenetworkradio.cpp \
+  src/routebench/routebench.cpp
+
+HEADERS += \
+  src/route/indexedheap.h \
+  src/route/routebenchmark.h \
+  src/route/routefinder.h \
+  src/route/routenetwork.h \
+  src/route/routenetworkairway.h \
+  src/route/routenetworkradio.h
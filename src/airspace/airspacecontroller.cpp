@@ -17,6 +17,8 @@
 
 #include "airspace/airspacecontroller.h"
 
+#include "airspace/airspaceindex.h"
+#include "route/route.h"
 #include "sql/sqlrecord.h"
 #include "query/airspacequery.h"
 #include "geo/linestring.h"
@@ -60,6 +62,8 @@ AirspaceController::AirspaceController(MainWindow *mainWindowParam,
   for(AirspaceQuery *q:queries.values())
     q->initQueries();
 
+  airspaceIndex = new AirspaceIndex(this);
+
   // Button and action handler =================================
   qDebug() << Q_FUNC_INFO << "Creating InfoController";
   airspaceHandler = new AirspaceToolBarHandler(NavApp::getMainWindow());
@@ -81,6 +85,8 @@ AirspaceController::~AirspaceController()
   qDebug() << Q_FUNC_INFO << "delete airspaceHandler";
   delete airspaceHandler;
 
+  delete airspaceIndex;
+
   qDeleteAll(queries);
   queries.clear();
 }
@@ -206,6 +212,65 @@ void AirspaceController::getAirspaces(AirspaceVector& airspaces, const Marble::G
   }
 }
 
+void AirspaceController::updateIndex()
+{
+  if(indexValid && indexGeneration == geometryGeneration && indexSources == sources)
+    return;
+
+  // Load all airspaces without geometry from enabled sources
+  QVector<map::MapAirspace> airspaces;
+  for(map::MapAirspaceSources src : map::MAP_AIRSPACE_SRC_VALUES)
+  {
+    if(!(src & sources) || ((src & map::AIRSPACE_SRC_USER) && loadingUserAirspaces))
+      continue;
+
+    AirspaceQuery *query = queries.value(src);
+    if(query != nullptr)
+      query->getAllAirspaces(airspaces);
+  }
+
+  airspaceIndex->build(airspaces);
+  indexValid = true;
+  indexGeneration = geometryGeneration;
+  indexSources = sources;
+}
+
+void AirspaceController::getAirspacesAtPos(AirspaceVector& airspaces, const atools::geo::Pos& pos, float altitudeFt,
+                                           map::MapAirspaceTypes types)
+{
+  updateIndex();
+  airspaceIndex->getAirspacesAtPos(airspaces, pos, altitudeFt, types);
+}
+
+void AirspaceController::getAirspacesAlongRoute(QVector<AirspaceCrossing>& crossings, const Route& route,
+                                                map::MapAirspaceTypes types)
+{
+  if(route.size() < 2)
+    return;
+
+  updateIndex();
+
+  // Build line from leg geometry including procedures but without alternates
+  atools::geo::LineString line;
+  for(int i = 0; i <= route.getDestinationAirportLegIndex() && i < route.size(); i++)
+  {
+    for(const atools::geo::Pos& pos : route.value(i).getGeometry())
+    {
+      if(line.isEmpty() || !line.last().almostEqual(pos, atools::geo::Pos::POS_EPSILON_10M))
+        line.append(pos);
+    }
+  }
+
+  float cruiseAltitudeFt = route.getCruisingAltitudeFeet();
+  float totalDistanceNm = route.getTotalDistance();
+  airspaceIndex->getAirspacesAlongLine(crossings, line,
+                                       [&route, cruiseAltitudeFt, totalDistanceNm](float distanceNm) -> float
+  {
+    float altitude = route.getAltitudeForDistance(totalDistanceNm - distanceNm);
+    return altitude < map::INVALID_ALTITUDE_VALUE ? altitude : cruiseAltitudeFt;
+  }, types);
+}
+
 const atools::geo::LineString *AirspaceController::getAirspaceGeometry(map::MapAirspaceId id)
 {
   if((id.src & map::AIRSPACE_SRC_USER) && loadingUserAirspaces)
@@ -241,6 +306,7 @@ void AirspaceController::saveState()
 
 void AirspaceController::optionsChanged()
 {
+  geometryGeneration++;
   if(!loadingUserAirspaces)
   {
     for(AirspaceQuery *q:queries.values())
@@ -251,6 +317,8 @@ void AirspaceController::optionsChanged()
 
 void AirspaceController::preDatabaseLoad()
 {
+  geometryGeneration++;
+
   // Avoid recursion from signal which is reflected by the database manager from
   // preDatabaseLoadAirspaces and postDatabaseLoadAirspaces
   if(!loadingUserAirspaces)
@@ -262,6 +330,8 @@ void AirspaceController::preDatabaseLoad()
 
 void AirspaceController::postDatabaseLoad()
 {
+  geometryGeneration++;
+
   // Avoid recursion from signal which is reflected by the database manager from
   // preDatabaseLoadAirspaces and postDatabaseLoadAirspaces
   if(!loadingUserAirspaces)
@@ -273,12 +343,14 @@ void AirspaceController::postDatabaseLoad()
 
 void AirspaceController::onlineClientAndAtcUpdated()
 {
+  geometryGeneration++;
   if(queries.contains(map::AIRSPACE_SRC_ONLINE))
     queries.value(map::AIRSPACE_SRC_ONLINE)->clearCache();
 }
 
 void AirspaceController::resetAirspaceOnlineScreenGeometry()
 {
+  geometryGeneration++;
   if(queries.contains(map::AIRSPACE_SRC_ONLINE))
   {
     queries.value(map::AIRSPACE_SRC_ONLINE)->deInitQueries();
@@ -493,6 +565,7 @@ atools::geo::LineString *AirspaceController::getOnlineAirspaceGeoByName(const QS
 
 void AirspaceController::preLoadAirpaces()
 {
+  geometryGeneration++;
   loadingUserAirspaces = true;
   if(queries.contains(map::AIRSPACE_SRC_USER))
     queries.value(map::AIRSPACE_SRC_USER)->deInitQueries();
@@ -502,6 +575,7 @@ void AirspaceController::preLoadAirpaces()
 
 void AirspaceController::postLoadAirpaces()
 {
+  geometryGeneration++;
   if(queries.contains(map::AIRSPACE_SRC_USER))
     queries.value(map::AIRSPACE_SRC_USER)->initQueries();
   loadingUserAirspaces = false;
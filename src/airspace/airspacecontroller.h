@@ -33,10 +33,13 @@ namespace Marble {
 class GeoDataLatLonBox;
 }
 
+struct AirspaceCrossing;
+class AirspaceIndex;
 class AirspaceQuery;
 class MapLayer;
 class AirspaceToolBarHandler;
 class MainWindow;
+class Route;
 
 typedef  QHash<map::MapAirspaceSources, AirspaceQuery *> AirspaceQueryMapType;
 typedef  QVector<const map::MapAirspace *> AirspaceVector;
@@ -72,9 +75,27 @@ public:
   void getAirspaces(AirspaceVector& airspaces, const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer,
                     map::MapAirspaceFilter filter, float flightPlanAltitude, bool lazy, map::MapAirspaceSources src);
 
+  /* Get airspaces of all enabled sources containing the position. Uses the containment index and is cheap enough
+   * to be called on each simulator update. altitudeFt is ignored if INVALID_ALTITUDE_VALUE.
+   * Pointers are valid until the next change of the geometry generation or sources. */
+  void getAirspacesAtPos(AirspaceVector& airspaces, const atools::geo::Pos& pos, float altitudeFt,
+                         map::MapAirspaceTypes types = map::AIRSPACE_ALL);
+
+  /* Get airspaces of all enabled sources crossed by the flight plan without alternates ordered by entry distance.
+   * Altitude is taken from the vertical flight path or the cruise altitude if not calculated. */
+  void getAirspacesAlongRoute(QVector<AirspaceCrossing>& crossings, const Route& route,
+                              map::MapAirspaceTypes types = map::AIRSPACE_ALL);
+
   /* Get Geometry for any airspace and source database */
   const atools::geo::LineString *getAirspaceGeometry(map::MapAirspaceId id);
 
+  /* Incremented each time queries are reset or caches cleared. Geometry cached outside has to be dropped
+   * if this changes since ids might refer to other airspaces. */
+  quint32 getGeometryGeneration() const
+  {
+    return geometryGeneration;
+  }
+
   /* Read and write widget states, source and airspace selection */
   void restoreState();
   void saveState();
@@ -145,11 +166,20 @@ private:
   void preLoadAirpaces();
   void postLoadAirpaces();
 
+  /* Rebuild the containment index if geometry generation or sources have changed */
+  void updateIndex();
+
   AirspaceQueryMapType queries;
   map::MapAirspaceSources sources = map::AIRSPACE_SRC_NONE;
   AirspaceToolBarHandler *airspaceHandler = nullptr;
   MainWindow *mainWindow;
   bool loadingUserAirspaces = false;
+  quint32 geometryGeneration = 0;
+
+  AirspaceIndex *airspaceIndex = nullptr;
+  bool indexValid = false;
+  quint32 indexGeneration = 0;
+  map::MapAirspaceSources indexSources = map::AIRSPACE_SRC_NONE;
 };
 
 #endif // LNM_AIRSPACECONTROLLER_H
@@ -0,0 +1,221 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "airspace/airspacegeometrycache.h"
+
+#include "airspace/airspacecontroller.h"
+#include "geo/calculations.h"
+#include "geo/linestring.h"
+#include "navapp.h"
+
+#include <marble/ViewportParams.h>
+
+#include <cmath>
+
+/* Simplification tolerance in degree for each level from coarse to full resolution */
+const static QVector<float> LEVEL_TOLERANCE_DEG({0.2f, 0.04f, 0.008f, 0.0016f, 0.f});
+
+/* Maximum allowed simplification error on screen */
+const static float MAX_ERROR_PIXEL = 1.f;
+
+/* Maximum number of source points in all cached airspaces */
+const static int MAX_CACHE_POINTS = 2000000;
+
+struct AirspaceGeometryCache::Entry
+{
+  /* Simplified rings for each level. Bit in builtLevels is set if built. */
+  QVector<Marble::GeoDataLinearRing> rings;
+  int builtLevels = 0;
+
+  /* Projected polygons for screenLevel in the view of screenViewGeneration */
+  QVector<QPolygonF> screenPolygons;
+  int screenLevel = -1;
+  quint32 screenViewGeneration = 0;
+};
+
+bool AirspaceGeometryCache::ViewportKey::operator==(const AirspaceGeometryCache::ViewportKey& other) const
+{
+  return projection == other.projection && centerLonXRad == other.centerLonXRad &&
+         centerLatYRad == other.centerLatYRad && radius == other.radius &&
+         width == other.width && height == other.height;
+}
+
+AirspaceGeometryCache::AirspaceGeometryCache()
+{
+  cache.setMaxCost(MAX_CACHE_POINTS);
+}
+
+AirspaceGeometryCache::~AirspaceGeometryCache()
+{
+
+}
+
+void AirspaceGeometryCache::beginFrame(const Marble::ViewportParams *viewport, quint32 geometryGeneration)
+{
+  if(geometryGeneration != lastGeometryGeneration)
+  {
+    // Queries were reset or database switched - ids might point to other airspaces now
+    cache.clear();
+    lastGeometryGeneration = geometryGeneration;
+  }
+
+  ViewportKey key = {viewport->projection(), viewport->centerLongitude(), viewport->centerLatitude(),
+                     viewport->radius(), viewport->width(), viewport->height()};
+
+  if(key != lastViewport)
+  {
+    // Screen coordinates of all entries are outdated
+    viewGeneration++;
+    lastViewport = key;
+  }
+}
+
+int AirspaceGeometryCache::levelForScale(float pixelPerDegree)
+{
+  if(!(pixelPerDegree > 0.f))
+    // Scale not initialized - use full resolution
+    return LEVEL_TOLERANCE_DEG.size() - 1;
+
+  for(int level = 0; level < LEVEL_TOLERANCE_DEG.size(); level++)
+  {
+    if(LEVEL_TOLERANCE_DEG.at(level) * pixelPerDegree <= MAX_ERROR_PIXEL)
+      return level;
+  }
+  return LEVEL_TOLERANCE_DEG.size() - 1;
+}
+
+const QVector<QPolygonF> *AirspaceGeometryCache::getScreenPolygons(const map::MapAirspaceId& id, int level,
+                                                                   const Marble::ViewportParams *viewport)
+{
+  level = std::max(0, std::min(level, LEVEL_TOLERANCE_DEG.size() - 1));
+
+  Entry *entry = cache.object(id);
+  if(entry == nullptr || !(entry->builtLevels & (1 << level)))
+  {
+    // Geometry is cached in the airspace queries
+    const atools::geo::LineString *line = NavApp::getAirspaceController()->getAirspaceGeometry(id);
+    if(line == nullptr || line->isEmpty())
+      // Do not remember missing geometry since it might be only temporarily unavailable while loading
+      return nullptr;
+
+    if(entry == nullptr)
+    {
+      entry = new Entry;
+      entry->rings.resize(LEVEL_TOLERANCE_DEG.size());
+      if(!cache.insert(id, entry, line->size()))
+        // Too big for cache - entry was deleted
+        return nullptr;
+    }
+
+    buildRing(entry->rings[level], *line, LEVEL_TOLERANCE_DEG.at(level));
+    entry->builtLevels |= 1 << level;
+  }
+
+  if(entry->screenLevel != level || entry->screenViewGeneration != viewGeneration)
+  {
+    // Project ring into screen polygons - Marble tessellates and splits at the horizon or the anti-meridian
+    entry->screenPolygons.clear();
+
+    const Marble::GeoDataLinearRing& ring = entry->rings.at(level);
+    if(viewport->resolves(ring.latLonAltBox()))
+    {
+      QVector<QPolygonF *> polygons;
+      viewport->screenCoordinates(ring, polygons);
+      for(const QPolygonF *polygon : polygons)
+        entry->screenPolygons.append(*polygon);
+      qDeleteAll(polygons);
+    }
+
+    entry->screenLevel = level;
+    entry->screenViewGeneration = viewGeneration;
+  }
+
+  return &entry->screenPolygons;
+}
+
+void AirspaceGeometryCache::clear()
+{
+  cache.clear();
+}
+
+void AirspaceGeometryCache::buildRing(Marble::GeoDataLinearRing& ring, const atools::geo::LineString& line,
+                                      float toleranceDeg)
+{
+  ring.clear();
+  ring.setTessellate(true);
+
+  int size = line.size();
+  QVector<bool> keep(size, toleranceDeg <= 0.f || size < 5);
+
+  if(!keep.first())
+  {
+    // Douglas-Peucker simplification ====================================
+    // Scale longitude to get approximately equal distances in both directions
+    double lonScale = std::cos(atools::geo::toRadians(static_cast<double>(line.first().getLatY())));
+    double toleranceSq = static_cast<double>(toleranceDeg) * static_cast<double>(toleranceDeg);
+
+    keep[0] = keep[size - 1] = true;
+
+    QVector<std::pair<int, int> > stack;
+    stack.append(std::make_pair(0, size - 1));
+
+    while(!stack.isEmpty())
+    {
+      std::pair<int, int> range = stack.takeLast();
+
+      const atools::geo::Pos& first = line.at(range.first);
+      const atools::geo::Pos& last = line.at(range.second);
+      double x1 = first.getLonX() * lonScale, y1 = first.getLatY();
+      double dx = last.getLonX() * lonScale - x1, dy = last.getLatY() - y1;
+      double lengthSq = dx * dx + dy * dy;
+
+      // Find point with largest distance to the segment first/last
+      double maxDistSq = 0.;
+      int maxIndex = -1;
+      for(int i = range.first + 1; i < range.second; i++)
+      {
+        double px = line.at(i).getLonX() * lonScale - x1, py = line.at(i).getLatY() - y1;
+
+        // Projection on segment clamped to end points - also covers closed rings where first equals last
+        double t = lengthSq > 0. ? std::max(0., std::min(1., (px * dx + py * dy) / lengthSq)) : 0.;
+        double ex = px - t * dx, ey = py - t * dy;
+        double distSq = ex * ex + ey * ey;
+
+        if(distSq > maxDistSq)
+        {
+          maxDistSq = distSq;
+          maxIndex = i;
+        }
+      }
+
+      if(maxIndex != -1 && maxDistSq > toleranceSq)
+      {
+        keep[maxIndex] = true;
+        stack.append(std::make_pair(range.first, maxIndex));
+        stack.append(std::make_pair(maxIndex, range.second));
+      }
+    }
+  }
+
+  for(int i = 0; i < size; i++)
+  {
+    if(keep.at(i))
+      ring.append(Marble::GeoDataCoordinates(line.at(i).getLonX(), line.at(i).getLatY(), 0.,
+                                             Marble::GeoDataCoordinates::Degree));
+  }
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LNM_AIRSPACEGEOMETRYCACHE_H
+#define LNM_AIRSPACEGEOMETRYCACHE_H
+
+#include "common/mapflags.h"
+
+#include <QCache>
+#include <QPolygonF>
+#include <QVector>
+
+#include <marble/GeoDataLinearRing.h>
+#include <marble/MarbleGlobal.h>
+
+namespace atools {
+namespace geo {
+class LineString;
+}
+}
+
+namespace Marble {
+class ViewportParams;
+}
+
+/*
+ * Caches airspace boundaries simplified for several levels of detail and their projected screen polygons.
+ *
+ * Boundaries are simplified with the Douglas-Peucker algorithm using tolerances from coarse to full resolution.
+ * The level is selected from the map scale keeping the error below one pixel. Rings are built on demand for each
+ * level and kept until AirspaceController changes its geometry generation, i.e. queries were reset.
+ *
+ * Screen polygons are reused as long as projection, center, zoom and size of the viewport do not change.
+ * Therefore one instance is needed for each map widget.
+ */
+class AirspaceGeometryCache
+{
+public:
+  AirspaceGeometryCache();
+  ~AirspaceGeometryCache();
+
+  /* Call before drawing a frame. Invalidates screen polygons if the viewport has changed and
+   * all geometry if the geometry generation has changed. */
+  void beginFrame(const Marble::ViewportParams *viewport, quint32 geometryGeneration);
+
+  /* Get level of detail for map scale given in pixel per degree latitude */
+  static int levelForScale(float pixelPerDegree);
+
+  /* Get projected polygons for the airspace in the current viewport. Geometry is loaded from AirspaceController
+   * if needed. Returns null if geometry is not available. Pointer is valid until the next call. */
+  const QVector<QPolygonF> *getScreenPolygons(const map::MapAirspaceId& id, int level,
+                                              const Marble::ViewportParams *viewport);
+
+  /* Remove all geometry */
+  void clear();
+
+private:
+  struct Entry;
+
+  /* Viewport values which change the screen coordinates */
+  struct ViewportKey
+  {
+    bool operator==(const ViewportKey& other) const;
+
+    bool operator!=(const ViewportKey& other) const
+    {
+      return !(*this == other);
+    }
+
+    Marble::Projection projection;
+    double centerLonXRad, centerLatYRad;
+    int radius, width, height;
+  };
+
+  /* Build ring for level from line */
+  static void buildRing(Marble::GeoDataLinearRing& ring, const atools::geo::LineString& line, float toleranceDeg);
+
+  /* Kept by airspace id. Cost is the number of source points. */
+  QCache<map::MapAirspaceId, Entry> cache;
+
+  /* VerticalPerspective is never used and forces an update on first call */
+  ViewportKey lastViewport = {Marble::VerticalPerspective, 0., 0., 0, 0, 0};
+  quint32 viewGeneration = 0, lastGeometryGeneration = 0;
+};
+
+#endif // LNM_AIRSPACEGEOMETRYCACHE_H
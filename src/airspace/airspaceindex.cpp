@@ -0,0 +1,530 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "airspace/airspaceindex.h"
+
+#include "airspace/airspacecontroller.h"
+#include "geo/calculations.h"
+#include "geo/linestring.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <cmath>
+
+using atools::geo::Pos;
+using atools::geo::LineString;
+
+/* Maximum number of children for each tree node */
+const static int NODE_SIZE = 16;
+
+/* Maximum number of points in all cached polygons */
+const static int MAX_CACHE_POINTS = 2000000;
+
+/* Polygon points for each latitude band and maximum number of bands */
+const static int POINTS_PER_BAND = 8;
+const static int MAX_BANDS = 64;
+
+/* Lines are interpolated along the great circle with segments not longer than this */
+const static float SEGMENT_LENGTH_NM = 20.f;
+
+/* Z component of the cross product */
+static double cross(const QPointF& p1, const QPointF& p2)
+{
+  return p1.x() * p2.y() - p1.y() * p2.x();
+}
+
+struct AirspaceIndex::Polygon
+{
+  /* x is longitude and y latitude. Longitudes are moved into the range 0 to 360 if shifted is true,
+   * i.e. the airspace crosses the anti-meridian. */
+  QVector<QPointF> points;
+  bool shifted = false;
+
+  /* Indexes of all edges touching a band. Edge i goes from point i to point i + 1. */
+  QVector<QVector<int> > bands;
+  double south = 0., north = 0., bandHeight = 1.;
+
+  int bandIndex(double lat) const
+  {
+    return std::min(std::max(static_cast<int>((lat - south) / bandHeight), 0), bands.size() - 1);
+  }
+
+  /* Even-odd test */
+  bool contains(const QPointF& point) const;
+
+  /* Append parameters from 0 to 1 along the segment for all edge intersections */
+  void intersections(QVector<double>& params, const QPointF& from, const QPointF& to) const;
+};
+
+bool AirspaceIndex::Polygon::contains(const QPointF& point) const
+{
+  QPointF pt(shifted && point.x() < 0. ? point.x() + 360. : point.x(), point.y());
+
+  if(points.size() < 3 || pt.y() < south || pt.y() > north)
+    return false;
+
+  bool inside = false;
+  int num = points.size();
+  for(int i : bands.at(bandIndex(pt.y())))
+  {
+    const QPointF& p1 = points.at(i);
+    const QPointF& p2 = points.at((i + 1) % num);
+
+    if((p1.y() > pt.y()) != (p2.y() > pt.y()) &&
+       pt.x() < (p2.x() - p1.x()) * (pt.y() - p1.y()) / (p2.y() - p1.y()) + p1.x())
+      inside = !inside;
+  }
+  return inside;
+}
+
+void AirspaceIndex::Polygon::intersections(QVector<double>& params, const QPointF& from, const QPointF& to) const
+{
+  QPointF a(from), b(to);
+
+  // Segments do not cross the anti-meridian - move the whole segment if on the western side
+  if(shifted && a.x() <= 0. && b.x() <= 0.)
+  {
+    a.rx() += 360.;
+    b.rx() += 360.;
+  }
+
+  double minLat = std::min(a.y(), b.y()), maxLat = std::max(a.y(), b.y());
+  if(points.size() < 3 || maxLat < south || minLat > north)
+    return;
+
+  // Collect edges from all touched bands and remove duplicates
+  int firstBand = bandIndex(minLat), lastBand = bandIndex(maxLat);
+  QVector<int> edges;
+  for(int band = firstBand; band <= lastBand; band++)
+    edges.append(bands.at(band));
+
+  if(lastBand > firstBand)
+  {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  }
+
+  int num = points.size();
+  QPointF dir = b - a;
+  for(int i : edges)
+  {
+    const QPointF& p1 = points.at(i);
+    QPointF edge = points.at((i + 1) % num) - p1;
+
+    double denominator = cross(dir, edge);
+    if(denominator == 0.)
+      // Parallel
+      continue;
+
+    QPointF diff = p1 - a;
+    double t = cross(diff, edge) / denominator;
+    double u = cross(diff, dir) / denominator;
+
+    if(t >= 0. && t < 1. && u >= 0. && u < 1.)
+      params.append(t);
+  }
+}
+
+AirspaceIndex::AirspaceIndex(AirspaceController *controllerParam)
+  : controller(controllerParam)
+{
+  polygonCache.setMaxCost(MAX_CACHE_POINTS);
+}
+
+AirspaceIndex::~AirspaceIndex()
+{
+}
+
+void AirspaceIndex::clear()
+{
+  airspaces.clear();
+  entries.clear();
+  nodes.clear();
+  polygonCache.clear();
+}
+
+void AirspaceIndex::build(const QVector<map::MapAirspace>& airspaceList)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  clear();
+  airspaces = airspaceList;
+
+  // Create entries and split rectangles at the anti-meridian =====================
+  for(int i = 0; i < airspaces.size(); i++)
+  {
+    const atools::geo::Rect& bounding = airspaces.at(i).bounding;
+    if(!bounding.isValid())
+      continue;
+
+    QList<atools::geo::Rect> rects;
+    if(bounding.crossesAntiMeridian())
+      rects = bounding.splitAtAntiMeridian();
+    else
+      rects.append(bounding);
+
+    for(const atools::geo::Rect& rect : rects)
+      entries.append({{rect.getWest(), rect.getSouth(), rect.getEast(), rect.getNorth()}, i});
+  }
+
+  // Pack leaves and then all upper levels until only the root is left =====================
+  QVector<Node> level;
+  packLevel(entries, level, true /* leaf */);
+
+  while(level.size() > 1)
+  {
+    QVector<Node> parents;
+    packLevel(level, parents, false /* leaf */);
+
+    // Parents refer to the level which is appended now
+    int offset = nodes.size();
+    nodes.append(level);
+    for(Node& node : parents)
+      node.first += offset;
+
+    level = parents;
+  }
+  nodes.append(level);
+
+  qDebug() << Q_FUNC_INFO << "airspaces" << airspaces.size() << "entries" << entries.size()
+           << "nodes" << nodes.size() << timer.elapsed() << "ms";
+}
+
+template<typename TYPE>
+void AirspaceIndex::packLevel(QVector<TYPE>& items, QVector<Node>& parents, bool leaf)
+{
+  if(items.isEmpty())
+    return;
+
+  int numParents = (items.size() + NODE_SIZE - 1) / NODE_SIZE;
+  int sliceSize = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numParents)))) * NODE_SIZE;
+
+  // Sort into vertical slices by center longitude and each slice by center latitude
+  std::sort(items.begin(), items.end(), [](const TYPE& item1, const TYPE& item2) -> bool
+  {
+    return item1.box.west + item1.box.east < item2.box.west + item2.box.east;
+  });
+
+  for(int slice = 0; slice < items.size(); slice += sliceSize)
+  {
+    std::sort(items.begin() + slice, items.begin() + std::min(slice + sliceSize, items.size()),
+              [](const TYPE& item1, const TYPE& item2) -> bool
+    {
+      return item1.box.south + item1.box.north < item2.box.south + item2.box.north;
+    });
+  }
+
+  // Each run of NODE_SIZE items gets a parent
+  for(int i = 0; i < items.size(); i += NODE_SIZE)
+  {
+    Node node;
+    node.first = i;
+    node.count = std::min(NODE_SIZE, items.size() - i);
+    node.leaf = leaf;
+    node.box = items.at(i).box;
+    for(int j = i + 1; j < i + node.count; j++)
+      node.box.extend(items.at(j).box);
+    parents.append(node);
+  }
+}
+
+void AirspaceIndex::search(const Box& box, const std::function<void(int airspaceIndex)>& func) const
+{
+  if(nodes.isEmpty())
+    return;
+
+  QVector<int> stack({nodes.size() - 1});
+  while(!stack.isEmpty())
+  {
+    const Node& node = nodes.at(stack.takeLast());
+    if(!node.box.overlaps(box))
+      continue;
+
+    for(int i = node.first; i < node.first + node.count; i++)
+    {
+      if(node.leaf)
+      {
+        const Entry& entry = entries.at(i);
+        if(entry.box.overlaps(box))
+          func(entry.airspaceIndex);
+      }
+      else
+        stack.append(i);
+    }
+  }
+}
+
+const AirspaceIndex::Polygon *AirspaceIndex::polygon(int airspaceIndex) const
+{
+  Polygon *poly = polygonCache.object(airspaceIndex);
+
+  if(poly == nullptr)
+  {
+    const map::MapAirspace& airspace = airspaces.at(airspaceIndex);
+
+    // Do not cache missing geometry since it might be unavailable only while loading user airspaces
+    const LineString *line = controller->getAirspaceGeometry(airspace.combinedId());
+    if(line == nullptr || line->size() < 3)
+      return nullptr;
+
+    poly = new Polygon;
+    poly->shifted = airspace.bounding.crossesAntiMeridian();
+    poly->south = 90.;
+    poly->north = -90.;
+
+    for(const Pos& pos : *line)
+    {
+      double lonX = pos.getLonX();
+      if(poly->shifted && lonX < 0.)
+        lonX += 360.;
+
+      poly->points.append(QPointF(lonX, pos.getLatY()));
+      poly->south = std::min(poly->south, static_cast<double>(pos.getLatY()));
+      poly->north = std::max(poly->north, static_cast<double>(pos.getLatY()));
+    }
+
+    // Sort edges into latitude bands =====================
+    int num = poly->points.size();
+    int numBands = std::min(std::max(num / POINTS_PER_BAND, 1), MAX_BANDS);
+    poly->bands.resize(numBands);
+    poly->bandHeight = (poly->north - poly->south) / numBands;
+    if(!(poly->bandHeight > 0.))
+      poly->bandHeight = 1.;
+
+    for(int i = 0; i < num; i++)
+    {
+      double lat1 = poly->points.at(i).y(), lat2 = poly->points.at((i + 1) % num).y();
+      int lastBand = poly->bandIndex(std::max(lat1, lat2));
+      for(int band = poly->bandIndex(std::min(lat1, lat2)); band <= lastBand; band++)
+        poly->bands[band].append(i);
+    }
+
+    if(!polygonCache.insert(airspaceIndex, poly, num))
+      // Too big for cache - polygon was deleted
+      return nullptr;
+  }
+  return poly;
+}
+
+bool AirspaceIndex::matchesAltitude(int airspaceIndex, float altitudeFt) const
+{
+  if(altitudeFt >= map::INVALID_ALTITUDE_VALUE)
+    return true;
+
+  const map::MapAirspace& airspace = airspaces.at(airspaceIndex);
+  return altitudeFt >= airspace.minAltitude && altitudeFt <= airspace.maxAltitude;
+}
+
+void AirspaceIndex::getAirspacesAtPos(QVector<const map::MapAirspace *>& result, const Pos& pos, float altitudeFt,
+                                      map::MapAirspaceTypes types) const
+{
+  if(!pos.isValid())
+    return;
+
+  float lonX = pos.getLonX(), latY = pos.getLatY();
+
+  // Rectangles split at the anti-meridian might be found twice
+  QVector<int> found;
+  search({lonX, latY, lonX, latY}, [&found](int airspaceIndex)
+  {
+    if(!found.contains(airspaceIndex))
+      found.append(airspaceIndex);
+  });
+
+  int oldSize = result.size();
+  for(int airspaceIndex : found)
+  {
+    const map::MapAirspace& airspace = airspaces.at(airspaceIndex);
+    if(!(airspace.type & types) || !matchesAltitude(airspaceIndex, altitudeFt))
+      continue;
+
+    const Polygon *poly = polygon(airspaceIndex);
+    if(poly != nullptr && poly->contains(QPointF(lonX, latY)))
+      result.append(&airspace);
+  }
+
+  std::sort(result.begin() + oldSize, result.end(),
+            [](const map::MapAirspace *airspace1, const map::MapAirspace *airspace2) -> bool
+  {
+    return map::airspaceDrawingOrder(airspace1->type) < map::airspaceDrawingOrder(airspace2->type);
+  });
+}
+
+void AirspaceIndex::getAirspacesAlongLine(QVector<AirspaceCrossing>& result, const LineString& line,
+                                          const std::function<float(float distanceNm)>& altitudeFunc,
+                                          map::MapAirspaceTypes types) const
+{
+  QVector<Segment> segments;
+  buildSegments(segments, line);
+
+  if(segments.isEmpty() || nodes.isEmpty())
+    return;
+
+  // Collect touched segments in order for each airspace =====================
+  QHash<int, QVector<int> > segmentsByAirspace;
+  for(int i = 0; i < segments.size(); i++)
+  {
+    search(segments.at(i).box, [this, &segmentsByAirspace, i, types](int airspaceIndex)
+    {
+      if(airspaces.at(airspaceIndex).type & types)
+      {
+        QVector<int>& segmentIndexes = segmentsByAirspace[airspaceIndex];
+        if(segmentIndexes.isEmpty() || segmentIndexes.last() != i)
+          segmentIndexes.append(i);
+      }
+    });
+  }
+
+  int oldSize = result.size();
+  for(auto it = segmentsByAirspace.constBegin(); it != segmentsByAirspace.constEnd(); ++it)
+    crossingsForAirspace(result, it.key(), it.value(), segments, altitudeFunc);
+
+  std::sort(result.begin() + oldSize, result.end(),
+            [](const AirspaceCrossing& crossing1, const AirspaceCrossing& crossing2) -> bool
+  {
+    if(crossing1.entryDistanceNm != crossing2.entryDistanceNm)
+      return crossing1.entryDistanceNm < crossing2.entryDistanceNm;
+
+    int order1 = map::airspaceDrawingOrder(crossing1.airspace->type),
+        order2 = map::airspaceDrawingOrder(crossing2.airspace->type);
+    if(order1 != order2)
+      return order1 < order2;
+
+    return crossing1.airspace->id < crossing2.airspace->id;
+  });
+}
+
+void AirspaceIndex::crossingsForAirspace(QVector<AirspaceCrossing>& result, int airspaceIndex,
+                                         const QVector<int>& segmentIndexes, const QVector<Segment>& segments,
+                                         const std::function<float(float distanceNm)>& altitudeFunc) const
+{
+  const Polygon *poly = polygon(airspaceIndex);
+  if(poly == nullptr)
+    return;
+
+  const map::MapAirspace *airspace = &airspaces.at(airspaceIndex);
+
+  auto addCrossing = [this, &result, &segments, &altitudeFunc, airspace, airspaceIndex](float entryNm, float exitNm)
+  {
+    bool matches = true;
+    if(altitudeFunc)
+    {
+      matches = matchesAltitude(airspaceIndex, altitudeFunc(entryNm)) ||
+                matchesAltitude(airspaceIndex, altitudeFunc(exitNm));
+
+      // Check the altitude at all segment points inside the airspace
+      auto it = std::upper_bound(segments.begin(), segments.end(), entryNm,
+                                 [](float distanceNm, const Segment& segment) -> bool
+      {
+        return distanceNm < segment.startDistanceNm;
+      });
+
+      for(; !matches && it != segments.end() && it->startDistanceNm < exitNm; ++it)
+        matches = matchesAltitude(airspaceIndex, altitudeFunc(it->startDistanceNm));
+    }
+
+    if(matches)
+      result.append({airspace, entryNm, exitNm});
+  };
+
+  // Line can only start inside if the first segment touches the bounding rectangle
+  bool inside = segmentIndexes.first() == 0 && poly->contains(segments.first().from);
+  float entryNm = 0.f;
+
+  QVector<double> params;
+  for(int index : segmentIndexes)
+  {
+    const Segment& segment = segments.at(index);
+
+    params.clear();
+    poly->intersections(params, segment.from, segment.to);
+    std::sort(params.begin(), params.end());
+
+    // Each intersection toggles between inside and outside
+    for(double param : params)
+    {
+      float distanceNm = segment.startDistanceNm + static_cast<float>(param) * segment.lengthNm;
+      if(inside)
+        addCrossing(entryNm, distanceNm);
+      else
+        entryNm = distanceNm;
+      inside = !inside;
+    }
+  }
+
+  if(inside)
+    // Line ends inside
+    addCrossing(entryNm, segments.last().startDistanceNm + segments.last().lengthNm);
+}
+
+void AirspaceIndex::buildSegments(QVector<Segment>& segments, const LineString& line)
+{
+  auto appendSegment = [&segments](const QPointF& from, const QPointF& to, float startDistanceNm, float lengthNm)
+  {
+    Segment segment;
+    segment.from = from;
+    segment.to = to;
+    segment.startDistanceNm = startDistanceNm;
+    segment.lengthNm = lengthNm;
+    segment.box = {static_cast<float>(std::min(from.x(), to.x())), static_cast<float>(std::min(from.y(), to.y())),
+                   static_cast<float>(std::max(from.x(), to.x())), static_cast<float>(std::max(from.y(), to.y()))};
+    segments.append(segment);
+  };
+
+  float distanceNm = 0.f;
+  for(int i = 1; i < line.size(); i++)
+  {
+    const Pos& pos1 = line.at(i - 1);
+    const Pos& pos2 = line.at(i);
+    if(!pos1.isValid() || !pos2.isValid())
+      continue;
+
+    float distanceMeter = pos1.distanceMeterTo(pos2);
+    int steps = std::min(std::max(static_cast<int>(std::ceil(atools::geo::meterToNm(distanceMeter) /
+                                                             SEGMENT_LENGTH_NM)), 1), 1000);
+
+    Pos last = pos1;
+    for(int step = 1; step <= steps; step++)
+    {
+      Pos next = step == steps ? pos2 : pos1.interpolate(pos2, distanceMeter, static_cast<float>(step) / steps);
+      float lengthNm = atools::geo::meterToNm(last.distanceMeterTo(next));
+
+      QPointF from(last.getLonX(), last.getLatY()), to(next.getLonX(), next.getLatY());
+      if(std::abs(to.x() - from.x()) > 180.)
+      {
+        // Split at the anti-meridian
+        double border = from.x() > 0. ? 180. : -180.;
+        double toLonX = to.x() + (from.x() > 0. ? 360. : -360.);
+        double fraction = (border - from.x()) / (toLonX - from.x());
+        double latY = from.y() + fraction * (to.y() - from.y());
+        float firstLengthNm = lengthNm * static_cast<float>(fraction);
+
+        appendSegment(from, QPointF(border, latY), distanceNm, firstLengthNm);
+        appendSegment(QPointF(-border, latY), to, distanceNm + firstLengthNm, lengthNm - firstLengthNm);
+      }
+      else
+        appendSegment(from, to, distanceNm, lengthNm);
+
+      distanceNm += lengthNm;
+      last = next;
+    }
+  }
+}
@@ -0,0 +1,167 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LNM_AIRSPACEINDEX_H
+#define LNM_AIRSPACEINDEX_H
+
+#include "common/maptypes.h"
+
+#include <QCache>
+#include <QPointF>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+namespace atools {
+namespace geo {
+class Pos;
+class LineString;
+}
+}
+
+class AirspaceController;
+
+/* One pass through an airspace along a line. An airspace can be crossed more than once.
+ * Distances are in NM from the start of the line. Entry distance is 0 if the line starts inside. */
+struct AirspaceCrossing
+{
+  const map::MapAirspace *airspace;
+  float entryDistanceNm, exitDistanceNm;
+};
+
+/*
+ * In-memory containment index for all airspaces of the enabled sources.
+ *
+ * Bounding rectangles are kept in a static R-tree which is bulk loaded using sort-tile-recursive packing.
+ * Rectangles crossing the anti-meridian are split into two entries.
+ *
+ * Boundaries are loaded on demand from AirspaceController and converted into polygons with edges sorted into
+ * latitude bands. Point-in-polygon and segment intersection tests then only look at the edges of the bands
+ * touched. Polygons are kept in a cache and dropped together with the tree on rebuild.
+ *
+ * Objects returned by the methods are valid until the next call of build() or clear().
+ */
+class AirspaceIndex
+{
+public:
+  explicit AirspaceIndex(AirspaceController *controllerParam);
+  ~AirspaceIndex();
+
+  /* Build the tree from airspaces without geometry. Removes all previous content. */
+  void build(const QVector<map::MapAirspace>& airspaceList);
+
+  /* Remove all airspaces and polygons */
+  void clear();
+
+  bool isEmpty() const
+  {
+    return airspaces.isEmpty();
+  }
+
+  /* Get airspaces containing the position. altitudeFt is ignored if INVALID_ALTITUDE_VALUE.
+   * Result is sorted by drawing order. */
+  void getAirspacesAtPos(QVector<const map::MapAirspace *>& result, const atools::geo::Pos& pos, float altitudeFt,
+                         map::MapAirspaceTypes types) const;
+
+  /* Get airspaces crossed by the line which is interpolated along great circles. Result is ordered by entry distance.
+   * altitudeFunc returns the altitude in feet for a distance from the start of the line in NM. Crossings are
+   * omitted if the altitude is outside of the airspace at entry, exit and all points between.
+   * Altitude is not checked if the function is empty or returns INVALID_ALTITUDE_VALUE. */
+  void getAirspacesAlongLine(QVector<AirspaceCrossing>& result, const atools::geo::LineString& line,
+                             const std::function<float(float distanceNm)>& altitudeFunc,
+                             map::MapAirspaceTypes types) const;
+
+private:
+  struct Polygon;
+
+  /* Rectangle in degree. west is always less or equal than east. */
+  struct Box
+  {
+    float west, south, east, north;
+
+    bool overlaps(const Box& other) const
+    {
+      return !(other.east < west || other.west > east || other.north < south || other.south > north);
+    }
+
+    void extend(const Box& other)
+    {
+      west = std::min(west, other.west);
+      south = std::min(south, other.south);
+      east = std::max(east, other.east);
+      north = std::max(north, other.north);
+    }
+  };
+
+  /* Leaf nodes refer to entries and all other nodes to child nodes from first to first + count - 1 */
+  struct Node
+  {
+    Box box;
+    int first, count;
+    bool leaf;
+  };
+
+  /* Bounding rectangle or part of it referring to the airspaces list */
+  struct Entry
+  {
+    Box box;
+    int airspaceIndex;
+  };
+
+  /* Line segment in lon/lat not crossing the anti-meridian */
+  struct Segment
+  {
+    QPointF from, to;
+    float startDistanceNm, lengthNm;
+    Box box;
+  };
+
+  /* Sorts items in tiles and appends a parent node for each tile to parents */
+  template<typename TYPE>
+  static void packLevel(QVector<TYPE>& items, QVector<Node>& parents, bool leaf);
+
+  /* Call func with the airspace index for each entry overlapping the box */
+  void search(const Box& box, const std::function<void(int airspaceIndex)>& func) const;
+
+  /* Load polygon from geometry or get it from the cache. Null if geometry is not available or too large. */
+  const Polygon *polygon(int airspaceIndex) const;
+
+  /* Interpolate line and split segments at the anti-meridian */
+  static void buildSegments(QVector<Segment>& segments, const atools::geo::LineString& line);
+
+  /* Add passes of one airspace to result */
+  void crossingsForAirspace(QVector<AirspaceCrossing>& result, int airspaceIndex, const QVector<int>& segmentIndexes,
+                            const QVector<Segment>& segments,
+                            const std::function<float(float distanceNm)>& altitudeFunc) const;
+
+  bool matchesAltitude(int airspaceIndex, float altitudeFt) const;
+
+  AirspaceController *controller;
+
+  QVector<map::MapAirspace> airspaces;
+  QVector<Entry> entries;
+
+  /* Root is the last node */
+  QVector<Node> nodes;
+
+  /* Polygons are loaded on demand from const methods. Cost is the number of points. */
+  mutable QCache<int, Polygon> polygonCache;
+};
+
+#endif // LNM_AIRSPACEINDEX_H
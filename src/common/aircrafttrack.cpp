@@ -24,10 +24,24 @@
 #include <QDataStream>
 #include <QDateTime>
 #include <QFile>
+#include <QPointF>
+
+#include <cmath>
+
+/* Tolerances for the simplified track levels from fine to coarse */
+static const float SIMPLIFY_TOLERANCES_METER[] = {25.f, 100.f, 500.f, 2000.f, 10000.f};
+
+/* Approximate length of one degree latitude */
+static const double METER_PER_DEGREE = 111319.5;
 
 AircraftTrack::AircraftTrack()
 {
-
+  for(float tolerance : SIMPLIFY_TOLERANCES_METER)
+  {
+    SimplifiedLevel level;
+    level.toleranceMeter = tolerance;
+    levels.append(level);
+  }
 }
 
 AircraftTrack::~AircraftTrack()
@@ -67,7 +81,7 @@ void AircraftTrack::saveState()
 
 void AircraftTrack::restoreState()
 {
-  clear();
+  clearTrack();
 
   QFile trackFile(atools::settings::Settings::getConfigFilename(".track"));
   if(trackFile.exists())
@@ -87,13 +101,16 @@ void AircraftTrack::saveToStream(QDataStream& out)
 {
   out.setVersion(QDataStream::Qt_5_5);
   out.setFloatingPointPrecision(QDataStream::SinglePrecision);
-  out << FILE_MAGIC_NUMBER << FILE_VERSION << *this;
+  // Same format as a serialized QList which was used before
+  out << FILE_MAGIC_NUMBER << FILE_VERSION << static_cast<quint32>(buffer.size());
+  for(const at::AircraftTrackPos& trackPos : *this)
+    out << trackPos;
 }
 
 bool AircraftTrack::readFromStream(QDataStream& in)
 {
   bool retval = false;
-  clear();
+  clearTrack();
 
   quint32 magic;
   quint16 version;
@@ -106,8 +123,15 @@ bool AircraftTrack::readFromStream(QDataStream& in)
     in >> version;
     if(version == FILE_VERSION)
     {
-      in >> *this;
-      retval = true;
+      quint32 num;
+      in >> num;
+      for(quint32 i = 0; i < num && in.status() == QDataStream::Ok; i++)
+      {
+        at::AircraftTrackPos trackPos;
+        in >> trackPos;
+        appendInternal(trackPos);
+      }
+      retval = in.status() == QDataStream::Ok;
     }
     else
       qWarning() << "Cannot read track. Invalid version number:" << version;
@@ -120,13 +144,13 @@ bool AircraftTrack::readFromStream(QDataStream& in)
 
 bool AircraftTrack::appendTrackPos(const atools::geo::Pos& pos, const QDateTime& timestamp, bool onGround)
 {
-  bool pruned = false;
+  bool cleared = false;
   // Use a larger distance on ground before storing position
   float epsilon = onGround ? atools::geo::Pos::POS_EPSILON_5M : atools::geo::Pos::POS_EPSILON_100M;
   long timeDiff = onGround ? MIN_POSITION_TIME_DIFF_GROUND_MS : MIN_POSITION_TIME_DIFF_MS;
 
   if(isEmpty())
-    append({pos, timestamp.toTime_t(), onGround});
+    appendInternal({pos, timestamp.toTime_t(), onGround});
   else
   {
     long time = timestamp.toMSecsSinceEpoch();
@@ -136,22 +160,15 @@ bool AircraftTrack::appendTrackPos(const atools::geo::Pos& pos, const QDateTime&
     {
       if(pos.distanceMeterTo(last().pos) > atools::geo::nmToMeter(MAX_POINT_DISTANCE_NM))
       {
-        clear();
-        pruned = true;
+        clearTrack();
+        cleared = true;
       }
-      else
-      {
-        if(size() > maxTrackEntries)
-        {
-          for(int i = 0; i < PRUNE_TRACK_ENTRIES; i++)
-            removeFirst();
-          pruned = true;
-        }
-      }
-      append({pos, timestamp.toTime_t(), onGround});
+
+      // Removes oldest entry if full
+      appendInternal({pos, timestamp.toTime_t(), onGround});
     }
   }
-  return pruned;
+  return cleared;
 }
 
 float AircraftTrack::getMaxAltitude() const
@@ -161,3 +178,210 @@ float AircraftTrack::getMaxAltitude() const
     maxAlt = std::max(maxAlt, trackPos.pos.getAltitude());
   return maxAlt;
 }
+
+void AircraftTrack::clearTrack()
+{
+  buffer.clear();
+  head = 0;
+  firstSequence = 0;
+
+  for(SimplifiedLevel& level : levels)
+  {
+    level.sequences.clear();
+    level.start = 0;
+  }
+}
+
+void AircraftTrack::setMaxTrackEntries(int value)
+{
+  value = std::max(value, 1);
+  if(value == maxTrackEntries)
+    return;
+
+  maxTrackEntries = value;
+
+  if(!buffer.isEmpty())
+  {
+    // Copy entries in order and drop the oldest ones if capacity is smaller now
+    int num = std::min(buffer.size(), maxTrackEntries);
+    int offset = buffer.size() - num;
+
+    QVector<at::AircraftTrackPos> temp;
+    temp.reserve(num);
+    for(int i = offset; i < buffer.size(); i++)
+      temp.append(at(i));
+
+    buffer = temp;
+    head = 0;
+    firstSequence += static_cast<quint64>(offset);
+    rebuildLevels();
+  }
+}
+
+void AircraftTrack::appendInternal(const at::AircraftTrackPos& trackPos)
+{
+  if(buffer.size() < maxTrackEntries)
+    buffer.append(trackPos);
+  else
+  {
+    // Buffer is full - overwrite oldest entry
+    buffer[head] = trackPos;
+    head = (head + 1) % buffer.size();
+    firstSequence++;
+    evictLevels();
+  }
+
+  updateLevels(firstSequence + static_cast<quint64>(buffer.size()) - 1);
+}
+
+void AircraftTrack::updateLevels(quint64 lastSequence)
+{
+  for(SimplifiedLevel& level : levels)
+  {
+    if(level.start >= level.sequences.size())
+      // Empty or all positions evicted - start with the oldest one
+      level.sequences.append(firstSequence);
+
+    // Simplify the open chunk if it is large enough
+    quint64 anchor = level.sequences.last();
+    if(lastSequence - anchor >= SIMPLIFY_CHUNK_SIZE)
+      simplifyChunk(level, anchor, lastSequence);
+  }
+}
+
+void AircraftTrack::evictLevels()
+{
+  for(SimplifiedLevel& level : levels)
+  {
+    while(level.start < level.sequences.size() && level.sequences.at(level.start) < firstSequence)
+      level.start++;
+
+    // Remove unused entries from time to time
+    if(level.start > SIMPLIFY_CHUNK_SIZE * 16 && level.start > level.sequences.size() / 2)
+    {
+      level.sequences.remove(0, level.start);
+      level.start = 0;
+    }
+  }
+}
+
+void AircraftTrack::rebuildLevels()
+{
+  for(SimplifiedLevel& level : levels)
+  {
+    level.sequences.clear();
+    level.start = 0;
+  }
+
+  for(int i = 0; i < buffer.size(); i++)
+    updateLevels(firstSequence + static_cast<quint64>(i));
+}
+
+void AircraftTrack::simplifyChunk(SimplifiedLevel& level, quint64 from, quint64 to) const
+{
+  int num = static_cast<int>(to - from) + 1;
+
+  // Project positions into a local plane in meter around the first position
+  const atools::geo::Pos& origin = posForSequence(from);
+  double cosLat = std::cos(atools::geo::toRadians(static_cast<double>(origin.getLatY())));
+  QVector<QPointF> points(num);
+  for(int i = 0; i < num; i++)
+  {
+    const atools::geo::Pos& pos = posForSequence(from + static_cast<quint64>(i));
+    double lonDiff = static_cast<double>(pos.getLonX() - origin.getLonX());
+    if(lonDiff > 180.)
+      lonDiff -= 360.;
+    else if(lonDiff < -180.)
+      lonDiff += 360.;
+
+    points[i] = QPointF(lonDiff * cosLat * METER_PER_DEGREE,
+                        static_cast<double>(pos.getLatY() - origin.getLatY()) * METER_PER_DEGREE);
+  }
+
+  // Douglas-Peucker using a stack instead of recursion
+  QVector<bool> keep(num, false);
+  keep[0] = keep[num - 1] = true;
+
+  QVector<QPair<int, int> > stack;
+  stack.append(qMakePair(0, num - 1));
+  while(!stack.isEmpty())
+  {
+    QPair<int, int> range = stack.takeLast();
+    const QPointF& p1 = points.at(range.first);
+    const QPointF& p2 = points.at(range.second);
+    QPointF seg = p2 - p1;
+    double segLenSq = QPointF::dotProduct(seg, seg);
+
+    double maxDist = 0.;
+    int maxIndex = -1;
+    for(int i = range.first + 1; i < range.second; i++)
+    {
+      // Distance to segment and not to infinite line to keep loops like holdings
+      QPointF pt = points.at(i);
+      double t = segLenSq > 0. ? atools::minmax(0., 1., QPointF::dotProduct(pt - p1, seg) / segLenSq) : 0.;
+      QPointF diff = pt - (p1 + seg * t);
+      double dist = std::sqrt(QPointF::dotProduct(diff, diff));
+      if(dist > maxDist)
+      {
+        maxDist = dist;
+        maxIndex = i;
+      }
+    }
+
+    if(maxIndex != -1 && maxDist > static_cast<double>(level.toleranceMeter))
+    {
+      keep[maxIndex] = true;
+      stack.append(qMakePair(range.first, maxIndex));
+      stack.append(qMakePair(maxIndex, range.second));
+    }
+  }
+
+  // First position is already in the list
+  for(int i = 1; i < num; i++)
+  {
+    if(keep.at(i))
+      level.sequences.append(from + static_cast<quint64>(i));
+  }
+}
+
+void AircraftTrack::getSimplifiedIndexes(QVector<int>& indexes, float maxToleranceMeter) const
+{
+  indexes.clear();
+  if(buffer.isEmpty())
+    return;
+
+  // Find coarsest level within tolerance
+  const SimplifiedLevel *level = nullptr;
+  for(const SimplifiedLevel& l : levels)
+  {
+    if(l.toleranceMeter <= maxToleranceMeter)
+      level = &l;
+  }
+
+  if(level == nullptr)
+  {
+    // Full resolution
+    indexes.reserve(buffer.size());
+    for(int i = 0; i < buffer.size(); i++)
+      indexes.append(i);
+    return;
+  }
+
+  // Always start with oldest position which might be already evicted from the level
+  indexes.append(0);
+  quint64 lastSequence = firstSequence;
+  for(int i = level->start; i < level->sequences.size(); i++)
+  {
+    quint64 sequence = level->sequences.at(i);
+    if(sequence > lastSequence)
+    {
+      indexes.append(static_cast<int>(sequence - firstSequence));
+      lastSequence = sequence;
+    }
+  }
+
+  // Add open chunk in full resolution
+  quint64 endSequence = firstSequence + static_cast<quint64>(buffer.size());
+  for(quint64 sequence = lastSequence + 1; sequence < endSequence; sequence++)
+    indexes.append(static_cast<int>(sequence - firstSequence));
+}
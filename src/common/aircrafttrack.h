@@ -20,6 +20,8 @@
 
 #include "geo/pos.h"
 
+#include <QVector>
+
 namespace at {
 /* Track position. Can be converted to QVariant and thus be saved to settings */
 struct AircraftTrackPos
@@ -38,10 +40,16 @@ Q_DECLARE_TYPEINFO(at::AircraftTrackPos, Q_PRIMITIVE_TYPE);
 Q_DECLARE_METATYPE(at::AircraftTrackPos);
 
 /*
- * Stores the track of the flight simulator aircraft
+ * Stores the track of the flight simulator aircraft.
+ *
+ * Positions are kept in a ring buffer with fixed capacity. Appending and removing the oldest position if the buffer
+ * is full are O(1) operations.
+ *
+ * Several simplified versions of the track with increasing tolerance are maintained incrementally while appending.
+ * Each new chunk of positions is reduced using the Douglas-Peucker algorithm once it is complete.
+ * Painters can use getSimplifiedIndexes() to get a version suitable for the current zoom distance.
  */
-class AircraftTrack :
-  private QList<at::AircraftTrackPos>
+class AircraftTrack
 {
 public:
   AircraftTrack();
@@ -51,45 +59,156 @@ public:
   void saveState();
   void restoreState();
 
-  void clearTrack()
-  {
-    clear();
-  }
+  void clearTrack();
 
   /*
    * Add a track position. Accurracy depends on the ground flag which will cause more
    * or less points skipped.
-   * @return true if the track was pruned
+   * @return true if the track was cleared since the aircraft jumped too far
    */
   bool appendTrackPos(const atools::geo::Pos& pos, const QDateTime& timestamp, bool onGround);
 
   float getMaxAltitude() const;
 
-  /* Pull only needed methods into public space */
-  using QList::isEmpty;
-  using QList::first;
-  using QList::last;
-  using QList::size;
-  using QList::at;
-  using QList::begin;
-  using QList::end;
-
-  /* Track will be pruned if it contains more track entries than this value. Default is 20000. */
-  void setMaxTrackEntries(int value)
+  bool isEmpty() const
+  {
+    return buffer.isEmpty();
+  }
+
+  int size() const
+  {
+    return buffer.size();
+  }
+
+  /* Index 0 is the oldest position */
+  const at::AircraftTrackPos& at(int index) const
+  {
+    return buffer.at((head + index) % buffer.size());
+  }
+
+  const at::AircraftTrackPos& first() const
+  {
+    return at(0);
+  }
+
+  const at::AircraftTrackPos& last() const
+  {
+    return at(buffer.size() - 1);
+  }
+
+  /* Simple iterator for range based loops from oldest to newest position */
+  class const_iterator
+  {
+public:
+    const_iterator(const AircraftTrack *trackParam, int indexParam)
+      : track(trackParam), index(indexParam)
+    {
+    }
+
+    const at::AircraftTrackPos& operator*() const
+    {
+      return track->at(index);
+    }
+
+    const at::AircraftTrackPos *operator->() const
+    {
+      return &track->at(index);
+    }
+
+    const_iterator& operator++()
+    {
+      index++;
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      return index == other.index && track == other.track;
+    }
+
+    bool operator!=(const const_iterator& other) const
+    {
+      return !operator==(other);
+    }
+
+private:
+    const AircraftTrack *track;
+    int index;
+  };
+
+  const_iterator begin() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const
   {
-    maxTrackEntries = value;
+    return const_iterator(this, buffer.size());
   }
 
+  /* Track capacity. Oldest entries are removed if the track contains more entries than this value.
+   * Default is 20000. */
+  void setMaxTrackEntries(int value);
+
+  /* Get indexes of track positions for a simplified track where no position deviates more than
+   * maxToleranceMeter from the drawn line. Uses full resolution if maxToleranceMeter is smaller than the
+   * smallest simplification level. Indexes are in ascending order and always contain first and last position. */
+  void getSimplifiedIndexes(QVector<int>& indexes, float maxToleranceMeter) const;
+
   /* Write and read the whole track to and from a binary stream */
   void saveToStream(QDataStream& out);
 
   bool readFromStream(QDataStream & in);
 
 private:
-  /* Maximum number of track points. If exceeded entries will be removed from beginning of the list */
+  /* Simplified version of the track for one tolerance */
+  struct SimplifiedLevel
+  {
+    float toleranceMeter;
+
+    /* Sequence numbers of all positions kept after simplification up to the last completed chunk */
+    QVector<quint64> sequences;
+
+    /* Index of the first valid entry in sequences. Entries before were removed from the ring buffer. */
+    int start = 0;
+  };
+
+  /* Add position to ring buffer and update simplified levels */
+  void appendInternal(const at::AircraftTrackPos& trackPos);
+
+  /* Update simplification for newly appended position with the given sequence number */
+  void updateLevels(quint64 lastSequence);
+
+  /* Remove sequences of evicted positions from levels */
+  void evictLevels();
+
+  /* Run Douglas-Peucker on the track range from and including sequence "from" to "to" and add all kept
+   * sequences except the first to the level */
+  void simplifyChunk(SimplifiedLevel& level, quint64 from, quint64 to) const;
+
+  /* Rebuild all levels from the current track */
+  void rebuildLevels();
+
+  /* Position for sequence number */
+  const atools::geo::Pos& posForSequence(quint64 sequence) const
+  {
+    return at(static_cast<int>(sequence - firstSequence)).pos;
+  }
+
+  /* Ring buffer. Grows until maxTrackEntries is reached. Entries are overwritten from head after. */
+  QVector<at::AircraftTrackPos> buffer;
+  int head = 0;
+
+  /* Sequence number of the oldest position. Incremented for each evicted entry. */
+  quint64 firstSequence = 0;
+
+  QVector<SimplifiedLevel> levels;
+
+  /* Maximum number of track points. If exceeded oldest entries will be removed */
   int maxTrackEntries = 20000;
-  /* Number of entries to remove at once */
-  static Q_DECL_CONSTEXPR int PRUNE_TRACK_ENTRIES = 200;
+
+  /* Number of positions which are simplified at once for each level. The open chunk is used in full resolution. */
+  static Q_DECL_CONSTEXPR int SIMPLIFY_CHUNK_SIZE = 64;
 
   /* Minimum time difference between recordings */
   static Q_DECL_CONSTEXPR int MIN_POSITION_TIME_DIFF_MS = 1000;
@@ -263,6 +263,11 @@ const QLatin1Literal OPTIONS_VERSION("Options/Version");
 const QLatin1Literal OPTIONS_NO_USER_AGENT("Options/NoUserAgent");
 const QLatin1Literal OPTIONS_WEATHER_UPDATE("Options/WeatherUpdate");
 const QLatin1Literal OPTIONS_PROFILE_SIMPLYFY("Options/SimplifyProfile");
+const QLatin1Literal OPTIONS_ROUTE_NETWORK_PRELOAD("Options/RouteNetworkPreload");
+const QLatin1Literal OPTIONS_ROUTE_NETWORK_LANDMARKS("Options/RouteNetworkLandmarks");
+const QLatin1Literal OPTIONS_MAP_STATIC_LAYER_CACHE("Options/MapStaticLayerCache");
+const QLatin1Literal OPTIONS_MAP_PAINT_PROFILER("Options/MapPaintProfiler");
+const QLatin1Literal OPTIONS_MAP_PAINT_PROFILER_CSV("Options/MapPaintProfilerCsv");
 
 /* Used to override  default URL */
 const QLatin1Literal OPTIONS_UPDATE_URL("Update/Url");
@@ -18,6 +18,7 @@
 #include "common/elevationprovider.h"
 
 #include "navapp.h"
+#include "common/globemappedreader.h"
 #include "fs/common/globereader.h"
 #include "options/optiondata.h"
 #include "geo/line.h"
@@ -53,9 +54,22 @@ ElevationProvider::ElevationProvider(QObject *parent, const Marble::ElevationMod
 
 ElevationProvider::~ElevationProvider()
 {
+  delete globeMappedReader;
   delete globeReader;
 }
 
+bool ElevationProvider::isGlobeOfflineProvider() const
+{
+  QReadLocker locker(&lock);
+  return isGlobeOfflineProviderInternal();
+}
+
+bool ElevationProvider::isConcurrent() const
+{
+  QReadLocker locker(&lock);
+  return globeMappedReader != nullptr;
+}
+
 void ElevationProvider::marbleUpdateAvailable()
 {
   if(!isGlobeOfflineProvider())
@@ -64,11 +78,19 @@ void ElevationProvider::marbleUpdateAvailable()
 
 float ElevationProvider::getElevationMeter(const atools::geo::Pos& pos)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
 
-  if(isGlobeOfflineProvider())
+  if(isGlobeOfflineProviderInternal())
   {
-    float elevation = globeReader->getElevation(pos);
+    float elevation;
+    if(globeMappedReader != nullptr)
+      elevation = globeMappedReader->getElevation(pos);
+    else
+    {
+      QMutexLocker readerLocker(&globeReaderMutex);
+      elevation = globeReader->getElevation(pos);
+    }
+
     if(!(elevation > atools::fs::common::OCEAN && elevation < atools::fs::common::INVALID))
       return 0.f;
     else
@@ -83,21 +105,18 @@ void ElevationProvider::getElevations(atools::geo::LineString& elevations, const
   if(!line.isValid())
     return;
 
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
 
-  if(isGlobeOfflineProvider())
+  if(isGlobeOfflineProviderInternal())
   {
-    globeReader->getElevations(elevations, LineString(line.getPos1(), line.getPos2()));
-    for(Pos& pos : elevations)
-    {
-      float alt = pos.getAltitude();
-      if(!(alt > atools::fs::common::OCEAN && alt < atools::fs::common::INVALID))
-        // Reset all invalid and ocean indicators to 0
-        pos.setAltitude(0.f);
-    }
+    // Line string method locks again
+    locker.unlock();
+    getElevations(elevations, LineString(line.getPos1(), line.getPos2()));
   }
   else
   {
+    QMutexLocker marbleLocker(&marbleMutex);
+
     // Get altitude points for the line segment
     // The might not be complete and will be more complete on further iterations when we get a signal
     // from the elevation model
@@ -134,11 +153,59 @@ void ElevationProvider::getElevations(atools::geo::LineString& elevations, const
       elevations.append(line.getPos1());
       elevations.append(line.getPos2());
     }
+
+    for(Pos& pos : elevations)
+      // Limit ground altitude
+      pos.setAltitude(std::min(pos.getAltitude(), ALTITUDE_LIMIT_METER));
   }
+}
 
+void ElevationProvider::getElevations(atools::geo::LineString& elevations, const atools::geo::LineString& linestring)
+{
+  if(linestring.size() < 2)
+    return;
+
+  QReadLocker locker(&lock);
+
+  if(globeMappedReader != nullptr)
+  {
+    // Lock free - no need to serialize
+    LineString temp;
+    globeMappedReader->getElevations(temp, linestring);
+    correctElevations(temp);
+    elevations.append(temp);
+  }
+  else if(globeReader != nullptr)
+  {
+    LineString temp;
+    {
+      QMutexLocker readerLocker(&globeReaderMutex);
+      globeReader->getElevations(temp, linestring);
+    }
+    correctElevations(temp);
+    elevations.append(temp);
+  }
+  else
+  {
+    locker.unlock();
+    // Online provider - fetch segment by segment
+    for(int i = 1; i < linestring.size(); i++)
+      getElevations(elevations, Line(linestring.at(i - 1), linestring.at(i)));
+  }
+}
+
+void ElevationProvider::correctElevations(atools::geo::LineString& elevations)
+{
   for(Pos& pos : elevations)
-    // Limit ground altitude
-    pos.setAltitude(std::min(pos.getAltitude(), ALTITUDE_LIMIT_METER));
+  {
+    float alt = pos.getAltitude();
+    if(!(alt > atools::fs::common::OCEAN && alt < atools::fs::common::INVALID))
+      // Reset all invalid and ocean indicators to 0
+      pos.setAltitude(0.f);
+    else
+      // Limit ground altitude
+      pos.setAltitude(std::min(alt, ALTITUDE_LIMIT_METER));
+  }
 }
 
 bool ElevationProvider::isGlobeDirectoryValid(const QString& path) const
@@ -149,9 +216,14 @@ bool ElevationProvider::isGlobeDirectoryValid(const QString& path) const
 
 void ElevationProvider::optionsChanged()
 {
-  // Make sure to wait for other methods to finish before changing the reader
-  QMutexLocker locker(&mutex);
-  updateReader();
+  {
+    // Make sure to wait for other methods to finish before changing the reader
+    QWriteLocker locker(&lock);
+    updateReader();
+  }
+
+  // Emit after unlocking since receivers query the provider
+  emit updateAvailable();
 }
 
 void ElevationProvider::updateReader()
@@ -167,9 +239,22 @@ void ElevationProvider::updateReader()
     }
     else
     {
+      delete globeMappedReader;
+      globeMappedReader = nullptr;
       delete globeReader;
-      globeReader = new GlobeReader(path);
+      globeReader = nullptr;
+
+      // Try memory mapped files first which allows concurrent access
+      globeMappedReader = new GlobeMappedReader(path);
+      if(globeMappedReader->openFiles())
+        qDebug() << Q_FUNC_INFO << "Mapped GLOBE files";
+      else
       {
+        qWarning() << Q_FUNC_INFO << "Cannot map GLOBE files. Falling back to serialized access.";
+        delete globeMappedReader;
+        globeMappedReader = nullptr;
+
+        globeReader = new GlobeReader(path);
         qDebug() << Q_FUNC_INFO << "Opening GLOBE files";
 
         if(!globeReader->openFiles())
@@ -184,9 +269,9 @@ void ElevationProvider::updateReader()
   }
   else
   {
+    delete globeMappedReader;
+    globeMappedReader = nullptr;
     delete globeReader;
     globeReader = nullptr;
   }
-
-  emit updateAvailable();
 }
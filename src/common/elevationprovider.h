@@ -20,6 +20,7 @@
 
 #include <QMutex>
 #include <QObject>
+#include <QReadWriteLock>
 
 namespace Marble {
 class ElevationModel;
@@ -39,10 +40,15 @@ class Line;
 }
 }
 
+class GlobeMappedReader;
+
 /*
  * Wraps the slow Marble online elevation provider and the fast offline GLOBE data provider.
  * Use GLOBE data if all paramters are set properly in settings.
  *
+ * GLOBE files are memory mapped if possible which allows concurrent queries from all threads.
+ * Falls back to the serialized atools GlobeReader if mapping fails.
+ *
  * Class is thread safe.
  */
 class ElevationProvider :
@@ -61,11 +67,15 @@ public:
    * consecutive ones with same elevation. Elevation given in meter */
   void getElevations(atools::geo::LineString& elevations, const atools::geo::Line& line);
 
+  /* Get elevations along all segments of a line string in one call. Same as above but avoids locking and
+   * duplicate points for each segment. Line string must not cross the anti-meridian. */
+  void getElevations(atools::geo::LineString& elevations, const atools::geo::LineString& linestring);
+
   /* true if the data is provided from the fast offline source */
-  bool isGlobeOfflineProvider() const
-  {
-    return globeReader != nullptr;
-  }
+  bool isGlobeOfflineProvider() const;
+
+  /* true if GLOBE files are memory mapped and concurrent calls from several threads do not block each other */
+  bool isConcurrent() const;
 
   /* True if directory is valid and contains at least one valid GLOBE file */
   bool isGlobeDirectoryValid(const QString& path) const;
@@ -81,11 +91,30 @@ private:
   void marbleUpdateAvailable();
   void updateReader();
 
+  /* Same as isGlobeOfflineProvider() but caller has to hold the lock */
+  bool isGlobeOfflineProviderInternal() const
+  {
+    return globeMappedReader != nullptr || globeReader != nullptr;
+  }
+
+  /* Adjust ocean, invalid and too high values */
+  static void correctElevations(atools::geo::LineString& elevations);
+
   const Marble::ElevationModel *marbleModel = nullptr;
+
+  /* Lock free reader used if files can be mapped into memory */
+  GlobeMappedReader *globeMappedReader = nullptr;
+
+  /* Fallback if mapping fails. Not thread safe and protected by globeReaderMutex. */
   atools::fs::common::GlobeReader *globeReader = nullptr;
 
-  /* Need to synchronize here since it is called from profile widget thread */
-  mutable QMutex mutex;
+  /* Need to synchronize here since it is called from profile widget thread. Read locked for all queries
+   * and write locked when changing the readers. */
+  mutable QReadWriteLock lock;
+  mutable QMutex globeReaderMutex;
+
+  /* Marble elevation model is not thread safe */
+  mutable QMutex marbleMutex;
 
 };
 
@@ -0,0 +1,212 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "common/globemappedreader.h"
+
+#include "atools.h"
+#include "fs/common/globereader.h"
+#include "geo/linestring.h"
+#include "geo/pos.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QtEndian>
+
+#include <cmath>
+
+using atools::geo::Pos;
+using atools::geo::LineString;
+
+/* GLOBE files have 10800 columns of 30 arc seconds covering 90 degrees longitude each.
+ * Files are arranged in four latitude bands from north to south with 4 files each (a-d, e-h, i-l and m-p). */
+static const int NUM_TILES = 16;
+static const int NUM_COLUMNS = 10800;
+static const int CELLS_PER_DEGREE = 120;
+static const int BAND_ROWS[4] = {4800, 6000, 6000, 4800};
+static const double BAND_TOP_LAT[4] = {90., 50., 0., -50.};
+
+GlobeMappedReader::GlobeMappedReader(const QString& dataDirParam)
+  : dataDir(dataDirParam)
+{
+}
+
+GlobeMappedReader::~GlobeMappedReader()
+{
+  closeFiles();
+}
+
+bool GlobeMappedReader::openFiles()
+{
+  closeFiles();
+
+  QDir dir(dataDir);
+  for(int i = 0; i < NUM_TILES; i++)
+  {
+    QString name = QString("%1").arg(QChar('a' + i)) + "10g";
+
+    QFile *file = new QFile(dir.filePath(name));
+    if(!file->exists())
+      // Try upper case name
+      file->setFileName(dir.filePath(name.toUpper()));
+    files.append(file);
+
+    qint64 expectedSize = static_cast<qint64>(NUM_COLUMNS) * BAND_ROWS[i / 4] * static_cast<qint64>(sizeof(qint16));
+    if(!file->open(QIODevice::ReadOnly))
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot open" << file->fileName() << file->errorString();
+      closeFiles();
+      return false;
+    }
+
+    if(file->size() != expectedSize)
+    {
+      qWarning() << Q_FUNC_INFO << "Invalid size" << file->size() << "for" << file->fileName();
+      closeFiles();
+      return false;
+    }
+
+    uchar *data = file->map(0, expectedSize);
+    if(data == nullptr)
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot map" << file->fileName() << file->errorString();
+      closeFiles();
+      return false;
+    }
+    tiles.append(reinterpret_cast<const qint16 *>(data));
+  }
+
+  open = true;
+  return true;
+}
+
+void GlobeMappedReader::closeFiles()
+{
+  open = false;
+  tiles.clear();
+
+  // Closing unmaps the memory too
+  for(QFile *file : files)
+    file->close();
+  qDeleteAll(files);
+  files.clear();
+}
+
+int GlobeMappedReader::tileIndex(double lonX, double latY)
+{
+  if(lonX < -180. || lonX > 180. || latY < -90. || latY > 90.)
+    return -1;
+
+  int band;
+  if(latY > BAND_TOP_LAT[1])
+    band = 0;
+  else if(latY > BAND_TOP_LAT[2])
+    band = 1;
+  else if(latY > BAND_TOP_LAT[3])
+    band = 2;
+  else
+    band = 3;
+
+  int column;
+  if(lonX < -90.)
+    column = 0;
+  else if(lonX < 0.)
+    column = 1;
+  else if(lonX < 90.)
+    column = 2;
+  else
+    column = 3;
+
+  return band * 4 + column;
+}
+
+float GlobeMappedReader::cellValue(int tile, double lonX, double latY) const
+{
+  int band = tile / 4;
+  double leftLon = -180. + (tile % 4) * 90.;
+
+  int row = static_cast<int>(std::floor((BAND_TOP_LAT[band] - latY) * CELLS_PER_DEGREE));
+  int col = static_cast<int>(std::floor((lonX - leftLon) * CELLS_PER_DEGREE));
+
+  row = std::max(0, std::min(row, BAND_ROWS[band] - 1));
+  col = std::max(0, std::min(col, NUM_COLUMNS - 1));
+
+  // Files are little endian signed 16 bit values
+  return static_cast<float>(qFromLittleEndian<qint16>(tiles.at(tile) + static_cast<qint64>(row) * NUM_COLUMNS + col));
+}
+
+float GlobeMappedReader::getElevation(const Pos& pos) const
+{
+  if(!open || !pos.isValid())
+    return atools::fs::common::INVALID;
+
+  int tile = tileIndex(pos.getLonX(), pos.getLatY());
+  if(tile == -1)
+    return atools::fs::common::INVALID;
+
+  return cellValue(tile, pos.getLonX(), pos.getLatY());
+}
+
+void GlobeMappedReader::getElevations(LineString& elevations, const LineString& linestring, float intervalMeter) const
+{
+  Pos lastDropped;
+
+  // Add point and drop it if it has the same elevation as the last one
+  auto addPos = [&elevations, &lastDropped](const Pos& pos) -> void
+  {
+    if(!elevations.isEmpty() && atools::almostEqual(elevations.last().getAltitude(), pos.getAltitude()))
+    {
+      lastDropped = pos;
+      return;
+    }
+
+    if(lastDropped.isValid())
+    {
+      // Add last point of a stretch with same elevation
+      elevations.append(lastDropped);
+      lastDropped = Pos();
+    }
+    elevations.append(pos);
+  };
+
+  for(int i = 0; i < linestring.size(); i++)
+  {
+    const Pos& pos2 = linestring.at(i);
+
+    if(i == 0)
+    {
+      addPos(pos2.alt(getElevation(pos2)));
+      continue;
+    }
+
+    const Pos& pos1 = linestring.at(i - 1);
+    float distanceMeter = pos1.distanceMeterTo(pos2);
+    int numPoints = std::max(1, static_cast<int>(std::ceil(distanceMeter / intervalMeter)));
+
+    // Start point was already added by the previous segment
+    for(int j = 1; j < numPoints; j++)
+    {
+      Pos pos = pos1.interpolate(pos2, distanceMeter, static_cast<float>(j) / numPoints);
+      addPos(pos.alt(getElevation(pos)));
+    }
+    addPos(pos2.alt(getElevation(pos2)));
+  }
+
+  if(lastDropped.isValid())
+    // Always keep the last point
+    elevations.append(lastDropped);
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_GLOBEMAPPEDREADER_H
+#define LITTLENAVMAP_GLOBEMAPPEDREADER_H
+
+#include <QString>
+#include <QVector>
+
+class QFile;
+
+namespace atools {
+namespace geo {
+class Pos;
+class LineString;
+}
+}
+
+/*
+ * Read only access to the 16 GLOBE elevation tiles "a10g" to "p10g" which are mapped into memory.
+ *
+ * Decoding is a plain array lookup in the mapped files and the operating system page cache keeps frequently
+ * used parts in memory. No locking is needed since the mapped memory is never changed after openFiles().
+ * All const methods can be called from any thread concurrently.
+ *
+ * Opening can fail if not enough address space is available like on 32-bit systems.
+ * The caller has to fall back to atools::fs::common::GlobeReader in this case.
+ */
+class GlobeMappedReader
+{
+public:
+  explicit GlobeMappedReader(const QString& dataDirParam);
+  ~GlobeMappedReader();
+
+  GlobeMappedReader(const GlobeMappedReader& other) = delete;
+  GlobeMappedReader& operator=(const GlobeMappedReader& other) = delete;
+
+  /* Open and map all files. Returns false if any file is missing, has an unexpected size or cannot be mapped. */
+  bool openFiles();
+  void closeFiles();
+
+  bool isOpen() const
+  {
+    return open;
+  }
+
+  /* Elevation in meter for the nearest GLOBE cell. Returns atools::fs::common::OCEAN for water and
+   * atools::fs::common::INVALID if not open or position not valid. */
+  float getElevation(const atools::geo::Pos& pos) const;
+
+  /* Sample all segments of the line string along great circles with the given interval.
+   * Consecutive points having the same elevation are removed except the first and last of each stretch.
+   * Results are appended to elevations and altitude is set to elevation in meter.
+   * Line string must not cross the anti-meridian. */
+  void getElevations(atools::geo::LineString& elevations, const atools::geo::LineString& linestring,
+                     float intervalMeter = 500.f) const;
+
+private:
+  /* Tile index 0-15 for position or -1 if invalid */
+  static int tileIndex(double lonX, double latY);
+
+  /* Value for cell in tile */
+  float cellValue(int tile, double lonX, double latY) const;
+
+  QString dataDir;
+  QVector<QFile *> files;
+  QVector<const qint16 *> tiles;
+  bool open = false;
+};
+
+#endif // LITTLENAVMAP_GLOBEMAPPEDREADER_H
@@ -0,0 +1,67 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "common/screengrid.h"
+
+ScreenGrid::ScreenGrid(int cellSizePixel)
+  : cellSize(cellSizePixel)
+{
+}
+
+void ScreenGrid::reset(const QRect& screenRect, int margin)
+{
+  rect = screenRect.adjusted(-margin, -margin, margin, margin);
+  columns = std::max(rect.width() / cellSize + 1, 1);
+  rows = std::max(rect.height() / cellSize + 1, 1);
+  entries.clear();
+  cellStart.clear();
+}
+
+void ScreenGrid::clear()
+{
+  rect = QRect();
+  columns = rows = 0;
+  entries.clear();
+  cellStart.clear();
+}
+
+void ScreenGrid::insert(int x, int y, int type, int index)
+{
+  if(rect.contains(x, y))
+    entries.append({x, y, type, index});
+}
+
+void ScreenGrid::finish()
+{
+  // Counting sort by cell index
+  int numCells = columns * rows;
+  cellStart.fill(0, numCells + 1);
+
+  for(const Entry& entry : entries)
+    cellStart[cellY(entry.y) * columns + cellX(entry.x) + 1]++;
+
+  for(int i = 0; i < numCells; i++)
+    cellStart[i + 1] += cellStart.at(i);
+
+  QVector<int> next(cellStart);
+  QVector<Entry> sorted(entries.size());
+  for(const Entry& entry : entries)
+    sorted[next[cellY(entry.y) * columns + cellX(entry.x)]++] = entry;
+
+  entries.swap(sorted);
+}
@@ -0,0 +1,119 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_SCREENGRID_H
+#define LITTLENAVMAP_SCREENGRID_H
+
+#include <QRect>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdlib>
+
+/*
+ * Bucket grid of points in screen coordinates allowing fast lookup of all points near a position.
+ * Each point carries a caller defined type and index which usually refers to a list of map objects.
+ *
+ * Fill the grid by calling reset(), insert() for all points and finish() before calling query().
+ */
+class ScreenGrid
+{
+public:
+  struct Entry
+  {
+    int x, y, type, index;
+  };
+
+  ScreenGrid(int cellSizePixel = 32);
+
+  /* Clear all points and set the covered screen rectangle. Points farther than margin outside
+   * the rectangle are ignored on insert. */
+  void reset(const QRect& screenRect, int margin);
+
+  /* Remove all points and mark grid as empty */
+  void clear();
+
+  /* Add a point. Ignored if outside of the screen rectangle plus margin. */
+  void insert(int x, int y, int type, int index);
+
+  /* Sort points into cells. Has to be called before query(). */
+  void finish();
+
+  /* Call func for all points having a manhattan distance smaller than maxDistance to xs/ys */
+  template<typename FUNC>
+  void query(int xs, int ys, int maxDistance, FUNC func) const;
+
+  int size() const
+  {
+    return entries.size();
+  }
+
+  bool isEmpty() const
+  {
+    return entries.isEmpty();
+  }
+
+private:
+  int cellX(int x) const
+  {
+    return std::min(std::max((x - rect.left()) / cellSize, 0), columns - 1);
+  }
+
+  int cellY(int y) const
+  {
+    return std::min(std::max((y - rect.top()) / cellSize, 0), rows - 1);
+  }
+
+  int cellSize, columns = 0, rows = 0;
+
+  /* Screen rectangle including margin */
+  QRect rect;
+
+  /* Points sorted by cell after finish(). Points for cell i are entries[cellStart[i]] to
+   * entries[cellStart[i + 1] - 1]. */
+  QVector<Entry> entries;
+  QVector<int> cellStart;
+};
+
+Q_DECLARE_TYPEINFO(ScreenGrid::Entry, Q_PRIMITIVE_TYPE);
+
+template<typename FUNC>
+void ScreenGrid::query(int xs, int ys, int maxDistance, FUNC func) const
+{
+  if(cellStart.isEmpty())
+    return;
+
+  int x1 = cellX(xs - maxDistance), x2 = cellX(xs + maxDistance);
+  int y1 = cellY(ys - maxDistance), y2 = cellY(ys + maxDistance);
+
+  for(int cy = y1; cy <= y2; cy++)
+  {
+    for(int cx = x1; cx <= x2; cx++)
+    {
+      int cell = cy * columns + cx;
+      for(int i = cellStart.at(cell); i < cellStart.at(cell + 1); i++)
+      {
+        const Entry& entry = entries.at(i);
+        if(std::abs(entry.x - xs) + std::abs(entry.y - ys) < maxDistance)
+          func(entry);
+      }
+    }
+  }
+}
+
+#endif // LITTLENAVMAP_SCREENGRID_H
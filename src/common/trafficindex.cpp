@@ -0,0 +1,172 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "common/trafficindex.h"
+
+#include <algorithm>
+
+int TrafficIndex::cellX(float lonX)
+{
+  return std::min(std::max(static_cast<int>(std::floor(lonX + 180.f)), 0), CELLS_X - 1);
+}
+
+int TrafficIndex::cellY(float latY)
+{
+  return std::min(std::max(static_cast<int>(std::floor(latY + 90.f)), 0), CELLS_Y - 1);
+}
+
+void TrafficIndex::clear()
+{
+  entries.clear();
+  cells.clear();
+}
+
+void TrafficIndex::beginUpdate()
+{
+  generation++;
+}
+
+void TrafficIndex::updateEntry(int id, const atools::geo::Pos& pos, int index)
+{
+  if(!pos.isValid())
+    // Removed in endUpdate() if present
+    return;
+
+  int newCell = cell(pos);
+  auto it = entries.find(id);
+  if(it == entries.end())
+  {
+    // New aircraft
+    entries.insert(id, {pos, newCell, index, generation});
+    cells[newCell].append(id);
+  }
+  else
+  {
+    Entry& entry = it.value();
+    if(entry.cell != newCell)
+    {
+      // Moved into another cell
+      removeFromCell(entry.cell, id);
+      cells[newCell].append(id);
+      entry.cell = newCell;
+    }
+    entry.pos = pos;
+    entry.index = index;
+    entry.generation = generation;
+  }
+}
+
+void TrafficIndex::endUpdate()
+{
+  // Remove aircraft which were not part of the last update
+  for(auto it = entries.begin(); it != entries.end();)
+  {
+    if(it.value().generation != generation)
+    {
+      removeFromCell(it.value().cell, it.key());
+      it = entries.erase(it);
+    }
+    else
+      ++it;
+  }
+}
+
+void TrafficIndex::removeFromCell(int cellIndex, int id)
+{
+  auto it = cells.find(cellIndex);
+  if(it != cells.end())
+  {
+    it.value().removeOne(id);
+    if(it.value().isEmpty())
+      cells.erase(it);
+  }
+}
+
+bool TrafficIndex::containsAny(const Marble::GeoDataLatLonBox& rect) const
+{
+  if(entries.isEmpty())
+    return false;
+
+  QVector<Range> rangeList = ranges(rect);
+  if(numCells(rangeList) > entries.size())
+  {
+    // Large rectangle - cheaper to check all aircraft
+    for(const Entry& entry : entries)
+    {
+      for(const Range& range : rangeList)
+      {
+        if(range.contains(entry.pos))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  for(const Range& range : rangeList)
+  {
+    for(int cy = cellY(range.south); cy <= cellY(range.north); cy++)
+    {
+      for(int cx = cellX(range.west); cx <= cellX(range.east); cx++)
+      {
+        auto it = cells.constFind(cy * CELLS_X + cx);
+        if(it != cells.constEnd())
+        {
+          for(int id : it.value())
+          {
+            if(range.contains(entries.value(id).pos))
+              return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+int TrafficIndex::numCells(const QVector<Range>& rangeList)
+{
+  int num = 0;
+  for(const Range& range : rangeList)
+    num += (cellX(range.east) - cellX(range.west) + 1) * (cellY(range.north) - cellY(range.south) + 1);
+  return num;
+}
+
+QVector<TrafficIndex::Range> TrafficIndex::ranges(const Marble::GeoDataLatLonBox& rect)
+{
+  float west = static_cast<float>(rect.west(Marble::GeoDataCoordinates::Degree));
+  float east = static_cast<float>(rect.east(Marble::GeoDataCoordinates::Degree));
+  float north = static_cast<float>(rect.north(Marble::GeoDataCoordinates::Degree));
+  float south = static_cast<float>(rect.south(Marble::GeoDataCoordinates::Degree));
+
+  if(rect.crossesDateLine())
+    return {{west, south, 180.f, north}, {-180.f, south, east, north}};
+  else
+    return {{west, south, east, north}};
+}
+
+QVector<TrafficIndex::Range> TrafficIndex::ranges(float west, float south, float east, float north)
+{
+  if(east - west >= 360.f)
+    return {{-180.f, south, 180.f, north}};
+  else if(west < -180.f)
+    return {{west + 360.f, south, 180.f, north}, {-180.f, south, east, north}};
+  else if(east > 180.f)
+    return {{west, south, 180.f, north}, {-180.f, south, east - 360.f, north}};
+  else
+    return {{west, south, east, north}};
+}
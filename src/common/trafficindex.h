@@ -0,0 +1,214 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_TRAFFICINDEX_H
+#define LITTLENAVMAP_TRAFFICINDEX_H
+
+#include "geo/calculations.h"
+#include "geo/pos.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <marble/GeoDataLatLonBox.h>
+
+#include <cmath>
+
+/*
+ * Grid index of AI or online aircraft positions using cells of one degree.
+ * Entries are keyed by aircraft id and refer to the index of the aircraft in the list given to update().
+ *
+ * update() is incremental and changes only cells for aircraft which appeared, vanished or moved into another cell.
+ * Query results are exact and not limited to cells.
+ */
+class TrafficIndex
+{
+public:
+  /* Update index from a list of SimConnectAircraft using getId() as key. Has to be called for each list change
+   * since indexes into the list are stored. */
+  template<typename CONTAINER>
+  void update(const CONTAINER& aircraftList);
+
+  /* Remove all aircraft */
+  void clear();
+
+  /* Call func(int index) for all aircraft inside the rectangle. Considers the anti-meridian. */
+  template<typename FUNC>
+  void queryRect(const Marble::GeoDataLatLonBox& rect, FUNC func) const;
+
+  /* true if at least one aircraft is inside the rectangle */
+  bool containsAny(const Marble::GeoDataLatLonBox& rect) const;
+
+  /* Call func(int index) for all aircraft closer than radiusMeter to pos */
+  template<typename FUNC>
+  void queryRadius(const atools::geo::Pos& pos, float radiusMeter, FUNC func) const;
+
+  int size() const
+  {
+    return entries.size();
+  }
+
+  bool isEmpty() const
+  {
+    return entries.isEmpty();
+  }
+
+private:
+  struct Entry
+  {
+    atools::geo::Pos pos;
+    int cell, index;
+    quint32 generation;
+  };
+
+  /* Longitude ranges in degree. Up to two if crossing the anti-meridian. */
+  struct Range
+  {
+    float west, south, east, north;
+
+    bool contains(const atools::geo::Pos& pos) const
+    {
+      return pos.getLonX() >= west && pos.getLonX() <= east && pos.getLatY() >= south && pos.getLatY() <= north;
+    }
+
+  };
+
+  static const int CELLS_X = 360, CELLS_Y = 180;
+
+  static int cellX(float lonX);
+  static int cellY(float latY);
+
+  static int cell(const atools::geo::Pos& pos)
+  {
+    return cellY(pos.getLatY()) * CELLS_X + cellX(pos.getLonX());
+  }
+
+  /* Start and end an update cycle. endUpdate() removes all aircraft not seen since beginUpdate(). */
+  void beginUpdate();
+  void updateEntry(int id, const atools::geo::Pos& pos, int index);
+  void endUpdate();
+
+  void removeFromCell(int cellIndex, int id);
+
+  /* Number of grid cells touched by the ranges */
+  static int numCells(const QVector<Range>& rangeList);
+
+  /* Split rectangle at the anti-meridian */
+  static QVector<Range> ranges(const Marble::GeoDataLatLonBox& rect);
+  static QVector<Range> ranges(float west, float south, float east, float north);
+
+  /* Call func(const Entry&) for all entries in cells touched by the ranges */
+  template<typename FUNC>
+  void forCandidates(const QVector<Range>& rangeList, FUNC func) const;
+
+  /* Aircraft by id */
+  QHash<int, Entry> entries;
+
+  /* Aircraft ids by cell index */
+  QHash<int, QVector<int> > cells;
+
+  quint32 generation = 0;
+};
+
+template<typename CONTAINER>
+void TrafficIndex::update(const CONTAINER& aircraftList)
+{
+  beginUpdate();
+  for(int i = 0; i < aircraftList.size(); i++)
+    updateEntry(aircraftList.at(i).getId(), aircraftList.at(i).getPosition(), i);
+  endUpdate();
+}
+
+template<typename FUNC>
+void TrafficIndex::forCandidates(const QVector<Range>& rangeList, FUNC func) const
+{
+  // Iterate over all entries if the number of cells exceeds the number of aircraft
+  if(numCells(rangeList) > entries.size())
+  {
+    for(const Entry& entry : entries)
+      func(entry);
+  }
+  else
+  {
+    for(const Range& range : rangeList)
+    {
+      for(int cy = cellY(range.south); cy <= cellY(range.north); cy++)
+      {
+        for(int cx = cellX(range.west); cx <= cellX(range.east); cx++)
+        {
+          auto it = cells.constFind(cy * CELLS_X + cx);
+          if(it != cells.constEnd())
+          {
+            for(int id : it.value())
+              func(entries.value(id));
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename FUNC>
+void TrafficIndex::queryRect(const Marble::GeoDataLatLonBox& rect, FUNC func) const
+{
+  if(entries.isEmpty())
+    return;
+
+  QVector<Range> rangeList = ranges(rect);
+  forCandidates(rangeList, [&rangeList, &func](const Entry& entry)
+  {
+    for(const Range& range : rangeList)
+    {
+      if(range.contains(entry.pos))
+      {
+        func(entry.index);
+        break;
+      }
+    }
+  });
+}
+
+template<typename FUNC>
+void TrafficIndex::queryRadius(const atools::geo::Pos& pos, float radiusMeter, FUNC func) const
+{
+  if(entries.isEmpty() || !pos.isValid())
+    return;
+
+  // Degree of latitude is roughly 111 km
+  float latDelta = radiusMeter / 111120.f;
+  float south = pos.getLatY() - latDelta, north = pos.getLatY() + latDelta;
+
+  QVector<Range> rangeList;
+  if(north >= 90.f || south <= -90.f)
+    // Pole is covered - use all longitudes
+    rangeList = ranges(-180.f, std::max(south, -90.f), 180.f, std::min(north, 90.f));
+  else
+  {
+    float lonDelta = latDelta / std::max(std::cos(atools::geo::toRadians(std::max(std::abs(south),
+                                                                                    std::abs(north)))), 0.01f);
+    rangeList = ranges(pos.getLonX() - lonDelta, south, pos.getLonX() + lonDelta, north);
+  }
+
+  forCandidates(rangeList, [&pos, radiusMeter, &func](const Entry& entry)
+  {
+    if(entry.pos.distanceMeterTo(pos) < radiusMeter)
+      func(entry.index);
+  });
+}
+
+#endif // LITTLENAVMAP_TRAFFICINDEX_H
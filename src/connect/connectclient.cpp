@@ -17,6 +17,7 @@
 
 #include "connect/connectclient.h"
 
+#include "connect/simdatadispatcher.h"
 #include "navapp.h"
 #include "common/constants.h"
 #include "fs/sc/simconnectreply.h"
@@ -64,6 +65,10 @@ ConnectClient::ConnectClient(MainWindow *parent)
   // We were able to connect
   dataReader->setReconnectRateSec(DIRECT_RECONNECT_SEC);
 
+  // Drop pending data on disconnect - connect before all other receivers of disconnectedFromSimulator
+  simDataDispatcher = new SimDataDispatcher(this);
+  connect(this, &ConnectClient::disconnectedFromSimulator, simDataDispatcher, &SimDataDispatcher::clear);
+
   connect(dataReader, &DataReaderThread::postSimConnectData, this, &ConnectClient::postSimConnectData);
   connect(dataReader, &DataReaderThread::postLogMessage, this, &ConnectClient::postLogMessage);
   connect(dataReader, &DataReaderThread::connectedToSimulator, this, &ConnectClient::connectedToSimulatorDirect);
@@ -227,7 +232,10 @@ void ConnectClient::postSimConnectData(atools::fs::sc::SimConnectData dataPacket
   if(NavApp::getOnlinedataController()->isShadowAircraft(userAircraft))
     userAircraft.setFlags(atools::fs::sc::SIM_ONLINE_SHADOW | userAircraft.getFlags());
 
-  emit dataPacketReceived(dataPacket);
+  // Weather replies from Little Navconnect do not carry aircraft and are not needed by subscribers
+  if(dataPacket.getMetars().isEmpty() || dataPacket.getUserAircraftConst().isValid() ||
+     !dataPacket.getAiAircraftConst().isEmpty())
+    simDataDispatcher->postSimData(dataPacket);
 
   if(!dataPacket.getMetars().isEmpty())
   {
@@ -29,6 +29,7 @@
 class QTcpSocket;
 class ConnectDialog;
 class MainWindow;
+class SimDataDispatcher;
 
 namespace atools {
 namespace fs {
@@ -46,7 +47,8 @@ class SimConnectReply;
 }
 
 /*
- * Client for the Little Navconnect Simconnect agent/server. Receives data and passes it around by emitting a signal.
+ * Client for the Little Navconnect Simconnect agent/server. Receives data and passes it to the SimDataDispatcher
+ * which delivers it to all subscribers.
  * Does not use multithreading - runs completely in the event loop.
  */
 class ConnectClient :
@@ -83,11 +85,14 @@ public:
   bool isFetchAiShip() const;
   bool isFetchAiAircraft() const;
 
-signals:
-  /* Emitted when new data was received from the server (Little Navconnect), SimConnect or X-Plane.
-   * can be aircraft position or weather update */
-  void dataPacketReceived(atools::fs::sc::SimConnectData simConnectData);
+  /* Gets all aircraft data received from the server (Little Navconnect), SimConnect or X-Plane.
+   * Use SimDataDispatcher::subscribe() to get updates. */
+  SimDataDispatcher *getSimDataDispatcher() const
+  {
+    return simDataDispatcher;
+  }
 
+signals:
   /* Emitted when a new SimConnect data was received that contains weather data */
   void weatherUpdated();
 
@@ -138,6 +143,7 @@ private:
 
   /* Does automatic reconnect */
   atools::fs::sc::DataReaderThread *dataReader = nullptr;
+  SimDataDispatcher *simDataDispatcher = nullptr;
   atools::fs::sc::SimConnectHandler *simConnectHandler = nullptr;
   atools::fs::sc::XpConnectHandler *xpConnectHandler = nullptr;
 
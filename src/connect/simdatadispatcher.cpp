@@ -0,0 +1,115 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "connect/simdatadispatcher.h"
+
+#include "fs/sc/simconnectdata.h"
+
+#include <QDateTime>
+#include <QDebug>
+
+SimDataDispatcher::SimDataDispatcher(QObject *parent)
+  : QObject(parent)
+{
+  deliveryTimer.setSingleShot(true);
+  connect(&deliveryTimer, &QTimer::timeout, this, &SimDataDispatcher::deliver);
+}
+
+SimDataDispatcher::~SimDataDispatcher()
+{
+  deliveryTimer.stop();
+}
+
+void SimDataDispatcher::subscribe(QObject *receiver, int intervalMs, const SimDataCallback& callback)
+{
+  subscribers.append({receiver, intervalMs, callback, 0L, serial});
+}
+
+void SimDataDispatcher::postSimData(const atools::fs::sc::SimConnectData& simConnectData)
+{
+  // Replace any snapshot not delivered yet - data is copied only once here
+  latestSimData.reset(new atools::fs::sc::SimConnectData(simConnectData));
+  serial++;
+
+  // Deliver with the next event loop iteration and collect all packets arriving until then
+  if(!deliveryTimer.isActive() || deliveryTimer.remainingTime() > 0)
+    deliveryTimer.start(0);
+}
+
+void SimDataDispatcher::clear()
+{
+  deliveryTimer.stop();
+  latestSimData.reset();
+  serial++;
+
+  for(Subscriber& subscriber : subscribers)
+  {
+    subscriber.lastDeliveryMs = 0L;
+    subscriber.lastSerial = serial;
+  }
+}
+
+void SimDataDispatcher::deliver()
+{
+  if(latestSimData.isNull())
+    return;
+
+  // Keep a reference in case a subscriber calls clear() or a new packet arrives
+  QSharedPointer<const atools::fs::sc::SimConnectData> simData = latestSimData;
+  quint64 currentSerial = serial;
+  int nextDeliveryMs = -1;
+
+  for(int i = 0; i < subscribers.size(); i++)
+  {
+    if(latestSimData.isNull())
+      // A subscriber disconnected - do not pass old data to the remaining ones
+      return;
+
+    if(subscribers.at(i).receiver.isNull())
+    {
+      // Receiver was deleted
+      subscribers.removeAt(i--);
+      continue;
+    }
+
+    if(subscribers.at(i).lastSerial == currentSerial)
+      // Already has this snapshot
+      continue;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 remainingMs = subscribers.at(i).lastDeliveryMs + subscribers.at(i).intervalMs - now;
+    if(remainingMs > 0)
+    {
+      // Too early - remember time for the next try
+      if(nextDeliveryMs == -1 || remainingMs < nextDeliveryMs)
+        nextDeliveryMs = static_cast<int>(remainingMs);
+    }
+    else
+    {
+      // Update state before calling since callback might run the event loop
+      subscribers[i].lastDeliveryMs = now;
+      subscribers[i].lastSerial = currentSerial;
+      SimDataCallback callback = subscribers.at(i).callback;
+      callback(*simData);
+    }
+  }
+
+  // Start timer for skipped subscribers if no new packet scheduled a delivery meanwhile
+  if(nextDeliveryMs >= 0 && !deliveryTimer.isActive() && serial == currentSerial)
+    deliveryTimer.start(nextDeliveryMs);
+}
@@ -0,0 +1,100 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_SIMDATADISPATCHER_H
+#define LITTLENAVMAP_SIMDATADISPATCHER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+namespace atools {
+namespace fs {
+namespace sc {
+class SimConnectData;
+}
+}
+}
+
+/*
+ * Central stage for simulator data packets received by the ConnectClient.
+ *
+ * Keeps only the latest packet as a shared read only snapshot. Packets arriving in a burst before the event loop
+ * can deliver them are coalesced and only the latest one is passed on.
+ * Each subscriber is called with its own minimum interval and always gets the latest snapshot. A subscriber
+ * which was skipped due to its interval gets the latest snapshot once the interval has passed.
+ *
+ * Runs completely in the event loop.
+ */
+class SimDataDispatcher :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  typedef std::function<void (const atools::fs::sc::SimConnectData& simConnectData)> SimDataCallback;
+
+  explicit SimDataDispatcher(QObject *parent);
+  virtual ~SimDataDispatcher() override;
+
+  /* Register a callback. Subscribers are called in order of registration. intervalMs is the minimum time
+   * between two calls or 0 to get every coalesced packet. Subscription ends if the receiver is deleted. */
+  void subscribe(QObject *receiver, int intervalMs, const SimDataCallback& callback);
+
+  /* Store packet as latest snapshot and schedule delivery */
+  void postSimData(const atools::fs::sc::SimConnectData& simConnectData);
+
+  /* Latest snapshot or null if nothing was received since last clear */
+  QSharedPointer<const atools::fs::sc::SimConnectData> getLatestSimData() const
+  {
+    return latestSimData;
+  }
+
+  /* Drop snapshot and pending deliveries. Called on disconnect */
+  void clear();
+
+private:
+  struct Subscriber
+  {
+    QPointer<QObject> receiver;
+    int intervalMs;
+    SimDataCallback callback;
+
+    /* Time of last call or 0 */
+    qint64 lastDeliveryMs;
+
+    /* Serial of the last delivered snapshot */
+    quint64 lastSerial;
+  };
+
+  /* Call all subscribers which are due and restart timer for the others */
+  void deliver();
+
+  QVector<Subscriber> subscribers;
+  QSharedPointer<const atools::fs::sc::SimConnectData> latestSimData;
+
+  /* Incremented for each new snapshot */
+  quint64 serial = 0L;
+  QTimer deliveryTimer;
+};
+
+#endif // LITTLENAVMAP_SIMDATADISPATCHER_H
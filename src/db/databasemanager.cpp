@@ -1029,6 +1029,39 @@ void DatabaseManager::closeDatabaseFile(atools::sql::SqlDatabase *db)
   }
 }
 
+atools::sql::SqlDatabase *DatabaseManager::openThreadDatabase(const QString& connectionName, const QString& file,
+                                                             bool readonly)
+{
+  qDebug() << Q_FUNC_INFO << connectionName << file << "readonly" << readonly;
+
+  // Do not use settings here since this can be called from any thread
+  SqlDatabase::addDatabase("QSQLITE", connectionName);
+  SqlDatabase *db = new SqlDatabase(connectionName);
+  db->setDatabaseName(file);
+
+  QStringList pragmas({"PRAGMA cache_size=-20000", "PRAGMA locking_mode=NORMAL", "PRAGMA foreign_keys = OFF"});
+  if(readonly)
+    db->setReadonly();
+  else
+    pragmas.append("PRAGMA busy_timeout=2000");
+
+  db->open(pragmas);
+  return db;
+}
+
+void DatabaseManager::closeThreadDatabase(atools::sql::SqlDatabase *db, const QString& connectionName)
+{
+  qDebug() << Q_FUNC_INFO << connectionName;
+
+  if(db != nullptr)
+  {
+    if(db->isOpen())
+      db->close();
+    delete db;
+  }
+  SqlDatabase::removeDatabase(connectionName);
+}
+
 atools::sql::SqlDatabase *DatabaseManager::getDatabaseSim()
 {
   return databaseSim;
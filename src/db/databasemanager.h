@@ -190,6 +190,16 @@ public:
   /* Create an empty database schema. Boundary option does not use transaction. */
   void createEmptySchema(atools::sql::SqlDatabase *db, bool boundary = false);
 
+  /* Open an additional connection to the given database file for background threads.
+   * Has to be called in the thread using the connection. Connection name has to be unique.
+   * Writeable connections wait for locks held by other connections.
+   * Throws an exception if opening fails. Thread safe. */
+  static atools::sql::SqlDatabase *openThreadDatabase(const QString& connectionName, const QString& file,
+                                                      bool readonly = true);
+
+  /* Close, delete and remove a connection opened by openThreadDatabase in the same thread. Thread safe. */
+  static void closeThreadDatabase(atools::sql::SqlDatabase *db, const QString& connectionName);
+
 signals:
   /* Emitted before opening the scenery database dialog, loading a database or switching to a new simulator database.
    * Recipients have to close all database connections and clear all caches. The database instance itself is not changed
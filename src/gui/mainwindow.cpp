@@ -27,8 +27,10 @@
 #include "fs/common/morareader.h"
 #include "gui/application.h"
 #include "route/routealtitude.h"
+#include "route/routebenchmark.h"
 #include "weather/weatherreporter.h"
 #include "connect/connectclient.h"
+#include "connect/simdatadispatcher.h"
 #include "common/elevationprovider.h"
 #include "db/databasemanager.h"
 #include "gui/dialog.h"
@@ -467,6 +469,14 @@ void MainWindow::debugActionTriggered2()
 
 void MainWindow::debugActionTriggered3()
 {
+  qDebug() << Q_FUNC_INFO;
+
+  // Compare node expansions of great circle and landmark heuristic for a fixed list of airport pairs
+  QGuiApplication::setOverrideCursor(Qt::WaitCursor);
+  RouteBenchmark benchmark(NavApp::getDatabaseNav());
+  benchmark.run();
+  QGuiApplication::restoreOverrideCursor();
+  benchmark.logResults();
 }
 
 #endif
@@ -885,6 +895,7 @@ void MainWindow::connectAllSlots()
   connect(optionsDialog, &OptionsDialog::optionsChanged,
           NavApp::getAircraftPerfController(), &AircraftPerfController::optionsChanged);
   connect(optionsDialog, &OptionsDialog::optionsChanged, this, &MainWindow::saveStateNow);
+  connect(optionsDialog, &OptionsDialog::optionsChanged, NavApp::getWebController(), &WebController::clearTileCache);
 
   // Updated manually in dialog
   // connect(optionsDialog, &OptionsDialog::optionsChanged, NavApp::getWebController(), &WebController::optionsChanged);
@@ -1007,6 +1018,8 @@ void MainWindow::connectAllSlots()
   connect(userdataController, &UserdataController::userdataChanged, infoController,
           &InfoController::updateAllInformation);
   connect(userdataController, &UserdataController::userdataChanged, this, &MainWindow::updateMapObjectsShown);
+  connect(userdataController, &UserdataController::userdataChanged,
+          NavApp::getWebController(), &WebController::clearTileCache);
   connect(userdataController, &UserdataController::refreshUserdataSearch, userSearch, &UserdataSearch::refreshData);
 
   // Map marks, holds, etc.  ===================================================================================
@@ -1017,6 +1030,8 @@ void MainWindow::connectAllSlots()
   LogdataController *logdataController = NavApp::getLogdataController();
   connect(logdataController, &LogdataController::refreshLogSearch, logSearch, &LogdataSearch::refreshData);
   connect(logdataController, &LogdataController::logDataChanged, this, &MainWindow::updateMapObjectsShown);
+  connect(logdataController, &LogdataController::logDataChanged,
+          NavApp::getWebController(), &WebController::clearTileCache);
   connect(logdataController, &LogdataController::logDataChanged, infoController,
           &InfoController::updateAllInformation);
 
@@ -1060,25 +1075,39 @@ void MainWindow::connectAllSlots()
   connect(onlinedataController, &OnlinedataController::onlineNetworkChanged,
           this, &MainWindow::updateOnlineActionStates);
 
-  // Update search
+  // Update search - only tables which changed
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           clientSearch, &OnlineClientSearch::refreshData);
+  connect(onlinedataController, &OnlinedataController::onlineClientUpdated,
+          clientSearch, &OnlineClientSearch::refreshData);
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           centerSearch, &OnlineCenterSearch::refreshData);
+  connect(onlinedataController, &OnlinedataController::onlineAtcUpdated,
+          centerSearch, &OnlineCenterSearch::refreshData);
   connect(onlinedataController, &OnlinedataController::onlineServersUpdated,
           serverSearch, &OnlineServerSearch::refreshData);
 
   // Clear cache and update map widget
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           NavApp::getAirspaceController(), &AirspaceController::onlineClientAndAtcUpdated);
+  connect(onlinedataController, &OnlinedataController::onlineAtcUpdated,
+          NavApp::getAirspaceController(), &AirspaceController::onlineClientAndAtcUpdated);
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           mapWidget, &MapPaintWidget::onlineClientAndAtcUpdated);
+  connect(onlinedataController, &OnlinedataController::onlineAtcUpdated,
+          mapWidget, &MapPaintWidget::onlineClientAndAtcUpdated);
+  connect(onlinedataController, &OnlinedataController::onlineClientUpdated,
+          mapWidget, &MapPaintWidget::onlineClientUpdated);
   connect(onlinedataController, &OnlinedataController::onlineNetworkChanged,
           mapWidget, &MapPaintWidget::onlineNetworkChanged);
 
   // Update info
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           infoController, &InfoController::onlineClientAndAtcUpdated);
+  connect(onlinedataController, &OnlinedataController::onlineClientUpdated,
+          infoController, &InfoController::onlineClientAndAtcUpdated);
+  connect(onlinedataController, &OnlinedataController::onlineAtcUpdated,
+          infoController, &InfoController::onlineClientAndAtcUpdated);
   connect(onlinedataController, &OnlinedataController::onlineNetworkChanged,
           infoController, &InfoController::onlineNetworkChanged);
 
@@ -1086,6 +1115,8 @@ void MainWindow::connectAllSlots()
           NavApp::getAirspaceController(), &AirspaceController::updateButtonsAndActions);
   connect(onlinedataController, &OnlinedataController::onlineClientAndAtcUpdated,
           NavApp::getAirspaceController(), &AirspaceController::updateButtonsAndActions);
+  connect(onlinedataController, &OnlinedataController::onlineAtcUpdated,
+          NavApp::getAirspaceController(), &AirspaceController::updateButtonsAndActions);
 
   connect(clientSearch, &SearchBaseTable::selectionChanged, this, &MainWindow::searchSelectionChanged);
   connect(centerSearch, &SearchBaseTable::selectionChanged, this, &MainWindow::searchSelectionChanged);
@@ -1200,6 +1231,8 @@ void MainWindow::connectAllSlots()
           routeController, static_cast<void (RouteController::*)()>(&RouteController::calculateLowAlt));
   connect(ui->actionRouteCalcSetAlt, &QAction::triggered,
           routeController, static_cast<void (RouteController::*)()>(&RouteController::calculateSetAlt));
+  connect(ui->actionRouteCalcAlternatives, &QAction::triggered, routeController,
+          &RouteController::calculateAlternatives);
   connect(ui->actionRouteReverse, &QAction::triggered, routeController, &RouteController::reverseRoute);
 
   connect(ui->actionRouteCopyString, &QAction::triggered, routeController, &RouteController::routeStringToClipboard);
@@ -1415,19 +1448,39 @@ void MainWindow::connectAllSlots()
   ConnectClient *connectClient = NavApp::getConnectClient();
   connect(ui->actionConnectSimulator, &QAction::triggered, connectClient, &ConnectClient::connectToServerDialog);
 
+  // Subscribers get the latest simulator data not more often than the given interval
   // Deliver first to route controller to update active leg and distances
-  connect(connectClient, &ConnectClient::dataPacketReceived, routeController, &RouteController::simDataChanged);
+  SimDataDispatcher *simDataDispatcher = connectClient->getSimDataDispatcher();
+  simDataDispatcher->subscribe(routeController, RouteController::SIM_UPDATE_INTERVAL_MS,
+                               [this](const atools::fs::sc::SimConnectData& data)
+  {
+    routeController->simDataChanged(data);
+  });
 
-  connect(connectClient, &ConnectClient::dataPacketReceived, mapWidget, &MapWidget::simDataChanged);
-  connect(connectClient, &ConnectClient::dataPacketReceived, profileWidget, &ProfileWidget::simDataChanged);
-  connect(connectClient, &ConnectClient::dataPacketReceived, infoController, &InfoController::simDataChanged);
+  // Map, profile and performance collect all packets for track, takeoff detection and averaging
+  simDataDispatcher->subscribe(mapWidget, 0, [this](const atools::fs::sc::SimConnectData& data)
+  {
+    mapWidget->simDataChanged(data);
+  });
+  simDataDispatcher->subscribe(profileWidget, 0, [this](const atools::fs::sc::SimConnectData& data)
+  {
+    profileWidget->simDataChanged(data);
+  });
+  simDataDispatcher->subscribe(infoController, InfoController::SIM_UPDATE_INTERVAL_MS,
+                               [this](const atools::fs::sc::SimConnectData& data)
+  {
+    infoController->simDataChanged(data);
+  });
 
   connect(connectClient, &ConnectClient::connectedToSimulator,
           NavApp::getAircraftPerfController(), &AircraftPerfController::updateReports);
   connect(connectClient, &ConnectClient::disconnectedFromSimulator,
           NavApp::getAircraftPerfController(), &AircraftPerfController::updateReports);
-  connect(connectClient, &ConnectClient::dataPacketReceived,
-          NavApp::getAircraftPerfController(), &AircraftPerfController::simDataChanged);
+  AircraftPerfController *perfController = NavApp::getAircraftPerfController();
+  simDataDispatcher->subscribe(perfController, 0, [perfController](const atools::fs::sc::SimConnectData& data)
+  {
+    perfController->simDataChanged(data);
+  });
 
   connect(connectClient, &ConnectClient::disconnectedFromSimulator, routeController,
           &RouteController::disconnectedFromSimulator);
@@ -3393,6 +3446,7 @@ void MainWindow::updateActionStates()
   ui->actionRouteCalcHighAlt->setEnabled(canCalcRoute);
   ui->actionRouteCalcLowAlt->setEnabled(canCalcRoute);
   ui->actionRouteCalcSetAlt->setEnabled(canCalcRoute && ui->spinBoxRouteAlt->value() > 0);
+  ui->actionRouteCalcAlternatives->setEnabled(canCalcRoute);
   ui->actionRouteReverse->setEnabled(canCalcRoute);
 
   ui->actionMapShowHome->setEnabled(mapWidget->getHomePos().isValid());
@@ -3906,6 +3960,7 @@ void MainWindow::postDatabaseLoad(atools::fs::FsPaths::SimulatorType type)
     infoController->postDatabaseLoad();
     weatherReporter->postDatabaseLoad(type);
     windReporter->postDatabaseLoad(type);
+    NavApp::getWebController()->clearTileCache();
 
     // U actions for flight simulator database switch in main menu
     NavApp::getDatabaseManager()->insertSimSwitchActions();
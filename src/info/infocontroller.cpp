@@ -1159,32 +1159,27 @@ void InfoController::updateAiAircraftText()
     ui->textBrowserAircraftAiInfo->clear();
 }
 
-void InfoController::simDataChanged(atools::fs::sc::SimConnectData data)
+void InfoController::simDataChanged(const atools::fs::sc::SimConnectData& data)
 {
   if(databaseLoadStatus)
     return;
 
   Ui::MainWindow *ui = NavApp::getMainUi();
 
-  if(atools::almostNotEqual(QDateTime::currentDateTime().toMSecsSinceEpoch(),
-                            lastSimUpdate, static_cast<qint64>(MIN_SIM_UPDATE_TIME_MS)))
-  {
-    // Last update was more than 500 ms ago
-    updateAiAirports(data);
+  // Called not more often than every 500 ms by the SimDataDispatcher
+  updateAiAirports(data);
 
-    lastSimData = data;
-    if(data.getUserAircraftConst().isValid() && ui->dockWidgetAircraft->isVisible())
-    {
-      if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_USER)
-        updateUserAircraftText();
+  lastSimData = data;
+  if(data.getUserAircraftConst().isValid() && ui->dockWidgetAircraft->isVisible())
+  {
+    if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_USER)
+      updateUserAircraftText();
 
-      if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_USER_PROGRESS)
-        updateAircraftProgressText();
+    if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_USER_PROGRESS)
+      updateAircraftProgressText();
 
-      if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_AI)
-        updateAiAircraftText();
-    }
-    lastSimUpdate = QDateTime::currentDateTime().toMSecsSinceEpoch();
+    if(tabHandlerAircraft->getCurrentTabId() == ic::AIRCRAFT_AI)
+      updateAiAircraftText();
   }
 
   if(atools::almostNotEqual(QDateTime::currentDateTime().toMSecsSinceEpoch(),
@@ -1243,7 +1238,6 @@ void InfoController::disconnectedFromSimulator()
 {
   qDebug() << Q_FUNC_INFO;
   lastSimData = atools::fs::sc::SimConnectData();
-  lastSimUpdate = 0;
   updateAircraftInfo();
 }
 
@@ -86,8 +86,11 @@ public:
 
   void styleChanged();
 
+  /* Do not update aircraft progress more than every 0.5 seconds. Used for the SimDataDispatcher subscription. */
+  static Q_DECL_CONSTEXPR int SIM_UPDATE_INTERVAL_MS = 500;
+
   /* Update aircraft and aircraft progress tab */
-  void simDataChanged(atools::fs::sc::SimConnectData data);
+  void simDataChanged(const atools::fs::sc::SimConnectData& data);
   void connectedToSimulator();
   void disconnectedFromSimulator();
 
@@ -109,9 +112,6 @@ signals:
   void showRect(const atools::geo::Rect& rect, bool doubleClick);
 
 private:
-  /* Do not update aircraft progress more than every 0.5 seconds */
-  static Q_DECL_CONSTEXPR int MIN_SIM_UPDATE_TIME_MS = 500;
-
   /* Bearing update in information window time limit */
   static Q_DECL_CONSTEXPR int MIN_SIM_UPDATE_BEARING_TIME_MS = 1000;
 
@@ -141,7 +141,6 @@ private:
 
   bool databaseLoadStatus = false;
   atools::fs::sc::SimConnectData lastSimData;
-  qint64 lastSimUpdate = 0;
   qint64 lastSimBearingUpdate = 0;
 
   /* Airport and navaids that are currently shown in the tabs */
@@ -18,6 +18,7 @@
 #include "mapgui/mappaintwidget.h"
 
 #include "navapp.h"
+#include "atools.h"
 #include "mappainter/mappaintlayer.h"
 #include "mapgui/mapscale.h"
 #include "common/maptools.h"
@@ -27,9 +28,11 @@
 #include "common/unit.h"
 #include "common/aircrafttrack.h"
 #include "mapgui/aprongeometrycache.h"
+#include "query/mapquery.h"
 
 #include <QPainter>
 #include <QJsonDocument>
+#include <QDateTime>
 
 #include <marble/MarbleLocale.h>
 #include <marble/MarbleModel.h>
@@ -42,6 +45,16 @@ const float POS_IS_POINT_EPSILON = 0.0001f;
 const static double MINIMUM_DISTANCE_KM = 0.1;
 const static double MAXIMUM_DISTANCE_KM = 6000.;
 
+/* Predict view this time ahead when panning or zooming */
+const static double PREFETCH_PAN_LOOKAHEAD_MS = 1000.;
+
+/* Ignore movement if last paint event is older */
+const static qint64 PREFETCH_PAN_MAX_INTERVAL_MS = 1000L;
+
+/* Predict aircraft position this time ahead */
+const static float PREFETCH_AIRCRAFT_LOOKAHEAD_S = 120.f;
+const static qint64 PREFETCH_AIRCRAFT_INTERVAL_MS = 2000L;
+
 using namespace Marble;
 using atools::geo::Rect;
 using atools::geo::Pos;
@@ -222,11 +235,13 @@ void MapPaintWidget::optionsChanged()
 
   // reloadMap();
   updateCacheSizes();
+  paintLayer->invalidateStaticLayers();
   update();
 }
 
 void MapPaintWidget::styleChanged()
 {
+  paintLayer->invalidateStaticLayers();
   update();
 }
 
@@ -255,7 +270,11 @@ void MapPaintWidget::setShowMapSunShading(bool show)
 void MapPaintWidget::weatherUpdated()
 {
   if(paintLayer->getShownMapObjects() | map::AIRPORT_WEATHER)
+  {
+    // Weather symbols are drawn by the airport painter
+    paintLayer->invalidateStaticLayers();
     update();
+  }
 }
 
 void MapPaintWidget::windUpdated()
@@ -746,6 +765,9 @@ void MapPaintWidget::routeAltitudeChanged(float altitudeFeet)
 
   qDebug() << Q_FUNC_INFO;
   screenIndex->updateAirspaceScreenGeometry(getCurrentViewBoundingBox());
+
+  // Airspaces are filtered by cruise altitude
+  paintLayer->invalidateStaticLayers();
   update();
 }
 
@@ -1016,6 +1038,11 @@ const QVector<atools::fs::sc::SimConnectAircraft>& MapPaintWidget::getAiAircraft
   return screenIndex->getAiAircraft();
 }
 
+const TrafficIndex& MapPaintWidget::getAiAircraftIndex() const
+{
+  return screenIndex->getAiAircraftIndex();
+}
+
 void MapPaintWidget::resizeEvent(QResizeEvent *event)
 {
   if(!visibleWidget)
@@ -1076,6 +1103,12 @@ void MapPaintWidget::paintEvent(QPaintEvent *paintEvent)
 
   MarbleWidget::paintEvent(paintEvent);
 
+  // Cache contents or screen positions might have changed
+  screenIndex->resetNearestScreenGrid();
+
+  if(visibleWidget)
+    prefetchMovedView(visibleLatLonBox);
+
   if(changed)
   {
     // Major change - update index and visible objects
@@ -1087,6 +1120,82 @@ void MapPaintWidget::paintEvent(QPaintEvent *paintEvent)
     emit resultTruncated(paintLayer->getOverflow());
 }
 
+/* Normalize longitude to -180 to 180 degree */
+static double normalizeLonDeg(double lonX)
+{
+  while(lonX > 180.)
+    lonX -= 360.;
+  while(lonX < -180.)
+    lonX += 360.;
+  return lonX;
+}
+
+/* Move box center by given degrees and scale width and height */
+static GeoDataLatLonBox moveBox(const GeoDataLatLonBox& box, double deltaLonX, double deltaLatY, double scale)
+{
+  const GeoDataCoordinates center = box.center();
+  double lonX = center.longitude(GeoDataCoordinates::Degree) + deltaLonX;
+  double latY = center.latitude(GeoDataCoordinates::Degree) + deltaLatY;
+  double halfWidth = box.width(GeoDataCoordinates::Degree) * scale / 2.;
+  double halfHeight = box.height(GeoDataCoordinates::Degree) * scale / 2.;
+
+  double north = std::min(latY + halfHeight, 90.), south = std::max(latY - halfHeight, -90.);
+  if(halfWidth >= 180.)
+    return GeoDataLatLonBox(north, south, 180., -180., GeoDataCoordinates::Degree);
+  else
+    return GeoDataLatLonBox(north, south, normalizeLonDeg(lonX + halfWidth), normalizeLonDeg(lonX - halfWidth),
+                            GeoDataCoordinates::Degree);
+}
+
+void MapPaintWidget::prefetchMovedView(const GeoDataLatLonBox& box)
+{
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  const GeoDataCoordinates boxCenter = box.center();
+  Pos center(boxCenter.longitude(GeoDataCoordinates::Degree), boxCenter.latitude(GeoDataCoordinates::Degree));
+  double width = box.width(GeoDataCoordinates::Degree);
+  qint64 elapsedMs = now - prefetchLastMs;
+
+  if(prefetchLastCenter.isValid() && elapsedMs > 0L && elapsedMs < PREFETCH_PAN_MAX_INTERVAL_MS &&
+     width > 0. && prefetchLastWidth > 0.)
+  {
+    // Extrapolate pan and zoom speed since last paint event
+    double factor = PREFETCH_PAN_LOOKAHEAD_MS / elapsedMs;
+    double deltaLonX = normalizeLonDeg(center.getLonX() - prefetchLastCenter.getLonX()) * factor;
+    double deltaLatY = static_cast<double>(center.getLatY() - prefetchLastCenter.getLatY()) * factor;
+    double scale = atools::minmax(0.5, 2., std::pow(width / prefetchLastWidth, factor));
+
+    // Ignore small movements
+    if(std::abs(deltaLonX) > width * 0.05 || std::abs(deltaLatY) > box.height(GeoDataCoordinates::Degree) * 0.05 ||
+       std::abs(scale - 1.) > 0.05)
+      prefetchView(moveBox(box, deltaLonX, deltaLatY, scale));
+  }
+
+  prefetchLastCenter = center;
+  prefetchLastWidth = width;
+  prefetchLastMs = now;
+}
+
+void MapPaintWidget::prefetchAircraftView(const Pos& pos, float trackDegTrue, float groundSpeedKts)
+{
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  if(!pos.isValid() || groundSpeedKts < 30.f || now - prefetchLastAircraftMs < PREFETCH_AIRCRAFT_INTERVAL_MS)
+    return;
+
+  prefetchLastAircraftMs = now;
+
+  // Move view by the distance the aircraft will fly
+  Pos next = pos.endpoint(atools::geo::nmToMeter(groundSpeedKts * PREFETCH_AIRCRAFT_LOOKAHEAD_S / 3600.f),
+                          trackDegTrue).normalize();
+  prefetchView(moveBox(getCurrentViewBoundingBox(), normalizeLonDeg(next.getLonX() - pos.getLonX()),
+                       next.getLatY() - pos.getLatY(), 1.));
+}
+
+void MapPaintWidget::prefetchView(const GeoDataLatLonBox& box)
+{
+  if(!databaseLoadStatus)
+    NavApp::getMapQuery()->prefetch(box, paintLayer->getMapLayer(), getShownMapFeatures());
+}
+
 bool MapPaintWidget::loadKml(const QString& filename, bool center)
 {
   if(QFile::exists(filename))
@@ -1103,6 +1212,13 @@ bool MapPaintWidget::loadKml(const QString& filename, bool center)
 void MapPaintWidget::onlineClientAndAtcUpdated()
 {
   screenIndex->updateAirspaceScreenGeometry(currentViewBoundingBox);
+  paintLayer->invalidateStaticLayers();
+  update();
+}
+
+void MapPaintWidget::onlineClientUpdated()
+{
+  // Online aircraft are not part of the static layer cache
   update();
 }
 
@@ -1110,5 +1226,6 @@ void MapPaintWidget::onlineNetworkChanged()
 {
   screenIndex->resetAirspaceOnlineScreenGeometry();
   screenIndex->updateAirspaceScreenGeometry(currentViewBoundingBox);
+  paintLayer->invalidateStaticLayers();
   update();
 }
@@ -43,6 +43,7 @@ struct MapProcedureLegs;
 }
 
 class AircraftTrack;
+class TrafficIndex;
 
 /*
  * Contains all functions to draw a map including background, flight plan, navaids and whatnot.
@@ -190,6 +191,9 @@ public:
   /* AI aircraft as shown on the map */
   const QVector<atools::fs::sc::SimConnectAircraft>& getAiAircraft() const;
 
+  /* Grid index for AI aircraft. Values are indexes into getAiAircraft(). */
+  const TrafficIndex& getAiAircraftIndex() const;
+
   /* Get currently loaded KML file paths */
   const QStringList& getKmlFiles() const
   {
@@ -199,6 +203,9 @@ public:
   /* Update indexes for online network changes */
   void onlineClientAndAtcUpdated();
 
+  /* Only online clients changed - centers and their screen indexes are still valid */
+  void onlineClientUpdated();
+
   /* Whole online network has changed */
   void onlineNetworkChanged();
 
@@ -311,7 +318,8 @@ signals:
   /* Update action state in main window (disabled/enabled) */
   void updateActionStates();
 
-  /* Aircraft track was pruned and needs to be updated */
+  /* Aircraft track was cleared after a large jump and needs to be updated. Not sent when the oldest
+   * positions are dropped from the full track. */
   void aircraftTrackPruned();
 
   void shownMapFeaturesChanged(map::MapObjectTypes types);
@@ -349,6 +357,9 @@ protected:
   /* Set cache size from option data */
   void updateCacheSizes();
 
+  /* Load map objects in the background for the current view moved along the aircraft track */
+  void prefetchAircraftView(const atools::geo::Pos& pos, float trackDegTrue, float groundSpeedKts);
+
   /* Overrides for MapWidget with empty implementation that are used to update GUI elements ================ */
   /* Show or hide overlays depending on menu state - default is all off */
   virtual void overlayStateFromMenu();
@@ -445,12 +456,21 @@ private:
   virtual void paintEvent(QPaintEvent *paintEvent) override;
   virtual void resizeEvent(QResizeEvent *event) override;
 
+  /* Load map objects in the background for the view predicted from the last pan and zoom movement */
+  void prefetchMovedView(const Marble::GeoDataLatLonBox& box);
+  void prefetchView(const Marble::GeoDataLatLonBox& box);
+
   /* Keeps geographical objects as index in screen coordinates */
   MapScreenIndex *screenIndex = nullptr;
 
   /* Current zoom value (NOT distance) */
   int currentZoom = -1;
 
+  /* Values from last paint event and sim update used to predict the view for prefetching */
+  atools::geo::Pos prefetchLastCenter;
+  double prefetchLastWidth = 0.;
+  qint64 prefetchLastMs = 0L, prefetchLastAircraftMs = 0L;
+
   /* Avoids dark background when printing in night mode */
   bool printing = false;
 
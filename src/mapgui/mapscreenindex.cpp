@@ -65,6 +65,7 @@ void MapScreenIndex::copy(const MapScreenIndex& other)
 {
   simData = other.simData;
   lastSimData = other.lastSimData;
+  aiAircraftIndex = other.aiAircraftIndex;
   searchHighlights = other.searchHighlights;
   approachLegHighlights = other.approachLegHighlights;
   approachHighlight = other.approachHighlight;
@@ -84,6 +85,21 @@ void MapScreenIndex::copy(const MapScreenIndex& other)
   routePoints = other.routePoints;
 }
 
+void MapScreenIndex::clearUserMarksAndHighlights()
+{
+  searchHighlights = map::MapSearchResult();
+  approachLegHighlights = proc::MapProcedureLeg();
+  approachHighlight = proc::MapProcedureLegs();
+  airspaceHighlights.clear();
+  airwayHighlights.clear();
+  profileHighlight = atools::geo::EMPTY_POS;
+  routeHighlights.clear();
+  rangeMarks.clear();
+  distanceMarks.clear();
+  trafficPatterns.clear();
+  holds.clear();
+}
+
 void MapScreenIndex::updateAirspaceScreenGeometryInternal(QSet<map::MapAirspaceId>& ids, map::MapAirspaceSources source,
                                                           const Marble::GeoDataLatLonBox& curBox, bool highlights)
 {
@@ -482,6 +498,47 @@ void MapScreenIndex::updateRouteScreenGeometry(const Marble::GeoDataLatLonBox& c
   }
 }
 
+bool MapScreenIndex::nearestCircle(const CoordinateConverter& conv, int xs, int ys, int maxDistance,
+                                   atools::geo::Pos& center, float& radiusMeter) const
+{
+  center = conv.sToW(xs, ys);
+  if(!center.isValid())
+    return false;
+
+  radiusMeter = 0.f;
+  for(const QPoint& corner : {QPoint(xs - maxDistance, ys - maxDistance), QPoint(xs + maxDistance, ys - maxDistance),
+                              QPoint(xs - maxDistance, ys + maxDistance), QPoint(xs + maxDistance, ys + maxDistance)})
+  {
+    atools::geo::Pos pos = conv.sToW(corner);
+    if(!pos.isValid())
+      // Corner is off the globe
+      return false;
+
+    radiusMeter = std::max(radiusMeter, center.distanceMeterTo(pos));
+  }
+
+  // Add margin for projection distortion
+  radiusMeter = radiusMeter * 1.1f + 1.f;
+  return true;
+}
+
+void MapScreenIndex::updateNearestScreenGrid(const CoordinateConverter& conv, const MapLayer *mapLayer,
+                                             bool airportDiagram, map::MapObjectTypes types) const
+{
+  quint32 generation = mapQuery->getScreenCacheGeneration();
+  if(!nearestGridValid || nearestGridLayer != mapLayer || nearestGridAirportDiagram != airportDiagram ||
+     nearestGridTypes != types || nearestGridGeneration != generation)
+  {
+    mapQuery->updateScreenGrid(nearestGrid, conv, mapPaintWidget->rect(), mapLayer, airportDiagram, types);
+
+    nearestGridValid = true;
+    nearestGridLayer = mapLayer;
+    nearestGridAirportDiagram = airportDiagram;
+    nearestGridTypes = types;
+    nearestGridGeneration = generation;
+  }
+}
+
 void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSearchResult& result,
                                    map::MapObjectQueryTypes types) const
 {
@@ -509,13 +566,33 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
   // Check for AI / multiplayer aircraft from simulator ==============================
   int x, y;
 
+  // Use grid indexes to get only AI and online aircraft near the cursor if all corners are visible
+  atools::geo::Pos nearestCenter;
+  float nearestRadiusMeter = 0.f;
+  bool useIndex = nearestCircle(conv, xs, ys, maxDistance, nearestCenter, nearestRadiusMeter);
+
+  const QVector<atools::fs::sc::SimConnectAircraft>& aiAircraft = simData.getAiAircraftConst();
+  auto forNearestAi = [&](const auto& func)
+  {
+    if(useIndex)
+      aiAircraftIndex.queryRadius(nearestCenter, nearestRadiusMeter, [&](int index)
+      {
+        func(aiAircraft.at(index));
+      });
+    else
+    {
+      for(const atools::fs::sc::SimConnectAircraft& obj : aiAircraft)
+        func(obj);
+    }
+  };
+
   // Add boats ======================================
   result.aiAircraft.clear();
   if(NavApp::isConnected())
   {
     if(shown & map::AIRCRAFT_AI_SHIP && mapLayer->isAiShipLarge())
     {
-      for(const atools::fs::sc::SimConnectAircraft& obj : simData.getAiAircraftConst())
+      forNearestAi([&](const atools::fs::sc::SimConnectAircraft& obj)
       {
         if(obj.getCategory() == atools::fs::sc::BOAT &&
            (obj.getModelRadiusCorrected() * 2 > layer::LARGE_SHIP_SIZE || mapLayer->isAiShipSmall()))
@@ -524,7 +601,7 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
             if((atools::geo::manhattanDistance(x, y, xs, ys)) < maxDistance)
               insertSortedByDistance(conv, result.aiAircraft, nullptr, xs, ys, obj);
         }
-      }
+      });
     }
   }
 
@@ -533,7 +610,7 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
     // Add AI or injected multiplayer aircraft ======================================
     if(NavApp::isConnected() || mapPaintWidget->getUserAircraft().isDebug())
     {
-      for(const atools::fs::sc::SimConnectAircraft& obj : mapPaintWidget->getAiAircraft())
+      forNearestAi([&](const atools::fs::sc::SimConnectAircraft& obj)
       {
         if(obj.getCategory() != atools::fs::sc::BOAT && mapfunc::aircraftVisible(obj, mapLayer))
         {
@@ -550,11 +627,13 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
             }
           }
         }
-      }
+      });
     }
 
     // Add online clients ======================================
-    for(const atools::fs::sc::SimConnectAircraft& obj : *NavApp::getOnlinedataController()->getAircraftFromCache())
+    OnlinedataController *onlinedataController = NavApp::getOnlinedataController();
+    const QList<atools::fs::sc::SimConnectAircraft>& onlineAircraft = *onlinedataController->getAircraftFromCache();
+    auto addOnline = [&](const atools::fs::sc::SimConnectAircraft& obj)
     {
       if(mapfunc::aircraftVisible(obj, mapLayer))
       {
@@ -562,6 +641,17 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
           if((atools::geo::manhattanDistance(x, y, xs, ys)) < maxDistance)
             insertSortedByDistance(conv, result.onlineAircraft, &result.onlineAircraftIds, xs, ys, obj);
       }
+    };
+
+    if(useIndex)
+      onlinedataController->getAircraftIndexFromCache().queryRadius(nearestCenter, nearestRadiusMeter, [&](int index)
+      {
+        addOnline(onlineAircraft.at(index));
+      });
+    else
+    {
+      for(const atools::fs::sc::SimConnectAircraft& obj : onlineAircraft)
+        addOnline(obj);
     }
   }
 
@@ -585,9 +675,10 @@ void MapScreenIndex::getAllNearest(int xs, int ys, int maxDistance, map::MapSear
   getNearestHighlights(xs, ys, maxDistance, result, types);
 
   // Get objects from cache - already present objects will be skipped
-  mapQuery->getNearestScreenObjects(conv, mapLayer, mapLayerEffective->isAirportDiagram(),
-                                    shown & (map::AIRPORT_ALL | map::VOR | map::NDB | map::WAYPOINT | map::MARKER |
-                                             map::AIRWAYJ | map::AIRWAYV | map::USERPOINT | map::LOGBOOK),
+  map::MapObjectTypes cacheTypes = shown & (map::AIRPORT_ALL | map::VOR | map::NDB | map::WAYPOINT | map::MARKER |
+                                            map::AIRWAYJ | map::AIRWAYV | map::USERPOINT | map::LOGBOOK);
+  updateNearestScreenGrid(conv, mapLayer, mapLayerEffective->isAirportDiagram(), cacheTypes);
+  mapQuery->getNearestScreenObjects(conv, nearestGrid, mapLayer, mapLayerEffective->isAirportDiagram(), cacheTypes,
                                     xs, ys, maxDistance, result);
 
   // Update all incomplete objects, especially from search
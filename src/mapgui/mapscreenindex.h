@@ -21,6 +21,8 @@
 #include "fs/sc/simconnectdata.h"
 
 #include "route/route.h"
+#include "common/screengrid.h"
+#include "common/trafficindex.h"
 
 namespace map {
 struct MapSearchResult;
@@ -34,6 +36,7 @@ class GeoDataLatLonBox;
 class MapPaintWidget;
 class AirportQuery;
 class MapPaintLayer;
+class MapLayer;
 
 /*
  * Keeps an indes of certain map objects like flight plan lines, airway lines in screen coordinates
@@ -49,6 +52,9 @@ public:
 
   void copy(const MapScreenIndex& other);
 
+  /* Remove all user marks like range rings and all highlights. Used for map tiles which are shared between clients. */
+  void clearUserMarksAndHighlights();
+
   /*
    * Finds all objects near the screen coordinates with maximal distance of maxDistance to xs/ys.
    * Gets airways, visible map objects like airports, navaids and lightlighted objects.
@@ -84,6 +90,12 @@ public:
   void updateIlsScreenGeometry(const Marble::GeoDataLatLonBox& curBox);
   void updateLogEntryScreenGeometry(const Marble::GeoDataLatLonBox& curBox);
 
+  /* Screen grid for nearest cached map objects has to be rebuilt. Called on each repaint. */
+  void resetNearestScreenGrid()
+  {
+    nearestGridValid = false;
+  }
+
   /* Clear internal caches */
   void resetAirspaceOnlineScreenGeometry();
   void resetIlsScreenGeometry();
@@ -186,9 +198,16 @@ public:
     return simData.getAiAircraftConst();
   }
 
+  /* Grid index of AI aircraft and ships. Values are indexes into getAiAircraft(). */
+  const TrafficIndex& getAiAircraftIndex() const
+  {
+    return aiAircraftIndex;
+  }
+
   void updateSimData(const atools::fs::sc::SimConnectData& data)
   {
     simData = data;
+    aiAircraftIndex.update(simData.getAiAircraftConst());
   }
 
   bool isUserAircraftValid() const
@@ -266,7 +285,17 @@ private:
   template<typename TYPE>
   int getNearestIndex(int xs, int ys, int maxDistance, const QList<TYPE>& typeList) const;
 
+  /* Get a circle covering the square of maxDistance pixels around xs/ys in geographic coordinates.
+   * Returns false if a corner is not visible on the globe. */
+  bool nearestCircle(const CoordinateConverter& conv, int xs, int ys, int maxDistance, atools::geo::Pos& center,
+                     float& radiusMeter) const;
+
+  /* Rebuild grid if a repaint happened or parameters or the map query caches have changed */
+  void updateNearestScreenGrid(const CoordinateConverter& conv, const MapLayer *mapLayer, bool airportDiagram,
+                               map::MapObjectTypes types) const;
+
   atools::fs::sc::SimConnectData simData, lastSimData;
+  TrafficIndex aiAircraftIndex;
   MapPaintWidget *mapPaintWidget;
   MapQuery *mapQuery;
   AirportQuery *airportQuery;
@@ -307,6 +336,14 @@ private:
   QList<std::pair<int, QLine> > ilsLines; /* Index ILS center lines separately to allow
                                            * tooltips when getting the cursor near a line */
 
+  /* Screen coordinates of cached airports, navaids, etc. bucketed into a grid. Built lazily on the first
+   * nearest query after a repaint to avoid projecting all objects on each mouse move. */
+  mutable ScreenGrid nearestGrid;
+  mutable bool nearestGridValid = false, nearestGridAirportDiagram = false;
+  mutable const MapLayer *nearestGridLayer = nullptr;
+  mutable map::MapObjectTypes nearestGridTypes = map::NONE;
+  mutable quint32 nearestGridGeneration = 0;
+
 };
 
 #endif // LITTLENAVMAP_MAPSCREENINDEX_H
@@ -49,6 +49,7 @@
 #include "route/routealtitude.h"
 #include "fs/sc/simconnectdata.h"
 #include "connect/connectclient.h"
+#include "connect/simdatadispatcher.h"
 #include "common/unit.h"
 #include "common/aircrafttrack.h"
 #include "weather/windreporter.h"
@@ -2767,18 +2768,8 @@ void MapWidget::simDataChanged(const atools::fs::sc::SimConnectData& simulatorDa
       if(paintLayer->getShownMapObjects() & map::AIRCRAFT_AI ||
          paintLayer->getShownMapObjects() & map::AIRCRAFT_AI_SHIP ||
          paintLayer->getShownMapObjects() & map::AIRCRAFT_ONLINE)
-      {
-        for(const atools::fs::sc::SimConnectAircraft& ai : simulatorData.getAiAircraftConst())
-        {
-          if(getCurrentViewBoundingBox().contains(
-               Marble::GeoDataCoordinates(ai.getPosition().getLonX(), ai.getPosition().getLatY(), 0,
-                                          Marble::GeoDataCoordinates::Degree)))
-          {
-            aiVisible = true;
-            break;
-          }
-        }
-      }
+        // Index was updated in updateSimData() above
+        aiVisible = getScreenIndexConst()->getAiAircraftIndex().containsAny(getCurrentViewBoundingBox());
 
       using atools::almostNotEqual;
 
@@ -2818,6 +2809,9 @@ void MapWidget::simDataChanged(const atools::fs::sc::SimConnectData& simulatorDa
 
       if(centerAircraft && !contextMenuActive) // centering required by button but not while menu is open
       {
+        // Load map objects ahead of the aircraft to avoid waiting for queries when re-centering
+        prefetchAircraftView(aircraft.getPosition(), aircraft.getTrackDegTrue(), aircraft.getGroundSpeedKts());
+
         if(!curPosVisible || // Not visible on world map
            posHasChanged) // Significant change in position might require zooming or re-centering
         {
@@ -3524,6 +3518,9 @@ void MapWidget::updateMapObjectsShown()
 
   emit shownMapFeaturesChanged(paintLayer->getShownMapObjects());
 
+  // Airspace sources or other settings might have changed without touching the visible types
+  paintLayer->invalidateStaticLayers();
+
   // Update widget
   update();
 }
@@ -3916,7 +3913,7 @@ void MapWidget::debugMovingPlane(QMouseEvent *event)
                                                                   totalFuel, 10.f);
       data.setPacketId(packetId++);
 
-      emit NavApp::getConnectClient()->dataPacketReceived(data);
+      NavApp::getConnectClient()->getSimDataDispatcher()->postSimData(data);
       lastPos = pos;
       lastPoint = event->pos();
     }
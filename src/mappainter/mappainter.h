@@ -123,6 +123,17 @@ struct PaintContext
     return objectCount > MAX_OBJECT_COUNT;
   }
 
+  /* Set by painters if a query hit the row limit and drawn objects are incomplete. Reported like an overflow. */
+  bool queryOverflow = false;
+
+  /* Number of objects skipped since they are outside of the visible area. Used for profiling only. */
+  int objectCulledCount = 0;
+
+  void objCulled()
+  {
+    objectCulledCount++;
+  }
+
   bool  dOpt(const optsd::DisplayOptions& opts) const
   {
     return dispOpts & opts;
@@ -24,6 +24,8 @@
 #include "mapgui/mapfunctions.h"
 #include "util/paintercontextsaver.h"
 #include "geo/calculations.h"
+#include "common/trafficindex.h"
+#include "query/querytypes.h"
 
 #include <marble/GeoPainter.h>
 #include <marble/ViewportParams.h>
@@ -34,6 +36,10 @@ const int NUM_CLOSEST_AI_LABELS = 5;
 const float DIST_METER_CLOSEST_AI_LABELS = atools::geo::nmToMeter(20);
 const float DIST_FT_CLOSEST_AI_LABELS = 5000;
 
+/* Enlarge view rectangle to avoid aircraft symbols vanishing at the edges */
+const double AI_RECT_INFLATION_FACTOR = 0.2;
+const double AI_RECT_INFLATION_INCREMENT = 0.1;
+
 MapPainterAircraft::MapPainterAircraft(MapPaintWidget* mapWidget, MapScale *mapScale)
   : MapPainterVehicle(mapWidget, mapScale)
 {
@@ -75,11 +81,17 @@ void MapPainterAircraft::render(PaintContext *context)
 
     if(NavApp::isConnected() || mapPaintWidget->getUserAircraft().isDebug())
     {
-      for(const SimConnectAircraft& ac : mapPaintWidget->getAiAircraft())
+      // Get only aircraft in the slightly enlarged view rectangle
+      Marble::GeoDataLatLonBox rect(context->viewport->viewLatLonAltBox());
+      query::inflateQueryRect(rect, AI_RECT_INFLATION_FACTOR, AI_RECT_INFLATION_INCREMENT);
+
+      const QVector<atools::fs::sc::SimConnectAircraft>& aiAircraft = mapPaintWidget->getAiAircraft();
+      mapPaintWidget->getAiAircraftIndex().queryRect(rect, [&aiAircraft, &allAircraft](int index)
       {
+        const SimConnectAircraft& ac = aiAircraft.at(index);
         if(ac.getCategory() != atools::fs::sc::BOAT)
           allAircraft.append(&ac);
-      }
+      });
     }
 
     // Sort by distance to user aircraft
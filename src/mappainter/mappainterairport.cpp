@@ -78,10 +78,12 @@ void MapPainterAirport::render(PaintContext *context)
   // Get airports from cache/database for the bounding rectangle and add them to the map
   const GeoDataLatLonAltBox& curBox = context->viewport->viewLatLonAltBox();
   const QList<MapAirport> *airportCache = nullptr;
+  bool overflow = false;
   if(context->mapLayerEffective->isAirportDiagramRunway())
-    airportCache = mapQuery->getAirports(curBox, context->mapLayerEffective, context->lazyUpdate);
+    airportCache = mapQuery->getAirports(curBox, context->mapLayerEffective, context->lazyUpdate, &overflow);
   else
-    airportCache = mapQuery->getAirports(curBox, context->mapLayer, context->lazyUpdate);
+    airportCache = mapQuery->getAirports(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+  context->queryOverflow |= overflow;
 
   // Collect all airports that are visible
   QList<PaintAirportType> visibleAirports;
@@ -111,7 +113,11 @@ void MapPainterAirport::render(PaintContext *context)
           if(drawAirport)
             visibleAirports.append({&airport, QPointF(x, y)});
         }
+        else
+          context->objCulled();
       }
+      else
+        context->objCulled();
     }
   }
 
@@ -77,6 +77,10 @@ void MapPainterAirspace::render(PaintContext *context)
 
     painter->setBackgroundMode(Qt::TransparentMode);
 
+    // Select level of detail by the size of one degree latitude on screen
+    geometryCache.beginFrame(context->viewport, controller->getGeometryGeneration());
+    int level = AirspaceGeometryCache::levelForScale(scale->getPixelForNm(60.f));
+
     for(const MapAirspace *airspace : airspaces)
     {
       if(!(airspace->type & context->airspaceFilterByLayer.types))
@@ -89,24 +93,22 @@ void MapPainterAirspace::render(PaintContext *context)
 
         // qDebug() << airspace.getId() << airspace.name;
 
-        Marble::GeoDataLinearRing linearRing;
-        linearRing.setTessellate(true);
-
-        painter->setPen(mapcolors::penForAirspace(*airspace));
-
-        if(!context->drawFast)
-          painter->setBrush(mapcolors::colorForAirspaceFill(*airspace));
+        const QVector<QPolygonF> *polygons = geometryCache.getScreenPolygons(airspace->combinedId(), level,
+                                                                              context->viewport);
 
-        const LineString *lines = controller->getAirspaceGeometry(airspace->combinedId());
-
-        if(lines != nullptr)
+        if(polygons != nullptr && !polygons->isEmpty())
         {
-          for(const Pos& pos : *lines)
-            linearRing.append(Marble::GeoDataCoordinates(pos.getLonX(), pos.getLatY(), 0, DEG));
+          painter->setPen(mapcolors::penForAirspace(*airspace));
+
+          if(!context->drawFast)
+            painter->setBrush(mapcolors::colorForAirspaceFill(*airspace));
 
-          painter->drawPolygon(linearRing);
+          for(const QPolygonF& polygon : *polygons)
+            painter->drawPolygon(polygon);
         }
       }
+      else
+        context->objCulled();
     }
   }
 }
@@ -19,6 +19,7 @@
 #define LITTLENAVMAP_MAPPAINTERAIRSPACE_H
 
 #include "mappainter/mappainter.h"
+#include "airspace/airspacegeometrycache.h"
 
 namespace Marble {
 class GeoDataLineString;
@@ -41,6 +42,9 @@ public:
 
 private:
   const Route *route;
+
+  /* Simplified boundaries and screen polygons for the viewport of this map widget */
+  AirspaceGeometryCache geometryCache;
 };
 
 #endif // LITTLENAVMAP_MAPPAINTERAIRSPACE_H
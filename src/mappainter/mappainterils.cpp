@@ -51,7 +51,9 @@ void MapPainterIls::render(PaintContext *context)
   {
     const GeoDataLatLonBox& curBox = context->viewport->viewLatLonAltBox();
 
-    const QList<MapIls> *ilsList = mapQuery->getIls(curBox, context->mapLayer, context->lazyUpdate);
+    bool overflow = false;
+    const QList<MapIls> *ilsList = mapQuery->getIls(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+    context->queryOverflow |= overflow;
     if(ilsList != nullptr)
     {
       atools::util::PainterContextSaver saver(context->painter);
@@ -74,6 +76,8 @@ void MapPainterIls::render(PaintContext *context)
 
           drawIlsSymbol(context, ils);
         }
+        else
+          context->objCulled();
       }
     }
   }
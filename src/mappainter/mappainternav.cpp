@@ -58,10 +58,12 @@ void MapPainterNav::render(PaintContext *context)
 
   context->szFont(context->textSizeNavaid);
 
+  bool overflow = false;
   if(drawAirway && !context->isOverflow())
   {
     // Draw airway lines
-    const QList<MapAirway> *airways = mapQuery->getAirways(curBox, context->mapLayer, context->lazyUpdate);
+    const QList<MapAirway> *airways = mapQuery->getAirways(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+    context->queryOverflow |= overflow;
     if(airways != nullptr)
       paintAirways(context, airways, context->drawFast);
   }
@@ -71,7 +73,9 @@ void MapPainterNav::render(PaintContext *context)
   if((drawWaypoint || drawAirway) && !context->isOverflow())
   {
     // If airways are drawn we also have to go through waypoints
-    const QList<MapWaypoint> *waypoints = mapQuery->getWaypoints(curBox, context->mapLayer, context->lazyUpdate);
+    const QList<MapWaypoint> *waypoints = mapQuery->getWaypoints(curBox, context->mapLayer, context->lazyUpdate,
+                                                                 &overflow);
+    context->queryOverflow |= overflow;
     if(waypoints != nullptr)
       paintWaypoints(context, waypoints, drawWaypoint);
   }
@@ -79,7 +83,8 @@ void MapPainterNav::render(PaintContext *context)
   // VOR -------------------------------------------------
   if(context->mapLayer->isVor() && context->objectTypes.testFlag(map::VOR) && !context->isOverflow())
   {
-    const QList<MapVor> *vors = mapQuery->getVors(curBox, context->mapLayer, context->lazyUpdate);
+    const QList<MapVor> *vors = mapQuery->getVors(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+    context->queryOverflow |= overflow;
     if(vors != nullptr)
       paintVors(context, vors, context->drawFast);
   }
@@ -87,7 +92,8 @@ void MapPainterNav::render(PaintContext *context)
   // NDB -------------------------------------------------
   if(context->mapLayer->isNdb() && context->objectTypes.testFlag(map::NDB) && !context->isOverflow())
   {
-    const QList<MapNdb> *ndbs = mapQuery->getNdbs(curBox, context->mapLayer, context->lazyUpdate);
+    const QList<MapNdb> *ndbs = mapQuery->getNdbs(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+    context->queryOverflow |= overflow;
     if(ndbs != nullptr)
       paintNdbs(context, ndbs, context->drawFast);
   }
@@ -95,7 +101,8 @@ void MapPainterNav::render(PaintContext *context)
   // Marker -------------------------------------------------
   if(context->mapLayer->isMarker() && context->objectTypes.testFlag(map::ILS) && !context->isOverflow())
   {
-    const QList<MapMarker> *markers = mapQuery->getMarkers(curBox, context->mapLayer, context->lazyUpdate);
+    const QList<MapMarker> *markers = mapQuery->getMarkers(curBox, context->mapLayer, context->lazyUpdate, &overflow);
+    context->queryOverflow |= overflow;
     if(markers != nullptr)
       paintMarkers(context, markers, context->drawFast);
   }
@@ -230,6 +237,8 @@ void MapPainterNav::paintAirways(PaintContext *context, const QList<MapAirway> *
         }
       }
     }
+    else
+      context->objCulled();
   }
 
   TextPlacement textPlacement(context->painter, this);
@@ -309,6 +318,8 @@ void MapPainterNav::paintWaypoints(PaintContext *context, const QList<MapWaypoin
           ((drawAirwayV && waypoint.hasVictorAirways) || (drawAirwayJ && waypoint.hasJetAirways))))
         symbolPainter->drawWaypointText(context->painter, waypoint, x, y, textflags::IDENT, size, fill);
     }
+    else
+      context->objCulled();
   }
 }
 
@@ -343,6 +354,8 @@ void MapPainterNav::paintVors(PaintContext *context, const QList<MapVor> *vors,
 
       symbolPainter->drawVorText(context->painter, vor, x, y, flags, size, fill);
     }
+    else
+      context->objCulled();
   }
 }
 
@@ -375,6 +388,8 @@ void MapPainterNav::paintNdbs(PaintContext *context, const QList<MapNdb> *ndbs,
 
       symbolPainter->drawNdbText(context->painter, ndb, x, y, flags, size, fill);
     }
+    else
+      context->objCulled();
   }
 }
 
@@ -404,5 +419,7 @@ void MapPainterNav::paintMarkers(PaintContext *context, const QList<MapMarker> *
                                textatt::BOLD | textatt::RIGHT, transparency);
       }
     }
+    else
+      context->objCulled();
   }
 }
@@ -167,11 +167,19 @@ void MapPainterVehicle::paintTrack(const PaintContext *context)
     int x2 = -1, y2 = -1;
     bool hidden1, hidden2;
     QRect vpRect(painter->viewport());
-    wToS(aircraftTrack.first().pos, x1, y1, DEFAULT_WTOS_SIZE, &hidden1);
 
-    for(int i = 1; i < aircraftTrack.size(); i++)
+    // Use simplified track where deviation is not visible on the screen
+    float pixelPerNm = scale->getPixelForNm(1.f);
+    float toleranceMeter = pixelPerNm > 0.f ?
+                           atools::geo::nmToMeter(1.f) / pixelPerNm * AIRCRAFT_TRACK_TOLERANCE_PIXEL : 0.f;
+    QVector<int> indexes;
+    aircraftTrack.getSimplifiedIndexes(indexes, toleranceMeter);
+
+    wToS(aircraftTrack.at(indexes.first()).pos, x1, y1, DEFAULT_WTOS_SIZE, &hidden1);
+
+    for(int i = 1; i < indexes.size(); i++)
     {
-      const Pos& trackPos = aircraftTrack.at(i).pos;
+      const Pos& trackPos = aircraftTrack.at(indexes.at(i)).pos;
       wToS(trackPos, x2, y2, DEFAULT_WTOS_SIZE, &hidden2);
 
       QRect rect(QPoint(x1, y1), QPoint(x2, y2));
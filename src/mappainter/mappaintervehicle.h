@@ -83,6 +83,9 @@ protected:
   /* Minimum length in pixel of a track segment to be drawn */
   static Q_DECL_CONSTEXPR int AIRCRAFT_TRACK_MIN_LINE_LENGTH = 5;
 
+  /* Maximum deviation of the simplified aircraft track from the recorded one */
+  static Q_DECL_CONSTEXPR float AIRCRAFT_TRACK_TOLERANCE_PIXEL = 1.5f;
+
   static Q_DECL_CONSTEXPR int WIND_POINTER_SIZE = 40;
 
 };
@@ -35,11 +35,15 @@
 #include "mappainter/mappainteruser.h"
 #include "mappainter/mappainteraltitude.h"
 #include "mappainter/mappaintertop.h"
+#include "mappainter/mappaintprofiler.h"
 #include "mapgui/mapscale.h"
 #include "userdata/userdatacontroller.h"
 #include "route/route.h"
 #include "geo/calculations.h"
 #include "options/optiondata.h"
+#include "common/constants.h"
+#include "settings/settings.h"
+#include "atools.h"
 
 #include <QElapsedTimer>
 
@@ -71,9 +75,14 @@ MapPaintLayer::MapPaintLayer(MapPaintWidget *widget, MapQuery *mapQueries)
   mapPainterWind = new MapPainterWind(mapWidget, mapScale);
   mapPainterTop = new MapPainterTop(mapWidget, mapScale);
 
+  profiler = new MapPaintProfiler;
+
   // Default for visible object types
   objectTypes = map::MapObjectTypes(map::AIRPORT | map::VOR | map::NDB | map::AP_ILS | map::MARKER | map::WAYPOINT);
   objectDisplayTypes = map::DISPLAY_TYPE_NONE;
+
+  staticLayerCache = atools::settings::Settings::instance().
+                     getAndStoreValue(lnm::OPTIONS_MAP_STATIC_LAYER_CACHE, true).toBool();
 }
 
 MapPaintLayer::~MapPaintLayer()
@@ -91,6 +100,7 @@ MapPaintLayer::~MapPaintLayer()
   delete mapPainterWeather;
   delete mapPainterWind;
   delete mapPainterTop;
+  delete profiler;
 
   delete layers;
   delete mapScale;
@@ -111,11 +121,19 @@ void MapPaintLayer::copySettings(const MapPaintLayer& other)
 void MapPaintLayer::preDatabaseLoad()
 {
   databaseLoadStatus = true;
+  invalidateStaticLayers();
 }
 
 void MapPaintLayer::postDatabaseLoad()
 {
   databaseLoadStatus = false;
+  invalidateStaticLayers();
+}
+
+void MapPaintLayer::invalidateStaticLayers()
+{
+  staticLayerGeneration++;
+  staticLayerImage = QImage();
 }
 
 void MapPaintLayer::setShowMapObjects(map::MapObjectTypes type, bool show)
@@ -589,60 +607,51 @@ bool MapPaintLayer::render(GeoPainter *painter, ViewportParams *viewport, const
       // =========================================================================
       // Draw ====================================
 
+      // Profile only the map on screen and not the web or printing widget
+      profiling = profiler->isEnabled() && mapWidget->isVisibleWidget() && !mapWidget->isPrinting();
+      if(profiling)
+        profiler->beginFrame(&context);
+
       // Altitude below all others
-      mapPainterAltitude->render(&context);
+      renderPainter(mapPainterAltitude, &context, "Altitude");
 
       // Ship below other navaids and airports
-      mapPainterShip->render(&context);
+      renderPainter(mapPainterShip, &context, "Ship");
 
       if(mapWidget->distance() < layer::DISTANCE_CUT_OFF_LIMIT)
       {
-        if(!context.isOverflow())
-          mapPainterAirspace->render(&context);
-
-        if(context.mapLayerEffective->isAirportDiagram())
-        {
-          // Put ILS below and navaids on top of airport diagram
-          mapPainterIls->render(&context);
-
-          if(!context.isOverflow())
-            mapPainterAirport->render(&context);
-
-          if(!context.isOverflow())
-            mapPainterNav->render(&context);
-        }
+        // Use cached image only for a still map on screen. Moving map changes the view on each frame anyway.
+        if(staticLayerCache && context.viewContext == Marble::Still && mapWidget->isVisibleWidget() &&
+           !mapWidget->isPrinting())
+          renderStaticLayersCached(&context);
         else
-        {
-          // Airports on top of all
-          if(!context.isOverflow())
-            mapPainterIls->render(&context);
-
-          if(!context.isOverflow())
-            mapPainterNav->render(&context);
-
-          if(!context.isOverflow())
-            mapPainterAirport->render(&context);
-        }
+          renderStaticLayers(&context);
       }
 
       if(!context.isOverflow())
-        mapPainterUser->render(&context);
+        renderPainter(mapPainterUser, &context, "User");
 
-      mapPainterWind->render(&context);
+      renderPainter(mapPainterWind, &context, "Wind");
 
       // if(!context.isOverflow()) always paint route even if number of objets is too large
-      mapPainterRoute->render(&context);
+      renderPainter(mapPainterRoute, &context, "Route");
 
-      mapPainterWeather->render(&context);
+      renderPainter(mapPainterWeather, &context, "Weather");
 
       // if(!context.isOverflow())
-      mapPainterMark->render(&context);
+      renderPainter(mapPainterMark, &context, "Mark");
+
+      renderPainter(mapPainterAircraft, &context, "Aircraft");
 
-      mapPainterAircraft->render(&context);
+      renderPainter(mapPainterTop, &context, "Top");
 
-      mapPainterTop->render(&context);
+      if(profiling)
+      {
+        profiler->endFrame(&context);
+        profiler->paintOverlay(painter);
+      }
 
-      if(context.isOverflow())
+      if(context.isOverflow() || context.queryOverflow)
         overflow = PaintContext::MAX_OBJECT_COUNT;
       else
         overflow = 0;
@@ -654,3 +663,130 @@ bool MapPaintLayer::render(GeoPainter *painter, ViewportParams *viewport, const
   }
   return true;
 }
+
+void MapPaintLayer::renderStaticLayers(PaintContext *context)
+{
+  if(!context->isOverflow())
+    renderPainter(mapPainterAirspace, context, "Airspace");
+
+  if(context->mapLayerEffective->isAirportDiagram())
+  {
+    // Put ILS below and navaids on top of airport diagram
+    renderPainter(mapPainterIls, context, "ILS");
+
+    if(!context->isOverflow())
+      renderPainter(mapPainterAirport, context, "Airport");
+
+    if(!context->isOverflow())
+      renderPainter(mapPainterNav, context, "Nav");
+  }
+  else
+  {
+    // Airports on top of all
+    if(!context->isOverflow())
+      renderPainter(mapPainterIls, context, "ILS");
+
+    if(!context->isOverflow())
+      renderPainter(mapPainterNav, context, "Nav");
+
+    if(!context->isOverflow())
+      renderPainter(mapPainterAirport, context, "Airport");
+  }
+}
+
+void MapPaintLayer::renderPainter(MapPainter *mapPainter, PaintContext *context, const QString& name)
+{
+  if(profiling)
+  {
+    profiler->begin(context);
+    mapPainter->render(context);
+    profiler->end(context, name);
+  }
+  else
+    mapPainter->render(context);
+}
+
+void MapPaintLayer::renderStaticLayersCached(PaintContext *context)
+{
+  StaticLayerKey key = staticLayerKey(context);
+
+  if(staticLayerImage.isNull() || key != staticLayerImageKey)
+  {
+    // Render static layers into a transparent image having the size of the widget
+    staticLayerImage = QImage(key.size * key.devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    staticLayerImage.setDevicePixelRatio(key.devicePixelRatio);
+    staticLayerImage.fill(Qt::transparent);
+
+    GeoPainter imagePainter(&staticLayerImage, context->viewport, mapWidget->mapQuality());
+    imagePainter.setFont(context->painter->font());
+    imagePainter.setRenderHints(context->painter->renderHints());
+
+    GeoPainter *widgetPainter = context->painter;
+    int objectCount = context->objectCount;
+
+    context->painter = &imagePainter;
+    renderStaticLayers(context);
+    context->painter = widgetPainter;
+    imagePainter.end();
+
+    staticLayerObjectCount = context->objectCount - objectCount;
+    staticLayerQueryOverflow = context->queryOverflow;
+    staticLayerImageKey = key;
+  }
+  else
+  {
+    // Keep object count for overflow detection of the following painters
+    context->objectCount += staticLayerObjectCount;
+    context->queryOverflow |= staticLayerQueryOverflow;
+  }
+
+  if(profiling)
+    profiler->begin(context);
+
+  context->painter->drawImage(QPoint(0, 0), staticLayerImage);
+
+  if(profiling)
+    profiler->end(context, "Static image");
+}
+
+MapPaintLayer::StaticLayerKey MapPaintLayer::staticLayerKey(const PaintContext *context) const
+{
+  const GeoDataLatLonAltBox& box = context->viewport->viewLatLonAltBox();
+
+  StaticLayerKey key;
+  key.north = box.north(GeoDataCoordinates::Degree);
+  key.south = box.south(GeoDataCoordinates::Degree);
+  key.east = box.east(GeoDataCoordinates::Degree);
+  key.west = box.west(GeoDataCoordinates::Degree);
+  key.distance = mapWidget->distance();
+  key.size = context->viewport->size();
+  key.devicePixelRatio = mapWidget->devicePixelRatioF();
+  key.projection = context->viewport->projection();
+  key.mapLayer = context->mapLayer;
+  key.mapLayerEffective = context->mapLayerEffective;
+  key.objectTypes = context->objectTypes;
+  key.objectDisplayTypes = context->objectDisplayTypes;
+  key.airspaceTypes = context->airspaceFilterByLayer.types;
+  key.airspaceFlags = context->airspaceFilterByLayer.flags;
+  key.generation = staticLayerGeneration;
+
+  // Route objects are not drawn by airport and navaid painters - order independent hash
+  key.routeIdHash = static_cast<uint>(context->routeIdMap.size());
+  for(const map::MapObjectRef& ref : context->routeIdMap)
+    key.routeIdHash += map::qHash(ref);
+
+  return key;
+}
+
+bool MapPaintLayer::StaticLayerKey::operator==(const StaticLayerKey& other) const
+{
+  return atools::almostEqual(north, other.north) && atools::almostEqual(south, other.south) &&
+         atools::almostEqual(east, other.east) && atools::almostEqual(west, other.west) &&
+         atools::almostEqual(distance, other.distance) &&
+         size == other.size && atools::almostEqual(devicePixelRatio, other.devicePixelRatio) &&
+         projection == other.projection &&
+         mapLayer == other.mapLayer && mapLayerEffective == other.mapLayerEffective &&
+         objectTypes == other.objectTypes && objectDisplayTypes == other.objectDisplayTypes &&
+         airspaceTypes == other.airspaceTypes && airspaceFlags == other.airspaceFlags &&
+         routeIdHash == other.routeIdHash && generation == other.generation;
+}
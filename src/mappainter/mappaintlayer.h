@@ -20,6 +20,7 @@
 
 #include "mappainter/mappainter.h"
 
+#include <QImage>
 #include <QPen>
 
 #include <marble/LayerInterface.h>
@@ -49,6 +50,7 @@ class MapPainterAltitude;
 class MapPainterWeather;
 class MapPainterWind;
 class MapPaintWidget;
+class MapPaintProfiler;
 
 /*
  * Implements the Marble layer interface that paints upon the Marble map. Contains all painter instances
@@ -138,7 +140,46 @@ public:
     sunShading = value;
   }
 
+  /* Clear the cached image of static layers like airports, navaids and airspaces. Has to be called if the
+   * content of these layers changes without a change of the view, e.g. after database, option or route altitude
+   * changes or online airspace updates. */
+  void invalidateStaticLayers();
+
 private:
+  /* Values which require to render the static layers again if changed */
+  struct StaticLayerKey
+  {
+    double north = 0., south = 0., east = 0., west = 0., distance = 0.;
+    QSize size;
+    qreal devicePixelRatio = 1.;
+    int projection = 0;
+    const MapLayer *mapLayer = nullptr, *mapLayerEffective = nullptr;
+    map::MapObjectTypes objectTypes = map::NONE;
+    map::MapObjectDisplayTypes objectDisplayTypes = map::DISPLAY_TYPE_NONE;
+    map::MapAirspaceTypes airspaceTypes = map::AIRSPACE_NONE;
+    map::MapAirspaceFlags airspaceFlags = map::AIRSPACE_FLAG_NONE;
+    uint routeIdHash = 0;
+    quint32 generation = 0;
+
+    bool operator==(const StaticLayerKey& other) const;
+
+    bool operator!=(const StaticLayerKey& other) const
+    {
+      return !operator==(other);
+    }
+
+  };
+
+  /* Paint airspaces, ILS, airports and navaids */
+  void renderStaticLayers(PaintContext *context);
+
+  /* Paint static layers into an image if the view has changed and draw the image */
+  void renderStaticLayersCached(PaintContext *context);
+  StaticLayerKey staticLayerKey(const PaintContext *context) const;
+
+  /* Call render for the painter and collect timing information if profiling is enabled */
+  void renderPainter(MapPainter *mapPainter, PaintContext *context, const QString& name);
+
   void initMapLayerSettings();
   void updateLayers();
 
@@ -188,6 +229,20 @@ private:
   const MapLayer *mapLayer = nullptr, *mapLayerEffective = nullptr;
   int overflow = 0;
 
+  /* Cached image of the static layers which is reused while the view does not change */
+  QImage staticLayerImage;
+  StaticLayerKey staticLayerImageKey;
+  int staticLayerObjectCount = 0;
+  bool staticLayerQueryOverflow = false;
+
+  /* Incremented by invalidateStaticLayers() */
+  quint32 staticLayerGeneration = 0;
+  bool staticLayerCache = true;
+
+  /* Collects paint times per painter if enabled in settings */
+  MapPaintProfiler *profiler = nullptr;
+  bool profiling = false; /* Profiling enabled for the current frame */
+
 };
 
 #endif // LITTLENAVMAP_MAPPAINTLAYER_H
@@ -0,0 +1,205 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "mappainter/mappaintprofiler.h"
+
+#include "mappainter/mappainter.h"
+#include "common/constants.h"
+#include "query/querytypes.h"
+#include "settings/settings.h"
+#include "util/paintercontextsaver.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QPainter>
+#include <QTextStream>
+
+#include <algorithm>
+
+using atools::settings::Settings;
+
+MapPaintProfiler::MapPaintProfiler()
+{
+  overlay = Settings::instance().getAndStoreValue(lnm::OPTIONS_MAP_PAINT_PROFILER, false).toBool();
+  csv = Settings::instance().getAndStoreValue(lnm::OPTIONS_MAP_PAINT_PROFILER_CSV, false).toBool();
+
+  if(isEnabled())
+    // Enable measurement of query time - never disabled again since it is global
+    query::SqlTimer::setEnabled(true);
+}
+
+MapPaintProfiler::~MapPaintProfiler()
+{
+  delete csvStream;
+  csvStream = nullptr;
+
+  if(csvFile != nullptr)
+  {
+    csvFile->close();
+    delete csvFile;
+    csvFile = nullptr;
+  }
+}
+
+void MapPaintProfiler::openCsv()
+{
+  csvFile = new QFile(Settings::getConfigFilename("_paintprofile.csv"));
+  bool exists = csvFile->exists() && csvFile->size() > 0;
+
+  if(csvFile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+  {
+    qInfo() << Q_FUNC_INFO << "Writing paint profile to" << csvFile->fileName();
+    csvStream = new QTextStream(csvFile);
+    csvStream->setCodec("UTF-8");
+
+    if(!exists)
+      *csvStream << "frame,time,painter,ms,drawn,culled,sqlms" << endl;
+  }
+  else
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open" << csvFile->fileName() << csvFile->errorString();
+    delete csvFile;
+    csvFile = nullptr;
+    csv = false;
+  }
+}
+
+void MapPaintProfiler::beginFrame(const PaintContext *context)
+{
+  Q_UNUSED(context);
+
+  if(!isEnabled())
+    return;
+
+  entries.clear();
+  total = PaintProfileEntry();
+  frameNumber++;
+
+  frameSqlNsecs = query::SqlTimer::getTotalNsecs();
+  frameTimer.start();
+}
+
+void MapPaintProfiler::begin(const PaintContext *context)
+{
+  if(!isEnabled())
+    return;
+
+  painterDrawn = context->objectCount;
+  painterCulled = context->objectCulledCount;
+  painterSqlNsecs = query::SqlTimer::getTotalNsecs();
+  painterTimer.start();
+}
+
+void MapPaintProfiler::end(const PaintContext *context, const QString& name)
+{
+  if(!isEnabled())
+    return;
+
+  PaintProfileEntry entry;
+  entry.name = name;
+  entry.nsecs = painterTimer.nsecsElapsed();
+  entry.sqlNsecs = query::SqlTimer::getTotalNsecs() - painterSqlNsecs;
+  entry.drawn = context->objectCount - painterDrawn;
+  entry.culled = context->objectCulledCount - painterCulled;
+  entries.append(entry);
+}
+
+void MapPaintProfiler::endFrame(const PaintContext *context)
+{
+  if(!isEnabled())
+    return;
+
+  total.name = tr("Total");
+  total.nsecs = frameTimer.nsecsElapsed();
+  total.sqlNsecs = query::SqlTimer::getTotalNsecs() - frameSqlNsecs;
+  total.drawn = context->objectCount;
+  total.culled = context->objectCulledCount;
+
+  if(csv)
+    writeCsv();
+}
+
+void MapPaintProfiler::writeCsv()
+{
+  if(csvFile == nullptr)
+    // Open file on first frame to avoid creating it for map widgets which are never painted
+    openCsv();
+
+  if(csvStream == nullptr)
+    return;
+
+  QString time = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+  QVector<PaintProfileEntry> lines(entries);
+  lines.append(total);
+
+  for(const PaintProfileEntry& entry : lines)
+    *csvStream << frameNumber << "," << time << "," << entry.name << ","
+               << QString::number(entry.nsecs / 1000000., 'f', 3) << ","
+               << entry.drawn << "," << entry.culled << ","
+               << QString::number(entry.sqlNsecs / 1000000., 'f', 3) << endl;
+}
+
+void MapPaintProfiler::paintOverlay(QPainter *painter) const
+{
+  if(!overlay)
+    return;
+
+  atools::util::PainterContextSaver saver(painter);
+
+  QFont font("Monospace");
+  font.setStyleHint(QFont::TypeWriter);
+  font.setPointSizeF(painter->font().pointSizeF() * 0.9);
+  painter->setFont(font);
+
+  QStringList lines;
+  lines.append(tr("%1 %2 %3 %4 %5").
+               arg(tr("Painter"), -20).
+               arg(tr("ms"), 8).
+               arg(tr("Drawn"), 7).
+               arg(tr("Culled"), 7).
+               arg(tr("SQL ms"), 8));
+
+  QVector<PaintProfileEntry> all(entries);
+  all.append(total);
+
+  for(const PaintProfileEntry& entry : all)
+    lines.append(QString("%1 %2 %3 %4 %5").
+                 arg(entry.name, -20).
+                 arg(entry.nsecs / 1000000., 8, 'f', 2).
+                 arg(entry.drawn, 7).
+                 arg(entry.culled, 7).
+                 arg(entry.sqlNsecs / 1000000., 8, 'f', 2));
+
+  QFontMetrics metrics = painter->fontMetrics();
+  int width = 0;
+  for(const QString& line : lines)
+    width = std::max(width, metrics.width(line));
+
+  QRect rect(10, 10, width + 10, metrics.height() * lines.size() + 10);
+  painter->setPen(Qt::NoPen);
+  painter->setBrush(QColor(255, 255, 255, 200));
+  painter->drawRect(rect);
+
+  painter->setPen(Qt::black);
+  int y = rect.top() + 5 + metrics.ascent();
+  for(const QString& line : lines)
+  {
+    painter->drawText(rect.left() + 5, y, line);
+    y += metrics.height();
+  }
+}
@@ -0,0 +1,101 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPPAINTPROFILER_H
+#define LITTLENAVMAP_MAPPAINTPROFILER_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QVector>
+
+class QFile;
+class QPainter;
+class QTextStream;
+struct PaintContext;
+
+/* Timing and object counters for one painter call in a frame */
+struct PaintProfileEntry
+{
+  QString name;
+  qint64 nsecs = 0, /* Wall time for the painter */
+         sqlNsecs = 0; /* Time spent in SQL queries in MapQuery, AirportQuery and AirspaceQuery */
+  int drawn = 0, /* Objects drawn as counted by PaintContext::objCount() */
+      culled = 0; /* Objects skipped since outside of visible area */
+};
+
+/*
+ * Collects wall time, drawn and culled objects as well as SQL query time per map painter for each frame.
+ *
+ * Results of the last frame can be shown as an overlay on the map and every frame can be appended to a CSV file
+ * in the settings directory. Both are disabled by default and are enabled by the settings
+ * Options/MapPaintProfiler and Options/MapPaintProfilerCsv.
+ */
+class MapPaintProfiler
+{
+  Q_DECLARE_TR_FUNCTIONS(MapPaintProfiler)
+
+public:
+  MapPaintProfiler();
+  ~MapPaintProfiler();
+
+  MapPaintProfiler(const MapPaintProfiler& other) = delete;
+  MapPaintProfiler& operator=(const MapPaintProfiler& other) = delete;
+
+  /* true if either overlay or CSV output is enabled. All other methods are no-ops if this is false. */
+  bool isEnabled() const
+  {
+    return overlay || csv;
+  }
+
+  /* Clear results and start timer for a new frame */
+  void beginFrame(const PaintContext *context);
+
+  /* Start measuring a painter call. Calls cannot be nested. */
+  void begin(const PaintContext *context);
+
+  /* Stop measuring a painter and add an entry with the given name */
+  void end(const PaintContext *context, const QString& name);
+
+  /* Add a total line and write all entries of the frame to the CSV file if enabled */
+  void endFrame(const PaintContext *context);
+
+  /* Draw a table with the results of the last frame into the top left corner of the map */
+  void paintOverlay(QPainter *painter) const;
+
+  const QVector<PaintProfileEntry>& getEntries() const
+  {
+    return entries;
+  }
+
+private:
+  void openCsv();
+  void writeCsv();
+
+  QVector<PaintProfileEntry> entries;
+  PaintProfileEntry total;
+
+  QElapsedTimer frameTimer, painterTimer;
+  qint64 frameSqlNsecs = 0L, painterSqlNsecs = 0L;
+  int painterDrawn = 0, painterCulled = 0;
+  quint64 frameNumber = 0L;
+
+  bool overlay = false, csv = false;
+  QFile *csvFile = nullptr;
+  QTextStream *csvStream = nullptr;
+};
+
+#endif // LITTLENAVMAP_MAPPAINTPROFILER_H
@@ -18,15 +18,14 @@
 #include "online/onlinedatacontroller.h"
 
 #include "fs/online/onlinedatamanager.h"
-#include "airspace/airspacecontroller.h"
 #include "util/httpdownloader.h"
 #include "gui/mainwindow.h"
 #include "common/constants.h"
 #include "settings/settings.h"
 #include "options/optiondata.h"
-#include "zip/gzip.h"
 #include "gui/dialog.h"
 #include "geo/calculations.h"
+#include "sql/sqldatabase.h"
 #include "sql/sqlquery.h"
 #include "sql/sqlrecord.h"
 #include "mapgui/maplayer.h"
@@ -37,11 +36,16 @@
 #include <QMessageBox>
 #include <QTextCodec>
 #include <QApplication>
+#include <QtConcurrent/QtConcurrentRun>
 
 // #define DEBUG_ONLINE_DOWNLOAD 1
 
 static const int MIN_SERVER_DOWNLOAD_INTERVAL_MIN = 15;
 
+static const double AIRCRAFT_QUERY_RECT_INFLATION_FACTOR = 0.2;
+static const double AIRCRAFT_QUERY_RECT_INFLATION_INCREMENT = 0.1;
+static const int AIRCRAFT_QUERY_MAX_ROWS = 5000;
+
 // Remove if duplicates with same registration if they are this close (500 kts for 3 min)
 #ifdef DEBUG_INFORMATION
 static const int MIN_DISTANCE_DUPLICATE_M = atools::geo::nmToMeter(900);
@@ -52,7 +56,6 @@ static const int MIN_DISTANCE_DUPLICATE_M = atools::geo::nmToMeter(30);
 using atools::fs::sc::SimConnectAircraft;
 using atools::fs::online::OnlinedataManager;
 using atools::util::HttpDownloader;
-using atools::geo::LineString;
 using atools::geo::Pos;
 
 atools::fs::online::Format convertFormat(opts::OnlineFormat format)
@@ -86,8 +89,8 @@ OnlinedataController::OnlinedataController(atools::fs::online::OnlinedataManager
   // Recurring downloads
   connect(&downloadTimer, &QTimer::timeout, this, &OnlinedataController::startDownloadInternal);
 
-  using namespace std::placeholders;
-  manager->setGeometryCallback(std::bind(&OnlinedataController::geometryCallback, this, _1, _2));
+  connect(&whazzupWatcher, &QFutureWatcher<online::WhazzupResult>::finished,
+          this, &OnlinedataController::readWhazzupFinished);
 
 #ifdef DEBUG_ONLINE_DOWNLOAD
   downloader->enableCache(60);
@@ -96,7 +99,11 @@ OnlinedataController::OnlinedataController(atools::fs::online::OnlinedataManager
 
 OnlinedataController::~OnlinedataController()
 {
-  manager->setGeometryCallback(atools::fs::online::GeoCallbackType(nullptr));
+  // Background thread writes into the database - wait on shutdown
+  whazzupWatcher.disconnect(this);
+  if(!whazzupCancel.isNull())
+    *whazzupCancel = true;
+  whazzupWatcher.waitForFinished();
 
   deInitQueries();
 
@@ -150,6 +157,9 @@ void OnlinedataController::updateAtcSizes()
     sizeMap.insert(type, diameter != -1 ? std::max(1, diameter / 2) : -1);
   }
   manager->setAtcSize(sizeMap);
+
+  // Copy for background parsing
+  atcSizes = sizeMap;
 }
 
 void OnlinedataController::startProcessing()
@@ -249,80 +259,152 @@ void OnlinedataController::downloadFinished(const QByteArray& data, QString url)
     }
   }
   else if(currentState == DOWNLOADING_WHAZZUP)
+    // Parse in background - continues in readWhazzupFinished()
+    startReadWhazzup(data);
+  else if(currentState == DOWNLOADING_WHAZZUP_SERVERS)
   {
-    QByteArray whazzupData;
+    manager->readServersFromWhazzup(codec->toUnicode(data),
+                                    convertFormat(OptionData::instance().getOnlineFormat()),
+                                    lastWhazzupUpdateTime);
+    lastServerDownload = QDateTime::currentDateTime();
 
-    if(whazzupGzipped)
-    {
-      if(!atools::zip::gzipDecompress(data, whazzupData))
-        qWarning() << Q_FUNC_INFO << "Error unzipping data";
-    }
-    else
-      whazzupData = data;
+    // Done after downloading server.txt - start timer for next session
+    startDownloadTimer();
+    currentState = NONE;
+    lastUpdateTime = QDateTime::currentDateTime();
 
-    if(manager->readFromWhazzup(codec->toUnicode(whazzupData),
-                                convertFormat(OptionData::instance().getOnlineFormat()),
-                                manager->getLastUpdateTimeFromWhazzup()))
-    {
-      // Get all callsigns and positions from online list to allow deduplication
-      manager->getClientCallsignAndPosMap(clientCallsignAndPosMap);
+    // Message for search tabs, map widget and info
+    emitClientAndAtcUpdates();
+    emit onlineServersUpdated(true /* load all */, true /* keep selection */);
+    statusBarMessage();
+  }
+}
 
-      QString whazzupVoiceUrlFromStatus = manager->getWhazzupVoiceUrlFromStatus();
-      if(!whazzupVoiceUrlFromStatus.isEmpty() &&
-         lastServerDownload < QDateTime::currentDateTime().addSecs(-MIN_SERVER_DOWNLOAD_INTERVAL_MIN * 60))
-      {
-        // Next in chain is server file
-        currentState = DOWNLOADING_WHAZZUP_SERVERS;
-        downloader->setUrl(whazzupVoiceUrlFromStatus);
+void OnlinedataController::startReadWhazzup(const QByteArray& data)
+{
+  currentState = READING_WHAZZUP;
+
+  online::WhazzupJob job;
+  job.data = data;
+  job.gzipped = whazzupGzipped;
+  job.codec = codec;
+  job.format = convertFormat(OptionData::instance().getOnlineFormat());
+  job.lastUpdateTime = lastWhazzupUpdateTime;
+  job.onlineDatabaseFile = getDatabase()->databaseName();
+  job.userAirspaceDatabaseFile = NavApp::getDatabaseUserAirspace()->databaseName();
+  job.atcSizes = atcSizes;
 
-        // Call later in the event loop to avoid recursion
-        QTimer::singleShot(0, downloader, &HttpDownloader::startDownload);
-      }
-      else
-      {
-        // Done after downloading whazzup.txt - start timer for next session
-        startDownloadTimer();
-        currentState = NONE;
-        lastUpdateTime = QDateTime::currentDateTime();
+  opts2::Flags2 flags2 = OptionData::instance().getFlags2();
+  job.airspaceByName = flags2 & opts2::ONLINE_AIRSPACE_BY_NAME;
+  job.airspaceByFile = flags2 & opts2::ONLINE_AIRSPACE_BY_FILE;
+  job.verbose = atools::settings::Settings::instance().valueBool(lnm::OPTIONS_WHAZZUP_PARSER_DEBUG);
 
-        aircraftCache.clear();
-        simulatorAiRegistrations.clear();
+  whazzupCancel = QSharedPointer<std::atomic_bool>::create(false);
+  job.cancelled = whazzupCancel;
 
-        // Message for search tabs, map widget and info
-        emit onlineClientAndAtcUpdated(true /* load all */, true /* keep selection */);
-        statusBarMessage();
-      }
+  whazzupWatcher.setFuture(QtConcurrent::run(online::readWhazzup, job));
+}
+
+void OnlinedataController::readWhazzupFinished()
+{
+  if(currentState != READING_WHAZZUP)
+    // Processes were stopped in the meantime
+    return;
+
+  const online::WhazzupResult result = whazzupWatcher.result();
+
+  if(result.updated)
+  {
+    lastWhazzupUpdateTime = result.lastUpdateTime;
+    pendingDiff.merge(result.diff);
+    updateAircraftCache(result);
+
+    // Get all callsigns and positions from online list to allow deduplication
+    clientCallsignAndPosMap = result.clientCallsignAndPosMap;
+
+    QString whazzupVoiceUrlFromStatus = manager->getWhazzupVoiceUrlFromStatus();
+    if(!whazzupVoiceUrlFromStatus.isEmpty() &&
+       lastServerDownload < QDateTime::currentDateTime().addSecs(-MIN_SERVER_DOWNLOAD_INTERVAL_MIN * 60))
+    {
+      // Next in chain is server file
+      currentState = DOWNLOADING_WHAZZUP_SERVERS;
+      downloader->setUrl(whazzupVoiceUrlFromStatus);
+
+      // Call later in the event loop to avoid recursion
+      QTimer::singleShot(0, downloader, &HttpDownloader::startDownload);
     }
     else
     {
-      qInfo() << Q_FUNC_INFO << "whazzup.txt is not recent";
-
-      // Done after old update - try again later
+      // Done after downloading whazzup.txt - start timer for next session
       startDownloadTimer();
       currentState = NONE;
       lastUpdateTime = QDateTime::currentDateTime();
+
+      // Message for search tabs, map widget and info
+      emitClientAndAtcUpdates();
+      statusBarMessage();
     }
   }
-  else if(currentState == DOWNLOADING_WHAZZUP_SERVERS)
+  else
   {
-    manager->readServersFromWhazzup(codec->toUnicode(data),
-                                    convertFormat(OptionData::instance().getOnlineFormat()),
-                                    manager->getLastUpdateTimeFromWhazzup());
-    lastServerDownload = QDateTime::currentDateTime();
+    qInfo() << Q_FUNC_INFO << "whazzup.txt is not recent";
 
-    // Done after downloading server.txt - start timer for next session
+    // Done after old update - try again later
     startDownloadTimer();
     currentState = NONE;
     lastUpdateTime = QDateTime::currentDateTime();
+  }
+}
 
-    aircraftCache.clear();
-    simulatorAiRegistrations.clear();
+void OnlinedataController::emitClientAndAtcUpdates()
+{
+  bool clients = pendingDiff.hasClientChanges(), atc = pendingDiff.hasAtcChanges();
+  pendingDiff = online::WhazzupDiff();
 
-    // Message for search tabs, map widget and info
+  // Rows of unchanged clients and centers keep their ids which allows to skip the update of unchanged tables
+  if(clients && atc)
     emit onlineClientAndAtcUpdated(true /* load all */, true /* keep selection */);
-    emit onlineServersUpdated(true /* load all */, true /* keep selection */);
-    statusBarMessage();
+  else if(clients)
+    emit onlineClientUpdated(true /* load all */, true /* keep selection */);
+  else if(atc)
+    emit onlineAtcUpdated(true /* load all */, true /* keep selection */);
+}
+
+void OnlinedataController::updateAircraftCache(const online::WhazzupResult& result)
+{
+  const online::WhazzupDiff& diff = result.diff;
+  if(!diff.hasClientChanges() || aircraftCache.curRect.isEmpty())
+    // Nothing changed or nothing loaded yet
+    return;
+
+  // Remove vanished and changed aircraft
+  QList<SimConnectAircraft>& list = aircraftCache.list;
+  list.erase(std::remove_if(list.begin(), list.end(), [&diff](const SimConnectAircraft& aircraft) -> bool
+  {
+    return diff.clientsRemoved.contains(aircraft.getAirplaneRegistration()) ||
+    diff.clientsChanged.contains(aircraft.getAirplaneRegistration());
+  }), list.end());
+
+  // Add new and changed aircraft covered by the last query rectangle
+  Marble::GeoDataLatLonBox rect(aircraftCache.curRect);
+  query::inflateQueryRect(rect, AIRCRAFT_QUERY_RECT_INFLATION_FACTOR, AIRCRAFT_QUERY_RECT_INFLATION_INCREMENT);
+
+  for(const SimConnectAircraft& aircraft : result.changedAircraft)
+  {
+    const Pos& pos = aircraft.getPosition();
+    if(rect.contains(Marble::GeoDataCoordinates(pos.getLonX(), pos.getLatY(), 0.,
+                                                Marble::GeoDataCoordinates::Degree)))
+    {
+      const Pos simPos = simulatorAiRegistrations.value(aircraft.getAirplaneRegistration());
+      if(!simPos.isValid() || pos.distanceMeterTo(simPos) > MIN_DISTANCE_DUPLICATE_M)
+        // Avoid duplicates with simulator aircraft that are close by
+        list.append(aircraft);
+    }
   }
+
+  // Indexes into the list are outdated
+  aircraftCache.generation++;
+  aircraftCache.validate(AIRCRAFT_QUERY_MAX_ROWS);
 }
 
 void OnlinedataController::downloadFailed(const QString& error, int errorCode, QString url)
@@ -348,7 +430,13 @@ void OnlinedataController::stopAllProcesses()
 {
   downloader->cancelDownload();
   downloadTimer.stop();
+
+  // Stop background parsing without waiting - job does not write into the database once cancelled and
+  // the result is ignored because of the state change
+  if(!whazzupCancel.isNull())
+    *whazzupCancel = true;
   currentState = NONE;
+  pendingDiff = online::WhazzupDiff();
   simulatorAiRegistrations.clear();
   clientCallsignAndPosMap.clear();
 }
@@ -359,27 +447,6 @@ void OnlinedataController::showMessageDialog()
                            tr("Message from downloaded status file:\n\n%2\n").arg(manager->getMessageFromStatus()));
 }
 
-LineString *OnlinedataController::geometryCallback(const QString& callsign, atools::fs::online::fac::FacilityType type)
-{
-  opts2::Flags2 flags2 = OptionData::instance().getFlags2();
-
-  LineString *lineString = nullptr;
-
-  // Try to get airspace boundary by name vs. callsign if set in options
-  if(flags2 & opts2::ONLINE_AIRSPACE_BY_NAME)
-    lineString = NavApp::getAirspaceController()->
-                 getOnlineAirspaceGeoByName(callsign, atools::fs::online::facilityTypeText(type));
-
-  // Try to get airspace boundary by file name vs. callsign if set in options
-  if(flags2 & opts2::ONLINE_AIRSPACE_BY_FILE)
-  {
-    if(lineString == nullptr)
-      lineString = NavApp::getAirspaceController()->getOnlineAirspaceGeoByFile(callsign);
-  }
-
-  return lineString;
-}
-
 void OnlinedataController::optionsChanged()
 {
   qDebug() << Q_FUNC_INFO;
@@ -394,6 +461,7 @@ void OnlinedataController::optionsChanged()
   aircraftCache.clear();
   simulatorAiRegistrations.clear();
   clientCallsignAndPosMap.clear();
+  lastWhazzupUpdateTime = QDateTime();
 
   updateAtcSizes();
 
@@ -476,14 +544,22 @@ const QList<atools::fs::sc::SimConnectAircraft> *OnlinedataController::getAircra
   return &aircraftCache.list;
 }
 
+const TrafficIndex& OnlinedataController::getAircraftIndexFromCache()
+{
+  if(aircraftIndexGeneration != aircraftCache.generation)
+  {
+    // List was reloaded or changed - update only moved, new or removed aircraft
+    aircraftIndex.update(aircraftCache.list);
+    aircraftIndexGeneration = aircraftCache.generation;
+  }
+  return aircraftIndex;
+}
+
 const QList<atools::fs::sc::SimConnectAircraft> *OnlinedataController::getAircraft(const Marble::GeoDataLatLonBox& rect,
                                                                                    const MapLayer *mapLayer, bool lazy)
 {
-  static const double queryRectInflationFactor = 0.2;
-  static const double queryRectInflationIncrement = 0.1;
-  static const int queryMaxRows = 5000;
-
-  aircraftCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
+  aircraftCache.updateCache(rect, mapLayer, AIRCRAFT_QUERY_RECT_INFLATION_FACTOR,
+                            AIRCRAFT_QUERY_RECT_INFLATION_INCREMENT, lazy,
                             [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
   {
     return curLayer->hasSameQueryParametersWaypoint(newLayer);
@@ -509,7 +585,8 @@ const QList<atools::fs::sc::SimConnectAircraft> *OnlinedataController::getAircra
   if((aircraftCache.list.isEmpty() && !lazy))
   {
     for(const Marble::GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
+        query::splitAtAntiMeridian(rect, AIRCRAFT_QUERY_RECT_INFLATION_FACTOR,
+                                   AIRCRAFT_QUERY_RECT_INFLATION_INCREMENT))
     {
       query::bindRect(r, aircraftByRectQuery);
       aircraftByRectQuery->exec();
@@ -527,7 +604,7 @@ const QList<atools::fs::sc::SimConnectAircraft> *OnlinedataController::getAircra
     }
     simulatorAiRegistrations = curRegistrations;
   }
-  aircraftCache.validate(queryMaxRows);
+  aircraftCache.validate(AIRCRAFT_QUERY_MAX_ROWS);
   return &aircraftCache.list;
 }
 
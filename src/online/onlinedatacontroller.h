@@ -19,11 +19,14 @@
 #define LNM_ONLINECONTROLLER_H
 
 #include <QDateTime>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QTimer>
 
+#include "common/trafficindex.h"
 #include "query/querytypes.h"
 #include "fs/online/onlinetypes.h"
+#include "online/onlinedatareader.h"
 
 class MapLayer;
 
@@ -65,6 +68,9 @@ class QTextCodec;
 /*
  * Manages recurring download of online network data from the status.txt and whazzup.txt files.
  * Uses options to determine how to download data.
+ *
+ * The whazzup.txt file is parsed in a background thread which merges only the differences into the
+ * online database. Consumers are notified depending on what changed.
  */
 class OnlinedataController :
   public QObject
@@ -107,6 +113,10 @@ public:
   /* Get aircraft from last bounding rectangle query from cache. */
   const QList<atools::fs::sc::SimConnectAircraft> *getAircraftFromCache();
 
+  /* Grid index for the aircraft in getAircraftFromCache(). Values are indexes into the cache list.
+   * Updated on demand if the cache has changed. */
+  const TrafficIndex& getAircraftIndexFromCache();
+
   /* Fill aircraft object from table client */
   void getClientAircraftById(atools::fs::sc::SimConnectAircraft& aircraft, int id);
 
@@ -136,8 +146,15 @@ public:
   bool isShadowAircraft(const atools::fs::sc::SimConnectAircraft& simAircraft);
 
 signals:
-  /* Sent whenever new data was downloaded */
+  /* Sent whenever new data was downloaded and both clients and centers changed or after options changes */
   void onlineClientAndAtcUpdated(bool loadAll, bool keepSelection);
+
+  /* Sent if only clients changed. Centers in the database are unchanged. */
+  void onlineClientUpdated(bool loadAll, bool keepSelection);
+
+  /* Sent if only centers changed. Clients in the database are unchanged. */
+  void onlineAtcUpdated(bool loadAll, bool keepSelection);
+
   void onlineServersUpdated(bool loadAll, bool keepSelection);
 
   /* Sent when network changes via options dialog */
@@ -154,12 +171,21 @@ private:
   void stopAllProcesses();
   void updateAtcSizes();
 
+  /* Start background parsing of whazzup.txt */
+  void startReadWhazzup(const QByteArray& data);
+
+  /* Called by watcher in the GUI thread when background parsing is done */
+  void readWhazzupFinished();
+
+  /* Send signals for collected changes and clear them */
+  void emitClientAndAtcUpdates();
+
+  /* Remove changed and removed aircraft from the cache and add changed and new aircraft if in cached rectangle */
+  void updateAircraftCache(const online::WhazzupResult& result);
+
   /* Show message from status.txt */
   void showMessageDialog();
 
-  /* Tries to fetch geometry for atc centers from the user geometry database from cache */
-  atools::geo::LineString *geometryCallback(const QString& callsign, atools::fs::online::fac::FacilityType type);
-
   atools::fs::online::OnlinedataManager *manager;
   atools::util::HttpDownloader *downloader;
   MainWindow *mainWindow;
@@ -169,6 +195,7 @@ private:
     NONE, /* Not downloading anything */
     DOWNLOADING_STATUS, /* Downloading status.txt */
     DOWNLOADING_WHAZZUP, /* Downloading whazzup.txt */
+    READING_WHAZZUP, /* Parsing whazzup.txt in background */
     DOWNLOADING_WHAZZUP_SERVERS /* Downloading servers */
   };
 
@@ -182,6 +209,19 @@ private:
   /*  Last update from whazzup */
   QDateTime lastUpdateTime;
 
+  /* Time from last successfully parsed whazzup.txt. Older files are rejected. */
+  QDateTime lastWhazzupUpdateTime;
+
+  QFutureWatcher<online::WhazzupResult> whazzupWatcher;
+
+  /* Cancel flag of the last started parsing job */
+  QSharedPointer<std::atomic_bool> whazzupCancel;
+
+  /* Changes not sent yet while waiting for servers download */
+  online::WhazzupDiff pendingDiff;
+
+  QHash<atools::fs::online::fac::FacilityType, int> atcSizes;
+
   /* Set after parsing status.txt to indicate compressed file */
   bool whazzupGzipped = false;
 
@@ -193,6 +233,10 @@ private:
   QHash<QString, atools::geo::Pos> clientCallsignAndPosMap;
 
   query::SimpleRectCache<atools::fs::sc::SimConnectAircraft> aircraftCache;
+
+  /* Index for aircraftCache and cache generation it was built for */
+  TrafficIndex aircraftIndex;
+  quint32 aircraftIndexGeneration = 0;
   atools::sql::SqlQuery *aircraftByRectQuery = nullptr;
 };
 
@@ -0,0 +1,288 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "online/onlinedatareader.h"
+
+#include "db/databasemanager.h"
+#include "fs/online/onlinedatamanager.h"
+#include "query/airspacequery.h"
+#include "geo/linestring.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlrecord.h"
+#include "sql/sqltransaction.h"
+#include "zip/gzip.h"
+#include "exception.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTextCodec>
+
+using atools::sql::SqlDatabase;
+using atools::sql::SqlQuery;
+using atools::sql::SqlRecord;
+using atools::geo::LineString;
+using atools::geo::Pos;
+
+namespace online {
+
+/* A cancelled job can overlap with the next one. Connection names get a number for each job. */
+static const QLatin1Literal STAGE_CONNECTION_NAME("LNMWHAZZUPSTAGE");
+static const QLatin1Literal AIRSPACE_CONNECTION_NAME("LNMWHAZZUPAIRSPACE");
+
+/* Schema name of the attached online database. Staging database is "main". */
+static const QString ONLINE_SCHEMA("online");
+
+void WhazzupDiff::merge(const WhazzupDiff& other)
+{
+  clientsAdded.unite(other.clientsAdded);
+  clientsRemoved.unite(other.clientsRemoved);
+  clientsChanged.unite(other.clientsChanged);
+  atcAdded.unite(other.atcAdded);
+  atcRemoved.unite(other.atcRemoved);
+  atcChanged.unite(other.atcChanged);
+}
+
+/* Get all callsigns of a table in the given schema */
+static QSet<QString> readCallsigns(SqlDatabase *db, const QString& schema, const QString& table)
+{
+  QSet<QString> callsigns;
+  SqlQuery query(db);
+  query.exec("select callsign from " + schema + "." + table);
+  while(query.next())
+    callsigns.insert(query.valueStr("callsign"));
+  return callsigns;
+}
+
+/* Merge all differences of one table from the staging database into the online database.
+ * Primary key is not copied which keeps the ids of changed rows. Callsign is used to identify rows and
+ * duplicates are removed from the staging table before merging. */
+static void mergeTable(SqlDatabase *db, const QString& table, QSet<QString>& added, QSet<QString>& removed,
+                       QSet<QString>& changed)
+{
+  const QString idColumn = table + "_id";
+  const QString onlineTable = ONLINE_SCHEMA + "." + table;
+
+  // Collect all columns except primary key
+  QStringList columns, changedColumns;
+  SqlRecord record = db->record(table);
+  for(int i = 0; i < record.count(); i++)
+  {
+    QString name = record.fieldName(i);
+    if(name != idColumn)
+    {
+      columns.append(name);
+      changedColumns.append("s." + name + " is not " + onlineTable + "." + name);
+    }
+  }
+  QString columnList = columns.join(", ");
+  QString changedCondition = changedColumns.join(" or ");
+
+  SqlQuery query(db);
+
+  // Feeds can contain the same callsign more than once - keep only the last entry since callsign is the key
+  query.exec("delete from main." + table + " where " + idColumn + " not in "
+             "(select max(" + idColumn + ") from main." + table + " group by callsign)");
+  if(query.numRowsAffected() > 0)
+    qDebug() << Q_FUNC_INFO << "Removed" << query.numRowsAffected() << "duplicate callsigns from" << table;
+
+  QSet<QString> oldCallsigns = readCallsigns(db, ONLINE_SCHEMA, table);
+  QSet<QString> newCallsigns = readCallsigns(db, "main", table);
+  added = newCallsigns - oldCallsigns;
+  removed = oldCallsigns - newCallsigns;
+
+  // Get rows present in both databases having any different value
+  query.exec("select " + onlineTable + ".callsign from " + onlineTable + " where exists "
+             "(select 1 from main." + table + " s where s.callsign = " + onlineTable + ".callsign and "
+             "(" + changedCondition + "))");
+  while(query.next())
+    changed.insert(query.valueStr("callsign"));
+
+  // Delete vanished rows
+  query.exec("delete from " + onlineTable + " where callsign not in (select callsign from main." + table + ")");
+
+  // Update changed rows in place
+  query.exec("update " + onlineTable + " set (" + columnList + ") = "
+             "(select " + columnList + " from main." + table + " s where s.callsign = " + onlineTable + ".callsign) "
+             "where exists (select 1 from main." + table + " s where s.callsign = " + onlineTable + ".callsign and "
+             "(" + changedCondition + "))");
+
+  // Add new rows
+  query.exec("insert into " + onlineTable + " (" + columnList + ") "
+             "select " + columnList + " from main." + table +
+             " where callsign not in (select callsign from " + onlineTable + ")");
+}
+
+/* Runs in a thread of the global pool. Uses own database connections. */
+WhazzupResult readWhazzup(const WhazzupJob& job)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  WhazzupResult result;
+  result.lastUpdateTime = job.lastUpdateTime;
+
+  static std::atomic_int connectionId(0);
+  int id = connectionId++;
+  const QString stageConnectionName = STAGE_CONNECTION_NAME + QString::number(id);
+  const QString airspaceConnectionName = AIRSPACE_CONNECTION_NAME + QString::number(id);
+
+  auto isCancelled = [&job]() -> bool
+  {
+    return !job.cancelled.isNull() && *job.cancelled;
+  };
+
+  QByteArray whazzupData;
+  if(job.gzipped)
+  {
+    if(!atools::zip::gzipDecompress(job.data, whazzupData))
+      qWarning() << Q_FUNC_INFO << "Error unzipping data";
+  }
+  else
+    whazzupData = job.data;
+
+  QString whazzupText = job.codec->toUnicode(whazzupData);
+  whazzupData.clear();
+
+  SqlDatabase *stageDb = nullptr, *airspaceDb = nullptr;
+  AirspaceQuery *airspaceQuery = nullptr;
+  atools::fs::online::OnlinedataManager *stageManager = nullptr;
+
+  try
+  {
+    // Parse into an empty in-memory database to allow comparison with the current state
+    stageDb = DatabaseManager::openThreadDatabase(stageConnectionName, ":memory:", false /* readonly */);
+
+    if(job.airspaceByName || job.airspaceByFile)
+    {
+      airspaceDb = DatabaseManager::openThreadDatabase(airspaceConnectionName, job.userAirspaceDatabaseFile);
+      airspaceQuery = new AirspaceQuery(airspaceDb, map::AIRSPACE_SRC_USER);
+      airspaceQuery->initQueries();
+    }
+
+    stageManager = new atools::fs::online::OnlinedataManager(stageDb, job.verbose);
+    stageManager->createSchema();
+    stageManager->initQueries();
+    stageManager->setAtcSize(job.atcSizes);
+
+    // Same as OnlinedataController::geometryCallback but using the thread local query
+    stageManager->setGeometryCallback([&job, airspaceQuery](const QString& callsign,
+                                                            atools::fs::online::fac::FacilityType type) -> LineString *
+    {
+      LineString *lineString = nullptr;
+      if(airspaceQuery != nullptr)
+      {
+        // Try to get airspace boundary by name vs. callsign if set in options
+        if(job.airspaceByName)
+          lineString = airspaceQuery->getAirspaceGeometryByName(callsign,
+                                                                atools::fs::online::facilityTypeText(type));
+
+        // Try to get airspace boundary by file name vs. callsign if set in options
+        if(job.airspaceByFile && lineString == nullptr)
+          lineString = airspaceQuery->getAirspaceGeometryByFile(callsign);
+      }
+      return lineString;
+    });
+
+    // Parsing cannot be interrupted - check afterwards before touching the online database
+    if(stageManager->readFromWhazzup(whazzupText, job.format, job.lastUpdateTime) && !isCancelled())
+    {
+      result.updated = true;
+      result.lastUpdateTime = stageManager->getLastUpdateTimeFromWhazzup();
+      stageManager->getClientCallsignAndPosMap(result.clientCallsignAndPosMap);
+
+      // Attach cannot be done inside a transaction
+      SqlQuery query(stageDb);
+      query.prepare("attach database :file as " + ONLINE_SCHEMA);
+      query.bindValue(":file", job.onlineDatabaseFile);
+      query.exec();
+
+      {
+        // Write all changes at once so that the GUI thread never sees a partial update
+        atools::sql::SqlTransaction transaction(stageDb);
+        WhazzupDiff& diff = result.diff;
+        mergeTable(stageDb, "client", diff.clientsAdded, diff.clientsRemoved, diff.clientsChanged);
+        if(!isCancelled())
+          mergeTable(stageDb, "atc", diff.atcAdded, diff.atcRemoved, diff.atcChanged);
+
+        if(isCancelled())
+        {
+          // Leave the online database untouched
+          transaction.rollback();
+          result.updated = false;
+          result.diff = WhazzupDiff();
+        }
+        else
+          transaction.commit();
+      }
+
+      // Fetch new and changed aircraft with their final ids for the aircraft cache
+      if(result.updated && result.diff.hasClientChanges())
+      {
+        query.exec("select * from " + ONLINE_SCHEMA + ".client");
+        while(query.next())
+        {
+          QString callsign = query.valueStr("callsign");
+          if(result.diff.clientsAdded.contains(callsign) || result.diff.clientsChanged.contains(callsign))
+          {
+            atools::fs::sc::SimConnectAircraft aircraft;
+            atools::fs::online::OnlinedataManager::fillFromClient(aircraft, query.record());
+            result.changedAircraft.append(aircraft);
+          }
+        }
+      }
+      query.finish();
+      query.exec("detach database " + ONLINE_SCHEMA);
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught exception" << e.what();
+    result.updated = false;
+  }
+  catch(...)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught unknown exception";
+    result.updated = false;
+  }
+
+  // Manager and query have to be deleted before database to release the queries
+  if(stageManager != nullptr)
+  {
+    stageManager->setGeometryCallback(atools::fs::online::GeoCallbackType(nullptr));
+    stageManager->deInitQueries();
+    delete stageManager;
+  }
+  delete airspaceQuery;
+
+  DatabaseManager::closeThreadDatabase(stageDb, stageConnectionName);
+  if(airspaceDb != nullptr)
+    DatabaseManager::closeThreadDatabase(airspaceDb, airspaceConnectionName);
+
+  qDebug() << Q_FUNC_INFO << "updated" << result.updated << "cancelled" << isCancelled()
+           << "clients added" << result.diff.clientsAdded.size()
+           << "removed" << result.diff.clientsRemoved.size()
+           << "changed" << result.diff.clientsChanged.size()
+           << "atc added" << result.diff.atcAdded.size()
+           << "removed" << result.diff.atcRemoved.size()
+           << "changed" << result.diff.atcChanged.size()
+           << "time" << timer.elapsed() << "ms";
+
+  return result;
+}
+
+} // namespace online
@@ -0,0 +1,103 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LNM_ONLINEDATAREADER_H
+#define LNM_ONLINEDATAREADER_H
+
+#include "fs/online/onlinetypes.h"
+#include "fs/sc/simconnectaircraft.h"
+#include "geo/pos.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+
+#include <atomic>
+
+class QTextCodec;
+
+namespace online {
+
+/* All values needed to parse a whazzup.txt file in a background thread. Filled in the GUI thread. */
+struct WhazzupJob
+{
+  QByteArray data; /* Raw downloaded data */
+  bool gzipped = false;
+  QTextCodec *codec = nullptr;
+  atools::fs::online::Format format = atools::fs::online::UNKNOWN;
+
+  /* Files will be rejected if not newer than this */
+  QDateTime lastUpdateTime;
+
+  /* Online database which is updated and user airspace database used to look up center geometry */
+  QString onlineDatabaseFile, userAirspaceDatabaseFile;
+
+  QHash<atools::fs::online::fac::FacilityType, int> atcSizes;
+  bool airspaceByName = false, airspaceByFile = false, verbose = false;
+
+  /* Set by the GUI thread to stop the job. Nothing is written to the online database once set. */
+  QSharedPointer<std::atomic_bool> cancelled;
+};
+
+/* Callsigns of clients or ATC centers which were added, removed or changed (moved or other values
+ * like altitude, heading or ATIS) compared to the previous state of the online database. */
+struct WhazzupDiff
+{
+  QSet<QString> clientsAdded, clientsRemoved, clientsChanged, atcAdded, atcRemoved, atcChanged;
+
+  bool hasClientChanges() const
+  {
+    return !clientsAdded.isEmpty() || !clientsRemoved.isEmpty() || !clientsChanged.isEmpty();
+  }
+
+  bool hasAtcChanges() const
+  {
+    return !atcAdded.isEmpty() || !atcRemoved.isEmpty() || !atcChanged.isEmpty();
+  }
+
+  /* Add changes from another update which was not sent to the consumers yet */
+  void merge(const WhazzupDiff& other);
+};
+
+struct WhazzupResult
+{
+  /* false if file was not recent or on error. Online database is not changed in this case. */
+  bool updated = false;
+  QDateTime lastUpdateTime;
+
+  WhazzupDiff diff;
+
+  /* All callsigns and positions from online list to allow deduplication */
+  QHash<QString, atools::geo::Pos> clientCallsignAndPosMap;
+
+  /* Added and changed clients having the ids of the online database */
+  QList<atools::fs::sc::SimConnectAircraft> changedAircraft;
+};
+
+/*
+ * Decompresses, decodes and parses the whazzup data into an in-memory staging database and merges
+ * the differences into the online database. Rows of unchanged clients and centers keep their ids.
+ *
+ * Runs in a background thread and uses own database connections. A cancelled job can still run while the
+ * next one starts. Returns a result with updated set to false if cancelled.
+ */
+WhazzupResult readWhazzup(const WhazzupJob& job);
+
+} // namespace online
+
+#endif // LNM_ONLINEDATAREADER_H
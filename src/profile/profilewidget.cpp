@@ -47,6 +47,7 @@
 #include <QRubberBand>
 #include <QMouseEvent>
 #include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
 
 #include <marble/ElevationModel.h>
 #include <marble/GeoDataCoordinates.h>
@@ -1199,6 +1200,10 @@ void ProfileWidget::paintEvent(QPaintEvent *)
 /* Update signal from Marble elevation model */
 void ProfileWidget::elevationUpdateAvailable()
 {
+  // Elevation data has changed or is more complete now - fetch all legs again
+  legList.elevationCache.clear();
+  elevationCacheInvalidated = true;
+
   if(!widgetVisible || databaseLoadStatus)
     return;
 
@@ -1273,6 +1278,10 @@ void ProfileWidget::updateTimeout()
   ElevationLegList legs;
   legs.route = routeController->getRoute();
 
+  // Pass cached leg elevations to thread to avoid fetching unchanged legs again
+  legs.elevationCache = legList.elevationCache;
+  elevationCacheInvalidated = false;
+
   // Start thread
   future = QtConcurrent::run(this, &ProfileWidget::fetchRouteElevationsThread, legs);
 
@@ -1292,6 +1301,10 @@ void ProfileWidget::updateThreadFinished()
   {
     // Was not terminated in the middle of calculations - get result from the future
     legList = future.result();
+
+    if(elevationCacheInvalidated)
+      // Elevation data changed while thread was running - do not keep outdated legs
+      legList.elevationCache.clear();
     updateScreenCoords();
     updateErrorLabel();
     updateLabel();
@@ -1318,20 +1331,21 @@ bool ProfileWidget::fetchRouteElevations(atools::geo::LineString& elevations,
     QVector<Marble::GeoDataLineString *> coordsCorrected = coords.toDateLineCorrected();
     for(const Marble::GeoDataLineString *ls : coordsCorrected)
     {
-      for(int j = 1; j < ls->size(); j++)
+      if(terminateThreadSignal)
       {
-        if(terminateThreadSignal)
-          return false;
-
-        const Marble::GeoDataCoordinates& c1 = ls->at(j - 1);
-        const Marble::GeoDataCoordinates& c2 = ls->at(j);
-        Pos p1(c1.longitude(), c1.latitude());
-        Pos p2(c2.longitude(), c2.latitude());
+        qDeleteAll(coordsCorrected);
+        return false;
+      }
 
-        p1.toDeg();
-        p2.toDeg();
-        elevationProvider->getElevations(elevations, atools::geo::Line(p1, p2));
+      // Get elevations for each part on one side of the anti-meridian in one call
+      LineString part;
+      for(const Marble::GeoDataCoordinates& c : *ls)
+      {
+        Pos pos(c.longitude(), c.latitude());
+        pos.toDeg();
+        part.append(pos);
       }
+      elevationProvider->getElevations(elevations, part);
     }
     qDeleteAll(coordsCorrected);
   }
@@ -1349,6 +1363,37 @@ bool ProfileWidget::fetchRouteElevations(atools::geo::LineString& elevations,
   return true;
 }
 
+const LineString *ProfileWidget::cachedElevations(const ElevationCache& cache, const LineString& geometry)
+{
+  ElevationCache::const_iterator it = cache.constFind(geometryHash(geometry));
+  if(it != cache.constEnd())
+  {
+    // Check for hash collisions
+    const LineString& cachedGeometry = it.value().geometry;
+    if(cachedGeometry.size() == geometry.size())
+    {
+      for(int i = 0; i < geometry.size(); i++)
+      {
+        if(!cachedGeometry.at(i).almostEqual(geometry.at(i)))
+          return nullptr;
+      }
+      return &it.value().elevations;
+    }
+  }
+  return nullptr;
+}
+
+uint ProfileWidget::geometryHash(const LineString& geometry)
+{
+  uint hash = qHash(geometry.size());
+  for(const Pos& pos : geometry)
+  {
+    hash ^= qHash(pos.getLonX()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= qHash(pos.getLatY()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
 /* Background thread. Fetches elevation points from Marble elevation model and updates totals. */
 ProfileWidget::ElevationLegList ProfileWidget::fetchRouteElevationsThread(ElevationLegList legs) const
 {
@@ -1367,34 +1412,116 @@ ProfileWidget::ElevationLegList ProfileWidget::fetchRouteElevationsThread(Elevat
     // Return empty result
     return ElevationLegList();
 
-  // Loop over all route legs
+  const ElevationProvider *elevationProvider = NavApp::getElevationProvider();
+
+  // Collect geometry of all legs first ===================================
+  // Empty geometry if leg is skipped
+  QVector<LineString> geometries;
+  QVector<bool> fetchLegs;
   for(int i = 1; i <= legs.route.getDestinationLegIndex(); i++)
   {
-    if(terminateThreadSignal)
-      // Return empty result
-      return ElevationLegList();
-
     const RouteLeg& routeLeg = legs.route.value(i);
     if(routeLeg.getProcedureLeg().isMissed() || routeLeg.isAlternate())
       break;
 
     const RouteLeg& lastLeg = legs.route.value(i - 1);
-    ElevationLeg leg;
 
     // Skip for too long segments when using the marble online provider
-    if(routeLeg.getDistanceTo() < ELEVATION_MAX_LEG_NM || NavApp::getElevationProvider()->isGlobeOfflineProvider())
+    LineString geometry;
+    bool fetch = routeLeg.getDistanceTo() < ELEVATION_MAX_LEG_NM || elevationProvider->isGlobeOfflineProvider();
+    if(fetch)
     {
-      LineString geometry;
       if(routeLeg.isAnyProcedure() && routeLeg.getGeometry().size() > 2)
         geometry = routeLeg.getGeometry();
       else
         geometry << lastLeg.getPosition() << routeLeg.getPosition();
 
       geometry.removeInvalid();
+    }
+    geometries.append(geometry);
+    fetchLegs.append(fetch);
+  }
+
+  // Take unchanged legs from cache and collect the others ===================================
+  QVector<LineString> legElevations(geometries.size());
+  QVector<int> missingIndexes;
+  QVector<LineString> missingGeometries;
+  for(int i = 0; i < geometries.size(); i++)
+  {
+    const LineString& geometry = geometries.at(i);
+    if(!geometry.isEmpty())
+    {
+      const LineString *cached = cachedElevations(legs.elevationCache, geometry);
+      if(cached != nullptr)
+        legElevations[i] = *cached;
+      else
+      {
+        missingIndexes.append(i);
+        missingGeometries.append(geometry);
+      }
+    }
+  }
 
+  // Fetch elevations for new or changed legs ===================================
+  QVector<LineString> fetchedElevations;
+  if(elevationProvider->isConcurrent())
+  {
+    // Memory mapped GLOBE files allow to query legs in parallel without locking
+    std::function<LineString(const LineString&)> fetchFunc = [this](const LineString& geometry) -> LineString
+    {
+      LineString elevations;
+      fetchRouteElevations(elevations, geometry);
+      return elevations;
+    };
+    fetchedElevations = QtConcurrent::blockingMapped<QVector<LineString> >(missingGeometries, fetchFunc);
+  }
+  else
+  {
+    for(const LineString& geometry : missingGeometries)
+    {
       LineString elevations;
       if(!fetchRouteElevations(elevations, geometry))
         return ElevationLegList();
+      fetchedElevations.append(elevations);
+    }
+  }
+
+  if(terminateThreadSignal)
+    // Return empty result
+    return ElevationLegList();
+
+  // Add new legs to cache ===================================
+  for(int i = 0; i < missingIndexes.size(); i++)
+  {
+    legElevations[missingIndexes.at(i)] = fetchedElevations.at(i);
+    legs.elevationCache.insert(geometryHash(missingGeometries.at(i)), {missingGeometries.at(i), fetchedElevations.at(i)});
+  }
+
+  if(legs.elevationCache.size() > ELEVATION_CACHE_MAX_LEGS)
+  {
+    // Keep only legs of the current route
+    legs.elevationCache.clear();
+    for(int i = 0; i < geometries.size(); i++)
+    {
+      if(!geometries.at(i).isEmpty())
+        legs.elevationCache.insert(geometryHash(geometries.at(i)), {geometries.at(i), legElevations.at(i)});
+    }
+  }
+
+  // Loop over all route legs
+  for(int i = 1; i <= geometries.size(); i++)
+  {
+    if(terminateThreadSignal)
+      // Return empty result
+      return ElevationLegList();
+
+    const RouteLeg& routeLeg = legs.route.value(i);
+    const RouteLeg& lastLeg = legs.route.value(i - 1);
+    ElevationLeg leg;
+
+    if(fetchLegs.at(i - 1))
+    {
+      LineString& elevations = legElevations[i - 1];
 
       float dist = legs.totalDistance;
       // Loop over all elevation points for the current leg
@@ -23,6 +23,7 @@
 
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QWidget>
 
 namespace atools {
@@ -164,10 +165,21 @@ private:
     float maxElevation = 0.f; /* Max ground altitude for this leg */
   };
 
+  /* Elevation points for the geometry of a route leg. Allows to reuse results for unchanged legs. */
+  struct ElevationCacheEntry
+  {
+    atools::geo::LineString geometry; /* Leg geometry including procedure points used as key */
+    atools::geo::LineString elevations; /* Elevation points in meter as returned by fetchRouteElevations() */
+  };
+
+  /* Key is the hash of the leg geometry */
+  typedef QHash<uint, ElevationCacheEntry> ElevationCache;
+
   struct ElevationLegList
   {
     Route route; /* Copy from route controller.
                   * Need a copy to avoid thread synchronization problems. */
+    ElevationCache elevationCache; /* Passed to the thread and returned with updated entries */
     QList<ElevationLeg> elevationLegs; /* Elevation data for each route leg */
     float maxElevationFt = 0.f /* Maximum ground elevation for the route */,
           totalDistance = 0.f /* Total route distance in nautical miles */;
@@ -188,6 +200,12 @@ private:
   virtual void contextMenuEvent(QContextMenuEvent *event) override;
 
   bool fetchRouteElevations(atools::geo::LineString& elevations, const atools::geo::LineString& geometry) const;
+
+  /* Get cached elevations for the geometry. Returns nullptr if not found. */
+  static const atools::geo::LineString *cachedElevations(const ElevationCache& cache,
+                                                         const atools::geo::LineString& geometry);
+  static uint geometryHash(const atools::geo::LineString& geometry);
+
   ElevationLegList fetchRouteElevationsThread(ElevationLegList legs) const;
   void elevationUpdateAvailable();
   void updateTimeout();
@@ -248,6 +266,9 @@ private:
   /* Do not calculate a profile for legs longer than this value */
   static Q_DECL_CONSTEXPR int ELEVATION_MAX_LEG_NM = 2000;
 
+  /* Drop cached leg elevations which are not used by the current route if cache grows beyond this size */
+  static Q_DECL_CONSTEXPR int ELEVATION_CACHE_MAX_LEGS = 2000;
+
   /* User aircraft data */
   atools::fs::sc::SimConnectData simData, lastSimData;
 
@@ -272,6 +293,9 @@ private:
   QFutureWatcher<ElevationLegList> watcher;
   bool terminateThreadSignal = false;
 
+  /* Set if elevation data changed while the thread was running to avoid taking over outdated cache entries */
+  bool elevationCacheInvalidated = false;
+
   bool databaseLoadStatus = false;
 
   QRubberBand *rubberBand = nullptr;
@@ -282,6 +282,7 @@ const QList<map::MapApron> *AirportQuery::getAprons(int airportId)
     return apronCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     apronQuery->bindValue(":airportId", airportId);
     apronQuery->exec();
 
@@ -344,6 +345,7 @@ const QList<map::MapParking> *AirportQuery::getParkingsForAirport(int airportId)
     return parkingCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     parkingQuery->bindValue(":airportId", airportId);
     parkingQuery->exec();
 
@@ -367,6 +369,7 @@ const QList<map::MapStart> *AirportQuery::getStartPositionsForAirport(int airpor
     return startCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     startQuery->bindValue(":airportId", airportId);
     startQuery->exec();
 
@@ -555,6 +558,7 @@ const QList<map::MapHelipad> *AirportQuery::getHelipads(int airportId)
     return helipadCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     helipadQuery->bindValue(":airportId", airportId);
     helipadQuery->exec();
 
@@ -699,6 +703,7 @@ const QList<map::MapTaxiPath> *AirportQuery::getTaxiPaths(int airportId)
     return taxipathCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     taxiparthQuery->bindValue(":airportId", airportId);
     taxiparthQuery->exec();
 
@@ -729,6 +734,7 @@ const QList<map::MapRunway> *AirportQuery::getRunways(int airportId)
     return runwayCache.object(airportId);
   else
   {
+    query::SqlTimer sqlTimer;
     runwaysQuery->bindValue(":airportId", airportId);
     runwaysQuery->exec();
 
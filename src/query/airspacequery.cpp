@@ -44,25 +44,39 @@ static double queryRectInflationFactor = 0.2;
 static double queryRectInflationIncrement = 0.1;
 int AirspaceQuery::queryMaxRows = 5000;
 
+/* Cache sizes. Read once from settings by the first instance which is created in the GUI thread.
+ * Instances created later in background threads do not access the settings. */
+static bool settingsLoaded = false;
+static int airspaceLineCacheSize = 10000, onlineCenterGeoCacheSize = 10000, onlineCenterGeoFileCacheSize = 10000;
+
 AirspaceQuery::AirspaceQuery(SqlDatabase *sqlDb, map::MapAirspaceSources src)
   : db(sqlDb), source(src)
 {
   mapTypesFactory = new MapTypesFactory();
-  atools::settings::Settings& settings = atools::settings::Settings::instance();
-
-  airspaceLineCache.setMaxCost(settings.getAndStoreValue(
-                                 lnm::SETTINGS_MAPQUERY + "AirspaceLineCache", 10000).toInt());
-  onlineCenterGeoCache.setMaxCost(settings.getAndStoreValue(
-                                    lnm::SETTINGS_MAPQUERY + "OnlineCenterGeoCache", 10000).toInt());
-  onlineCenterGeoFileCache.setMaxCost(settings.getAndStoreValue(
-                                        lnm::SETTINGS_MAPQUERY + "OnlineCenterGeoFileCache", 10000).toInt());
-
-  queryRectInflationFactor = settings.getAndStoreValue(
-    lnm::SETTINGS_MAPQUERY + "QueryRectInflationFactor", 0.3).toDouble();
-  queryRectInflationIncrement = settings.getAndStoreValue(
-    lnm::SETTINGS_MAPQUERY + "QueryRectInflationIncrement", 0.1).toDouble();
-  queryMaxRows = settings.getAndStoreValue(
-    lnm::SETTINGS_MAPQUERY + "QueryRowLimit", 5000).toInt();
+
+  if(!settingsLoaded)
+  {
+    atools::settings::Settings& settings = atools::settings::Settings::instance();
+
+    airspaceLineCacheSize = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "AirspaceLineCache", 10000).toInt();
+    onlineCenterGeoCacheSize = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "OnlineCenterGeoCache", 10000).toInt();
+    onlineCenterGeoFileCacheSize = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "OnlineCenterGeoFileCache", 10000).toInt();
+
+    queryRectInflationFactor = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "QueryRectInflationFactor", 0.3).toDouble();
+    queryRectInflationIncrement = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "QueryRectInflationIncrement", 0.1).toDouble();
+    queryMaxRows = settings.getAndStoreValue(
+      lnm::SETTINGS_MAPQUERY + "QueryRowLimit", 5000).toInt();
+    settingsLoaded = true;
+  }
+
+  airspaceLineCache.setMaxCost(airspaceLineCacheSize);
+  onlineCenterGeoCache.setMaxCost(onlineCenterGeoCacheSize);
+  onlineCenterGeoFileCache.setMaxCost(onlineCenterGeoFileCacheSize);
 }
 
 AirspaceQuery::~AirspaceQuery()
@@ -197,6 +211,7 @@ const QList<map::MapAirspace> *AirspaceQuery::getAirspaces(const GeoDataLatLonBo
 
         for(const QString& typeStr : typeStrings)
         {
+          query::SqlTimer sqlTimer;
           query::bindRect(r, query);
           query->bindValue(":type", typeStr);
 
@@ -239,6 +254,7 @@ const LineString *AirspaceQuery::getAirspaceGeometryByName(int airspaceId)
     return airspaceLineCache.object(airspaceId);
   else
   {
+    query::SqlTimer sqlTimer;
     LineString *lines = new LineString;
 
     airspaceLinesByIdQuery->bindValue(":id", airspaceId);
@@ -255,6 +271,21 @@ const LineString *AirspaceQuery::getAirspaceGeometryByName(int airspaceId)
   }
 }
 
+void AirspaceQuery::getAllAirspaces(QVector<map::MapAirspace>& airspaces)
+{
+  if(airspaceAllQuery != nullptr)
+  {
+    query::SqlTimer sqlTimer;
+    airspaceAllQuery->exec();
+    while(airspaceAllQuery->next())
+    {
+      map::MapAirspace airspace;
+      mapTypesFactory->fillAirspace(airspaceAllQuery->record(), airspace, source);
+      airspaces.append(airspace);
+    }
+  }
+}
+
 LineString *AirspaceQuery::getAirspaceGeometryByFile(QString callsign)
 {
   if(airspaceGeoByFileQuery != nullptr)
@@ -438,6 +469,9 @@ void AirspaceQuery::initQueries()
   airspaceLinesByIdQuery = new SqlQuery(db);
   airspaceLinesByIdQuery->prepare("select geometry from " + table + " where " + id + " = :id");
 
+  airspaceAllQuery = new SqlQuery(db);
+  airspaceAllQuery->prepare("select " + airspaceQueryBase + "from " + table);
+
   // Queries for online center boundary matches
   if(!(source & map::AIRSPACE_SRC_ONLINE))
   {
@@ -466,6 +500,9 @@ void AirspaceQuery::deInitQueries()
   delete airspaceLinesByIdQuery;
   airspaceLinesByIdQuery = nullptr;
 
+  delete airspaceAllQuery;
+  airspaceAllQuery = nullptr;
+
   delete airspaceGeoByNameQuery;
   airspaceGeoByNameQuery = nullptr;
 
@@ -67,6 +67,9 @@ public:
                                               map::MapAirspaceFilter filter, float flightPlanAltitude, bool lazy);
   const atools::geo::LineString *getAirspaceGeometryByName(int airspaceId);
 
+  /* Get all airspaces without geometry. Used to build the containment index. Not cached. */
+  void getAllAirspaces(QVector<map::MapAirspace>& airspaces);
+
   /* Query raw geometry blob by online callsign (name) and facility type */
   atools::geo::LineString *getAirspaceGeometryByName(const QString& callsign, const QString& facilityType);
 
@@ -111,7 +114,8 @@ private:
   atools::sql::SqlQuery *airspaceByRectQuery = nullptr, *airspaceByRectBelowAltQuery = nullptr,
                         *airspaceByRectAboveAltQuery = nullptr, *airspaceByRectAtAltQuery = nullptr,
                         *airspaceLinesByIdQuery = nullptr, *airspaceGeoByNameQuery = nullptr,
-                        *airspaceGeoByFileQuery = nullptr, *airspaceByIdQuery = nullptr, *airspaceInfoQuery = nullptr;
+                        *airspaceGeoByFileQuery = nullptr, *airspaceByIdQuery = nullptr, *airspaceInfoQuery = nullptr,
+                        *airspaceAllQuery = nullptr;
 
   /* Source database definition */
   map::MapAirspaceSources source;
@@ -0,0 +1,200 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "query/mapprefetcher.h"
+
+#include "db/databasemanager.h"
+#include "sql/sqldatabase.h"
+#include "exception.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+const static QString SIM_CONNECTION_NAME("LNMPREFETCHSIM");
+const static QString NAV_CONNECTION_NAME("LNMPREFETCHNAV");
+
+MapPrefetcher::MapPrefetcher(query::TileStore *store)
+  : tileStore(store)
+{
+  cancelSignal = false;
+
+  // Keep the thread and its database connections alive between prefetches
+  threadPool.setMaxThreadCount(1);
+  threadPool.setExpiryTimeout(-1);
+}
+
+MapPrefetcher::~MapPrefetcher()
+{
+  closeDatabases();
+}
+
+void MapPrefetcher::start(const QVector<query::TileKey>& keys, const TileLoadParameters& params,
+                          const QString& simFile, const QString& navFile, int maxRows)
+{
+  cancel();
+  cancelSignal = false;
+  queryMaxRows = maxRows;
+
+  watcher = new QFutureWatcher<QVector<query::PrefetchedTile> >(this);
+  connect(watcher, &QFutureWatcher<QVector<query::PrefetchedTile> >::finished, this, &MapPrefetcher::watcherFinished);
+  watcher->setFuture(QtConcurrent::run(&threadPool, this, &MapPrefetcher::prefetch, keys, params, simFile,
+                                       navFile));
+}
+
+void MapPrefetcher::cancel()
+{
+  if(watcher != nullptr)
+  {
+    cancelSignal = true;
+    watcher->disconnect(this);
+    watcher->waitForFinished();
+    deleteTiles(watcher->result());
+    watcher->deleteLater();
+    watcher = nullptr;
+  }
+}
+
+void MapPrefetcher::closeDatabases()
+{
+  cancel();
+
+  // Connections have to be closed in the thread which opened them
+  QtConcurrent::run(&threadPool, this, &MapPrefetcher::closeDatabasesInternal).waitForFinished();
+}
+
+bool MapPrefetcher::isRunning() const
+{
+  return watcher != nullptr && watcher->isRunning();
+}
+
+void MapPrefetcher::deleteTiles(const QVector<query::PrefetchedTile>& tiles)
+{
+  for(const query::PrefetchedTile& tile : tiles)
+    delete tile.second;
+}
+
+/* Called in GUI thread by the watcher */
+void MapPrefetcher::watcherFinished()
+{
+  QVector<query::PrefetchedTile> tiles = watcher->result();
+  watcher->disconnect(this);
+  watcher->deleteLater();
+  watcher = nullptr;
+
+  int inserted = 0;
+  for(const query::PrefetchedTile& tile : tiles)
+  {
+    if(tile.second == nullptr)
+      continue;
+
+    // Tile might have been loaded by the GUI thread in the meantime
+    if(!tileStore->contains(tile.first) && tile.second->size() < queryMaxRows)
+    {
+      tileStore->insert(tile.first, tile.second, std::max(tile.second->size(), 1));
+      inserted++;
+    }
+    else
+      delete tile.second;
+  }
+
+#ifdef DEBUG_INFORMATION
+  qDebug() << Q_FUNC_INFO << "tiles" << tiles.size() << "inserted" << inserted;
+#else
+  Q_UNUSED(inserted)
+#endif
+}
+
+/* Runs in the thread of the own pool. Uses own database connections. */
+QVector<query::PrefetchedTile> MapPrefetcher::prefetch(QVector<query::TileKey> keys, TileLoadParameters params,
+                                                       QString simFile, QString navFile)
+{
+  QThread::currentThread()->setPriority(QThread::LowPriority);
+
+#ifdef DEBUG_INFORMATION
+  QElapsedTimer timer;
+  timer.start();
+#endif
+
+  QVector<query::PrefetchedTile> tiles;
+  if(cancelSignal)
+    return tiles;
+
+  try
+  {
+    openDatabases(simFile, navFile);
+
+    for(const query::TileKey& key : keys)
+    {
+      if(cancelSignal)
+        break;
+      tiles.append(std::make_pair(key, loader->loadTile(key, params)));
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught exception" << e.what();
+  }
+  catch(...)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught unknown exception";
+  }
+
+#ifdef DEBUG_INFORMATION
+  qDebug() << Q_FUNC_INFO << "tiles" << tiles.size() << "of" << keys.size() << "time" << timer.elapsed() << "ms";
+#endif
+
+  return tiles;
+}
+
+void MapPrefetcher::openDatabases(const QString& simFile, const QString& navFile)
+{
+  if(loader != nullptr && simFile == dbSimFile && navFile == dbNavFile)
+    return;
+
+  closeDatabasesInternal();
+
+  dbSim = DatabaseManager::openThreadDatabase(SIM_CONNECTION_NAME, simFile);
+
+  // Use only one connection if simulator and navigation data are in the same file
+  if(navFile != simFile)
+    dbNav = DatabaseManager::openThreadDatabase(NAV_CONNECTION_NAME, navFile);
+
+  loader = new MapTileLoader(dbSim, dbNav != nullptr ? dbNav : dbSim, queryMaxRows);
+  loader->initQueries();
+
+  dbSimFile = simFile;
+  dbNavFile = navFile;
+}
+
+void MapPrefetcher::closeDatabasesInternal()
+{
+  // Loader has to be deleted before database to release the queries
+  delete loader;
+  loader = nullptr;
+
+  if(dbSim != nullptr)
+    DatabaseManager::closeThreadDatabase(dbSim, SIM_CONNECTION_NAME);
+  dbSim = nullptr;
+
+  if(dbNav != nullptr)
+    DatabaseManager::closeThreadDatabase(dbNav, NAV_CONNECTION_NAME);
+  dbNav = nullptr;
+
+  dbSimFile.clear();
+  dbNavFile.clear();
+}
@@ -0,0 +1,102 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPPREFETCHER_H
+#define LITTLENAVMAP_MAPPREFETCHER_H
+
+#include "query/maptileloader.h"
+#include "query/querytypes.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
+
+namespace query {
+/* Tile loaded by the prefetch worker. Ownership is passed to the tile store or the tile is deleted. */
+typedef std::pair<query::TileKey, query::TileBase *> PrefetchedTile;
+}
+
+/*
+ * Loads map object tiles in a background thread and adds them to the shared tile store once finished.
+ *
+ * Uses an own pool with a single thread which never expires. The thread opens its own readonly connections
+ * to the simulator and navigation databases on first use and keeps them until closeDatabases() is called.
+ * Only one prefetch is running at a time. Tiles which were added to the store
+ * by the GUI thread in the meantime are dropped.
+ */
+class MapPrefetcher :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  /* @param store Tile store filled in GUI thread. */
+  MapPrefetcher(query::TileStore *store);
+  virtual ~MapPrefetcher() override;
+
+  /*
+   * Start loading tiles in the background. Cancels a running prefetch before.
+   * @param keys tiles to load
+   * @param params query parameters copied from the map layer
+   * @param simFile, navFile database files which are opened readonly by the thread
+   * @param maxRows tiles having this number of objects or more are not added to the store
+   */
+  void start(const QVector<query::TileKey>& keys, const TileLoadParameters& params, const QString& simFile,
+             const QString& navFile, int maxRows);
+
+  /* Stop loading and wait for the thread. Loaded tiles are discarded. */
+  void cancel();
+
+  /* Cancel and close the database connections of the thread. Has to be called before loading a new database. */
+  void closeDatabases();
+
+  bool isRunning() const;
+
+private:
+  /* Runs in background thread */
+  QVector<query::PrefetchedTile> prefetch(QVector<query::TileKey> keys, TileLoadParameters params,
+                                          QString simFile, QString navFile);
+
+  /* Open connections if not already done for the given files. Runs in background thread. */
+  void openDatabases(const QString& simFile, const QString& navFile);
+
+  /* Delete loader and close connections. Runs in background thread. */
+  void closeDatabasesInternal();
+
+  /* Called in GUI thread */
+  void watcherFinished();
+
+  static void deleteTiles(const QVector<query::PrefetchedTile>& tiles);
+
+  query::TileStore *tileStore;
+  QFutureWatcher<QVector<query::PrefetchedTile> > *watcher = nullptr;
+  int queryMaxRows = 0;
+
+  std::atomic_bool cancelSignal;
+
+  /* Pool having one thread owning the connections below */
+  QThreadPool threadPool;
+
+  /* Only accessed in the pool thread */
+  atools::sql::SqlDatabase *dbSim = nullptr, *dbNav = nullptr;
+  MapTileLoader *loader = nullptr;
+  QString dbSimFile, dbNavFile;
+};
+
+#endif // LITTLENAVMAP_MAPPREFETCHER_H
@@ -20,6 +20,7 @@
 #include "common/constants.h"
 #include "common/maptypesfactory.h"
 #include "common/maptools.h"
+#include "common/screengrid.h"
 #include "common/proctypes.h"
 #include "fs/common/binarygeometry.h"
 #include "online/onlinedatacontroller.h"
@@ -29,6 +30,8 @@
 #include "sql/sqlquery.h"
 #include "sql/sqlrecord.h"
 #include "query/airportquery.h"
+#include "query/mapprefetcher.h"
+#include "query/maptileloader.h"
 #include "navapp.h"
 #include "common/maptools.h"
 #include "settings/settings.h"
@@ -60,6 +63,51 @@ static double queryRectInflationFactor = 0.2;
 static double queryRectInflationIncrement = 0.1;
 int MapQuery::queryMaxRows = 5000;
 
+/* Layer comparison functions for the tile caches. Layers having the same query parameters share tiles. */
+static bool sameLayerAirport(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersAirport(newLayer);
+}
+
+static bool sameLayerWaypoint(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersWaypoint(newLayer);
+}
+
+static bool sameLayerVor(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersVor(newLayer);
+}
+
+static bool sameLayerNdb(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersNdb(newLayer);
+}
+
+static bool sameLayerMarker(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersMarker(newLayer);
+}
+
+static bool sameLayerIls(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersIls(newLayer);
+}
+
+static bool sameLayerAirway(const MapLayer *curLayer, const MapLayer *newLayer)
+{
+  return curLayer->hasSameQueryParametersAirway(newLayer);
+}
+
+/* Increase bounding rect since ILS has no bounding to query */
+static void increaseIlsRect(GeoDataLatLonBox& rect)
+{
+  // ILS length is 9 NM * 1' per degree
+  double increase = atools::geo::toRadians(9. / 60.);
+  rect.setBoundaries(rect.north() + increase, rect.south() - increase,
+                     rect.east() + increase, rect.west() - increase);
+}
+
 MapQuery::MapQuery(atools::sql::SqlDatabase *sqlDb, SqlDatabase *sqlDbNav, SqlDatabase *sqlDbUser)
   : dbSim(sqlDb), dbNav(sqlDbNav), dbUser(sqlDbUser)
 {
@@ -74,11 +122,20 @@ MapQuery::MapQuery(atools::sql::SqlDatabase *sqlDb, SqlDatabase *sqlDbNav, SqlDa
     lnm::SETTINGS_MAPQUERY + "QueryRectInflationIncrement", 0.1).toDouble();
   queryMaxRows = settings.getAndStoreValue(
     lnm::SETTINGS_MAPQUERY + "QueryRowLimit", 5000).toInt();
+
+  // Cost is number of objects in all tiles
+  tileStore.setMaxCost(settings.getAndStoreValue(lnm::SETTINGS_MAPQUERY + "TileCacheSize", 100000).toInt());
+  prefetchEnabled = settings.getAndStoreValue(lnm::SETTINGS_MAPQUERY + "Prefetch", true).toBool();
+
+  tileLoader = new MapTileLoader(dbSim, dbNav, queryMaxRows);
+  prefetcher = new MapPrefetcher(&tileStore);
 }
 
 MapQuery::~MapQuery()
 {
   deInitQueries();
+  delete prefetcher;
+  delete tileLoader;
   delete mapTypesFactory;
 }
 
@@ -195,42 +252,29 @@ map::MapSearchResultIndex *MapQuery::nearestNavaidsInternal(const Pos& pos, floa
     // Create a rectangle that roughly covers the requested region
     atools::geo::Rect rect(pos, atools::geo::nmToMeter(distanceNm));
 
-    if(type & map::VOR)
-    {
-      query::fetchObjectsForRect(rect, vorsByRectQuery, [ =, &res](atools::sql::SqlQuery *query) -> void {
-        map::MapVor obj;
-        mapTypesFactory->fillVor(query->record(), obj);
-        res.vors.append(obj);
-      });
-    }
+    // Split at anti-meridian and convert to Marble rectangles for the loader
+    QList<GeoDataLatLonBox> boxes;
+    for(const atools::geo::Rect& r : rect.splitAtAntiMeridian())
+      boxes.append(GeoDataLatLonBox(r.getNorth(), r.getSouth(), r.getEast(), r.getWest(), GeoDataCoordinates::Degree));
 
-    if(type & map::NDB)
+    for(const GeoDataLatLonBox& box : boxes)
     {
-      query::fetchObjectsForRect(rect, ndbsByRectQuery, [ =, &res](atools::sql::SqlQuery *query) -> void {
-        map::MapNdb obj;
-        mapTypesFactory->fillNdb(query->record(), obj);
-        res.ndbs.append(obj);
-      });
-    }
+      if(type & map::VOR)
+        tileLoader->loadVors(box, res.vors);
 
-    if(type & map::WAYPOINT)
-    {
-      query::fetchObjectsForRect(rect, waypointsByRectQuery, [ =, &res](atools::sql::SqlQuery *query) -> void {
-        map::MapWaypoint obj;
-        mapTypesFactory->fillWaypoint(query->record(), obj);
-        res.waypoints.append(obj);
-      });
+      if(type & map::NDB)
+        tileLoader->loadNdbs(box, res.ndbs);
+
+      if(type & map::WAYPOINT)
+        tileLoader->loadWaypoints(box, res.waypoints);
     }
 
     if(type & map::ILS)
     {
       QList<map::MapIls> ilsRes;
+      for(const GeoDataLatLonBox& box : boxes)
+        tileLoader->loadIls(box, ilsRes);
 
-      query::fetchObjectsForRect(rect, ilsByRectQuery, [ =, &ilsRes](atools::sql::SqlQuery *query) -> void {
-        map::MapIls obj;
-        mapTypesFactory->fillIls(query->record(), obj);
-        ilsRes.append(obj);
-      });
       maptools::removeByDistance(ilsRes, pos, atools::geo::nmToMeter(maxIlsDist));
       maptools::sortByDistance(ilsRes, pos);
       res.ils.append(ilsRes.mid(0, maxIls));
@@ -636,119 +680,177 @@ map::MapWaypoint MapQuery::getWaypointById(int id)
   return wp;
 }
 
-void MapQuery::getNearestScreenObjects(const CoordinateConverter& conv, const MapLayer *mapLayer,
-                                       bool airportDiagram, map::MapObjectTypes types,
-                                       int xs, int ys, int screenDistance,
-                                       map::MapSearchResult& result)
+/* Type of entries in the screen grid. Index refers to the respective cache list. */
+enum ScreenGridType
 {
-  using maptools::insertSortedByDistance;
-  using maptools::insertSortedByTowerDistance;
+  GRID_AIRPORT,
+  GRID_TOWER,
+  GRID_VOR,
+  GRID_NDB,
+  GRID_WAYPOINT,
+  GRID_USERPOINT,
+  GRID_MARKER,
+  GRID_ILS
+};
+
+/* Screen grid margin to catch objects just outside of the visible area. Larger than any tooltip distance. */
+static const int SCREEN_GRID_MARGIN = 100;
+
+void MapQuery::updateScreenGrid(ScreenGrid& grid, const CoordinateConverter& conv, const QRect& screenRect,
+                                const MapLayer *mapLayer, bool airportDiagram, map::MapObjectTypes types) const
+{
+  grid.reset(screenRect, SCREEN_GRID_MARGIN);
 
   int x, y;
   if(mapLayer->isAirport() && types.testFlag(map::AIRPORT))
   {
-    for(int i = airportCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < airportCache.list.size(); i++)
     {
       const MapAirport& airport = airportCache.list.at(i);
 
       if(airport.isVisible(types))
       {
         if(conv.wToS(airport.position, x, y))
-          if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-            insertSortedByDistance(conv, result.airports, &result.airportIds, xs, ys, airport);
+          grid.insert(x, y, GRID_AIRPORT, i);
 
-        if(airportDiagram)
-        {
-          // Include tower for airport diagrams
-          if(conv.wToS(airport.towerCoords, x, y) &&
-             atools::geo::manhattanDistance(x, y, xs, ys) < screenDistance)
-            insertSortedByTowerDistance(conv, result.towers, xs, ys, airport);
-        }
+        // Include tower for airport diagrams
+        if(airportDiagram && conv.wToS(airport.towerCoords, x, y))
+          grid.insert(x, y, GRID_TOWER, i);
       }
     }
   }
 
   if(mapLayer->isVor() && types.testFlag(map::VOR))
   {
-    for(int i = vorCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < vorCache.list.size(); i++)
     {
-      const MapVor& vor = vorCache.list.at(i);
-      if(conv.wToS(vor.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.vors, &result.vorIds, xs, ys, vor);
+      if(conv.wToS(vorCache.list.at(i).position, x, y))
+        grid.insert(x, y, GRID_VOR, i);
     }
   }
 
   if(mapLayer->isNdb() && types.testFlag(map::NDB))
   {
-    for(int i = ndbCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < ndbCache.list.size(); i++)
     {
-      const MapNdb& ndb = ndbCache.list.at(i);
-      if(conv.wToS(ndb.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.ndbs, &result.ndbIds, xs, ys, ndb);
+      if(conv.wToS(ndbCache.list.at(i).position, x, y))
+        grid.insert(x, y, GRID_NDB, i);
     }
   }
 
-  if(mapLayer->isWaypoint() && types.testFlag(map::WAYPOINT))
+  // Waypoints and waypoints that displayed together with airways
+  bool waypoints = mapLayer->isWaypoint() && types.testFlag(map::WAYPOINT);
+  bool airwayWaypoints = mapLayer->isAirwayWaypoint() &&
+                         (types.testFlag(map::AIRWAYV) || types.testFlag(map::AIRWAYJ));
+  if(waypoints || airwayWaypoints)
   {
-    for(int i = waypointCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < waypointCache.list.size(); i++)
     {
       const MapWaypoint& wp = waypointCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys, wp);
+      if(waypoints || (wp.hasVictorAirways && types.testFlag(map::AIRWAYV)) ||
+         (wp.hasJetAirways && types.testFlag(map::AIRWAYJ)))
+      {
+        if(conv.wToS(wp.position, x, y))
+          grid.insert(x, y, GRID_WAYPOINT, i);
+      }
     }
   }
 
   // No flag since visibility is defined by type
   if(mapLayer->isUserpoint())
   {
-    for(int i = userpointCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < userpointCache.list.size(); i++)
     {
-      const MapUserpoint& wp = userpointCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.userpoints, &result.userpointIds, xs, ys, wp);
+      if(conv.wToS(userpointCache.list.at(i).position, x, y))
+        grid.insert(x, y, GRID_USERPOINT, i);
     }
   }
 
-  // Add waypoints that displayed together with airways =================================
-  if(mapLayer->isAirwayWaypoint() && (types.testFlag(map::AIRWAYV) || types.testFlag(map::AIRWAYJ)))
+  if(mapLayer->isMarker() && types.testFlag(map::MARKER))
   {
-    for(int i = waypointCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < markerCache.list.size(); i++)
     {
-      const MapWaypoint& wp = waypointCache.list.at(i);
-      if((wp.hasVictorAirways && types.testFlag(map::AIRWAYV)) ||
-         (wp.hasJetAirways && types.testFlag(map::AIRWAYJ)))
-        if(conv.wToS(wp.position, x, y))
-          if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-            insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys, wp);
+      if(conv.wToS(markerCache.list.at(i).position, x, y))
+        grid.insert(x, y, GRID_MARKER, i);
     }
   }
 
-  if(mapLayer->isMarker() && types.testFlag(map::MARKER))
+  if(mapLayer->isIls() && types.testFlag(map::ILS))
   {
-    for(int i = markerCache.list.size() - 1; i >= 0; i--)
+    for(int i = 0; i < ilsCache.list.size(); i++)
     {
-      const MapMarker& wp = markerCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.markers, nullptr, xs, ys, wp);
+      if(conv.wToS(ilsCache.list.at(i).position, x, y))
+        grid.insert(x, y, GRID_ILS, i);
     }
   }
 
-  if(mapLayer->isIls() && types.testFlag(map::ILS))
+  grid.finish();
+}
+
+quint32 MapQuery::getScreenCacheGeneration() const
+{
+  return airportCache.generation + vorCache.generation + ndbCache.generation + waypointCache.generation +
+         userpointCache.generation + markerCache.generation + ilsCache.generation;
+}
+
+void MapQuery::getNearestScreenObjects(const CoordinateConverter& conv, const ScreenGrid& grid,
+                                       const MapLayer *mapLayer, bool airportDiagram, map::MapObjectTypes types,
+                                       int xs, int ys, int screenDistance, map::MapSearchResult& result)
+{
+  using maptools::insertSortedByDistance;
+  using maptools::insertSortedByTowerDistance;
+
+  // Objects from cache lists which are near the position
+  grid.query(xs, ys, screenDistance, [&](const ScreenGrid::Entry& entry)
   {
-    for(int i = ilsCache.list.size() - 1; i >= 0; i--)
+    switch(static_cast<ScreenGridType>(entry.type))
     {
-      const MapIls& wp = ilsCache.list.at(i);
-      if(conv.wToS(wp.position, x, y))
-        if((atools::geo::manhattanDistance(x, y, xs, ys)) < screenDistance)
-          insertSortedByDistance(conv, result.ils, nullptr, xs, ys, wp);
+      case GRID_AIRPORT:
+        if(entry.index < airportCache.list.size())
+          insertSortedByDistance(conv, result.airports, &result.airportIds, xs, ys,
+                                 airportCache.list.at(entry.index));
+        break;
+
+      case GRID_TOWER:
+        if(entry.index < airportCache.list.size())
+          insertSortedByTowerDistance(conv, result.towers, xs, ys, airportCache.list.at(entry.index));
+        break;
+
+      case GRID_VOR:
+        if(entry.index < vorCache.list.size())
+          insertSortedByDistance(conv, result.vors, &result.vorIds, xs, ys, vorCache.list.at(entry.index));
+        break;
+
+      case GRID_NDB:
+        if(entry.index < ndbCache.list.size())
+          insertSortedByDistance(conv, result.ndbs, &result.ndbIds, xs, ys, ndbCache.list.at(entry.index));
+        break;
+
+      case GRID_WAYPOINT:
+        if(entry.index < waypointCache.list.size())
+          insertSortedByDistance(conv, result.waypoints, &result.waypointIds, xs, ys,
+                                 waypointCache.list.at(entry.index));
+        break;
+
+      case GRID_USERPOINT:
+        if(entry.index < userpointCache.list.size())
+          insertSortedByDistance(conv, result.userpoints, &result.userpointIds, xs, ys,
+                                 userpointCache.list.at(entry.index));
+        break;
+
+      case GRID_MARKER:
+        if(entry.index < markerCache.list.size())
+          insertSortedByDistance(conv, result.markers, nullptr, xs, ys, markerCache.list.at(entry.index));
+        break;
+
+      case GRID_ILS:
+        if(entry.index < ilsCache.list.size())
+          insertSortedByDistance(conv, result.ils, nullptr, xs, ys, ilsCache.list.at(entry.index));
+        break;
     }
-  }
+  });
 
+  int x, y;
   // Get objects from airport diagram =====================================================
   if(mapLayer->isAirport() && types.testFlag(map::AIRPORT))
   {
@@ -783,113 +885,67 @@ void MapQuery::getNearestScreenObjects(const CoordinateConverter& conv, const Ma
 }
 
 const QList<map::MapAirport> *MapQuery::getAirports(const Marble::GeoDataLatLonBox& rect,
-                                                    const MapLayer *mapLayer, bool lazy)
+                                                    const MapLayer *mapLayer, bool lazy, bool *overflow)
 {
-  airportCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                           [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
+  TileLoadParameters params = tileLoadParameters(mapLayer);
+  airportCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                           queryMaxRows, lazy, sameLayerAirport,
+                           [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapAirport>& airports) -> void
   {
-    return curLayer->hasSameQueryParametersAirport(newLayer);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadAirports(tileRect, params, airports);
   });
 
-  switch(mapLayer->getDataSource())
-  {
-    case layer::ALL:
-      airportByRectQuery->bindValue(":minlength", mapLayer->getMinRunwayLength());
-      return fetchAirports(rect, airportByRectQuery, lazy, false /* overview */);
-
-    case layer::MEDIUM:
-      // Airports > 4000 ft
-      return fetchAirports(rect, airportMediumByRectQuery, lazy, true /* overview */);
-
-    case layer::LARGE:
-      // Airports > 8000 ft
-      return fetchAirports(rect, airportLargeByRectQuery, lazy, true /* overview */);
-
-  }
-  return nullptr;
+  if(overflow != nullptr)
+    *overflow = airportCache.truncated;
+  return &airportCache.list;
 }
 
 const QList<map::MapWaypoint> *MapQuery::getWaypoints(const GeoDataLatLonBox& rect,
-                                                      const MapLayer *mapLayer, bool lazy)
+                                                      const MapLayer *mapLayer, bool lazy, bool *overflow)
 {
-  waypointCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                            [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
+  waypointCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                            queryMaxRows, lazy, sameLayerWaypoint,
+                            [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapWaypoint>& list) -> void
   {
-    return curLayer->hasSameQueryParametersWaypoint(newLayer);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadWaypoints(tileRect, list);
   });
 
-  if(waypointCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, waypointsByRectQuery);
-      waypointsByRectQuery->exec();
-      while(waypointsByRectQuery->next())
-      {
-        map::MapWaypoint wp;
-        mapTypesFactory->fillWaypoint(waypointsByRectQuery->record(), wp);
-        waypointCache.list.append(wp);
-      }
-    }
-  }
-  waypointCache.validate(queryMaxRows);
+  if(overflow != nullptr)
+    *overflow = waypointCache.truncated;
   return &waypointCache.list;
 }
 
 const QList<map::MapVor> *MapQuery::getVors(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
-                                            bool lazy)
+                                            bool lazy, bool *overflow)
 {
-  vorCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                       [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
+  vorCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                       queryMaxRows, lazy, sameLayerVor,
+                       [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapVor>& list) -> void
   {
-    return curLayer->hasSameQueryParametersVor(newLayer);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadVors(tileRect, list);
   });
 
-  if(vorCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, vorsByRectQuery);
-      vorsByRectQuery->exec();
-      while(vorsByRectQuery->next())
-      {
-        map::MapVor vor;
-        mapTypesFactory->fillVor(vorsByRectQuery->record(), vor);
-        vorCache.list.append(vor);
-      }
-    }
-  }
-  vorCache.validate(queryMaxRows);
+  if(overflow != nullptr)
+    *overflow = vorCache.truncated;
   return &vorCache.list;
 }
 
 const QList<map::MapNdb> *MapQuery::getNdbs(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
-                                            bool lazy)
+                                            bool lazy, bool *overflow)
 {
-  ndbCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                       [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
+  ndbCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                       queryMaxRows, lazy, sameLayerNdb,
+                       [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapNdb>& list) -> void
   {
-    return curLayer->hasSameQueryParametersNdb(newLayer);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadNdbs(tileRect, list);
   });
 
-  if(ndbCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, ndbsByRectQuery);
-      ndbsByRectQuery->exec();
-      while(ndbsByRectQuery->next())
-      {
-        map::MapNdb ndb;
-        mapTypesFactory->fillNdb(ndbsByRectQuery->record(), ndb);
-        ndbCache.list.append(ndb);
-      }
-    }
-  }
-  ndbCache.validate(queryMaxRows);
+  if(overflow != nullptr)
+    *overflow = ndbCache.truncated;
   return &ndbCache.list;
 }
 
@@ -909,6 +965,7 @@ const QList<map::MapUserpoint> MapQuery::getUserdataPoints(const GeoDataLatLonBo
     for(const GeoDataLatLonBox& r :
         query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
     {
+      query::SqlTimer sqlTimer;
       query::bindRect(r, userdataPointByRectQuery);
       userdataPointByRectQuery->bindValue(":dist", distance);
 
@@ -949,136 +1006,110 @@ const QList<map::MapUserpoint> MapQuery::getUserdataPoints(const GeoDataLatLonBo
 }
 
 const QList<map::MapMarker> *MapQuery::getMarkers(const GeoDataLatLonBox& rect, const MapLayer *mapLayer,
-                                                  bool lazy)
+                                                  bool lazy, bool *overflow)
 {
-  markerCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                          [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
+  markerCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                          queryMaxRows, lazy, sameLayerMarker,
+                          [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapMarker>& list) -> void
   {
-    return curLayer->hasSameQueryParametersMarker(newLayer);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadMarkers(tileRect, list);
   });
 
-  if(markerCache.list.isEmpty() && !lazy)
-  {
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, markersByRectQuery);
-      markersByRectQuery->exec();
-      while(markersByRectQuery->next())
-      {
-        map::MapMarker marker;
-        mapTypesFactory->fillMarker(markersByRectQuery->record(), marker);
-        markerCache.list.append(marker);
-      }
-    }
-  }
-  markerCache.validate(queryMaxRows);
+  if(overflow != nullptr)
+    *overflow = markerCache.truncated;
   return &markerCache.list;
 }
 
-const QList<map::MapIls> *MapQuery::getIls(GeoDataLatLonBox rect, const MapLayer *mapLayer, bool lazy)
+const QList<map::MapIls> *MapQuery::getIls(GeoDataLatLonBox rect, const MapLayer *mapLayer, bool lazy,
+                                           bool *overflow)
 {
-  ilsCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                       [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
-  {
-    return curLayer->hasSameQueryParametersIls(newLayer);
-  });
+  increaseIlsRect(rect);
 
-  if(ilsCache.list.isEmpty() && !lazy)
+  ilsCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                       queryMaxRows, lazy, sameLayerIls,
+                       [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapIls>& list) -> void
   {
-    // ILS length is 9 NM * 1' per degree
-    double increase = atools::geo::toRadians(9. / 60.);
-
-    // Increase bounding rect since ILS has no bounding to query
-    rect.setBoundaries(rect.north() + increase, rect.south() - increase,
-                       rect.east() + increase, rect.west() - increase);
-
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, ilsByRectQuery);
+    query::SqlTimer sqlTimer;
+    tileLoader->loadIls(tileRect, list);
+  });
 
-      ilsByRectQuery->exec();
-      while(ilsByRectQuery->next())
-      {
-        map::MapIls ils;
-        mapTypesFactory->fillIls(ilsByRectQuery->record(), ils);
-        ilsCache.list.append(ils);
-      }
-    }
-  }
-  ilsCache.validate(queryMaxRows);
+  if(overflow != nullptr)
+    *overflow = ilsCache.truncated;
   return &ilsCache.list;
 }
 
-const QList<map::MapAirway> *MapQuery::getAirways(const GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy)
+void MapQuery::prefetch(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, map::MapObjectTypes types)
 {
-  airwayCache.updateCache(rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement, lazy,
-                          [](const MapLayer *curLayer, const MapLayer *newLayer) -> bool
-  {
-    return curLayer->hasSameQueryParametersAirway(newLayer);
-  });
+  if(!prefetchEnabled || mapLayer == nullptr || prefetcher->isRunning())
+    return;
 
-  if(airwayCache.list.isEmpty() && !lazy)
-  {
-    QSet<int> ids;
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, airwayByRectQuery);
-      airwayByRectQuery->exec();
-      while(airwayByRectQuery->next())
-      {
-        if(ids.contains(airwayByRectQuery->valueInt("airway_id")))
-          continue;
+  // Collect tiles for the same objects as loaded by the painters
+  QVector<query::TileKey> keys;
+  bool airway = mapLayer->isAirway() && (types.testFlag(map::AIRWAYJ) || types.testFlag(map::AIRWAYV));
 
-        map::MapAirway airway;
-        mapTypesFactory->fillAirway(airwayByRectQuery->record(), airway);
-        airwayCache.list.append(airway);
-        ids.insert(airway.id);
-      }
-    }
+  if(mapLayer->isAirport() && types.testFlag(map::AIRPORT))
+    airportCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                              sameLayerAirport);
+
+  if(airway)
+    airwayCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                             sameLayerAirway);
+
+  // Waypoints are needed for airways too
+  if((mapLayer->isWaypoint() && types.testFlag(map::WAYPOINT)) || airway)
+    waypointCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor,
+                               queryRectInflationIncrement, sameLayerWaypoint);
+
+  if(mapLayer->isVor() && types.testFlag(map::VOR))
+    vorCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                          sameLayerVor);
+
+  if(mapLayer->isNdb() && types.testFlag(map::NDB))
+    ndbCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                          sameLayerNdb);
+
+  if(mapLayer->isMarker() && types.testFlag(map::ILS))
+    markerCache.missingTiles(keys, tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                             sameLayerMarker);
+
+  if(mapLayer->isIls() && types.testFlag(map::ILS))
+  {
+    GeoDataLatLonBox ilsRect(rect);
+    increaseIlsRect(ilsRect);
+    ilsCache.missingTiles(keys, tileStore, ilsRect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                          sameLayerIls);
   }
-  airwayCache.validate(queryMaxRows);
-  return &airwayCache.list;
+
+  if(!keys.isEmpty())
+    prefetcher->start(keys, tileLoadParameters(mapLayer), dbSim->databaseName(), dbNav->databaseName(),
+                      queryMaxRows);
+}
+
+TileLoadParameters MapQuery::tileLoadParameters(const MapLayer *mapLayer) const
+{
+  TileLoadParameters params;
+  params.airportSource = mapLayer->getDataSource();
+  params.minRunwayLength = mapLayer->getMinRunwayLength();
+  params.navdata = NavApp::getDatabaseManager()->getNavDatabaseStatus() == dm::NAVDATABASE_ALL;
+  params.xplane = NavApp::getCurrentSimulatorDb() == atools::fs::FsPaths::XPLANE11;
+  return params;
 }
 
-/*
- * Get airport cache
- * @param reverse reverse order of airports to have unimportant small ones below in painting order
- * @param lazy do not update cache - instead return incomplete resut
- * @param overview fetch only incomplete data for overview airports
- * @return pointer to the airport cache
- */
-const QList<map::MapAirport> *MapQuery::fetchAirports(const Marble::GeoDataLatLonBox& rect,
-                                                      atools::sql::SqlQuery *query,
-                                                      bool lazy, bool overview)
+const QList<map::MapAirway> *MapQuery::getAirways(const GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                                  bool *overflow)
 {
-  if(airportCache.list.isEmpty() && !lazy)
+  airwayCache.updateCache(tileStore, rect, mapLayer, queryRectInflationFactor, queryRectInflationIncrement,
+                          queryMaxRows, lazy, sameLayerAirway,
+                          [ = ](const GeoDataLatLonBox& tileRect, QList<map::MapAirway>& list) -> void
   {
-    bool navdata = NavApp::getDatabaseManager()->getNavDatabaseStatus() == dm::NAVDATABASE_ALL;
-    for(const GeoDataLatLonBox& r :
-        query::splitAtAntiMeridian(rect, queryRectInflationFactor, queryRectInflationIncrement))
-    {
-      query::bindRect(r, query);
-      query->exec();
-      while(query->next())
-      {
-        map::MapAirport ap;
-        if(overview)
-          // Fill only a part of the object
-          mapTypesFactory->fillAirportForOverview(query->record(), ap, navdata,
-                                                  NavApp::getCurrentSimulatorDb() == atools::fs::FsPaths::XPLANE11);
-        else
-          mapTypesFactory->fillAirport(query->record(), ap, true /* complete */, navdata,
-                                       NavApp::getCurrentSimulatorDb() == atools::fs::FsPaths::XPLANE11);
-
-        airportCache.list.append(ap);
-      }
-    }
-  }
-  airportCache.validate(queryMaxRows);
-  return &airportCache.list;
+    query::SqlTimer sqlTimer;
+    tileLoader->loadAirways(tileRect, list);
+  });
+
+  if(overflow != nullptr)
+    *overflow = airwayCache.truncated;
+  return &airwayCache.list;
 }
 
 const QList<map::MapRunway> *MapQuery::getRunwaysForOverview(int airportId)
@@ -1089,6 +1120,7 @@ const QList<map::MapRunway> *MapQuery::getRunwaysForOverview(int airportId)
   {
     using atools::geo::Pos;
 
+    query::SqlTimer sqlTimer;
     runwayOverviewQuery->bindValue(":airportId", airportId);
     runwayOverviewQuery->exec();
 
@@ -1168,9 +1200,6 @@ void MapQuery::initQueries()
   static const QString whereLimit("limit " + QString::number(queryMaxRows));
 
   // Common select statements
-  QStringList const airportQueryBase = AirportQuery::airportColumns(dbSim);
-  QStringList const airportQueryBaseOverview = AirportQuery::airportOverviewColumns(dbSim);
-
   static const QString airwayQueryBase(
     "airway_id, airway_name, airway_type, airway_fragment_no, sequence_no, from_waypoint_id, to_waypoint_id, "
     "direction, minimum_altitude, maximum_altitude, from_lonx, from_laty, to_lonx, to_laty ");
@@ -1194,6 +1223,8 @@ void MapQuery::initQueries()
 
   deInitQueries();
 
+  tileLoader->initQueries();
+
   vorByIdentQuery = new SqlQuery(dbNav);
   vorByIdentQuery->prepare("select " + vorQueryBase + " from vor where " + whereIdentRegion);
 
@@ -1245,57 +1276,17 @@ void MapQuery::initQueries()
   ilsQuerySimByName->prepare("select " + ilsQueryBase + " from ils "
                                                         "where loc_airport_ident = :apt and loc_runway_name = :rwy");
 
-  airportByRectQuery = new SqlQuery(dbSim);
-  airportByRectQuery->prepare(
-    "select " + airportQueryBase.join(", ") + " from airport where " + whereRect +
-    " and longest_runway_length >= :minlength "
-    + whereLimit);
-
-  airportMediumByRectQuery = new SqlQuery(dbSim);
-  airportMediumByRectQuery->prepare(
-    "select " + airportQueryBaseOverview.join(", ") + " from airport_medium where " + whereRect + " " + whereLimit);
-
-  airportLargeByRectQuery = new SqlQuery(dbSim);
-  airportLargeByRectQuery->prepare(
-    "select " + airportQueryBaseOverview.join(", ") + " from airport_large where " + whereRect + " " + whereLimit);
-
   // Runways > 4000 feet for simplyfied runway overview
   runwayOverviewQuery = new SqlQuery(dbSim);
   runwayOverviewQuery->prepare(
     "select length, heading, lonx, laty, primary_lonx, primary_laty, secondary_lonx, secondary_laty "
     "from runway where airport_id = :airportId and length > 4000 " + whereLimit);
 
-  waypointsByRectQuery = new SqlQuery(dbNav);
-  waypointsByRectQuery->prepare(
-    "select " + waypointQueryBase + " from waypoint where " + whereRect + " " + whereLimit);
-
-  vorsByRectQuery = new SqlQuery(dbNav);
-  vorsByRectQuery->prepare("select " + vorQueryBase + " from vor where " + whereRect + " " + whereLimit);
-
-  ndbsByRectQuery = new SqlQuery(dbNav);
-  ndbsByRectQuery->prepare("select " + ndbQueryBase + " from ndb where " + whereRect + " " + whereLimit);
-
   userdataPointByRectQuery = new SqlQuery(dbUser);
   userdataPointByRectQuery->prepare("select * from userdata "
                                     "where " + whereRect + " and visible_from > :dist and type like :type " +
                                     whereLimit);
 
-  markersByRectQuery = new SqlQuery(dbNav);
-  markersByRectQuery->prepare(
-    "select marker_id, type, ident, heading, lonx, laty "
-    "from marker "
-    "where " + whereRect + " " + whereLimit);
-
-  ilsByRectQuery = new SqlQuery(dbSim);
-  ilsByRectQuery->prepare("select " + ilsQueryBase + " from ils where " + whereRect + " " + whereLimit);
-
-  // Get all that are crossing the anti meridian too and filter them out from the query result
-  airwayByRectQuery = new SqlQuery(dbNav);
-  airwayByRectQuery->prepare(
-    "select " + airwayQueryBase + ", right_lonx, left_lonx, bottom_laty, top_laty from airway where " +
-    "not (right_lonx < :leftx or left_lonx > :rightx or bottom_laty > :topy or top_laty < :bottomy) "
-    "or right_lonx < left_lonx");
-
   airwayByWaypointIdQuery = new SqlQuery(dbNav);
   airwayByWaypointIdQuery->prepare(
     "select " + airwayQueryBase + " from airway where from_waypoint_id = :id or to_waypoint_id = :id");
@@ -1337,6 +1328,9 @@ void MapQuery::initQueries()
 
 void MapQuery::deInitQueries()
 {
+  // Stop prefetching and close its connections before clearing tiles since the thread uses the old database files
+  prefetcher->closeDatabases();
+  tileStore.clear();
   airportCache.clear();
   waypointCache.clear();
   vorCache.clear();
@@ -1346,29 +1340,11 @@ void MapQuery::deInitQueries()
   airwayCache.clear();
   runwayOverwiewCache.clear();
 
-  delete airportByRectQuery;
-  airportByRectQuery = nullptr;
-  delete airportMediumByRectQuery;
-  airportMediumByRectQuery = nullptr;
-  delete airportLargeByRectQuery;
-  airportLargeByRectQuery = nullptr;
+  tileLoader->deInitQueries();
 
   delete runwayOverviewQuery;
   runwayOverviewQuery = nullptr;
 
-  delete waypointsByRectQuery;
-  waypointsByRectQuery = nullptr;
-  delete vorsByRectQuery;
-  vorsByRectQuery = nullptr;
-  delete ndbsByRectQuery;
-  ndbsByRectQuery = nullptr;
-  delete markersByRectQuery;
-  markersByRectQuery = nullptr;
-  delete ilsByRectQuery;
-  ilsByRectQuery = nullptr;
-  delete airwayByRectQuery;
-  airwayByRectQuery = nullptr;
-
   delete userdataPointByRectQuery;
   userdataPointByRectQuery = nullptr;
 
@@ -34,8 +34,13 @@ class SqlQuery;
 }
 
 class CoordinateConverter;
+class ScreenGrid;
+class QRect;
 class MapTypesFactory;
 class MapLayer;
+class MapTileLoader;
+class MapPrefetcher;
+struct TileLoadParameters;
 
 /*
  * Provides map related database queries. Fill objects of the maptypes namespace and maintains a cache.
@@ -136,6 +141,7 @@ public:
    * No objects are loaded from the database.
    *
    * @param conv Converter to calcualte screen coordinates
+   * @param grid Screen grid filled by updateScreenGrid() for the same converter, layer and types
    * @param mapLayer current map layer
    * @param airportDiagram get nearest parking and helipads too
    * @param types map objects to fetch AIRPORT, VOR, NDB, WAYPOINT, AIRWAY, etc.
@@ -143,10 +149,21 @@ public:
    * @param screenDistance maximum distance to coordinates
    * @param result will receive objects based on type
    */
-  void getNearestScreenObjects(const CoordinateConverter& conv, const MapLayer *mapLayer, bool airportDiagram,
-                               map::MapObjectTypes types, int xs, int ys, int screenDistance,
+  void getNearestScreenObjects(const CoordinateConverter& conv, const ScreenGrid& grid, const MapLayer *mapLayer,
+                               bool airportDiagram, map::MapObjectTypes types, int xs, int ys, int screenDistance,
                                map::MapSearchResult& result);
 
+  /*
+   * Fill grid with screen coordinates of all cached objects visible for the given layer and types.
+   * Grid entries refer to the cache lists and have to be updated if getScreenCacheGeneration() changes or
+   * the map view changes.
+   */
+  void updateScreenGrid(ScreenGrid& grid, const CoordinateConverter& conv, const QRect& screenRect,
+                        const MapLayer *mapLayer, bool airportDiagram, map::MapObjectTypes types) const;
+
+  /* Changes each time one of the caches used by updateScreenGrid() is cleared or reloaded */
+  quint32 getScreenCacheGeneration() const;
+
   /* Only VOR, NDB, ILS and waypoints
    * All sorted by distance to pos with a maximum distance distanceNm
    * Uses distance * 4 and searches again if nothing was found.*/
@@ -158,29 +175,43 @@ public:
    * @param rect bounding rectangle for query
    * @param mapLayer used to find source table
    * @param lazy do not reload from database and return (probably incomplete) result from cache if true
+   * @param overflow set to true if the result hit the row limit and is incomplete. Optional.
    * @return pointer to airport cache. Create a copy if this is needed for a longer
    * time than for e.g. one drawing request.
    */
-  const QList<map::MapAirport> *getAirports(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapAirport> *getAirports(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                            bool *overflow = nullptr);
 
   /* Similar to getAirports */
   const QList<map::MapWaypoint> *getWaypoints(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer,
-                                              bool lazy);
+                                              bool lazy, bool *overflow = nullptr);
 
   /* Similar to getAirports */
-  const QList<map::MapVor> *getVors(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapVor> *getVors(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                    bool *overflow = nullptr);
 
   /* Similar to getAirports */
-  const QList<map::MapNdb> *getNdbs(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapNdb> *getNdbs(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                    bool *overflow = nullptr);
 
   /* Similar to getAirports */
-  const QList<map::MapMarker> *getMarkers(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapMarker> *getMarkers(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                          bool *overflow = nullptr);
 
   /* Similar to getAirports */
-  const QList<map::MapIls> *getIls(Marble::GeoDataLatLonBox rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapIls> *getIls(Marble::GeoDataLatLonBox rect, const MapLayer *mapLayer, bool lazy,
+                                   bool *overflow = nullptr);
 
   /* Similar to getAirports */
-  const QList<map::MapAirway> *getAirways(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy);
+  const QList<map::MapAirway> *getAirways(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, bool lazy,
+                                          bool *overflow = nullptr);
+
+  /*
+   * Load tiles of all objects which would be shown by the painters for the given layer and types in the background.
+   * Tiles already in the cache are skipped. Call with a viewport predicted from pan velocity or aircraft movement
+   * to avoid blocking queries while painting.
+   */
+  void prefetch(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, map::MapObjectTypes types);
 
   /* Get a partially filled runway list for the overview */
   const QList<map::MapRunway> *getRunwaysForOverview(int airportId);
@@ -229,9 +260,8 @@ private:
                                 const atools::geo::Pos& sortByDistancePos,
                                 float maxDistance, bool airportFromNavDatabase);
 
-  const QList<map::MapAirport> *fetchAirports(const Marble::GeoDataLatLonBox& rect,
-                                              atools::sql::SqlQuery *query,
-                                              bool lazy, bool overview);
+  /* Copy query parameters from layer and application state */
+  TileLoadParameters tileLoadParameters(const MapLayer *mapLayer) const;
   QVector<map::MapIls> ilsByAirportAndRunway(const QString& airportIdent, const QString& runway);
 
   void runwayEndByNameFuzzy(QList<map::MapRunwayEnd>& runwayEnds, const QString& name, const map::MapAirport& airport,
@@ -240,15 +270,24 @@ private:
   MapTypesFactory *mapTypesFactory;
   atools::sql::SqlDatabase *dbSim, *dbNav, *dbUser;
 
-  /* Simple bounding rectangle caches */
-  query::SimpleRectCache<map::MapAirport> airportCache;
-  query::SimpleRectCache<map::MapWaypoint> waypointCache;
+  /* Tile caches sharing one LRU store. Object type is used as cache id in the store. */
+  query::TileStore tileStore;
+  MapTileLoader *tileLoader;
+
+  /* Fills tileStore in background */
+  MapPrefetcher *prefetcher;
+  bool prefetchEnabled = true;
+
+  query::TileRectCache<map::MapAirport> airportCache {map::AIRPORT};
+  query::TileRectCache<map::MapWaypoint> waypointCache {map::WAYPOINT};
+  query::TileRectCache<map::MapVor> vorCache {map::VOR};
+  query::TileRectCache<map::MapNdb> ndbCache {map::NDB};
+  query::TileRectCache<map::MapMarker> markerCache {map::MARKER};
+  query::TileRectCache<map::MapIls> ilsCache {map::ILS};
+  query::TileRectCache<map::MapAirway> airwayCache {map::AIRWAY};
+
+  /* Not cached since points can change - filled on each call */
   query::SimpleRectCache<map::MapUserpoint> userpointCache;
-  query::SimpleRectCache<map::MapVor> vorCache;
-  query::SimpleRectCache<map::MapNdb> ndbCache;
-  query::SimpleRectCache<map::MapMarker> markerCache;
-  query::SimpleRectCache<map::MapIls> ilsCache;
-  query::SimpleRectCache<map::MapAirway> airwayCache;
 
   /* ID/object caches */
   QCache<int, QList<map::MapRunway> > runwayOverwiewCache;
@@ -257,13 +296,7 @@ private:
   static int queryMaxRows;
 
   /* Database queries */
-  atools::sql::SqlQuery *runwayOverviewQuery = nullptr,
-                        *airportByRectQuery = nullptr, *airportMediumByRectQuery = nullptr,
-                        *airportLargeByRectQuery = nullptr;
-
-  atools::sql::SqlQuery *waypointsByRectQuery = nullptr, *vorsByRectQuery = nullptr,
-                        *ndbsByRectQuery = nullptr, *markersByRectQuery = nullptr, *ilsByRectQuery = nullptr,
-                        *airwayByRectQuery = nullptr, *userdataPointByRectQuery = nullptr;
+  atools::sql::SqlQuery *runwayOverviewQuery = nullptr, *userdataPointByRectQuery = nullptr;
 
   atools::sql::SqlQuery *vorByIdentQuery = nullptr, *ndbByIdentQuery = nullptr, *waypointByIdentQuery = nullptr,
                         *ilsByIdentQuery = nullptr;
@@ -0,0 +1,300 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "query/maptileloader.h"
+
+#include "common/maptypesfactory.h"
+#include "query/airportquery.h"
+#include "query/querytypes.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlrecord.h"
+
+using atools::sql::SqlQuery;
+
+MapTileLoader::MapTileLoader(atools::sql::SqlDatabase *sqlDb, atools::sql::SqlDatabase *sqlDbNav, int maxRows)
+  : dbSim(sqlDb), dbNav(sqlDbNav), queryMaxRows(maxRows)
+{
+  mapTypesFactory = new MapTypesFactory();
+}
+
+MapTileLoader::~MapTileLoader()
+{
+  deInitQueries();
+  delete mapTypesFactory;
+}
+
+void MapTileLoader::loadAirports(const Marble::GeoDataLatLonBox& rect, const TileLoadParameters& params,
+                                 QList<map::MapAirport>& airports)
+{
+  SqlQuery *query = nullptr;
+  bool overview = true;
+  switch(params.airportSource)
+  {
+    case layer::ALL:
+      query = airportByRectQuery;
+      query->bindValue(":minlength", params.minRunwayLength);
+      overview = false;
+      break;
+
+    case layer::MEDIUM:
+      // Airports > 4000 ft
+      query = airportMediumByRectQuery;
+      break;
+
+    case layer::LARGE:
+      // Airports > 8000 ft
+      query = airportLargeByRectQuery;
+      break;
+  }
+
+  query::bindRect(rect, query);
+  query->exec();
+  while(query->next())
+  {
+    map::MapAirport ap;
+    if(overview)
+      // Fill only a part of the object
+      mapTypesFactory->fillAirportForOverview(query->record(), ap, params.navdata, params.xplane);
+    else
+      mapTypesFactory->fillAirport(query->record(), ap, true /* complete */, params.navdata, params.xplane);
+
+    airports.append(ap);
+  }
+}
+
+void MapTileLoader::loadWaypoints(const Marble::GeoDataLatLonBox& rect, QList<map::MapWaypoint>& waypoints)
+{
+  query::bindRect(rect, waypointsByRectQuery);
+  waypointsByRectQuery->exec();
+  while(waypointsByRectQuery->next())
+  {
+    map::MapWaypoint wp;
+    mapTypesFactory->fillWaypoint(waypointsByRectQuery->record(), wp);
+    waypoints.append(wp);
+  }
+}
+
+void MapTileLoader::loadVors(const Marble::GeoDataLatLonBox& rect, QList<map::MapVor>& vors)
+{
+  query::bindRect(rect, vorsByRectQuery);
+  vorsByRectQuery->exec();
+  while(vorsByRectQuery->next())
+  {
+    map::MapVor vor;
+    mapTypesFactory->fillVor(vorsByRectQuery->record(), vor);
+    vors.append(vor);
+  }
+}
+
+void MapTileLoader::loadNdbs(const Marble::GeoDataLatLonBox& rect, QList<map::MapNdb>& ndbs)
+{
+  query::bindRect(rect, ndbsByRectQuery);
+  ndbsByRectQuery->exec();
+  while(ndbsByRectQuery->next())
+  {
+    map::MapNdb ndb;
+    mapTypesFactory->fillNdb(ndbsByRectQuery->record(), ndb);
+    ndbs.append(ndb);
+  }
+}
+
+void MapTileLoader::loadMarkers(const Marble::GeoDataLatLonBox& rect, QList<map::MapMarker>& markers)
+{
+  query::bindRect(rect, markersByRectQuery);
+  markersByRectQuery->exec();
+  while(markersByRectQuery->next())
+  {
+    map::MapMarker marker;
+    mapTypesFactory->fillMarker(markersByRectQuery->record(), marker);
+    markers.append(marker);
+  }
+}
+
+void MapTileLoader::loadIls(const Marble::GeoDataLatLonBox& rect, QList<map::MapIls>& ils)
+{
+  query::bindRect(rect, ilsByRectQuery);
+  ilsByRectQuery->exec();
+  while(ilsByRectQuery->next())
+  {
+    map::MapIls obj;
+    mapTypesFactory->fillIls(ilsByRectQuery->record(), obj);
+    ils.append(obj);
+  }
+}
+
+void MapTileLoader::loadAirways(const Marble::GeoDataLatLonBox& rect, QList<map::MapAirway>& airways)
+{
+  query::bindRect(rect, airwayByRectQuery);
+  airwayByRectQuery->exec();
+  while(airwayByRectQuery->next())
+  {
+    map::MapAirway airway;
+    mapTypesFactory->fillAirway(airwayByRectQuery->record(), airway);
+    airways.append(airway);
+  }
+}
+
+query::TileBase *MapTileLoader::loadTile(const query::TileKey& key, const TileLoadParameters& params)
+{
+  Marble::GeoDataLatLonBox rect = query::tileRect(key);
+
+  switch(key.cacheId)
+  {
+    case map::AIRPORT:
+      {
+        query::Tile<map::MapAirport> *tile = new query::Tile<map::MapAirport>;
+        loadAirports(rect, params, tile->list);
+        return tile;
+      }
+
+    case map::WAYPOINT:
+      {
+        query::Tile<map::MapWaypoint> *tile = new query::Tile<map::MapWaypoint>;
+        loadWaypoints(rect, tile->list);
+        return tile;
+      }
+
+    case map::VOR:
+      {
+        query::Tile<map::MapVor> *tile = new query::Tile<map::MapVor>;
+        loadVors(rect, tile->list);
+        return tile;
+      }
+
+    case map::NDB:
+      {
+        query::Tile<map::MapNdb> *tile = new query::Tile<map::MapNdb>;
+        loadNdbs(rect, tile->list);
+        return tile;
+      }
+
+    case map::MARKER:
+      {
+        query::Tile<map::MapMarker> *tile = new query::Tile<map::MapMarker>;
+        loadMarkers(rect, tile->list);
+        return tile;
+      }
+
+    case map::ILS:
+      {
+        query::Tile<map::MapIls> *tile = new query::Tile<map::MapIls>;
+        loadIls(rect, tile->list);
+        return tile;
+      }
+
+    case map::AIRWAY:
+      {
+        query::Tile<map::MapAirway> *tile = new query::Tile<map::MapAirway>;
+        loadAirways(rect, tile->list);
+        return tile;
+      }
+  }
+  return nullptr;
+}
+
+void MapTileLoader::initQueries()
+{
+  // Common where clauses
+  QString whereRect("lonx between :leftx and :rightx and laty between :bottomy and :topy");
+  QString whereLimit("limit " + QString::number(queryMaxRows));
+
+  // Common select statements
+  QStringList const airportQueryBase = AirportQuery::airportColumns(dbSim);
+  QStringList const airportQueryBaseOverview = AirportQuery::airportOverviewColumns(dbSim);
+
+  QString airwayQueryBase(
+    "airway_id, airway_name, airway_type, airway_fragment_no, sequence_no, from_waypoint_id, to_waypoint_id, "
+    "direction, minimum_altitude, maximum_altitude, from_lonx, from_laty, to_lonx, to_laty ");
+
+  QString waypointQueryBase(
+    "waypoint_id, ident, region, type, num_victor_airway, num_jet_airway, "
+    "mag_var, lonx, laty ");
+
+  QString vorQueryBase(
+    "vor_id, ident, name, region, type, name, frequency, channel, range, dme_only, dme_altitude, "
+    "mag_var, altitude, lonx, laty ");
+  QString ndbQueryBase(
+    "ndb_id, ident, name, region, type, name, frequency, range, mag_var, altitude, lonx, laty ");
+
+  QString ilsQueryBase(
+    "ils_id, ident, name, region, mag_var, loc_heading, gs_pitch, frequency, range, dme_range, loc_width, "
+    "end1_lonx, end1_laty, end_mid_lonx, end_mid_laty, end2_lonx, end2_laty, altitude, lonx, laty");
+
+  deInitQueries();
+
+  airportByRectQuery = new SqlQuery(dbSim);
+  airportByRectQuery->prepare(
+    "select " + airportQueryBase.join(", ") + " from airport where " + whereRect +
+    " and longest_runway_length >= :minlength "
+    + whereLimit);
+
+  airportMediumByRectQuery = new SqlQuery(dbSim);
+  airportMediumByRectQuery->prepare(
+    "select " + airportQueryBaseOverview.join(", ") + " from airport_medium where " + whereRect + " " + whereLimit);
+
+  airportLargeByRectQuery = new SqlQuery(dbSim);
+  airportLargeByRectQuery->prepare(
+    "select " + airportQueryBaseOverview.join(", ") + " from airport_large where " + whereRect + " " + whereLimit);
+
+  waypointsByRectQuery = new SqlQuery(dbNav);
+  waypointsByRectQuery->prepare(
+    "select " + waypointQueryBase + " from waypoint where " + whereRect + " " + whereLimit);
+
+  vorsByRectQuery = new SqlQuery(dbNav);
+  vorsByRectQuery->prepare("select " + vorQueryBase + " from vor where " + whereRect + " " + whereLimit);
+
+  ndbsByRectQuery = new SqlQuery(dbNav);
+  ndbsByRectQuery->prepare("select " + ndbQueryBase + " from ndb where " + whereRect + " " + whereLimit);
+
+  markersByRectQuery = new SqlQuery(dbNav);
+  markersByRectQuery->prepare(
+    "select marker_id, type, ident, heading, lonx, laty "
+    "from marker "
+    "where " + whereRect + " " + whereLimit);
+
+  ilsByRectQuery = new SqlQuery(dbSim);
+  ilsByRectQuery->prepare("select " + ilsQueryBase + " from ils where " + whereRect + " " + whereLimit);
+
+  // Get all that are crossing the anti meridian too and filter them out from the query result
+  airwayByRectQuery = new SqlQuery(dbNav);
+  airwayByRectQuery->prepare(
+    "select " + airwayQueryBase + ", right_lonx, left_lonx, bottom_laty, top_laty from airway where " +
+    "not (right_lonx < :leftx or left_lonx > :rightx or bottom_laty > :topy or top_laty < :bottomy) "
+    "or right_lonx < left_lonx");
+}
+
+void MapTileLoader::deInitQueries()
+{
+  delete airportByRectQuery;
+  airportByRectQuery = nullptr;
+  delete airportMediumByRectQuery;
+  airportMediumByRectQuery = nullptr;
+  delete airportLargeByRectQuery;
+  airportLargeByRectQuery = nullptr;
+  delete waypointsByRectQuery;
+  waypointsByRectQuery = nullptr;
+  delete vorsByRectQuery;
+  vorsByRectQuery = nullptr;
+  delete ndbsByRectQuery;
+  ndbsByRectQuery = nullptr;
+  delete markersByRectQuery;
+  markersByRectQuery = nullptr;
+  delete ilsByRectQuery;
+  ilsByRectQuery = nullptr;
+  delete airwayByRectQuery;
+  airwayByRectQuery = nullptr;
+}
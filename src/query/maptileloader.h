@@ -0,0 +1,100 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_MAPTILELOADER_H
+#define LITTLENAVMAP_MAPTILELOADER_H
+
+#include "common/maptypes.h"
+#include "mapgui/maplayer.h"
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+class SqlQuery;
+}
+}
+
+namespace Marble {
+class GeoDataLatLonBox;
+}
+
+namespace query {
+struct TileKey;
+struct TileBase;
+}
+
+class MapTypesFactory;
+
+/* Query parameters copied from map layer and application state which are needed to load tiles.
+ * Allows to load tiles in background threads without access to GUI objects. */
+struct TileLoadParameters
+{
+  layer::AirportSource airportSource = layer::ALL;
+  int minRunwayLength = 0;
+  bool navdata = false /* Navdata database is used for all */, xplane = false /* X-Plane simulator database */;
+};
+
+/*
+ * Loads airports, navaids, markers, ILS and airways within a rectangle from the database.
+ * Used by the map query tile caches and by the prefetch worker which uses its own database connections.
+ * Not thread safe. Each thread has to use its own instance.
+ */
+class MapTileLoader
+{
+public:
+  /*
+   * @param sqlDb database for simulator scenery data
+   * @param sqlDbNav for updated navaids
+   * @param maxRows limit for all queries
+   */
+  MapTileLoader(atools::sql::SqlDatabase *sqlDb, atools::sql::SqlDatabase *sqlDbNav, int maxRows);
+  ~MapTileLoader();
+
+  /* Create and prepare all queries */
+  void initQueries();
+
+  /* Delete all queries */
+  void deInitQueries();
+
+  /* Load objects within rectangle and append them to the list. Rectangle must not cross the anti-meridian. */
+  void loadAirports(const Marble::GeoDataLatLonBox& rect, const TileLoadParameters& params,
+                    QList<map::MapAirport>& airports);
+  void loadWaypoints(const Marble::GeoDataLatLonBox& rect, QList<map::MapWaypoint>& waypoints);
+  void loadVors(const Marble::GeoDataLatLonBox& rect, QList<map::MapVor>& vors);
+  void loadNdbs(const Marble::GeoDataLatLonBox& rect, QList<map::MapNdb>& ndbs);
+  void loadMarkers(const Marble::GeoDataLatLonBox& rect, QList<map::MapMarker>& markers);
+  void loadIls(const Marble::GeoDataLatLonBox& rect, QList<map::MapIls>& ils);
+
+  /* Loads all airways overlapping the rectangle */
+  void loadAirways(const Marble::GeoDataLatLonBox& rect, QList<map::MapAirway>& airways);
+
+  /* Create a new tile and load objects depending on the cache id (object type) of the key.
+   * Caller takes ownership. Returns null for unknown types. */
+  query::TileBase *loadTile(const query::TileKey& key, const TileLoadParameters& params);
+
+private:
+  MapTypesFactory *mapTypesFactory;
+  atools::sql::SqlDatabase *dbSim, *dbNav;
+  int queryMaxRows;
+
+  atools::sql::SqlQuery *airportByRectQuery = nullptr, *airportMediumByRectQuery = nullptr,
+                        *airportLargeByRectQuery = nullptr, *waypointsByRectQuery = nullptr,
+                        *vorsByRectQuery = nullptr, *ndbsByRectQuery = nullptr, *markersByRectQuery = nullptr,
+                        *ilsByRectQuery = nullptr, *airwayByRectQuery = nullptr;
+};
+
+#endif // LITTLENAVMAP_MAPTILELOADER_H
@@ -0,0 +1,648 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "query/procedurecache.h"
+
+#include "common/proctypes.h"
+#include "common/unit.h"
+#include "common/constants.h"
+#include "db/databasemanager.h"
+#include "fs/db/databasemeta.h"
+#include "settings/settings.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqltransaction.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+
+using atools::sql::SqlQuery;
+using atools::sql::SqlTransaction;
+using atools::geo::Pos;
+using proc::MapProcedureLeg;
+using proc::MapProcedureLegs;
+
+/* Increase if the stored format changes. Application version in the signature covers processing changes. */
+const static quint32 FORMAT_VERSION = 2;
+
+const static QString CONNECTION_NAME("LNMDBPROCCACHE");
+
+/* Batch builds procedures for this time and then pauses for the interval to keep the GUI responsive.
+ * Also writes the procedures which were built on demand in the meantime. */
+const static int BATCH_SLICE_MS = 5;
+const static int BATCH_INTERVAL_MS = 100;
+
+// Serialization ============================================================================
+static void writeLine(QDataStream& out, const atools::geo::Line& line)
+{
+  out << line.getPos1() << line.getPos2();
+}
+
+static void readLine(QDataStream& in, atools::geo::Line& line)
+{
+  Pos pos1, pos2;
+  in >> pos1 >> pos2;
+  line = atools::geo::Line(pos1, pos2);
+}
+
+static void writeLineString(QDataStream& out, const atools::geo::LineString& lineString)
+{
+  out << static_cast<qint32>(lineString.size());
+  for(const Pos& pos : lineString)
+    out << pos;
+}
+
+static void readLineString(QDataStream& in, atools::geo::LineString& lineString)
+{
+  qint32 num;
+  in >> num;
+  for(int i = 0; i < num && in.status() == QDataStream::Ok; i++)
+  {
+    Pos pos;
+    in >> pos;
+    lineString.append(pos);
+  }
+}
+
+static void writeRect(QDataStream& out, const atools::geo::Rect& rect)
+{
+  out << rect.isValid() << rect.getWest() << rect.getNorth() << rect.getEast() << rect.getSouth();
+}
+
+static void readRect(QDataStream& in, atools::geo::Rect& rect)
+{
+  bool valid;
+  float west, north, east, south;
+  in >> valid >> west >> north >> east >> south;
+  if(valid)
+    rect = atools::geo::Rect(west, north, east, south);
+}
+
+static void writeObject(QDataStream& out, const map::MapRunwayEnd& end)
+{
+  out << end.id << end.position << end.name << end.leftVasiType << end.rightVasiType << end.pattern
+      << end.heading << end.leftVasiPitch << end.rightVasiPitch << end.secondary << end.navdata;
+}
+
+static void readObject(QDataStream& in, map::MapRunwayEnd& end)
+{
+  in >> end.id >> end.position >> end.name >> end.leftVasiType >> end.rightVasiType >> end.pattern
+  >> end.heading >> end.leftVasiPitch >> end.rightVasiPitch >> end.secondary >> end.navdata;
+}
+
+static void writeObject(QDataStream& out, const map::MapAirport& obj)
+{
+  out << obj.id << obj.position << obj.ident << obj.icao << obj.iata << obj.name << obj.region
+      << obj.longestRunwayLength << obj.longestRunwayHeading << obj.transitionAltitude << obj.rating
+      << static_cast<quint32>(obj.flags) << obj.magvar << obj.navdata << obj.xplane
+      << obj.towerFrequency << obj.atisFrequency << obj.awosFrequency << obj.asosFrequency << obj.unicomFrequency
+      << obj.towerCoords << obj.routeIndex;
+  writeRect(out, obj.bounding);
+}
+
+static void readObject(QDataStream& in, map::MapAirport& obj)
+{
+  quint32 flags;
+  in >> obj.id >> obj.position >> obj.ident >> obj.icao >> obj.iata >> obj.name >> obj.region
+  >> obj.longestRunwayLength >> obj.longestRunwayHeading >> obj.transitionAltitude >> obj.rating
+  >> flags >> obj.magvar >> obj.navdata >> obj.xplane
+  >> obj.towerFrequency >> obj.atisFrequency >> obj.awosFrequency >> obj.asosFrequency >> obj.unicomFrequency
+  >> obj.towerCoords >> obj.routeIndex;
+  readRect(in, obj.bounding);
+  obj.flags = map::MapAirportFlags(flags);
+}
+
+static void writeObject(QDataStream& out, const map::MapVor& obj)
+{
+  out << obj.id << obj.position << obj.ident << obj.region << obj.type << obj.name << obj.magvar
+      << obj.frequency << obj.range << obj.channel << obj.routeIndex
+      << obj.dmeOnly << obj.hasDme << obj.tacan << obj.vortac;
+}
+
+static void readObject(QDataStream& in, map::MapVor& obj)
+{
+  in >> obj.id >> obj.position >> obj.ident >> obj.region >> obj.type >> obj.name >> obj.magvar
+  >> obj.frequency >> obj.range >> obj.channel >> obj.routeIndex
+  >> obj.dmeOnly >> obj.hasDme >> obj.tacan >> obj.vortac;
+}
+
+static void writeObject(QDataStream& out, const map::MapNdb& obj)
+{
+  out << obj.id << obj.position << obj.ident << obj.region << obj.type << obj.name << obj.magvar
+      << obj.frequency << obj.range << obj.routeIndex;
+}
+
+static void readObject(QDataStream& in, map::MapNdb& obj)
+{
+  in >> obj.id >> obj.position >> obj.ident >> obj.region >> obj.type >> obj.name >> obj.magvar
+  >> obj.frequency >> obj.range >> obj.routeIndex;
+}
+
+static void writeObject(QDataStream& out, const map::MapWaypoint& obj)
+{
+  out << obj.id << obj.position << obj.magvar << obj.ident << obj.region << obj.type << obj.routeIndex
+      << obj.hasVictorAirways << obj.hasJetAirways;
+}
+
+static void readObject(QDataStream& in, map::MapWaypoint& obj)
+{
+  in >> obj.id >> obj.position >> obj.magvar >> obj.ident >> obj.region >> obj.type >> obj.routeIndex
+  >> obj.hasVictorAirways >> obj.hasJetAirways;
+}
+
+static void writeObject(QDataStream& out, const map::MapIls& obj)
+{
+  out << obj.id << obj.position << obj.ident << obj.name << obj.region
+      << obj.magvar << obj.slope << obj.heading << obj.width << obj.frequency << obj.range
+      << obj.pos1 << obj.pos2 << obj.posmid << obj.hasDme;
+  writeRect(out, obj.bounding);
+}
+
+static void readObject(QDataStream& in, map::MapIls& obj)
+{
+  in >> obj.id >> obj.position >> obj.ident >> obj.name >> obj.region
+  >> obj.magvar >> obj.slope >> obj.heading >> obj.width >> obj.frequency >> obj.range
+  >> obj.pos1 >> obj.pos2 >> obj.posmid >> obj.hasDme;
+  readRect(in, obj.bounding);
+}
+
+template<typename TYPE>
+static void writeObjects(QDataStream& out, const QList<TYPE>& objects)
+{
+  out << static_cast<qint32>(objects.size());
+  for(const TYPE& obj : objects)
+    writeObject(out, obj);
+}
+
+template<typename TYPE>
+static void readObjects(QDataStream& in, QList<TYPE>& objects)
+{
+  qint32 num;
+  in >> num;
+  for(int i = 0; i < num && in.status() == QDataStream::Ok; i++)
+  {
+    TYPE obj;
+    readObject(in, obj);
+    objects.append(obj);
+  }
+}
+
+/* Navaids are stored completely to avoid database queries when reading */
+static void writeNavaids(QDataStream& out, const map::MapSearchResult& navaids)
+{
+  writeObjects(out, navaids.airports);
+  writeObjects(out, navaids.vors);
+  writeObjects(out, navaids.ndbs);
+  writeObjects(out, navaids.waypoints);
+  writeObjects(out, navaids.ils);
+  writeObjects(out, navaids.runwayEnds);
+}
+
+static void readNavaids(QDataStream& in, map::MapSearchResult& navaids)
+{
+  readObjects(in, navaids.airports);
+  readObjects(in, navaids.vors);
+  readObjects(in, navaids.ndbs);
+  readObjects(in, navaids.waypoints);
+  readObjects(in, navaids.ils);
+  readObjects(in, navaids.runwayEnds);
+}
+
+static void writeLeg(QDataStream& out, const MapProcedureLeg& leg)
+{
+  out << leg.fixType << leg.fixIdent << leg.fixRegion << leg.recFixType << leg.recFixIdent << leg.recFixRegion
+      << leg.turnDirection << leg.arincDescrCode << leg.displayText << leg.remarks
+      << leg.fixPos << leg.recFixPos << leg.interceptPos << leg.procedureTurnPos;
+
+  writeLine(out, leg.line);
+  writeLine(out, leg.holdLine);
+  writeLineString(out, leg.geometry);
+  writeNavaids(out, leg.navaids);
+
+  out << static_cast<qint32>(leg.altRestriction.descriptor) << leg.altRestriction.alt1 << leg.altRestriction.alt2
+      << leg.altRestriction.forceFinal
+      << static_cast<qint32>(leg.speedRestriction.descriptor) << leg.speedRestriction.speed
+      << static_cast<qint32>(leg.type) << static_cast<qint32>(leg.mapType)
+      << leg.approachId << leg.transitionId << leg.legId << leg.navId << leg.recNavId
+      << leg.course << leg.distance << leg.calculatedDistance << leg.calculatedTrueCourse
+      << leg.time << leg.theta << leg.rho << leg.magvar
+      << leg.missed << leg.flyover << leg.trueCourse << leg.intercept << leg.disabled << leg.malteseCross;
+}
+
+static void readLeg(QDataStream& in, MapProcedureLeg& leg)
+{
+  in >> leg.fixType >> leg.fixIdent >> leg.fixRegion >> leg.recFixType >> leg.recFixIdent >> leg.recFixRegion
+  >> leg.turnDirection >> leg.arincDescrCode >> leg.displayText >> leg.remarks
+  >> leg.fixPos >> leg.recFixPos >> leg.interceptPos >> leg.procedureTurnPos;
+
+  readLine(in, leg.line);
+  readLine(in, leg.holdLine);
+  readLineString(in, leg.geometry);
+  readNavaids(in, leg.navaids);
+
+  qint32 altDescriptor, speedDescriptor, type, mapType;
+  in >> altDescriptor >> leg.altRestriction.alt1 >> leg.altRestriction.alt2 >> leg.altRestriction.forceFinal
+  >> speedDescriptor >> leg.speedRestriction.speed
+  >> type >> mapType
+  >> leg.approachId >> leg.transitionId >> leg.legId >> leg.navId >> leg.recNavId
+  >> leg.course >> leg.distance >> leg.calculatedDistance >> leg.calculatedTrueCourse
+  >> leg.time >> leg.theta >> leg.rho >> leg.magvar
+  >> leg.missed >> leg.flyover >> leg.trueCourse >> leg.intercept >> leg.disabled >> leg.malteseCross;
+
+  leg.altRestriction.descriptor = static_cast<proc::MapAltRestriction::Descriptor>(altDescriptor);
+  leg.speedRestriction.descriptor = static_cast<proc::MapSpeedRestriction::Descriptor>(speedDescriptor);
+  leg.type = static_cast<proc::ProcedureLegType>(type);
+  leg.mapType = static_cast<proc::MapProcedureTypes>(mapType);
+}
+
+static void writeProcedure(QDataStream& out, const MapProcedureLegs& legs)
+{
+  out << static_cast<qint32>(legs.transitionLegs.size());
+  for(const MapProcedureLeg& leg : legs.transitionLegs)
+    writeLeg(out, leg);
+
+  out << static_cast<qint32>(legs.approachLegs.size());
+  for(const MapProcedureLeg& leg : legs.approachLegs)
+    writeLeg(out, leg);
+
+  out << legs.ref.airportId << legs.ref.runwayEndId << legs.ref.approachId << legs.ref.transitionId << legs.ref.legId
+      << static_cast<qint32>(legs.ref.mapType);
+
+  writeRect(out, legs.bounding);
+
+  out << legs.approachType << legs.approachSuffix << legs.approachFixIdent << legs.approachArincName
+      << legs.transitionType << legs.transitionFixIdent << legs.procedureRunway;
+
+  writeObject(out, legs.runwayEnd);
+
+  out << static_cast<qint32>(legs.mapType) << legs.approachDistance << legs.transitionDistance << legs.missedDistance
+      << legs.approachCustomAltitude << legs.approachCustomDistance
+      << legs.gpsOverlay << legs.hasError << legs.circleToLand;
+}
+
+static void readProcedure(QDataStream& in, MapProcedureLegs& legs)
+{
+  qint32 num;
+  in >> num;
+  for(int i = 0; i < num && in.status() == QDataStream::Ok; i++)
+  {
+    MapProcedureLeg leg;
+    readLeg(in, leg);
+    legs.transitionLegs.append(leg);
+  }
+
+  in >> num;
+  for(int i = 0; i < num && in.status() == QDataStream::Ok; i++)
+  {
+    MapProcedureLeg leg;
+    readLeg(in, leg);
+    legs.approachLegs.append(leg);
+  }
+
+  qint32 refMapType, mapType;
+  in >> legs.ref.airportId >> legs.ref.runwayEndId >> legs.ref.approachId >> legs.ref.transitionId >> legs.ref.legId
+  >> refMapType;
+  legs.ref.mapType = static_cast<proc::MapProcedureTypes>(refMapType);
+
+  readRect(in, legs.bounding);
+
+  in >> legs.approachType >> legs.approachSuffix >> legs.approachFixIdent >> legs.approachArincName
+  >> legs.transitionType >> legs.transitionFixIdent >> legs.procedureRunway;
+
+  readObject(in, legs.runwayEnd);
+
+  in >> mapType >> legs.approachDistance >> legs.transitionDistance >> legs.missedDistance
+  >> legs.approachCustomAltitude >> legs.approachCustomDistance
+  >> legs.gpsOverlay >> legs.hasError >> legs.circleToLand;
+  legs.mapType = static_cast<proc::MapProcedureTypes>(mapType);
+}
+
+// ProcedureCache ============================================================================
+ProcedureCache::ProcedureCache(const BuildFunctionType& buildFunction)
+  : buildFunc(buildFunction)
+{
+  batchTimer.setInterval(BATCH_INTERVAL_MS);
+  QObject::connect(&batchTimer, &QTimer::timeout, [ = ]()
+  {
+    batchStep();
+  });
+}
+
+ProcedureCache::~ProcedureCache()
+{
+  close();
+}
+
+void ProcedureCache::open(atools::sql::SqlDatabase *dbNavParam)
+{
+  close();
+
+  atools::settings::Settings& settings = atools::settings::Settings::instance();
+  enabled = settings.getAndStoreValue(lnm::SETTINGS_DATABASE + "ProcedureCache", true).toBool();
+  batchEnabled = settings.getAndStoreValue(lnm::SETTINGS_DATABASE + "ProcedureCacheBatch", true).toBool();
+
+  dbNav = dbNavParam;
+  if(!enabled || dbNav == nullptr || !dbNav->isOpen())
+    return;
+
+  // Cache file is stored next to the database file
+  QFileInfo dbInfo(dbNav->databaseName());
+  QString filename = dbInfo.absolutePath() + QDir::separator() + dbInfo.completeBaseName() + "_procedures.sqlite";
+
+  try
+  {
+    dbCache = DatabaseManager::openThreadDatabase(CONNECTION_NAME, filename, false /* readonly */);
+    updateSchema();
+    createQueries();
+
+    if(batchEnabled)
+      startBatch();
+  }
+  catch(std::exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Cannot open procedure cache" << filename << e.what();
+    close();
+  }
+}
+
+void ProcedureCache::close()
+{
+  batchTimer.stop();
+  batchEntries.clear();
+  batchIndex = 0;
+
+  if(!pendingWrites.isEmpty())
+  {
+    try
+    {
+      SqlTransaction transaction(dbCache);
+      insertPendingWrites();
+      transaction.commit();
+    }
+    catch(std::exception& e)
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot write procedure cache" << e.what();
+    }
+    pendingWrites.clear();
+  }
+
+  deleteQueries();
+
+  if(dbCache != nullptr)
+  {
+    DatabaseManager::closeThreadDatabase(dbCache, CONNECTION_NAME);
+    dbCache = nullptr;
+  }
+  dbNav = nullptr;
+}
+
+void ProcedureCache::optionsChanged()
+{
+  if(dbCache != nullptr && updateSchema() && batchEnabled)
+    // Content was dropped - fill again
+    startBatch();
+}
+
+QString ProcedureCache::signature() const
+{
+  QFileInfo dbInfo(dbNav->databaseName());
+
+  // Display texts contain distances in the selected unit and are translated
+  // Application version covers changes in procedure processing
+  return QString("%1|%2|%3|%4|%5|%6|%7").
+         arg(FORMAT_VERSION).
+         arg(QCoreApplication::applicationVersion()).
+         arg(dbInfo.size()).
+         arg(dbInfo.lastModified().toMSecsSinceEpoch()).
+         arg(atools::fs::db::DatabaseMeta(dbNav).getAiracCycle()).
+         arg(Unit::distNm(1.5f, true, 20, true)).
+         arg(QCoreApplication::translate("ProcedureQuery", "°M"));
+}
+
+bool ProcedureCache::updateSchema()
+{
+  SqlTransaction transaction(dbCache);
+  SqlQuery query(dbCache);
+  query.exec("create table if not exists metadata (signature varchar(1024) not null)");
+  query.exec("create table if not exists procedure_legs ("
+             "approach_id integer not null, transition_id integer not null, legs blob not null, "
+             "primary key (approach_id, transition_id))");
+
+  QString storedSignature;
+  query.exec("select signature from metadata");
+  if(query.next())
+    storedSignature = query.valueStr("signature");
+  query.finish();
+
+  QString currentSignature = signature();
+  bool outdated = storedSignature != currentSignature;
+  if(outdated)
+  {
+    qInfo() << Q_FUNC_INFO << "Procedure cache outdated" << storedSignature << "new" << currentSignature;
+    pendingWrites.clear();
+    query.exec("delete from procedure_legs");
+    query.exec("delete from metadata");
+    query.prepare("insert into metadata (signature) values(:signature)");
+    query.bindValue(":signature", currentSignature);
+    query.exec();
+  }
+  transaction.commit();
+  return outdated;
+}
+
+void ProcedureCache::createQueries()
+{
+  deleteQueries();
+
+  readQuery = new SqlQuery(dbCache);
+  readQuery->prepare("select legs from procedure_legs where approach_id = :approachId and "
+                     "transition_id = :transitionId");
+
+  writeQuery = new SqlQuery(dbCache);
+  writeQuery->prepare("insert or replace into procedure_legs (approach_id, transition_id, legs) "
+                      "values(:approachId, :transitionId, :legs)");
+}
+
+void ProcedureCache::deleteQueries()
+{
+  delete readQuery;
+  readQuery = nullptr;
+
+  delete writeQuery;
+  writeQuery = nullptr;
+}
+
+MapProcedureLegs *ProcedureCache::readLegs(int approachId, int transitionId)
+{
+  if(readQuery == nullptr)
+    return nullptr;
+
+  QByteArray bytes;
+  auto pending = pendingWrites.constFind(key(approachId, transitionId));
+  if(pending != pendingWrites.constEnd())
+    // Built on demand and not written yet
+    bytes = qUncompress(pending.value());
+  else
+  {
+    readQuery->bindValue(":approachId", approachId);
+    readQuery->bindValue(":transitionId", transitionId);
+    readQuery->exec();
+    if(readQuery->next())
+      bytes = qUncompress(readQuery->value("legs").toByteArray());
+    readQuery->finish();
+  }
+
+  if(bytes.isEmpty())
+    return nullptr;
+
+  MapProcedureLegs *legs = new MapProcedureLegs;
+  QDataStream in(bytes);
+  in.setVersion(QDataStream::Qt_5_5);
+  in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  readProcedure(in, *legs);
+
+  if(in.status() != QDataStream::Ok)
+  {
+    qWarning() << Q_FUNC_INFO << "Damaged entry for approach" << approachId << "transition" << transitionId;
+    delete legs;
+    return nullptr;
+  }
+  return legs;
+}
+
+void ProcedureCache::writeLegs(const MapProcedureLegs& legs, int approachId, int transitionId)
+{
+  if(writeQuery == nullptr)
+    return;
+
+  // Written in the transaction of the next batch step
+  pendingWrites.insert(key(approachId, transitionId), serialize(legs));
+  if(!batchTimer.isActive())
+    batchTimer.start();
+}
+
+QByteArray ProcedureCache::serialize(const MapProcedureLegs& legs)
+{
+  QByteArray bytes;
+  QDataStream out(&bytes, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_5_5);
+  out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  writeProcedure(out, legs);
+  return qCompress(bytes);
+}
+
+void ProcedureCache::insertLegs(int approachId, int transitionId, const QByteArray& bytes)
+{
+  writeQuery->bindValue(":approachId", approachId);
+  writeQuery->bindValue(":transitionId", transitionId);
+  writeQuery->bindValue(":legs", bytes);
+  writeQuery->exec();
+}
+
+void ProcedureCache::insertPendingWrites()
+{
+  for(auto it = pendingWrites.constBegin(); it != pendingWrites.constEnd(); ++it)
+    insertLegs(static_cast<int>(it.key() >> 32), static_cast<qint32>(it.key() & 0xffffffff), it.value());
+  pendingWrites.clear();
+}
+
+void ProcedureCache::startBatch()
+{
+  batchTimer.stop();
+  batchEntries.clear();
+  batchIndex = 0;
+
+  // Collect keys of all stored procedures including the ones not written yet
+  QSet<qint64> stored = pendingWrites.keys().toSet();
+  SqlQuery cacheQuery(dbCache);
+  cacheQuery.exec("select approach_id, transition_id from procedure_legs");
+  while(cacheQuery.next())
+    stored.insert(key(cacheQuery.valueInt("approach_id"), cacheQuery.valueInt("transition_id")));
+
+  // Get all approaches and transitions sorted by airport to make use of the airport cache
+  SqlQuery navQuery(dbNav);
+  navQuery.exec("select approach_id, airport_id, -1 as transition_id from approach "
+                "union all "
+                "select t.approach_id, a.airport_id, t.transition_id from transition t "
+                "join approach a on t.approach_id = a.approach_id "
+                "order by airport_id");
+  while(navQuery.next())
+  {
+    BatchEntry entry;
+    entry.airportId = navQuery.valueInt("airport_id");
+    entry.approachId = navQuery.valueInt("approach_id");
+    entry.transitionId = navQuery.valueInt("transition_id");
+
+    if(!stored.contains(key(entry.approachId, entry.transitionId)))
+      batchEntries.append(entry);
+  }
+
+  qDebug() << Q_FUNC_INFO << "stored" << stored.size() << "missing" << batchEntries.size();
+
+  if(!batchEntries.isEmpty() || !pendingWrites.isEmpty())
+    batchTimer.start();
+}
+
+void ProcedureCache::batchStep()
+{
+  // Do not build while the user is dragging the map or similar
+  bool build = QGuiApplication::mouseButtons() == Qt::NoButton;
+  if(!build && pendingWrites.isEmpty())
+    return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  try
+  {
+    SqlTransaction transaction(dbCache);
+    insertPendingWrites();
+
+    while(build && batchIndex < batchEntries.size() && timer.elapsed() < BATCH_SLICE_MS)
+    {
+      const BatchEntry& entry = batchEntries.at(batchIndex++);
+      MapProcedureLegs *legs = buildFunc(entry.airportId, entry.approachId, entry.transitionId);
+      if(legs != nullptr)
+      {
+        insertLegs(entry.approachId, entry.transitionId, serialize(*legs));
+        delete legs;
+      }
+    }
+    transaction.commit();
+  }
+  catch(std::exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Stopping procedure cache batch" << e.what();
+    batchIndex = batchEntries.size();
+    pendingWrites.clear();
+  }
+
+  if(batchIndex >= batchEntries.size())
+  {
+    if(!batchEntries.isEmpty())
+      qDebug() << Q_FUNC_INFO << "Procedure cache batch done" << batchEntries.size();
+    batchTimer.stop();
+    batchEntries.clear();
+    batchIndex = 0;
+  }
+}
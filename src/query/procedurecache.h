@@ -0,0 +1,124 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_PROCEDURECACHE_H
+#define LITTLENAVMAP_PROCEDURECACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+class SqlQuery;
+}
+}
+
+namespace proc {
+struct MapProcedureLegs;
+}
+
+/*
+ * Persistent cache of fully processed procedure legs keyed by approach and transition id.
+ *
+ * Stored in an SQLite database beside the navigation database. The cache is dropped if size or modification time
+ * of the navigation database, its AIRAC cycle, the format version or the display text units change.
+ *
+ * Resolved navaids of legs are stored completely so reading needs no further queries.
+ *
+ * After opening, a batch fills the cache for all procedures not yet stored. It runs in short time slices in
+ * the GUI thread since procedure processing uses the GUI thread queries. The batch continues in the next session.
+ * Procedures built on demand are written in the transaction of the next batch step.
+ */
+class ProcedureCache
+{
+public:
+  /* Build function returns a new processed procedure for airport id, approach id and
+   * transition id (-1 if approach only) or null on error. */
+  typedef std::function<proc::MapProcedureLegs *(int airportId, int approachId, int transitionId)> BuildFunctionType;
+
+  ProcedureCache(const BuildFunctionType& buildFunction);
+  ~ProcedureCache();
+
+  /* Open or create the cache database for the given navigation database and start the batch if enabled */
+  void open(atools::sql::SqlDatabase *dbNavParam);
+
+  /* Stop batch and close cache database */
+  void close();
+
+  /* Drops the cache if the display text units have changed */
+  void optionsChanged();
+
+  /* Get new procedure object from the cache. Transition id is -1 for approaches.
+   * Returns null if not found. Caller takes ownership. */
+  proc::MapProcedureLegs *readLegs(int approachId, int transitionId);
+
+  /* Store procedure. Transition id is -1 for approaches. Written to the database in the next batch step. */
+  void writeLegs(const proc::MapProcedureLegs& legs, int approachId, int transitionId);
+
+private:
+  /* Airport, approach and transition ids to build in batch */
+  struct BatchEntry
+  {
+    int airportId, approachId, transitionId;
+  };
+
+  /* Create tables if missing and drop all content if the signature does not match. Returns true if dropped. */
+  bool updateSchema();
+  void createQueries();
+  void deleteQueries();
+
+  /* Compressed procedure for the legs column */
+  static QByteArray serialize(const proc::MapProcedureLegs& legs);
+
+  /* Insert or replace without transaction */
+  void insertLegs(int approachId, int transitionId, const QByteArray& bytes);
+  void insertPendingWrites();
+
+  /* Cache validity depending on navigation database, format and units */
+  QString signature() const;
+
+  /* Collect all procedures not in cache */
+  void startBatch();
+  void batchStep();
+
+  static qint64 key(int approachId, int transitionId)
+  {
+    return (static_cast<qint64>(approachId) << 32) | static_cast<quint32>(transitionId);
+  }
+
+  BuildFunctionType buildFunc;
+
+  atools::sql::SqlDatabase *dbNav = nullptr, *dbCache = nullptr;
+  atools::sql::SqlQuery *readQuery = nullptr, *writeQuery = nullptr;
+
+  QVector<BatchEntry> batchEntries;
+  int batchIndex = 0;
+  QTimer batchTimer;
+
+  /* Compressed procedures built on demand by key which are not written yet */
+  QHash<qint64, QByteArray> pendingWrites;
+
+  bool enabled = true, batchEnabled = true;
+};
+
+#endif // LITTLENAVMAP_PROCEDURECACHE_H
@@ -16,6 +16,7 @@
 *****************************************************************************/
 
 #include "query/procedurequery.h"
+#include "query/procedurecache.h"
 #include "navapp.h"
 #include "sql/sqlrecord.h"
 #include "query/mapquery.h"
@@ -52,11 +53,17 @@ ProcedureQuery::ProcedureQuery(atools::sql::SqlDatabase *sqlDbNav)
 {
   mapQuery = NavApp::getMapQuery();
   airportQueryNav = NavApp::getAirportQueryNav();
+
+  procedureCache = new ProcedureCache([ = ](int airportId, int approachId, int transitionId)
+  {
+    return buildProcessedLegsForCache(airportId, approachId, transitionId);
+  });
 }
 
 ProcedureQuery::~ProcedureQuery()
 {
   deInitQueries();
+  delete procedureCache;
 }
 
 const proc::MapProcedureLegs *ProcedureQuery::getApproachLegs(map::MapAirport airport, int approachId)
@@ -561,10 +568,17 @@ proc::MapProcedureLegs *ProcedureQuery::fetchApproachLegs(const map::MapAirport&
   else
 #endif
   {
-    qDebug() << "buildApproachEntries" << airport.ident << "approachId" << approachId;
+    MapProcedureLegs *legs = nullptr;
+#ifndef DEBUG_APPROACH_NO_CACHE
+    // Try persistent cache first
+    legs = procedureCache->readLegs(approachId, -1);
+#endif
 
-    MapProcedureLegs *legs = buildApproachLegs(airport, approachId);
-    postProcessLegs(airport, *legs, true /*addArtificialLegs*/);
+    if(legs == nullptr)
+    {
+      legs = buildProcessedApproachLegs(airport, approachId);
+      procedureCache->writeLegs(*legs, approachId, -1);
+    }
 
     for(int i = 0; i < legs->size(); i++)
       approachLegIndex.insert(legs->at(i).legId, std::make_pair(approachId, i));
@@ -585,55 +599,109 @@ proc::MapProcedureLegs *ProcedureQuery::fetchTransitionLegs(const map::MapAirpor
   else
 #endif
   {
+    MapProcedureLegs *legs = nullptr;
+#ifndef DEBUG_APPROACH_NO_CACHE
+    // Try persistent cache first
+    legs = procedureCache->readLegs(approachId, transitionId);
+#endif
+
+    if(legs == nullptr)
+    {
+      legs = buildProcessedTransitionLegs(airport, approachId, transitionId);
+      procedureCache->writeLegs(*legs, approachId, transitionId);
+    }
+
+    for(int i = 0; i < legs->size(); ++i)
+      transitionLegIndex.insert(legs->at(i).legId, std::make_pair(transitionId, i));
+
+    transitionCache.insert(transitionId, legs);
+    return legs;
+  }
+}
+
+proc::MapProcedureLegs *ProcedureQuery::buildProcessedApproachLegs(const map::MapAirport& airport, int approachId)
+{
+  if(!batchMode)
+    qDebug() << "buildApproachEntries" << airport.ident << "approachId" << approachId;
+
+  MapProcedureLegs *legs = buildApproachLegs(airport, approachId);
+  postProcessLegs(airport, *legs, true /*addArtificialLegs*/);
+  return legs;
+}
+
+proc::MapProcedureLegs *ProcedureQuery::buildProcessedTransitionLegs(const map::MapAirport& airport,
+                                                                    int approachId, int transitionId)
+{
+  if(!batchMode)
     qDebug() << "buildApproachEntries" << airport.ident << "approachId" << approachId
              << "transitionId" << transitionId;
 
-    transitionLegQuery->bindValue(":id", transitionId);
-    transitionLegQuery->exec();
+  transitionLegQuery->bindValue(":id", transitionId);
+  transitionLegQuery->exec();
 
-    proc::MapProcedureLegs *legs = new proc::MapProcedureLegs;
-    legs->ref.airportId = airport.id;
-    legs->ref.approachId = approachId;
-    legs->ref.transitionId = transitionId;
+  proc::MapProcedureLegs *legs = new proc::MapProcedureLegs;
+  legs->ref.airportId = airport.id;
+  legs->ref.approachId = approachId;
+  legs->ref.transitionId = transitionId;
 
-    while(transitionLegQuery->next())
-    {
-      legs->transitionLegs.append(buildTransitionLegEntry(airport));
-      legs->transitionLegs.last().approachId = approachId;
-      legs->transitionLegs.last().transitionId = transitionId;
-    }
+  while(transitionLegQuery->next())
+  {
+    legs->transitionLegs.append(buildTransitionLegEntry(airport));
+    legs->transitionLegs.last().approachId = approachId;
+    legs->transitionLegs.last().transitionId = transitionId;
+  }
 
-    // Add a full copy of the approach because approach legs will be modified for different transitions
-    proc::MapProcedureLegs *approach = buildApproachLegs(airport, approachId);
-    legs->approachLegs = approach->approachLegs;
-    legs->runwayEnd = approach->runwayEnd;
-    legs->procedureRunway = approach->procedureRunway;
-    legs->approachType = approach->approachType;
-    legs->approachSuffix = approach->approachSuffix;
-    legs->approachFixIdent = approach->approachFixIdent;
-    legs->approachArincName = approach->approachArincName;
-    legs->gpsOverlay = approach->gpsOverlay;
-    legs->circleToLand = approach->circleToLand;
+  // Add a full copy of the approach because approach legs will be modified for different transitions
+  proc::MapProcedureLegs *approach = buildApproachLegs(airport, approachId);
+  legs->approachLegs = approach->approachLegs;
+  legs->runwayEnd = approach->runwayEnd;
+  legs->procedureRunway = approach->procedureRunway;
+  legs->approachType = approach->approachType;
+  legs->approachSuffix = approach->approachSuffix;
+  legs->approachFixIdent = approach->approachFixIdent;
+  legs->approachArincName = approach->approachArincName;
+  legs->gpsOverlay = approach->gpsOverlay;
+  legs->circleToLand = approach->circleToLand;
 
-    delete approach;
+  delete approach;
 
-    transitionQuery->bindValue(":id", transitionId);
-    transitionQuery->exec();
-    if(transitionQuery->next())
-    {
-      legs->transitionType = transitionQuery->value("type").toString();
-      legs->transitionFixIdent = transitionQuery->value("fix_ident").toString();
-    }
-    transitionQuery->finish();
+  transitionQuery->bindValue(":id", transitionId);
+  transitionQuery->exec();
+  if(transitionQuery->next())
+  {
+    legs->transitionType = transitionQuery->value("type").toString();
+    legs->transitionFixIdent = transitionQuery->value("fix_ident").toString();
+  }
+  transitionQuery->finish();
 
-    postProcessLegs(airport, *legs, true /*addArtificialLegs*/);
+  postProcessLegs(airport, *legs, true /*addArtificialLegs*/);
+  return legs;
+}
 
-    for(int i = 0; i < legs->size(); ++i)
-      transitionLegIndex.insert(legs->at(i).legId, std::make_pair(transitionId, i));
+proc::MapProcedureLegs *ProcedureQuery::buildProcessedLegsForCache(int airportId, int approachId, int transitionId)
+{
+  map::MapAirport airport;
+  airportQueryNav->getAirportById(airport, airportId);
+  if(!airport.isValid())
+    return nullptr;
 
-    transitionCache.insert(transitionId, legs);
-    return legs;
+  // Called for all procedures of the database - do not flood the log
+  batchMode = true;
+  proc::MapProcedureLegs *legs = nullptr;
+  try
+  {
+    if(transitionId == -1)
+      legs = buildProcessedApproachLegs(airport, approachId);
+    else
+      legs = buildProcessedTransitionLegs(airport, approachId, transitionId);
+  }
+  catch(...)
+  {
+    batchMode = false;
+    throw;
   }
+  batchMode = false;
+  return legs;
 }
 
 proc::MapProcedureLegs *ProcedureQuery::buildApproachLegs(const map::MapAirport& airport, int approachId)
@@ -692,7 +760,8 @@ proc::MapProcedureLegs *ProcedureQuery::buildApproachLegs(const map::MapAirport&
   if(!runwayFound)
   {
     // Nothing found in the database - search by name fuzzy or add a dummy entry if nothing was found by name
-    qWarning() << "Runway end for approach" << approachId << "not found";
+    if(!batchMode)
+      qWarning() << "Runway end for approach" << approachId << "not found";
     map::MapSearchResult result;
     runwayEndByName(result, legs->procedureRunway, airport);
 
@@ -965,7 +1034,8 @@ void ProcedureQuery::processArtificialLegs(const map::MapAirport& airport, proc:
           prevLeg.type == proc::FROM_FIX_TO_MANUAL_TERMINATION ||
           prevLeg.type == proc::HEADING_TO_MANUAL_TERMINATION))
       {
-        qDebug() << Q_FUNC_INFO << prevLeg;
+        if(!batchMode)
+          qDebug() << Q_FUNC_INFO << prevLeg;
         proc::MapProcedureLeg vectorLeg;
         vectorLeg.approachId = legs.ref.approachId;
         vectorLeg.transitionId = legs.ref.transitionId;
@@ -1114,7 +1184,10 @@ void ProcedureQuery::processLegsDistanceAndCourse(proc::MapProcedureLegs& legs)
     proc::ProcedureLegType type = leg.type;
 
     if(!leg.line.isValid())
-      qWarning() << "leg line for leg is invalid" << leg;
+    {
+      if(!batchMode)
+        qWarning() << "leg line for leg is invalid" << leg;
+    }
 
     // ===========================================================
     else if(type == proc::INITIAL_FIX)
@@ -1152,7 +1225,8 @@ void ProcedureQuery::processLegsDistanceAndCourse(proc::MapProcedureLegs& legs)
         leg.calculatedDistance = meterToNm(leg.line.lengthMeter());
         leg.calculatedTrueCourse = normalizeCourse(leg.line.angleDeg());
         leg.geometry << leg.line.getPos1() << leg.line.getPos2();
-        qWarning() << "ARC_TO_FIX or CONSTANT_RADIUS_ARC has invalid recommended fix" << leg;
+        if(!batchMode)
+          qWarning() << "ARC_TO_FIX or CONSTANT_RADIUS_ARC has invalid recommended fix" << leg;
       }
     }
     // ===========================================================
@@ -1362,7 +1436,7 @@ void ProcedureQuery::processLegs(proc::MapProcedureLegs& legs)
             // Fly to start of leg
             lastPos = extended;
           }
-          else
+          else if(!batchMode)
             qWarning() << "leg line type" << leg.type << "fix" << leg.fixIdent
                        << "invalid cross track"
                        << "approachId" << leg.approachId
@@ -1475,8 +1549,9 @@ void ProcedureQuery::processLegs(proc::MapProcedureLegs& legs)
       else
       {
         curPos = lastPos;
-        qWarning() << "leg line type" << type << "fix" << leg.fixIdent << "no intersectingRadials found"
-                   << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
+        if(!batchMode)
+          qWarning() << "leg line type" << type << "fix" << leg.fixIdent << "no intersectingRadials found"
+                     << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
       }
     }
     // ===========================================================
@@ -1528,8 +1603,9 @@ void ProcedureQuery::processLegs(proc::MapProcedureLegs& legs)
       else
       {
         curPos = center;
-        qWarning() << "leg line type" << type << "fix" << leg.fixIdent << "no intersectionWithCircle found"
-                   << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
+        if(!batchMode)
+          qWarning() << "leg line type" << type << "fix" << leg.fixIdent << "no intersectionWithCircle found"
+                     << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
       }
 
       leg.displayText << leg.recFixIdent + "/" + Unit::distNm(leg.distance, true, 20, true) + "/" +
@@ -1585,7 +1661,7 @@ void ProcedureQuery::processLegs(proc::MapProcedureLegs& legs)
     else
       leg.line = Line(lastPos.isValid() ? lastPos : curPos, curPos);
 
-    if(!leg.line.isValid())
+    if(!leg.line.isValid() && !batchMode)
       qWarning() << "leg line type" << type << "fix" << leg.fixIdent << "invalid line"
                  << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
     lastPos = curPos;
@@ -1666,7 +1742,7 @@ void ProcedureQuery::processCourseInterceptLegs(proc::MapProcedureLegs& legs)
               next->line.setPos2(next->line.getPos2());
               leg.displayText << tr("Intercept");
             }
-            else
+            else if(!batchMode)
               qWarning() << "leg line type" << leg.type << "fix" << leg.fixIdent
                          << "invalid cross track"
                          << "approachId" << leg.approachId
@@ -1675,9 +1751,11 @@ void ProcedureQuery::processCourseInterceptLegs(proc::MapProcedureLegs& legs)
           }
           else
           {
-            qWarning() << "leg line type" << leg.type << "fix" << leg.fixIdent
-                       << "no intersectingRadials/intersectionWithCircle found"
-                       << "approachId" << leg.approachId << "transitionId" << leg.transitionId << "legId" << leg.legId;
+            if(!batchMode)
+              qWarning() << "leg line type" << leg.type << "fix" << leg.fixIdent
+                         << "no intersectingRadials/intersectionWithCircle found"
+                         << "approachId" << leg.approachId << "transitionId" << leg.transitionId
+                         << "legId" << leg.legId;
             leg.displayText << tr("Intercept") << tr("Leg");
             leg.line.setPos2(next->line.getPos1());
           }
@@ -1744,10 +1822,15 @@ void ProcedureQuery::initQueries()
 
   transitionIdsForApproachQuery = new SqlQuery(dbNav);
   transitionIdsForApproachQuery->prepare("select transition_id from transition where approach_id = :id");
+
+  // Needs the queries above for the batch
+  procedureCache->open(dbNav);
 }
 
 void ProcedureQuery::deInitQueries()
 {
+  procedureCache->close();
+
   approachCache.clear();
   transitionCache.clear();
   approachLegIndex.clear();
@@ -2078,6 +2161,9 @@ void ProcedureQuery::clearCache()
   transitionCache.clear();
   approachLegIndex.clear();
   transitionLegIndex.clear();
+
+  // Drop persistent cache too if units changed
+  procedureCache->optionsChanged();
 }
 
 QVector<int> ProcedureQuery::getTransitionIdsForApproach(int approachId)
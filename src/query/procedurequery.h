@@ -34,6 +34,7 @@ class SqlQuery;
 
 class MapQuery;
 class AirportQuery;
+class ProcedureCache;
 
 /* Loads and caches approaches and transitions. The corresponding approach is also loaded and cached if a
  * transition is loaded since legs depend on each other.
@@ -155,6 +156,14 @@ private:
                                        const proc::MapProcedureLegs& legs, const QStringList& displayText);
 
   proc::MapProcedureLegs *buildApproachLegs(const map::MapAirport& airport, int approachId);
+
+  /* Load and process without using any cache. Caller takes ownership. */
+  proc::MapProcedureLegs *buildProcessedApproachLegs(const map::MapAirport& airport, int approachId);
+  proc::MapProcedureLegs *buildProcessedTransitionLegs(const map::MapAirport& airport, int approachId,
+                                                       int transitionId);
+
+  /* Used by the persistent cache batch. transitionId is -1 for approaches. */
+  proc::MapProcedureLegs *buildProcessedLegsForCache(int airportId, int approachId, int transitionId);
   proc::MapProcedureLegs *fetchApproachLegs(const map::MapAirport& airport, int approachId);
   proc::MapProcedureLegs *fetchTransitionLegs(const map::MapAirport& airport, int approachId,
                                               int transitionId);
@@ -201,6 +210,12 @@ private:
   MapQuery *mapQuery = nullptr;
   AirportQuery *airportQueryNav = nullptr;
 
+  /* Persistent cache for processed procedures beside the navigation database */
+  ProcedureCache *procedureCache = nullptr;
+
+  /* Set while the cache processes all procedures of the database. Suppresses logging for each procedure. */
+  bool batchMode = false;
+
   /* Dummy used for custom approaches. */
   Q_DECL_CONSTEXPR static int CUSTOM_APPROACH_ID = 1000000000;
 
@@ -20,10 +20,77 @@
 #include "sql/sqlquery.h"
 #include "geo/rect.h"
 
+#include <cmath>
+
 using namespace Marble;
 
 namespace query {
 
+std::atomic_bool SqlTimer::enabled(false);
+std::atomic<qint64> SqlTimer::totalNsecs(0);
+
+/* Smallest tile size is 360 / 2^16 degrees or about 0.3 NM */
+static const int MAX_TILE_LEVEL = 16;
+
+int tileLevelForRect(const Marble::GeoDataLatLonBox& rect)
+{
+  double size = std::max(rect.width(GeoDataCoordinates::Degree), rect.height(GeoDataCoordinates::Degree));
+
+  if(size <= 0.)
+    return MAX_TILE_LEVEL;
+
+  // Smallest level where tile size is not larger than size
+  int level = static_cast<int>(std::ceil(std::log2(360. / size)));
+  return std::min(std::max(level, 1), MAX_TILE_LEVEL);
+}
+
+/* Get tile index for coordinate limited to 0 and max */
+static int tileIndex(double coord, double offset, double tileSize, int max)
+{
+  return std::min(std::max(static_cast<int>(std::floor((coord + offset) / tileSize)), 0), max);
+}
+
+void tilesForRect(QVector<TileKey>& keys, const Marble::GeoDataLatLonBox& rect, int cacheId, int layerId)
+{
+  int level = tileLevelForRect(rect);
+  double tileSize = 360. / (1 << level);
+  int maxX = (1 << level) - 1;
+  int maxY = static_cast<int>(std::ceil(180. / tileSize)) - 1;
+
+  int y1 = tileIndex(rect.south(GeoDataCoordinates::Degree), 90., tileSize, maxY);
+  int y2 = tileIndex(rect.north(GeoDataCoordinates::Degree), 90., tileSize, maxY);
+  int x1 = tileIndex(rect.west(GeoDataCoordinates::Degree), 180., tileSize, maxX);
+  int x2 = tileIndex(rect.east(GeoDataCoordinates::Degree), 180., tileSize, maxX);
+
+  // Split into western and eastern part if rectangle crosses the anti-meridian
+  QVector<std::pair<int, int> > xRanges;
+  if(rect.crossesDateLine())
+  {
+    xRanges.append(std::make_pair(x1, maxX));
+    xRanges.append(std::make_pair(0, x2));
+  }
+  else
+    xRanges.append(std::make_pair(x1, x2));
+
+  keys.clear();
+  for(const std::pair<int, int>& xRange : xRanges)
+  {
+    for(int y = y1; y <= y2; y++)
+    {
+      for(int x = xRange.first; x <= xRange.second; x++)
+        keys.append({cacheId, layerId, level, x, y});
+    }
+  }
+}
+
+Marble::GeoDataLatLonBox tileRect(const TileKey& key)
+{
+  double tileSize = 360. / (1 << key.level);
+  double west = -180. + key.x * tileSize, south = -90. + key.y * tileSize;
+  return GeoDataLatLonBox(std::min(south + tileSize, 90.), south, std::min(west + tileSize, 180.), west,
+                          GeoDataCoordinates::Degree);
+}
+
 void inflateQueryRect(Marble::GeoDataLatLonBox& rect, double factor, double increment)
 {
   rect.scale(1. + factor, 1. + factor);
@@ -21,8 +21,13 @@
 #include "sql/sqlrecord.h"
 #include "sql/sqlquery.h"
 
+#include <QCache>
+#include <QElapsedTimer>
 #include <QList>
+#include <QSet>
+#include <QVector>
 
+#include <atomic>
 #include <functional>
 
 #include <marble/GeoDataCoordinates.h>
@@ -53,6 +58,50 @@ QList<Marble::GeoDataLatLonBox> splitAtAntiMeridian(const Marble::GeoDataLatLonB
 /* Inflate rect by width and height in degrees. If it crosses the poles or date line it will be limited */
 void inflateQueryRect(Marble::GeoDataLatLonBox& rect, double factor, double increment);
 
+/* Measures the time while in scope and adds it to a global counter if enabled.
+ * Used to measure the time spent in SQL queries while painting the map. */
+class SqlTimer
+{
+public:
+  SqlTimer()
+  {
+    if(enabled)
+      timer.start();
+  }
+
+  ~SqlTimer()
+  {
+    if(enabled && timer.isValid())
+      totalNsecs += timer.nsecsElapsed();
+  }
+
+  SqlTimer(const SqlTimer& other) = delete;
+  SqlTimer& operator=(const SqlTimer& other) = delete;
+
+  /* Enable or disable measurement. Disabled by default. */
+  static void setEnabled(bool value)
+  {
+    enabled = value;
+  }
+
+  static bool isEnabled()
+  {
+    return enabled;
+  }
+
+  /* Accumulated time in nanoseconds since program start */
+  static qint64 getTotalNsecs()
+  {
+    return totalNsecs;
+  }
+
+private:
+  QElapsedTimer timer;
+
+  static std::atomic_bool enabled;
+  static std::atomic<qint64> totalNsecs;
+};
+
 template<typename ID>
 const atools::sql::SqlRecord *cachedRecord(QCache<ID, atools::sql::SqlRecord>& cache,
                                            atools::sql::SqlQuery *query, ID id);
@@ -83,10 +132,259 @@ struct SimpleRectCache
   const MapLayer *curMapLayer = nullptr;
   QList<TYPE> list;
 
+  /* Incremented each time the list is cleared or is empty and will be filled by the caller.
+   * Allows users to detect that indexes into the list are outdated. */
+  quint32 generation = 0;
+
+};
+
+/* Key for a tile in the shared tile store. Tiles are cells of a fixed lat/lon grid having a size of
+ * 360 / 2^level degrees. */
+struct TileKey
+{
+  int cacheId /* Object type of the owning cache */,
+      layerId /* Index of the query parameter set in the owning cache */, level, x, y;
+
+  bool operator==(const TileKey& other) const
+  {
+    return cacheId == other.cacheId && layerId == other.layerId && level == other.level &&
+           x == other.x && y == other.y;
+  }
+
+  bool operator!=(const TileKey& other) const
+  {
+    return !operator==(other);
+  }
+
+};
+
+inline uint qHash(const TileKey& key)
+{
+  return static_cast<uint>(key.cacheId ^ (key.layerId << 4) ^ (key.level << 8) ^ (key.x << 13) ^ (key.y << 23));
+}
+
+/* Base for tiles in the shared store allowing to keep lists of different object types in one LRU cache */
+struct TileBase
+{
+  virtual ~TileBase()
+  {
+  }
+
+  /* Number of objects in tile */
+  virtual int size() const = 0;
+
+};
+
+template<typename TYPE>
+struct Tile
+  : public TileBase
+{
+  virtual int size() const override
+  {
+    return list.size();
+  }
+
+  QList<TYPE> list;
+};
+
+/* LRU store of tiles shared by all tile caches. Cost is the number of objects in a tile. */
+typedef QCache<TileKey, TileBase> TileStore;
+
+/* Get the grid level for tiles covering the rectangle. Tiles are not larger than the rectangle. */
+int tileLevelForRect(const Marble::GeoDataLatLonBox& rect);
+
+/* Get keys of all tiles covering the rectangle. Key fields cacheId and layerId are set to the given values. */
+void tilesForRect(QVector<TileKey>& keys, const Marble::GeoDataLatLonBox& rect, int cacheId, int layerId);
+
+/* Get the bounding rectangle of a tile */
+Marble::GeoDataLatLonBox tileRect(const TileKey& key);
+
+/*
+ * Spatial cache that keeps objects for fixed lat/lon tiles in a shared LRU store.
+ * Only tiles that are not already in the store are loaded when the view moves.
+ * The list contains all objects of the tiles covering the last requested rectangle without duplicates.
+ */
+template<typename TYPE>
+struct TileRectCache
+{
+  typedef std::function<bool (const MapLayer *curLayer, const MapLayer *mapLayer)> LayerCompareFunc;
+
+  /* Loads all objects in the given tile rectangle into list */
+  typedef std::function<void (const Marble::GeoDataLatLonBox& rect, QList<TYPE>& list)> LoadFunc;
+
+  /* @param id Unique id of this cache in the shared store */
+  TileRectCache(int id)
+    : cacheId(id)
+  {
+  }
+
+  /*
+   * @param store shared tile store
+   * @param rect bounding rectangle - all objects inside this rectangle are returned
+   * @param mapLayer current map layer
+   * @param maxRows Tiles having this number of objects or more are considered incomplete and are not stored.
+   * The merged list is limited to this number too.
+   * @param lazy if true do not run queries. Returns tiles if all are in the store, otherwise the old list
+   * @return true if list has changed
+   */
+  bool updateCache(TileStore& store, const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, double factor,
+                   double increment, int maxRows, bool lazy, LayerCompareFunc funcSameLayer, LoadFunc funcLoad);
+
+  /* Get keys of all tiles covering the rectangle which are not in the store yet. Keys are appended.
+   * Used to prefetch tiles in the background. */
+  void missingTiles(QVector<TileKey>& keys, const TileStore& store, const Marble::GeoDataLatLonBox& rect,
+                    const MapLayer *mapLayer, double factor, double increment, LayerCompareFunc funcSameLayer);
+
+  /* Clear list and layers. Tiles have to be removed from the store too. */
+  void clear();
+
+  QList<TYPE> list;
+
+  /* Incremented each time the list changes. Allows users to detect that indexes into the list are outdated. */
+  quint32 generation = 0;
+
+  /* true if a tile or the merged list hit the row limit and the list is incomplete */
+  bool truncated = false;
+
+private:
+  /* Get index of the layer having the same query parameters. Adds the layer if not found. */
+  int layerIdFor(const MapLayer *mapLayer, LayerCompareFunc funcSameLayer);
+
+  int cacheId;
+
+  /* Layers having distinct query parameters. Index is used as layerId in the tile key. */
+  QVector<const MapLayer *> layers;
+
+  /* Tiles covered by list */
+  QVector<TileKey> curTiles;
 };
 
 // ---------------------------------------------------------------------------------
 
+template<typename TYPE>
+int TileRectCache<TYPE>::layerIdFor(const MapLayer *mapLayer, LayerCompareFunc funcSameLayer)
+{
+  for(int i = 0; i < layers.size(); i++)
+  {
+    if(funcSameLayer(layers.at(i), mapLayer))
+      return i;
+  }
+
+  layers.append(mapLayer);
+  return layers.size() - 1;
+}
+
+template<typename TYPE>
+void TileRectCache<TYPE>::missingTiles(QVector<TileKey>& keys, const TileStore& store,
+                                       const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer,
+                                       double factor, double increment, LayerCompareFunc funcSameLayer)
+{
+  Marble::GeoDataLatLonBox queryRect(rect);
+  query::inflateQueryRect(queryRect, factor, increment);
+
+  QVector<TileKey> rectKeys;
+  tilesForRect(rectKeys, queryRect, cacheId, layerIdFor(mapLayer, funcSameLayer));
+
+  for(const TileKey& key : rectKeys)
+  {
+    if(!store.contains(key))
+      keys.append(key);
+  }
+}
+
+template<typename TYPE>
+bool TileRectCache<TYPE>::updateCache(TileStore& store, const Marble::GeoDataLatLonBox& rect,
+                                      const MapLayer *mapLayer, double factor, double increment, int maxRows,
+                                      bool lazy, LayerCompareFunc funcSameLayer, LoadFunc funcLoad)
+{
+  Marble::GeoDataLatLonBox queryRect(rect);
+  query::inflateQueryRect(queryRect, factor, increment);
+
+  QVector<TileKey> keys;
+  tilesForRect(keys, queryRect, cacheId, layerIdFor(mapLayer, funcSameLayer));
+
+  if(keys == curTiles)
+    // Same tiles as before - list is up to date
+    return false;
+
+  if(lazy)
+  {
+    // Use new tiles only if all are already in the store, e.g. from prefetching - otherwise keep old list
+    for(const TileKey& key : keys)
+    {
+      if(!store.contains(key))
+        return false;
+    }
+  }
+
+  // Collect shallow copies of the tile lists since loading might evict other tiles from the store
+  QVector<QList<TYPE> > tileLists;
+  bool incomplete = false;
+  for(const TileKey& key : keys)
+  {
+    Tile<TYPE> *tile = static_cast<Tile<TYPE> *>(store.object(key));
+    if(tile != nullptr)
+      tileLists.append(tile->list);
+    else
+    {
+      tile = new Tile<TYPE>;
+      funcLoad(tileRect(key), tile->list);
+      tileLists.append(tile->list);
+
+      if(tile->list.size() < maxRows)
+        store.insert(key, tile, std::max(tile->list.size(), 1));
+      else
+      {
+        // Incomplete - load again next time
+        delete tile;
+        incomplete = true;
+      }
+    }
+  }
+
+  // Objects on tile borders or spanning more than one tile are loaded more than once
+  list.clear();
+  QSet<int> ids;
+  for(const QList<TYPE>& tileList : tileLists)
+  {
+    for(const TYPE& obj : tileList)
+    {
+      if(list.size() >= maxRows)
+      {
+        incomplete = true;
+        break;
+      }
+
+      if(!ids.contains(obj.getId()))
+      {
+        ids.insert(obj.getId());
+        list.append(obj);
+      }
+    }
+  }
+
+  if(incomplete)
+    // Do not remember tiles to query again on next update like SimpleRectCache::validate()
+    curTiles.clear();
+  else
+    curTiles = keys;
+  truncated = incomplete;
+  generation++;
+  return true;
+}
+
+template<typename TYPE>
+void TileRectCache<TYPE>::clear()
+{
+  list.clear();
+  layers.clear();
+  curTiles.clear();
+  truncated = false;
+  generation++;
+}
+
+// ---------------------------------------------------------------------------------
+
 template<typename TYPE>
 bool SimpleRectCache<TYPE>::updateCache(const Marble::GeoDataLatLonBox& rect, const MapLayer *mapLayer, double factor,
                                         double increment, bool lazy, LayerCompareFunc funcSameLayer)
@@ -103,10 +401,15 @@ bool SimpleRectCache<TYPE>::updateCache(const Marble::GeoDataLatLonBox& rect, co
   {
     // Rectangle not covered by loaded data or new layer selected
     list.clear();
+    generation++;
     curRect = rect;
     curMapLayer = mapLayer;
     return true;
   }
+
+  if(list.isEmpty())
+    // Caller will try to fill the list again
+    generation++;
   return false;
 }
 
@@ -124,6 +427,7 @@ template<typename TYPE>
 void SimpleRectCache<TYPE>::clear()
 {
   list.clear();
+  generation++;
   curRect.clear();
   curMapLayer = nullptr;
 }
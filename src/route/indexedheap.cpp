@@ -0,0 +1,120 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/indexedheap.h"
+
+IndexedHeap::IndexedHeap(int capacity)
+{
+  reserve(capacity);
+}
+
+void IndexedHeap::reserve(int capacity)
+{
+  if(capacity > positions.size())
+  {
+    // Grow in bigger steps to avoid reallocations when nodes are added one by one
+    int oldSize = positions.size();
+    positions.resize(std::max(capacity, oldSize * 3 / 2));
+    std::fill(positions.begin() + oldSize, positions.end(), -1);
+    entries.reserve(positions.size() / 4);
+  }
+}
+
+void IndexedHeap::clear()
+{
+  for(const Entry& entry : entries)
+    positions[entry.index] = -1;
+  entries.clear();
+}
+
+void IndexedHeap::push(int index, float cost)
+{
+  reserve(index + 1);
+  entries.append({cost, index});
+  positions[index] = entries.size() - 1;
+  siftUp(entries.size() - 1);
+}
+
+int IndexedHeap::pop()
+{
+  int index = entries.first().index;
+  positions[index] = -1;
+
+  Entry last = entries.takeLast();
+  if(!entries.isEmpty())
+  {
+    place(0, last);
+    siftDown(0);
+  }
+  return index;
+}
+
+void IndexedHeap::change(int index, float cost)
+{
+  int pos = positions.at(index);
+  float oldCost = entries.at(pos).cost;
+  entries[pos].cost = cost;
+
+  if(cost < oldCost)
+    siftUp(pos);
+  else
+    siftDown(pos);
+}
+
+void IndexedHeap::siftUp(int pos)
+{
+  Entry entry = entries.at(pos);
+  while(pos > 0)
+  {
+    int parent = (pos - 1) / 2;
+    if(!(entry.cost < entries.at(parent).cost))
+      break;
+
+    place(pos, entries.at(parent));
+    pos = parent;
+  }
+  place(pos, entry);
+}
+
+void IndexedHeap::siftDown(int pos)
+{
+  Entry entry = entries.at(pos);
+  int size = entries.size();
+  while(true)
+  {
+    int child = 2 * pos + 1;
+    if(child >= size)
+      break;
+
+    // Use smaller child
+    if(child + 1 < size && entries.at(child + 1).cost < entries.at(child).cost)
+      child++;
+
+    if(!(entries.at(child).cost < entry.cost))
+      break;
+
+    place(pos, entries.at(child));
+    pos = child;
+  }
+  place(pos, entry);
+}
+
+void IndexedHeap::place(int pos, const Entry& entry)
+{
+  entries[pos] = entry;
+  positions[entry.index] = pos;
+}
@@ -0,0 +1,84 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_INDEXEDHEAP_H
+#define LITTLENAVMAP_INDEXEDHEAP_H
+
+#include <QVector>
+
+/*
+ * Binary min heap for dense integer indexes with float costs.
+ * Keeps the position of each index in the heap which allows contains() and change() (decrease-key)
+ * in constant or logarithmic time without searching or re-inserting.
+ *
+ * Indexes have to be in the range 0 to capacity - 1. Capacity grows automatically on push.
+ */
+class IndexedHeap
+{
+public:
+  IndexedHeap(int capacity = 0);
+
+  /* Remove all entries. Touches only the entries remaining in the heap. */
+  void clear();
+
+  /* Add an index which must not be part of the heap */
+  void push(int index, float cost);
+
+  /* Remove index with lowest cost and return it. Heap must not be empty. */
+  int pop();
+
+  /* Change costs for an index which must be part of the heap and restore heap order */
+  void change(int index, float cost);
+
+  /* true if index is in the heap */
+  bool contains(int index) const
+  {
+    return index >= 0 && index < positions.size() && positions.at(index) != -1;
+  }
+
+  bool isEmpty() const
+  {
+    return entries.isEmpty();
+  }
+
+  int size() const
+  {
+    return entries.size();
+  }
+
+  /* Make room for indexes up to capacity - 1 */
+  void reserve(int capacity);
+
+private:
+  struct Entry
+  {
+    float cost;
+    int index;
+  };
+
+  void siftUp(int pos);
+  void siftDown(int pos);
+  void place(int pos, const Entry& entry);
+
+  /* Heap structure with root at position 0 */
+  QVector<Entry> entries;
+
+  /* Maps index to position in entries or -1 if not in heap */
+  QVector<int> positions;
+};
+
+#endif // LITTLENAVMAP_INDEXEDHEAP_H
@@ -1924,6 +1924,26 @@ bool Route::hasValidParking() const
 }
 
 /* Fetch airways by waypoint and name and adjust route altititude if needed */
+void Route::updateAirway(int index)
+{
+  RouteLeg& routeLeg = (*this)[index];
+  if(!routeLeg.getAirwayName().isEmpty())
+  {
+    map::MapAirway airway;
+    NavApp::getMapQuery()->getAirwayByNameAndWaypoint(airway, routeLeg.getAirwayName(), value(index - 1).getIdent(),
+                                                      routeLeg.getIdent());
+    routeLeg.setAirway(airway);
+  }
+  else
+    routeLeg.setAirway(map::MapAirway());
+}
+
+void Route::updateAirways(int fromIndex, int toIndex)
+{
+  for(int i = std::max(fromIndex, 1); i <= std::min(toIndex, size() - 1); i++)
+    updateAirway(i);
+}
+
 void Route::updateAirwaysAndAltitude(bool adjustRouteAltitude, bool adjustRouteType)
 {
   if(isEmpty())
@@ -1933,23 +1953,18 @@ void Route::updateAirwaysAndAltitude(bool adjustRouteAltitude, bool adjustRouteT
   int minAltitude = 0, maxAltitude = 100000;
   for(int i = 1; i < size(); i++)
   {
-    RouteLeg& routeLeg = (*this)[i];
-    const RouteLeg& prevLeg = value(i - 1);
+    updateAirway(i);
 
+    const RouteLeg& routeLeg = value(i);
     if(!routeLeg.getAirwayName().isEmpty())
     {
-      map::MapAirway airway;
-      NavApp::getMapQuery()->getAirwayByNameAndWaypoint(airway, routeLeg.getAirwayName(), prevLeg.getIdent(),
-                                                        routeLeg.getIdent());
-      routeLeg.setAirway(airway);
+      const map::MapAirway& airway = routeLeg.getAirway();
       minAltitude = std::max(airway.minAltitude, minAltitude);
       if(airway.maxAltitude > 0)
         maxAltitude = std::min(airway.maxAltitude, maxAltitude);
 
-      hasAirway |= !routeLeg.getAirwayName().isEmpty();
+      hasAirway = true;
     }
-    else
-      routeLeg.setAirway(map::MapAirway());
   }
 
   // Convert feet to local unit
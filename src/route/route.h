@@ -497,6 +497,9 @@ public:
   bool hasValidParking() const;
 
   void updateAirwaysAndAltitude(bool adjustRouteAltitude, bool adjustRouteType);
+
+  /* Load airways only for legs from fromIndex to toIndex inclusive. Used after partial changes. */
+  void updateAirways(int fromIndex, int toIndex);
   int adjustAltitude(int newAltitude) const;
 
   /* Get a position along the route. Pos is invalid if not along. distFromStart in nm */
@@ -556,6 +559,9 @@ private:
 
   void clearFlightplanProcedureProperties(proc::MapProcedureTypes type);
 
+  /* Query airway object for leg at index by name and the idents of the leg and the previous leg */
+  void updateAirway(int index);
+
   /* Calculate all distances and courses for route map objects */
   void updateDistancesAndCourse();
   void updateBoundingRect();
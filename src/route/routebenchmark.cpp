@@ -0,0 +1,251 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "route/routebenchmark.h"
+
+#include "route/routefinder.h"
+#include "route/routenetworkairway.h"
+#include "route/routenetworkradio.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "geo/pos.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+using atools::sql::SqlQuery;
+using atools::geo::Pos;
+
+RouteBenchmark::RouteBenchmark(atools::sql::SqlDatabase *sqlDb)
+  : db(sqlDb), airportPairs(defaultAirportPairs()),
+  modes({nw::ROUTE_RADIONAV, nw::ROUTE_VICTOR, nw::ROUTE_JET})
+{
+}
+
+RouteBenchmark::~RouteBenchmark()
+{
+
+}
+
+QVector<std::pair<QString, QString> > RouteBenchmark::defaultAirportPairs()
+{
+  return {
+    {"EDDF", "LIRF"},
+    {"LFPG", "LEMD"},
+    {"EDDM", "ESSA"},
+    {"EHAM", "UUEE"},
+    {"EGLL", "LTBA"},
+    {"EGLL", "OMDB"},
+    {"EDDF", "VIDP"},
+    {"KLAX", "KJFK"},
+    {"KSEA", "KMIA"},
+    {"CYYZ", "KDFW"},
+    {"RJTT", "VHHH"},
+    {"YSSY", "YPPH"}
+  };
+}
+
+void RouteBenchmark::run()
+{
+  results.clear();
+
+  RouteNetworkRadio networkRadio(db);
+  RouteNetworkAirway networkAirway(db);
+  networkRadio.setLandmarkDirectory(landmarkDirectory);
+  networkAirway.setLandmarkDirectory(landmarkDirectory);
+
+  QElapsedTimer timer;
+  timer.start();
+  if(preload)
+  {
+    networkRadio.preloadNetwork();
+    networkAirway.preloadNetwork();
+    qInfo() << Q_FUNC_INFO << "Preloading networks" << timer.restart() << "ms";
+
+    if(landmarks)
+    {
+      networkRadio.loadLandmarks();
+      networkAirway.loadLandmarks();
+      qInfo() << Q_FUNC_INFO << "Loading landmarks" << timer.restart() << "ms";
+    }
+  }
+
+  RouteFinder finderRadio(&networkRadio), finderAirway(&networkAirway);
+
+  for(const std::pair<QString, QString>& pair : airportPairs)
+  {
+    Pos departurePos = airportPos(pair.first), destinationPos = airportPos(pair.second);
+    if(!departurePos.isValid() || !destinationPos.isValid())
+    {
+      qWarning() << Q_FUNC_INFO << "Airport not found" << pair.first << pair.second;
+      continue;
+    }
+
+    for(nw::Modes mode : modes)
+    {
+      if(mode & nw::ROUTE_RADIONAV)
+        runPair(&networkRadio, &finderRadio, mode, pair.first, pair.second, departurePos, destinationPos);
+      else
+        runPair(&networkAirway, &finderAirway, mode, pair.first, pair.second, departurePos, destinationPos);
+    }
+  }
+}
+
+/* Calculate one pair with great circle and landmark heuristic */
+void RouteBenchmark::runPair(RouteNetwork *network, RouteFinder *finder, nw::Modes mode,
+                             const QString& departure, const QString& destination,
+                             const atools::geo::Pos& departurePos, const atools::geo::Pos& destinationPos)
+{
+  network->setMode(mode);
+
+  for(bool useLandmarks : {false, true})
+  {
+    if(useLandmarks && !network->hasLandmarks())
+      continue;
+
+    if(!network->isPreloaded())
+    {
+      // Start with empty caches to get reproducible query counts
+      network->deInitQueries();
+      network->initQueries();
+    }
+    network->resetNumberOfQueries();
+
+    rf::BenchmarkResult result;
+    result.departure = departure;
+    result.destination = destination;
+    result.mode = mode;
+    result.landmarks = useLandmarks;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    finder->setUseLandmarks(useLandmarks);
+    result.found = finder->calculateRoute(departurePos, destinationPos, 0);
+    result.elapsedMs = timer.elapsed();
+    result.nodesExpanded = finder->getNumNodesExpanded();
+    result.nodesCache = network->getNumberOfNodesCache();
+    result.queries = network->getNumberOfQueries();
+
+    if(result.found)
+    {
+      QVector<rf::RouteEntry> route;
+      finder->extractRoute(route, result.distanceMeter);
+    }
+    results.append(result);
+  }
+}
+
+Pos RouteBenchmark::airportPos(const QString& ident)
+{
+  SqlQuery query(db);
+  query.prepare("select lonx, laty from airport where ident = :ident");
+  query.bindValue(":ident", ident);
+  query.exec();
+
+  Pos pos;
+  if(query.next())
+    pos = Pos(query.valueFloat("lonx"), query.valueFloat("laty"));
+  query.finish();
+  return pos;
+}
+
+void RouteBenchmark::logResults() const
+{
+  qint64 expandedGc = 0, expandedLandmarks = 0;
+  for(int i = 0; i < results.size(); i++)
+  {
+    const rf::BenchmarkResult& result = results.at(i);
+    qInfo().noquote().nospace() << result.departure << "-" << result.destination
+                                << " " << modeName(result.mode)
+                                << (result.landmarks ? " landmarks" : " great circle")
+                                << " found " << result.found
+                                << " expanded " << result.nodesExpanded
+                                << " queries " << result.queries
+                                << " distance " << atools::geo::meterToNm(result.distanceMeter) << " NM"
+                                << " time " << result.elapsedMs << " ms";
+
+    // Compare only pairs where both variants were calculated
+    if(result.landmarks && i > 0 && !results.at(i - 1).landmarks)
+    {
+      expandedGc += results.at(i - 1).nodesExpanded;
+      expandedLandmarks += result.nodesExpanded;
+    }
+  }
+
+  if(expandedGc > 0)
+    qInfo() << Q_FUNC_INFO << "Expanded nodes great circle" << expandedGc << "landmarks" << expandedLandmarks
+            << "reduction" << QString::number(100. - 100. * expandedLandmarks / expandedGc, 'f', 1) << "%";
+}
+
+QByteArray RouteBenchmark::toJson() const
+{
+  QJsonArray array;
+  for(const rf::BenchmarkResult& result : results)
+  {
+    QJsonObject obj;
+    obj.insert("departure", result.departure);
+    obj.insert("destination", result.destination);
+    obj.insert("mode", modeName(result.mode));
+    obj.insert("landmarks", result.landmarks);
+    obj.insert("found", result.found);
+    obj.insert("wall_time_ms", static_cast<double>(result.elapsedMs));
+    obj.insert("nodes_expanded", result.nodesExpanded);
+    obj.insert("sql_queries", result.queries);
+    obj.insert("nodes_cache", result.nodesCache);
+    obj.insert("distance_nm", static_cast<double>(atools::geo::meterToNm(result.distanceMeter)));
+    array.append(obj);
+  }
+
+  QJsonObject root;
+  root.insert("database", db->databaseName());
+  root.insert("preload", preload);
+  root.insert("results", array);
+  return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QString RouteBenchmark::modeName(nw::Modes mode)
+{
+  if(mode & nw::ROUTE_RADIONAV)
+    return "radionav";
+  else if(mode & nw::ROUTE_VICTOR && mode & nw::ROUTE_JET)
+    return "both";
+  else if(mode & nw::ROUTE_VICTOR)
+    return "victor";
+  else if(mode & nw::ROUTE_JET)
+    return "jet";
+  else
+    return "none";
+}
+
+nw::Modes RouteBenchmark::modeFromName(const QString& name)
+{
+  QString mode = name.trimmed().toLower();
+  if(mode == "radionav")
+    return nw::ROUTE_RADIONAV;
+  else if(mode == "both")
+    return nw::ROUTE_VICTOR | nw::ROUTE_JET;
+  else if(mode == "victor")
+    return nw::ROUTE_VICTOR;
+  else if(mode == "jet")
+    return nw::ROUTE_JET;
+  else
+    return nw::ROUTE_NONE;
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_ROUTEBENCHMARK_H
+#define LITTLENAVMAP_ROUTEBENCHMARK_H
+
+#include "route/routenetwork.h"
+
+class RouteFinder;
+
+namespace rf {
+
+/* Result for one airport pair, mode and heuristic */
+struct BenchmarkResult
+{
+  QString departure, destination; /* Airport idents */
+  nw::Modes mode = nw::ROUTE_NONE;
+  bool landmarks = false; /* Landmark heuristic was used */
+  bool found = false;
+  int nodesExpanded = 0, nodesCache = 0, queries = 0;
+  float distanceMeter = 0.f;
+  qint64 elapsedMs = 0;
+};
+
+}
+
+/*
+ * Calculates routes for a list of airport pairs in all network modes with and without the landmark
+ * heuristic. Used to compare the number of expanded nodes, SQL queries and calculation time.
+ *
+ * Creates its own networks on the given database which are optionally preloaded before calculation.
+ * Used by the debug menu and the headless routebench program.
+ */
+class RouteBenchmark
+{
+public:
+  RouteBenchmark(atools::sql::SqlDatabase *sqlDb);
+  ~RouteBenchmark();
+
+  /* Airport ident pairs to calculate. Default is defaultAirportPairs(). */
+  void setAirportPairs(const QVector<std::pair<QString, QString> >& pairs)
+  {
+    airportPairs = pairs;
+  }
+
+  /* Fixed list of city pairs covering short, continental and intercontinental routes */
+  static QVector<std::pair<QString, QString> > defaultAirportPairs();
+
+  /* Modes to calculate. Default is radio navaids, Victor and Jet airways. */
+  void setModes(const QVector<nw::Modes>& value)
+  {
+    modes = value;
+  }
+
+  /* Load whole network into memory before calculation. Otherwise nodes are fetched on demand and
+   * caches are cleared before each calculation. Default is true. */
+  void setPreload(bool value)
+  {
+    preload = value;
+  }
+
+  /* Calculate each pair a second time using the landmark heuristic if available. Default is true. */
+  void setLandmarks(bool value)
+  {
+    landmarks = value;
+  }
+
+  /* Directory to read and write landmark files. Default is empty which uses the directory of the database. */
+  void setLandmarkDirectory(const QString& value)
+  {
+    landmarkDirectory = value;
+  }
+
+  /* Preload networks and landmarks if enabled and calculate all pairs */
+  void run();
+
+  const QVector<rf::BenchmarkResult>& getResults() const
+  {
+    return results;
+  }
+
+  /* Print all results and a comparison of node expansions with and without landmarks to the log */
+  void logResults() const;
+
+  /* Get all results as a JSON document */
+  QByteArray toJson() const;
+
+  /* Convert mode to a short name like "jet" and back. Returns ROUTE_NONE for an unknown name. */
+  static QString modeName(nw::Modes mode);
+  static nw::Modes modeFromName(const QString& name);
+
+private:
+  void runPair(RouteNetwork *network, RouteFinder *finder, nw::Modes mode, const QString& departure,
+               const QString& destination, const atools::geo::Pos& departurePos,
+               const atools::geo::Pos& destinationPos);
+  atools::geo::Pos airportPos(const QString& ident);
+
+  atools::sql::SqlDatabase *db;
+  QVector<std::pair<QString, QString> > airportPairs;
+  QVector<nw::Modes> modes;
+  QVector<rf::BenchmarkResult> results;
+  QString landmarkDirectory;
+  bool preload = true, landmarks = true;
+};
+
+#endif // LITTLENAVMAP_ROUTEBENCHMARK_H
@@ -0,0 +1,245 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "route/routecalcrunner.h"
+
+#include "db/databasemanager.h"
+#include "route/routenetworkairway.h"
+#include "route/routenetworkradio.h"
+#include "sql/sqldatabase.h"
+#include "exception.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+
+RouteCalcRunner::RouteCalcRunner(QObject *parent)
+  : QObject(parent)
+{
+  cancelSignal = false;
+}
+
+RouteCalcRunner::~RouteCalcRunner()
+{
+  cancel(true /* wait */);
+}
+
+void RouteCalcRunner::start(const QVector<rf::CalcRequest>& requests, const atools::geo::Pos& departure,
+                            const atools::geo::Pos& destination, const QString& databaseFile,
+                            bool preferVor, bool preferNdb)
+{
+  qDebug() << Q_FUNC_INFO << "requests" << requests.size();
+
+  cancel(true /* wait */);
+  cancelSignal = false;
+  results.clear();
+
+  departurePos = departure;
+  destinationPos = destination;
+  dbFile = databaseFile;
+  preferVorToAirway = preferVor;
+  preferNdbToAirway = preferNdb;
+
+  for(const rf::CalcRequest& request : requests)
+  {
+    QFutureWatcher<rf::CalcResult> *watcher = new QFutureWatcher<rf::CalcResult>(this);
+    connect(watcher, &QFutureWatcher<rf::CalcResult>::finished, this, &RouteCalcRunner::watcherFinished);
+    watcher->setFuture(QtConcurrent::run(this, &RouteCalcRunner::calculate, request, connectionCounter++));
+    watchers.append(watcher);
+  }
+}
+
+void RouteCalcRunner::cancel(bool wait)
+{
+  cancelSignal = true;
+
+  if(wait)
+  {
+    // Threads read the copied parameters - need to wait before they can be changed or deleted
+    for(QFutureWatcher<rf::CalcResult> *watcher : watchers)
+      watcher->waitForFinished();
+    clearWatchers();
+  }
+}
+
+bool RouteCalcRunner::isRunning() const
+{
+  for(const QFutureWatcher<rf::CalcResult> *watcher : watchers)
+  {
+    if(watcher->isRunning())
+      return true;
+  }
+  return false;
+}
+
+void RouteCalcRunner::clearWatchers()
+{
+  for(QFutureWatcher<rf::CalcResult> *watcher : watchers)
+  {
+    watcher->disconnect(this);
+    watcher->deleteLater();
+  }
+  watchers.clear();
+}
+
+/* Called in GUI thread by the watchers */
+void RouteCalcRunner::watcherFinished()
+{
+  if(cancelSignal)
+    return;
+
+  int numFinished = 0;
+  for(const QFutureWatcher<rf::CalcResult> *watcher : watchers)
+  {
+    if(watcher->isFinished())
+      numFinished++;
+  }
+
+  emit calculationProgress(numFinished, watchers.size());
+
+  if(numFinished == watchers.size())
+  {
+    // Collect successful results
+    results.clear();
+    for(const QFutureWatcher<rf::CalcResult> *watcher : watchers)
+    {
+      rf::CalcResult result = watcher->result();
+      if(result.found)
+        results.append(result);
+    }
+    clearWatchers();
+
+    // Rank by distance with a penalty for airway changes
+    std::sort(results.begin(), results.end(), [](const rf::CalcResult& r1, const rf::CalcResult& r2) -> bool
+    {
+      return r1.distanceMeter + r1.airwayChanges * AIRWAY_CHANGE_PENALTY_METER <
+      r2.distanceMeter + r2.airwayChanges * AIRWAY_CHANGE_PENALTY_METER;
+    });
+
+    // Remove identical routes found by different variants keeping the best ranked
+    QVector<rf::CalcResult> uniqueResults;
+    for(const rf::CalcResult& result : results)
+    {
+      bool duplicate = std::any_of(uniqueResults.begin(), uniqueResults.end(),
+                                   [&result](const rf::CalcResult& other) -> bool
+      {
+        if(other.route.size() != result.route.size())
+          return false;
+
+        for(int i = 0; i < result.route.size(); i++)
+        {
+          if(other.route.at(i).ref.id != result.route.at(i).ref.id ||
+             other.route.at(i).ref.type != result.route.at(i).ref.type)
+            return false;
+        }
+        return true;
+      });
+
+      if(!duplicate)
+        uniqueResults.append(result);
+    }
+    results = uniqueResults;
+
+    qDebug() << Q_FUNC_INFO << "results" << results.size();
+    emit calculationFinished();
+  }
+}
+
+/* Runs in a thread of the global pool. Uses own database connection and network. */
+rf::CalcResult RouteCalcRunner::calculate(rf::CalcRequest request, int connectionId) const
+{
+  QThread::currentThread()->setPriority(QThread::LowPriority);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  rf::CalcResult result;
+  result.request = request;
+
+  if(cancelSignal)
+    return result;
+
+  QString connectionName = QString("LNMROUTECALC%1").arg(connectionId);
+  atools::sql::SqlDatabase *db = nullptr;
+  RouteNetwork *network = nullptr;
+
+  try
+  {
+    db = DatabaseManager::openThreadDatabase(connectionName, dbFile);
+
+    if(request.mode & nw::ROUTE_RADIONAV)
+      network = new RouteNetworkRadio(db);
+    else
+      network = new RouteNetworkAirway(db);
+    network->setMode(request.mode);
+
+    RouteFinder finder(network);
+    finder.setPreferVorToAirway(preferVorToAirway);
+    finder.setPreferNdbToAirway(preferNdbToAirway);
+    finder.setCancelFlag(&cancelSignal);
+
+    result.found = finder.calculateRoute(departurePos, destinationPos, request.altitudeFt);
+    result.nodesExpanded = finder.getNumNodesExpanded();
+
+    if(result.found && !cancelSignal)
+    {
+      finder.extractRoute(result.route, result.distanceMeter);
+      result.airwayChanges = numAirwayChanges(result.route);
+    }
+    else
+      result.found = false;
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught exception" << e.what();
+    result.found = false;
+  }
+  catch(...)
+  {
+    qWarning() << Q_FUNC_INFO << "Caught unknown exception";
+    result.found = false;
+  }
+
+  // Network has to be deleted before database to release the queries
+  delete network;
+  DatabaseManager::closeThreadDatabase(db, connectionName);
+
+  result.elapsedMs = timer.elapsed();
+
+  qDebug() << Q_FUNC_INFO << request.description << "found" << result.found
+           << "distance" << atools::geo::meterToNm(result.distanceMeter) << "NM"
+           << "airway changes" << result.airwayChanges << "time" << result.elapsedMs << "ms";
+
+  return result;
+}
+
+int RouteCalcRunner::numAirwayChanges(const QVector<rf::RouteEntry>& route)
+{
+  int changes = 0;
+  QString lastAirway;
+  for(const rf::RouteEntry& entry : route)
+  {
+    if(!entry.airwayName.isEmpty())
+    {
+      if(!lastAirway.isEmpty() && lastAirway != entry.airwayName)
+        changes++;
+      lastAirway = entry.airwayName;
+    }
+  }
+  return changes;
+}
@@ -0,0 +1,121 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef LITTLENAVMAP_ROUTECALCRUNNER_H
+#define LITTLENAVMAP_ROUTECALCRUNNER_H
+
+#include "route/routefinder.h"
+#include "fs/pln/flightplan.h"
+#include "geo/pos.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+
+namespace rf {
+
+/* One flight plan calculation variant which is run in a separate thread */
+struct CalcRequest
+{
+  nw::Modes mode;
+  atools::fs::pln::RouteType type;
+  int altitudeFt; /* Use airways valid for this altitude. 0 to ignore. */
+  QString description; /* Shown to the user */
+};
+
+/* Result of one calculation variant */
+struct CalcResult
+{
+  rf::CalcRequest request;
+  bool found = false;
+  QVector<rf::RouteEntry> route;
+  float distanceMeter = 0.f;
+  int airwayChanges = 0, nodesExpanded = 0;
+  qint64 elapsedMs = 0;
+};
+
+}
+
+/*
+ * Runs several flight plan calculations concurrently in the global thread pool.
+ *
+ * Each calculation opens its own readonly connection to the navigation database and uses a separate
+ * route network. Therefore nothing is shared with the GUI thread.
+ * Results are ranked by distance and number of airway changes. All calculations can be cancelled at any time.
+ */
+class RouteCalcRunner :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  RouteCalcRunner(QObject *parent);
+  virtual ~RouteCalcRunner() override;
+
+  /*
+   * Start all calculations in the background. Cancels and waits for any running calculations before.
+   * @param databaseFile Navigation database file which is opened readonly by each thread
+   */
+  void start(const QVector<rf::CalcRequest>& requests, const atools::geo::Pos& departure,
+             const atools::geo::Pos& destination, const QString& databaseFile, bool preferVor, bool preferNdb);
+
+  /* Stop all calculations. Waits for threads to finish if wait is true. No signal is sent after cancelling.
+   * Threads finish shortly after cancelling and are waited for on next start. */
+  void cancel(bool wait);
+
+  bool isRunning() const;
+
+  /* Successful results ordered by rank. Best first. Valid after calculationFinished was emitted. */
+  const QVector<rf::CalcResult>& getResults() const
+  {
+    return results;
+  }
+
+signals:
+  /* Sent for each finished calculation */
+  void calculationProgress(int numFinished, int numTotal);
+
+  /* All calculations are finished. Not sent if cancelled. */
+  void calculationFinished();
+
+private:
+  /* Runs in background thread */
+  rf::CalcResult calculate(rf::CalcRequest request, int connectionId) const;
+
+  void watcherFinished();
+  void clearWatchers();
+
+  /* Number of airway changes along the route */
+  static int numAirwayChanges(const QVector<rf::RouteEntry>& route);
+
+  /* Rank used for sorting. Penalty in meter per airway change. */
+  static Q_DECL_CONSTEXPR float AIRWAY_CHANGE_PENALTY_METER = atools::geo::nmToMeter(20.f);
+
+  QVector<QFutureWatcher<rf::CalcResult> *> watchers;
+  QVector<rf::CalcResult> results;
+
+  /* Copied parameters used read only by the threads */
+  atools::geo::Pos departurePos, destinationPos;
+  QString dbFile;
+  bool preferVorToAirway = false, preferNdbToAirway = false;
+
+  std::atomic_bool cancelSignal;
+
+  /* Used to create unique connection names */
+  int connectionCounter = 0;
+};
+
+#endif // LITTLENAVMAP_ROUTECALCRUNNER_H
@@ -18,12 +18,38 @@
 #include "route/routecommand.h"
 #include "route/routecontroller.h"
 
+#include <QDebug>
+
+using atools::fs::pln::Flightplan;
+using atools::fs::pln::FlightplanEntry;
+
+/* Compare all fields of an entry which are not loaded from the database */
+static bool entriesEqual(const FlightplanEntry& entry1, const FlightplanEntry& entry2)
+{
+  return entry1.getWaypointType() == entry2.getWaypointType() &&
+         entry1.getWaypointId() == entry2.getWaypointId() &&
+         entry1.getIcaoIdent() == entry2.getIcaoIdent() &&
+         entry1.getIcaoRegion() == entry2.getIcaoRegion() &&
+         entry1.getAirway() == entry2.getAirway() &&
+         entry1.getPosition() == entry2.getPosition() &&
+         entry1.getFlags() == entry2.getFlags();
+}
+
+/* Copy of plan without entries */
+static Flightplan flightplanHeader(const Flightplan& flightplan)
+{
+  Flightplan header(flightplan);
+  header.getEntries().clear();
+  return header;
+}
+
 RouteCommand::RouteCommand(RouteController *routeController,
                            const atools::fs::pln::Flightplan& flightplanBefore, const QString& text,
                            rctype::RouteCmdType rcType)
   : QUndoCommand(text), controller(routeController), type(rcType)
 {
-  planBeforeChange = flightplanBefore;
+  headerBeforeChange = flightplanHeader(flightplanBefore);
+  entriesBeforeChange = flightplanBefore.getEntries();
 }
 
 RouteCommand::~RouteCommand()
@@ -33,12 +59,38 @@ RouteCommand::~RouteCommand()
 
 void RouteCommand::setFlightplanAfter(const atools::fs::pln::Flightplan& flightplanAfter)
 {
-  planAfterChange = flightplanAfter;
+  headerAfterChange = flightplanHeader(flightplanAfter);
+
+  // Start with the whole list and remove all equal entries at start and end
+  entryIndex = 0;
+  entriesRemoved = entriesBeforeChange;
+  entriesInserted = flightplanAfter.getEntries();
+  entriesBeforeChange.clear();
+
+  trimEntries();
+}
+
+void RouteCommand::trimEntries()
+{
+  int prefix = 0;
+  while(prefix < entriesRemoved.size() && prefix < entriesInserted.size() &&
+        entriesEqual(entriesRemoved.at(prefix), entriesInserted.at(prefix)))
+    prefix++;
+
+  int suffix = 0;
+  while(suffix < entriesRemoved.size() - prefix && suffix < entriesInserted.size() - prefix &&
+        entriesEqual(entriesRemoved.at(entriesRemoved.size() - 1 - suffix),
+                     entriesInserted.at(entriesInserted.size() - 1 - suffix)))
+    suffix++;
+
+  entryIndex += prefix;
+  entriesRemoved = entriesRemoved.mid(prefix, entriesRemoved.size() - prefix - suffix);
+  entriesInserted = entriesInserted.mid(prefix, entriesInserted.size() - prefix - suffix);
 }
 
 void RouteCommand::undo()
 {
-  controller->changeRouteUndo(planBeforeChange);
+  controller->changeRouteUndo(headerBeforeChange, entryIndex, entriesInserted.size(), entriesRemoved);
 }
 
 void RouteCommand::redo()
@@ -47,7 +99,7 @@ void RouteCommand::redo()
     // Skip first redo - I need to do the initial changes myself
     firstRedoExecuted = true;
   else
-    controller->changeRouteRedo(planAfterChange);
+    controller->changeRouteRedo(headerAfterChange, entryIndex, entriesRemoved.size(), entriesInserted);
 }
 
 int RouteCommand::id() const
@@ -73,8 +125,55 @@ bool RouteCommand::mergeWith(const QUndoCommand *other)
     case rctype::DELETE:
     case rctype::MOVE:
     case rctype::ALTITUDE:
-      // Merge - overwrite the flight plan after the change
-      planAfterChange = newCmd->planAfterChange;
+      {
+        // Combine both changes into one range. Entries outside of both ranges are unchanged by the new command and
+        // are taken from the current plan which is already in the state after the new command.
+        Flightplan current = controller->getRoute().getFlightplan();
+        current.removeNoSaveEntries();
+        const QList<FlightplanEntry>& currentEntries = current.getEntries();
+
+        const int index1 = entryIndex, index2 = newCmd->entryIndex;
+        const QList<FlightplanEntry>& inserted1 = entriesInserted, & removed2 = newCmd->entriesRemoved,
+                                    & inserted2 = newCmd->entriesInserted;
+
+        // Range covering both changes in the plan between the two commands
+        int start = std::min(index1, index2);
+        int end = std::max(index1 + inserted1.size(), index2 + removed2.size());
+        int sizeDiff2 = inserted2.size() - removed2.size();
+
+        if(end + sizeDiff2 > currentEntries.size())
+        {
+          qWarning() << Q_FUNC_INFO << "Cannot merge - plan does not match";
+          return false;
+        }
+
+        // Get entry of the plan between the two commands
+        auto intermediateAt = [&](int i) -> const FlightplanEntry& {
+                                if(i >= index2 && i < index2 + removed2.size())
+                                  return removed2.at(i - index2);
+                                else if(i >= index1 && i < index1 + inserted1.size())
+                                  return inserted1.at(i - index1);
+                                else if(i < index2)
+                                  return currentEntries.at(i);
+                                else
+                                  return currentEntries.at(i + sizeDiff2);
+                              };
+
+        QList<FlightplanEntry> removed;
+        for(int i = start; i < index1; i++)
+          removed.append(intermediateAt(i));
+        removed.append(entriesRemoved);
+        for(int i = index1 + inserted1.size(); i < end; i++)
+          removed.append(intermediateAt(i));
+
+        entryIndex = start;
+        entriesRemoved = removed;
+        entriesInserted = currentEntries.mid(start, end + sizeDiff2 - start);
+        trimEntries();
+
+        headerAfterChange = newCmd->headerAfterChange;
+      }
+
       // Let controller know about the merge so the undo index can be adapted
       controller->undoMerge();
       return true;
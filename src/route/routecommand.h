@@ -39,7 +39,8 @@ enum RouteCmdType
 
 /*
  * Flight plan undo command including a few workaround for QUndoCommand inflexibilities.
- * Keeps a copy of the flight plan before and after the change.
+ * Keeps only the flight plan values without entries before and after the change as well as the range of
+ * entries which was replaced. Entry indexes do not include procedure and alternate legs since these are not saved.
  */
 class RouteCommand :
   public QUndoCommand
@@ -52,18 +53,30 @@ public:
   virtual void undo() override;
   virtual void redo() override;
 
-  /* Need to keep both versions in a redundant way since linking between commands is not reliable */
+  /* Calculates the changed range of entries compared to the plan given in the constructor */
   void setFlightplanAfter(const atools::fs::pln::Flightplan& flightplanAfter);
 
 private:
   virtual int id() const override;
   virtual bool mergeWith(const QUndoCommand *other) override;
 
+  /* Remove entries from the start and end of the changed range which are equal before and after */
+  void trimEntries();
+
   /* Avoid the first redo action when inserting the command. This not usable for complex interactions. */
   bool firstRedoExecuted = false;
   RouteController *controller;
   rctype::RouteCmdType type;
-  atools::fs::pln::Flightplan planBeforeChange, planAfterChange;
+
+  /* Flight plan values and properties without entries */
+  atools::fs::pln::Flightplan headerBeforeChange, headerAfterChange;
+
+  /* All entries before the change. Only used until setFlightplanAfter() is called. */
+  QList<atools::fs::pln::FlightplanEntry> entriesBeforeChange;
+
+  /* Entries starting at entryIndex which were removed and inserted by the change */
+  int entryIndex = 0;
+  QList<atools::fs::pln::FlightplanEntry> entriesRemoved, entriesInserted;
 };
 
 #endif // LITTLENAVMAP_ROUTECOMMAND_H
@@ -42,10 +42,12 @@
 #include "mapgui/mapwidget.h"
 #include "parkingdialog.h"
 #include "route/routefinder.h"
+#include "route/routecalcrunner.h"
 #include "route/routenetworkairway.h"
 #include "route/routenetworkradio.h"
 #include "route/customproceduredialog.h"
 #include "settings/settings.h"
+#include "sql/sqldatabase.h"
 #include "ui_mainwindow.h"
 #include "gui/dialog.h"
 #include "route/routealtitude.h"
@@ -71,6 +73,8 @@
 #include <QInputDialog>
 #include <QFileInfo>
 #include <QTextTable>
+#include <QProgressDialog>
+#include <QtConcurrent/QtConcurrentRun>
 
 namespace rc {
 // Route table column indexes
@@ -199,6 +203,17 @@ RouteController::RouteController(QMainWindow *parentWindow, QTableView *tableVie
   routeNetworkRadio = new RouteNetworkRadio(NavApp::getDatabaseNav());
   routeNetworkAirway = new RouteNetworkAirway(NavApp::getDatabaseNav());
 
+  landmarkCancel = false;
+  connect(&landmarkWatcher, &QFutureWatcher<void>::finished, this, &RouteController::landmarkCalculationFinished);
+  preloadRouteNetworks();
+  routeFinderRadio = new RouteFinder(routeNetworkRadio);
+  routeFinderAirway = new RouteFinder(routeNetworkAirway);
+
+  // Calculates alternatives in background threads
+  routeCalcRunner = new RouteCalcRunner(this);
+  connect(routeCalcRunner, &RouteCalcRunner::calculationProgress, this, &RouteController::routeCalcProgressed);
+  connect(routeCalcRunner, &RouteCalcRunner::calculationFinished, this, &RouteController::routeCalcFinished);
+
   // Set up undo/redo framework
   undoStack = new QUndoStack(mainWindow);
   undoStack->setUndoLimit(ROUTE_UNDO_LIMIT);
@@ -295,11 +310,17 @@ RouteController::RouteController(QMainWindow *parentWindow, QTableView *tableVie
 RouteController::~RouteController()
 {
   routeAltDelayTimer.stop();
+  routeCalcRunner->cancel(true /* wait */);
+  cancelLandmarkCalculation();
+  delete routeCalcProgress;
+  delete routeCalcRunner;
   delete tabHandlerRoute;
   delete units;
   delete entryBuilder;
   delete model;
   delete undoStack;
+  delete routeFinderRadio;
+  delete routeFinderAirway;
   delete routeNetworkRadio;
   delete routeNetworkAirway;
   delete zoomHandler;
@@ -1443,9 +1464,7 @@ void RouteController::calculateRadionav(int fromIndex, int toIndex)
   // Changing mode might need a clear
   routeNetworkRadio->setMode(nw::ROUTE_RADIONAV);
 
-  RouteFinder routeFinder(routeNetworkRadio);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::VOR, tr("Radionnav Flight Plan Calculation"),
+  if(calculateRouteInternal(routeFinderRadio, atools::fs::pln::VOR, tr("Radionnav Flight Plan Calculation"),
                             false /* fetch airways */, false /* Use altitude */,
                             fromIndex, toIndex))
     NavApp::setStatusMessage(tr("Calculated radio navaid flight plan."));
@@ -1463,9 +1482,7 @@ void RouteController::calculateHighAlt(int fromIndex, int toIndex)
   qDebug() << Q_FUNC_INFO;
   routeNetworkAirway->setMode(nw::ROUTE_JET);
 
-  RouteFinder routeFinder(routeNetworkAirway);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::HIGH_ALTITUDE,
+  if(calculateRouteInternal(routeFinderAirway, atools::fs::pln::HIGH_ALTITUDE,
                             tr("High altitude Flight Plan Calculation"),
                             true /* fetch airways */, false /* Use altitude */,
                             fromIndex, toIndex))
@@ -1484,9 +1501,7 @@ void RouteController::calculateLowAlt(int fromIndex, int toIndex)
   qDebug() << Q_FUNC_INFO;
   routeNetworkAirway->setMode(nw::ROUTE_VICTOR);
 
-  RouteFinder routeFinder(routeNetworkAirway);
-
-  if(calculateRouteInternal(&routeFinder, atools::fs::pln::LOW_ALTITUDE,
+  if(calculateRouteInternal(routeFinderAirway, atools::fs::pln::LOW_ALTITUDE,
                             tr("Low altitude Flight Plan Calculation"),
                             true /* fetch airways */, false /* Use altitude */,
                             fromIndex, toIndex))
@@ -1505,8 +1520,6 @@ void RouteController::calculateSetAlt(int fromIndex, int toIndex)
   qDebug() << Q_FUNC_INFO;
   routeNetworkAirway->setMode(nw::ROUTE_VICTOR | nw::ROUTE_JET);
 
-  RouteFinder routeFinder(routeNetworkAirway);
-
   // Just decide by given altiude if this is a high or low plan
   atools::fs::pln::RouteType type;
   if(route.getFlightplan().getCruisingAltitude() >= Unit::altFeetF(20000.f))
@@ -1514,7 +1527,7 @@ void RouteController::calculateSetAlt(int fromIndex, int toIndex)
   else
     type = atools::fs::pln::LOW_ALTITUDE;
 
-  if(calculateRouteInternal(&routeFinder, type, tr("Low altitude flight plan"),
+  if(calculateRouteInternal(routeFinderAirway, type, tr("Low altitude flight plan"),
                             true /* fetch airways */, true /* Use altitude */,
                             fromIndex, toIndex))
     NavApp::setStatusMessage(tr("Calculated high/low flight plan for given altitude."));
@@ -1532,8 +1545,6 @@ bool RouteController::calculateRouteInternal(RouteFinder *routeFinder, atools::f
                                              const QString& commandName, bool fetchAirways,
                                              bool useSetAltitude, int fromIndex, int toIndex)
 {
-  bool calcRange = fromIndex != -1 && toIndex != -1;
-
   // Create wait cursor if calculation takes too long
   QGuiApplication::setOverrideCursor(Qt::WaitCursor);
 
@@ -1549,8 +1560,42 @@ bool RouteController::calculateRouteInternal(RouteFinder *routeFinder, atools::f
   routeFinder->setPreferNdbToAirway(OptionData::instance().getFlags() & opts::ROUTE_PREFER_NDB);
 
   Pos departurePos, destinationPos;
+  calculateRoutePositions(departurePos, destinationPos, fromIndex, toIndex);
+
+  // Calculate the route
+  bool found = routeFinder->calculateRoute(departurePos, destinationPos, altitude);
 
-  if(calcRange)
+  if(found)
+  {
+    // A route was found
+    float distance = 0.f;
+    QVector<rf::RouteEntry> calculatedRoute;
+
+    // Fetch waypoints
+    routeFinder->extractRoute(calculatedRoute, distance);
+
+    found = applyCalculatedRoute(calculatedRoute, distance, departurePos, destinationPos, type, commandName,
+                                 fetchAirways, useSetAltitude, 0 /* keep altitude */, fromIndex, toIndex);
+  }
+
+  QGuiApplication::restoreOverrideCursor();
+  if(!found)
+    atools::gui::Dialog(mainWindow).showInfoMsgBox(lnm::ACTIONS_SHOWROUTE_ERROR,
+                                                   tr("Cannot find a route.\n"
+                                                      "Try another routing type or create the flight plan manually."),
+                                                   tr("Do not &show this dialog again."));
+#ifdef DEBUG_INFORMATION
+  qDebug() << Q_FUNC_INFO << route;
+#endif
+
+  return found;
+}
+
+/* Get departure and destination position for calculation of the whole plan or the given range */
+void RouteController::calculateRoutePositions(atools::geo::Pos& departurePos, atools::geo::Pos& destinationPos,
+                                              int& fromIndex, int& toIndex) const
+{
+  if(fromIndex != -1 && toIndex != -1)
   {
     fromIndex = std::max(route.getStartIndexAfterProcedure(), fromIndex);
     toIndex = std::min(route.getDestinationIndexBeforeProcedure(), toIndex);
@@ -1563,109 +1608,227 @@ bool RouteController::calculateRouteInternal(RouteFinder *routeFinder, atools::f
     departurePos = route.getStartAfterProcedure().getPosition();
     destinationPos = route.getDestinationBeforeProcedure().getPosition();
   }
+}
 
-  // Calculate the route
-  bool found = routeFinder->calculateRoute(departurePos, destinationPos, altitude);
+/* Replace flight plan or range with the calculated route. Sets cruise altitude if cruiseAltitudeFt is not 0.
+ * Returns false if the route is too long. */
+bool RouteController::applyCalculatedRoute(const QVector<rf::RouteEntry>& calculatedRoute, float distance,
+                                           const atools::geo::Pos& departurePos,
+                                           const atools::geo::Pos& destinationPos,
+                                           atools::fs::pln::RouteType type, const QString& commandName,
+                                           bool fetchAirways, bool useSetAltitude, int cruiseAltitudeFt,
+                                           int fromIndex, int toIndex)
+{
+  bool calcRange = fromIndex != -1 && toIndex != -1;
+  Flightplan& flightplan = route.getFlightplan();
 
-  if(found)
+  // Compare to direct connection and check if route is too long
+  float directDistance = departurePos.distanceMeterTo(destinationPos);
+  float ratio = distance / directDistance;
+  qDebug() << "route distance" << QString::number(distance, 'f', 0)
+           << "direct distance" << QString::number(directDistance, 'f', 0) << "ratio" << ratio;
+
+  if(ratio < MAX_DISTANCE_DIRECT_RATIO)
   {
-    // A route was found
-    float distance = 0.f;
-    QVector<rf::RouteEntry> calculatedRoute;
+    // Start undo
+    RouteCommand *undoCommand = preChange(commandName);
+    int numAlternateLegs = route.getNumAlternateLegs();
 
-    // Fetch waypoints
-    routeFinder->extractRoute(calculatedRoute, distance);
+    QList<FlightplanEntry>& entries = flightplan.getEntries();
 
-    // Compare to direct connection and check if route is too long
-    float directDistance = departurePos.distanceMeterTo(destinationPos);
-    float ratio = distance / directDistance;
-    qDebug() << "route distance" << QString::number(distance, 'f', 0)
-             << "direct distance" << QString::number(directDistance, 'f', 0) << "ratio" << ratio;
+    flightplan.setRouteType(type);
+    if(cruiseAltitudeFt > 0)
+      flightplan.setCruisingAltitude(atools::roundToInt(Unit::altFeetF(cruiseAltitudeFt)));
 
-    if(ratio < MAX_DISTANCE_DIRECT_RATIO)
-    {
-      // Start undo
-      RouteCommand *undoCommand = preChange(commandName);
-      int numAlternateLegs = route.getNumAlternateLegs();
+    if(calcRange)
+      entries.erase(flightplan.getEntries().begin() + fromIndex + 1, flightplan.getEntries().begin() + toIndex);
+    else
+      // Erase all but start and destination
+      entries.erase(flightplan.getEntries().begin() + 1, entries.end() - numAlternateLegs - 1);
 
-      QList<FlightplanEntry>& entries = flightplan.getEntries();
+    int idx = 1;
+    // Create flight plan entries - will be copied later to the route map objects
+    for(const rf::RouteEntry& routeEntry : calculatedRoute)
+    {
+      FlightplanEntry flightplanEntry;
+      entryBuilder->buildFlightplanEntry(routeEntry.ref.id, atools::geo::EMPTY_POS, routeEntry.ref.type,
+                                         flightplanEntry, fetchAirways);
+      if(fetchAirways && routeEntry.airwayId != -1)
+        // Get airway by id - needed to fetch the name first
+        updateFlightplanEntryAirway(routeEntry.airwayId, flightplanEntry);
 
-      flightplan.setRouteType(type);
       if(calcRange)
-        entries.erase(flightplan.getEntries().begin() + fromIndex + 1, flightplan.getEntries().begin() + toIndex);
+        entries.insert(flightplan.getEntries().begin() + fromIndex + idx, flightplanEntry);
       else
-        // Erase all but start and destination
-        entries.erase(flightplan.getEntries().begin() + 1, entries.end() - numAlternateLegs - 1);
-
-      int idx = 1;
-      // Create flight plan entries - will be copied later to the route map objects
-      for(const rf::RouteEntry& routeEntry : calculatedRoute)
-      {
-        FlightplanEntry flightplanEntry;
-        entryBuilder->buildFlightplanEntry(routeEntry.ref.id, atools::geo::EMPTY_POS, routeEntry.ref.type,
-                                           flightplanEntry, fetchAirways);
-        if(fetchAirways && routeEntry.airwayId != -1)
-          // Get airway by id - needed to fetch the name first
-          updateFlightplanEntryAirway(routeEntry.airwayId, flightplanEntry);
-
-        if(calcRange)
-          entries.insert(flightplan.getEntries().begin() + fromIndex + idx, flightplanEntry);
-        else
-          entries.insert(entries.end() - numAlternateLegs - 1, flightplanEntry);
-        idx++;
-      }
+        entries.insert(entries.end() - numAlternateLegs - 1, flightplanEntry);
+      idx++;
+    }
 
-      // Remove procedure points from flight plan
-      flightplan.removeNoSaveEntries();
+    // Remove procedure points from flight plan
+    flightplan.removeNoSaveEntries();
 
-      // Copy flight plan to route object
-      route.createRouteLegsFromFlightplan();
+    // Copy flight plan to route object
+    route.createRouteLegsFromFlightplan();
 
-      // Reload procedures from properties
-      loadProceduresFromFlightplan(true /* clear old procedure properties */, true /* quiet */, nullptr);
-      loadAlternateFromFlightplan(true /* quiet */);
-      QGuiApplication::restoreOverrideCursor();
+    // Reload procedures from properties
+    loadProceduresFromFlightplan(true /* clear old procedure properties */, true /* quiet */, nullptr);
+    loadAlternateFromFlightplan(true /* quiet */);
 
-      // Remove duplicates in flight plan and route
-      route.removeDuplicateRouteLegs();
-      route.updateAll();
+    // Remove duplicates in flight plan and route
+    route.removeDuplicateRouteLegs();
+    route.updateAll();
 
-      bool adjustRouteType = type != atools::fs::pln::HIGH_ALTITUDE && type != atools::fs::pln::LOW_ALTITUDE &&
-                             type != atools::fs::pln::VOR;
-      route.updateAirwaysAndAltitude(!useSetAltitude /* adjustRouteAltitude */, adjustRouteType);
+    bool adjustRouteType = type != atools::fs::pln::HIGH_ALTITUDE && type != atools::fs::pln::LOW_ALTITUDE &&
+                           type != atools::fs::pln::VOR;
+    route.updateAirwaysAndAltitude(!useSetAltitude /* adjustRouteAltitude */, adjustRouteType);
 
-      updateActiveLeg();
+    updateActiveLeg();
 
-      route.updateLegAltitudes();
+    route.updateLegAltitudes();
 
-      updateTableModel();
+    updateTableModel();
 
-      postChange(undoCommand);
-      NavApp::updateWindowTitle();
+    postChange(undoCommand);
+    NavApp::updateWindowTitle();
 
 #ifdef DEBUG_INFORMATION
-      qDebug() << flightplan;
+    qDebug() << flightplan;
 #endif
 
-      updateErrorLabel();
-      emit routeChanged(true);
+    updateErrorLabel();
+    emit routeChanged(true);
+    return true;
+  }
+  else
+    // Too long
+    return false;
+}
+
+/* Start calculation of several variants in background threads. Results are shown in routeCalcFinished */
+void RouteController::calculateAlternatives()
+{
+  qDebug() << Q_FUNC_INFO;
+
+  // Stop any background tasks
+  beforeRouteCalc();
+
+  const Flightplan& flightplan = route.getFlightplan();
+  int cruiseFt = atools::roundToInt(Unit::rev(flightplan.getCruisingAltitude(), Unit::altFeetF));
+
+  QVector<rf::CalcRequest> requests;
+  requests.append({nw::ROUTE_RADIONAV, atools::fs::pln::VOR, 0, tr("Radio navaids")});
+  requests.append({nw::ROUTE_VICTOR, atools::fs::pln::LOW_ALTITUDE, 0, tr("Low altitude (Victor airways)")});
+  requests.append({nw::ROUTE_JET, atools::fs::pln::HIGH_ALTITUDE, 0, tr("High altitude (Jet airways)")});
+
+  if(cruiseFt > 0)
+  {
+    // Airways valid for the given altitude and a few altitudes around
+    for(int altFt : {cruiseFt, cruiseFt - ALTERNATIVES_ALTITUDE_STEP_FT, cruiseFt + ALTERNATIVES_ALTITUDE_STEP_FT})
+    {
+      if(altFt > 0)
+        requests.append({nw::ROUTE_VICTOR | nw::ROUTE_JET,
+                         altFt >= 20000 ? atools::fs::pln::HIGH_ALTITUDE : atools::fs::pln::LOW_ALTITUDE,
+                         altFt, tr("Airways at %1").arg(Unit::altFeet(altFt))});
     }
-    else
-      // Too long
-      found = false;
   }
 
-  QGuiApplication::restoreOverrideCursor();
-  if(!found)
+  int fromIndex = -1, toIndex = -1;
+  Pos departurePos, destinationPos;
+  calculateRoutePositions(departurePos, destinationPos, fromIndex, toIndex);
+
+  routeCalcRunner->start(requests, departurePos, destinationPos, NavApp::getDatabaseNav()->databaseName(),
+                         OptionData::instance().getFlags() & opts::ROUTE_PREFER_VOR,
+                         OptionData::instance().getFlags() & opts::ROUTE_PREFER_NDB);
+
+  // Progress dialog keeps the main window responsive and allows to cancel
+  delete routeCalcProgress;
+  routeCalcProgress = new QProgressDialog(tr("Calculating flight plan alternatives ..."), tr("&Cancel"),
+                                          0, requests.size(), mainWindow);
+  routeCalcProgress->setWindowModality(Qt::WindowModal);
+  routeCalcProgress->setMinimumDuration(0);
+  routeCalcProgress->setValue(0);
+  connect(routeCalcProgress, &QProgressDialog::canceled, this, &RouteController::routeCalcCancelled);
+
+  NavApp::setStatusMessage(tr("Calculating flight plan alternatives."));
+}
+
+void RouteController::routeCalcProgressed(int numFinished, int numTotal)
+{
+  if(routeCalcProgress != nullptr)
+  {
+    routeCalcProgress->setMaximum(numTotal);
+    routeCalcProgress->setValue(numFinished);
+  }
+}
+
+void RouteController::routeCalcCancelled()
+{
+  qDebug() << Q_FUNC_INFO;
+  routeCalcRunner->cancel(false /* wait */);
+
+  if(routeCalcProgress != nullptr)
+  {
+    routeCalcProgress->deleteLater();
+    routeCalcProgress = nullptr;
+  }
+  NavApp::setStatusMessage(tr("Flight plan calculation cancelled."));
+}
+
+/* All background calculations are done. Let the user select one of the alternatives. */
+void RouteController::routeCalcFinished()
+{
+  if(routeCalcProgress != nullptr)
+  {
+    routeCalcProgress->disconnect(this);
+    routeCalcProgress->deleteLater();
+    routeCalcProgress = nullptr;
+  }
+
+  const QVector<rf::CalcResult>& results = routeCalcRunner->getResults();
+
+  if(results.isEmpty())
+  {
     atools::gui::Dialog(mainWindow).showInfoMsgBox(lnm::ACTIONS_SHOWROUTE_ERROR,
                                                    tr("Cannot find a route.\n"
                                                       "Try another routing type or create the flight plan manually."),
                                                    tr("Do not &show this dialog again."));
-#ifdef DEBUG_INFORMATION
-  qDebug() << Q_FUNC_INFO << route;
-#endif
+    NavApp::setStatusMessage(tr("No route found."));
+    return;
+  }
 
-  return found;
+  QStringList items;
+  for(int i = 0; i < results.size(); i++)
+  {
+    const rf::CalcResult& result = results.at(i);
+    items.append(tr("%1. %2, %3, %4 waypoints, %5 airway changes").
+                 arg(i + 1).arg(result.request.description).arg(Unit::distMeter(result.distanceMeter)).
+                 arg(result.route.size()).arg(result.airwayChanges));
+  }
+
+  bool ok = false;
+  QString item = QInputDialog::getItem(mainWindow, QApplication::applicationName(),
+                                       tr("Select a flight plan alternative:"), items, 0, false, &ok);
+  int index = items.indexOf(item);
+
+  if(ok && index != -1)
+  {
+    const rf::CalcResult& result = results.at(index);
+    const rf::CalcRequest& request = result.request;
+    bool useSetAltitude = request.altitudeFt > 0;
+
+    // Start and destination might have changed in the meantime
+    int fromIndex = -1, toIndex = -1;
+    Pos departurePos, destinationPos;
+    calculateRoutePositions(departurePos, destinationPos, fromIndex, toIndex);
+
+    if(applyCalculatedRoute(result.route, result.distanceMeter, departurePos, destinationPos, request.type,
+                            tr("Alternative Flight Plan Calculation"),
+                            !(request.mode & nw::ROUTE_RADIONAV) /* fetch airways */, useSetAltitude,
+                            request.altitudeFt, fromIndex, toIndex))
+      NavApp::setStatusMessage(tr("Calculated flight plan: %1.").arg(request.description));
+    else
+      NavApp::setStatusMessage(tr("No route found."));
+  }
 }
 
 void RouteController::adjustFlightplanAltitude()
@@ -1749,9 +1912,80 @@ void RouteController::reverseRoute()
   NavApp::setStatusMessage(tr("Reversed flight plan."));
 }
 
+/* Load the complete networks into memory if enabled in settings. Avoids SQL queries during route calculation. */
+void RouteController::preloadRouteNetworks()
+{
+  if(atools::settings::Settings::instance().getAndStoreValue(lnm::OPTIONS_ROUTE_NETWORK_PRELOAD, false).toBool())
+  {
+    routeNetworkRadio->preloadNetwork();
+    routeNetworkAirway->preloadNetwork();
+
+    // Landmark tables are calculated once after loading or compiling a database and saved next to the file
+    if(atools::settings::Settings::instance().getAndStoreValue(lnm::OPTIONS_ROUTE_NETWORK_LANDMARKS, true).toBool())
+    {
+      // Calculation takes several seconds - routing uses the great circle heuristic until the tables are ready
+      QVector<RouteNetwork *> missing;
+      for(RouteNetwork *network : {routeNetworkRadio, routeNetworkAirway})
+      {
+        if(!network->readLandmarks())
+          missing.append(network);
+      }
+
+      if(!missing.isEmpty())
+        startLandmarkCalculation(missing);
+    }
+  }
+}
+
+void RouteController::startLandmarkCalculation(const QVector<RouteNetwork *>& networks)
+{
+  cancelLandmarkCalculation();
+
+  landmarkCancel = false;
+  landmarkNetworks = networks;
+  landmarkTables.fill(nw::LandmarkTables(), networks.size());
+
+  // Only reads the preloaded networks which are not changed before cancelLandmarkCalculation() is called
+  landmarkWatcher.setFuture(QtConcurrent::run([this]() -> void
+  {
+    for(int i = 0; i < landmarkNetworks.size() && !landmarkCancel; i++)
+      landmarkNetworks.at(i)->calculateLandmarks(landmarkTables[i], &landmarkCancel);
+  }));
+}
+
+void RouteController::cancelLandmarkCalculation()
+{
+  landmarkCancel = true;
+  landmarkWatcher.waitForFinished();
+  landmarkNetworks.clear();
+  landmarkTables.clear();
+}
+
+void RouteController::landmarkCalculationFinished()
+{
+  if(landmarkCancel)
+    return;
+
+  // Enables the landmark heuristic for the next calculation
+  for(int i = 0; i < landmarkNetworks.size(); i++)
+    landmarkNetworks.at(i)->setLandmarks(landmarkTables.at(i));
+
+  landmarkNetworks.clear();
+  landmarkTables.clear();
+}
+
 void RouteController::preDatabaseLoad()
 {
   loadingDatabaseState = true;
+
+  // Threads use their own connection to the database file
+  if(routeCalcRunner->isRunning())
+    routeCalcCancelled();
+  routeCalcRunner->cancel(true /* wait */);
+
+  // Stop landmark calculation before the networks are cleared
+  cancelLandmarkCalculation();
+
   routeNetworkRadio->deInitQueries();
   routeNetworkAirway->deInitQueries();
   routeAltDelayTimer.stop();
@@ -1765,6 +1999,7 @@ void RouteController::postDatabaseLoad()
 {
   routeNetworkRadio->initQueries();
   routeNetworkAirway->initQueries();
+  preloadRouteNetworks();
 
   // Remove the legs but keep the properties
   route.clearProcedures(proc::PROCEDURE_ALL);
@@ -2457,22 +2692,24 @@ void RouteController::tableSelectionChanged(const QItemSelection& selected, cons
 }
 
 /* Called by undo command */
-void RouteController::changeRouteUndo(const atools::fs::pln::Flightplan& newFlightplan)
+void RouteController::changeRouteUndo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                                      const QList<FlightplanEntry>& entries)
 {
   // Keep our own index as a workaround
   undoIndex--;
 
   qDebug() << "changeRouteUndo undoIndex" << undoIndex << "undoIndexClean" << undoIndexClean;
-  changeRouteUndoRedo(newFlightplan);
+  changeRouteUndoRedo(header, index, numRemove, entries);
 }
 
 /* Called by undo command */
-void RouteController::changeRouteRedo(const atools::fs::pln::Flightplan& newFlightplan)
+void RouteController::changeRouteRedo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                                      const QList<FlightplanEntry>& entries)
 {
   // Keep our own index as a workaround
   undoIndex++;
   qDebug() << "changeRouteRedo undoIndex" << undoIndex << "undoIndexClean" << undoIndexClean;
-  changeRouteUndoRedo(newFlightplan);
+  changeRouteUndoRedo(header, index, numRemove, entries);
 }
 
 /* Called by undo command when commands are merged */
@@ -2483,19 +2720,42 @@ void RouteController::undoMerge()
 }
 
 /* Update window after undo or redo action */
-void RouteController::changeRouteUndoRedo(const atools::fs::pln::Flightplan& newFlightplan)
+void RouteController::changeRouteUndoRedo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                                          const QList<FlightplanEntry>& entries)
 {
-  route.clearAll();
-  route.setFlightplan(newFlightplan);
+  qDebug() << Q_FUNC_INFO << "index" << index << "numRemove" << numRemove << "numInsert" << entries.size();
 
-  // Change format in plan according to last saved format
-  route.getFlightplan().setFileFormat(routeFileFormat);
-  route.createRouteLegsFromFlightplan();
-  loadProceduresFromFlightplan(false /* clear old procedure properties */, true /* quiet */, nullptr);
-  loadAlternateFromFlightplan(true /* quiet */);
-  route.updateAll();
-  route.updateAirwaysAndAltitude(false /* adjustRouteAltitude */, false /* adjustRouteType */);
-  route.updateLegAltitudes();
+  if(!changeRouteUndoRedoPartial(header, index, numRemove, entries))
+  {
+    // Build the complete plan from the current one and reload everything
+    Flightplan current = route.getFlightplan();
+    current.removeNoSaveEntries();
+    QList<FlightplanEntry> newEntries = current.getEntries();
+    if(index + numRemove > newEntries.size())
+    {
+      qWarning() << Q_FUNC_INFO << "Route does not match undo command";
+      index = std::min(index, newEntries.size());
+      numRemove = newEntries.size() - index;
+    }
+    newEntries.erase(newEntries.begin() + index, newEntries.begin() + index + numRemove);
+    for(int i = 0; i < entries.size(); i++)
+      newEntries.insert(index + i, entries.at(i));
+
+    Flightplan newFlightplan(header);
+    newFlightplan.getEntries() = newEntries;
+
+    route.clearAll();
+    route.setFlightplan(newFlightplan);
+
+    // Change format in plan according to last saved format
+    route.getFlightplan().setFileFormat(routeFileFormat);
+    route.createRouteLegsFromFlightplan();
+    loadProceduresFromFlightplan(false /* clear old procedure properties */, true /* quiet */, nullptr);
+    loadAlternateFromFlightplan(true /* quiet */);
+    route.updateAll();
+    route.updateAirwaysAndAltitude(false /* adjustRouteAltitude */, false /* adjustRouteType */);
+    route.updateLegAltitudes();
+  }
 
   updateTableModel();
   NavApp::updateWindowTitle();
@@ -2504,6 +2764,74 @@ void RouteController::changeRouteUndoRedo(const atools::fs::pln::Flightplan& new
   emit routeChanged(true);
 }
 
+bool RouteController::changeRouteUndoRedoPartial(const atools::fs::pln::Flightplan& header, int index,
+                                                 int numRemove, const QList<FlightplanEntry>& entries)
+{
+  Flightplan& flightplan = route.getFlightplan();
+
+  // Procedures, alternates and departure start position are loaded depending on these
+  if(flightplan.getProperties() != header.getProperties() ||
+     flightplan.getDepartureIdent() != header.getDepartureIdent() ||
+     flightplan.getDestinationIdent() != header.getDestinationIdent() ||
+     flightplan.getDepartureParkingName() != header.getDepartureParkingName())
+    return false;
+
+  // Get route indexes of all saved legs - excludes procedures and alternates
+  QVector<int> routeIndexes;
+  for(int i = 0; i < route.size(); i++)
+  {
+    if(route.value(i).isRoute())
+      routeIndexes.append(i);
+  }
+
+  // Changed range has to be between departure and destination which keeps procedures attached
+  if(index < 1 || index + numRemove > routeIndexes.size() - 1)
+    return false;
+
+  // Position in route after departure and SID legs or after the previous saved leg
+  int insertIndex = routeIndexes.at(index - 1) + 1;
+  while(insertIndex < route.size() && route.value(insertIndex).getProcedureType() & proc::PROCEDURE_DEPARTURE)
+    insertIndex++;
+
+  if(numRemove > 0 && routeIndexes.at(index) != insertIndex)
+  {
+    qWarning() << Q_FUNC_INFO << "Route does not match undo command";
+    return false;
+  }
+
+  QList<FlightplanEntry>& fpEntries = flightplan.getEntries();
+  for(int i = 0; i < numRemove; i++)
+  {
+    fpEntries.removeAt(insertIndex);
+    route.removeAt(insertIndex);
+  }
+
+  // Load only new legs from the database
+  for(int i = 0; i < entries.size(); i++)
+  {
+    int legIndex = insertIndex + i;
+    fpEntries.insert(legIndex, entries.at(i));
+
+    RouteLeg routeLeg(&flightplan);
+    routeLeg.createFromDatabaseByEntry(legIndex, &route.value(legIndex - 1));
+    route.insert(legIndex, routeLeg);
+  }
+
+  // Copy all values except entries - properties are equal
+  QList<FlightplanEntry> allEntries;
+  allEntries.swap(fpEntries);
+  flightplan = header;
+  flightplan.getEntries().swap(allEntries);
+  flightplan.setFileFormat(routeFileFormat);
+
+  route.updateAll();
+
+  // Airways change only for the new legs and the leg following them
+  route.updateAirways(insertIndex, insertIndex + entries.size());
+  route.updateLegAltitudes();
+  return true;
+}
+
 void RouteController::styleChanged()
 {
   tabHandlerRoute->styleChanged();
@@ -2516,6 +2844,9 @@ void RouteController::optionsChanged()
   zoomHandler->zoomPercent(OptionData::instance().getGuiRouteTableTextSize());
 
   updateTableHeaders();
+
+  // Units or text size might have changed - rebuild all rows
+  modelRowKeyVersion++;
   updateTableModel();
 
   updateUnits();
@@ -3552,67 +3883,171 @@ QIcon RouteController::iconForLeg(const RouteLeg& leg, int size) const
   return icon;
 }
 
-/* Update table view model completely */
+/* Create a row of empty items with flags, fonts and alignment. Texts are set in updateTableModel */
+QList<QStandardItem *> RouteController::createModelRow() const
+{
+  QList<QStandardItem *> itemRow;
+  for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; col++)
+  {
+    QStandardItem *item = new QStandardItem();
+    item->setFlags(item->flags() & ~(Qt::ItemIsEditable | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled));
+    itemRow.append(item);
+  }
+
+  QFont f = itemRow.at(rc::IDENT)->font();
+  f.setBold(true);
+  itemRow.at(rc::IDENT)->setFont(f);
+
+  // Align cells to the right
+  for(int col : {rc::IDENT, rc::REGION, rc::REMAINING_DISTANCE, rc::DIST, rc::COURSE, rc::DIRECT, rc::COURSETRUE,
+                 rc::DIRECTTRUE, rc::RANGE, rc::FREQ, rc::RESTRICTION, rc::LEG_TIME, rc::ETA, rc::FUEL_WEIGHT,
+                 rc::FUEL_VOLUME})
+    itemRow.at(col)->setTextAlignment(Qt::AlignRight);
+
+  return itemRow;
+}
+
+/* Set text only if changed to avoid needless data changed signals */
+void RouteController::setModelItemText(int row, int col, const QString& text)
+{
+  QStandardItem *item = model->item(row, col);
+  if(item == nullptr)
+  {
+    item = new QStandardItem(text);
+    item->setFlags(item->flags() & ~(Qt::ItemIsEditable | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled));
+    model->setItem(row, col, item);
+  }
+  else if(item->text() != text)
+    item->setText(text);
+}
+
+void RouteController::clearModelRouteTimeFuel(int row)
+{
+  setModelItemText(row, rc::LEG_TIME, QString());
+  setModelItemText(row, rc::ETA, QString());
+  setModelItemText(row, rc::FUEL_WEIGHT, QString());
+  setModelItemText(row, rc::FUEL_VOLUME, QString());
+}
+
+/* Key for the content of a model row. Distance, course, time and fuel columns are not covered since they depend on
+ * other legs. */
+QString RouteController::modelRowKey(const RouteLeg& leg, int iconSize) const
+{
+  const proc::MapProcedureLeg& procLeg = leg.getProcedureLeg();
+  const proc::MapAltRestriction& altRestr = leg.getProcedureLegAltRestr();
+  const proc::MapSpeedRestriction& speedRestr = procLeg.speedRestriction;
+  const map::MapAirway& airway = leg.getAirway();
+  map::MapRunwayEnd runwayEnd = leg.getRunwayEnd();
+
+  QStringList key({QString::number(modelRowKeyVersion), QString::number(iconSize),
+                   QString::number(static_cast<uint>(leg.getMapObjectType())), QString::number(leg.getId()),
+                   QString::number(leg.isAnyProcedure()), QString::number(leg.isAlternate()),
+                   leg.getIdent(), leg.getRegion(), leg.getName(),
+                   QString::number(leg.getFrequency()), QString::number(leg.getRange()),
+                   leg.getAirwayName(), QString::number(airway.isValid() ? airway.id : -1),
+                   QString::number(static_cast<int>(leg.getProcedureType())),
+                   QString::number(procLeg.approachId), QString::number(procLeg.transitionId),
+                   QString::number(procLeg.legId), QString::number(runwayEnd.isValid() ? runwayEnd.id : -1)});
+
+  if(altRestr.isValid())
+    key << QString::number(altRestr.descriptor) << QString::number(altRestr.alt1) << QString::number(altRestr.alt2);
+  if(speedRestr.isValid())
+    key << QString::number(speedRestr.descriptor) << QString::number(speedRestr.speed);
+
+  return key.join("|");
+}
+
+/* Update table view model. Rows are compared by a key built from the leg. Unchanged rows at start and end are kept,
+ * rows in between are reused, removed or inserted as needed. Texts and icons are built for these rows only. */
 void RouteController::updateTableModel()
 {
   Ui::MainWindow *ui = NavApp::getMainUi();
 
-  model->removeRows(0, model->rowCount());
-  float totalDistance = route.getTotalDistance();
-
-  int row = 0;
-  float cumulatedDistance = 0.f;
+  int iconSize = view->verticalHeader()->defaultSectionSize() - 2;
+
+  QStringList rowKeys;
+  for(int row = 0; row < route.size(); row++)
+    rowKeys.append(modelRowKey(route.value(row), iconSize));
+
+  // Remove highlight for active leg since rows might be moved below - set again in highlightNextWaypoint
+  if(highlightedLegIndex >= 0 && highlightedLegIndex < model->rowCount())
+    updateModelRowBackground(highlightedLegIndex, false /* active */);
+  highlightedLegIndex = -1;
+
+  auto rowEquals = [this, &rowKeys](int modelRow, int row) -> bool
+                   {
+                     QStandardItem *identItem = model->item(modelRow, rc::IDENT);
+                     return identItem != nullptr && identItem->data(Qt::UserRole).toString() == rowKeys.at(row);
+                   };
+
+  // Find unchanged rows at start and end of table ===================================
+  int numRows = rowKeys.size(), numModelRows = model->rowCount();
+  int numPrefix = 0;
+  while(numPrefix < numRows && numPrefix < numModelRows && rowEquals(numPrefix, numPrefix))
+    numPrefix++;
+
+  int numSuffix = 0;
+  while(numSuffix < numRows - numPrefix && numSuffix < numModelRows - numPrefix &&
+        rowEquals(numModelRows - 1 - numSuffix, numRows - 1 - numSuffix))
+    numSuffix++;
+
+  // Adjust number of rows in the changed range ===================================
+  int numChangedRows = numRows - numPrefix - numSuffix;
+  int numChangedModelRows = numModelRows - numPrefix - numSuffix;
+  if(numChangedModelRows > numChangedRows)
+    model->removeRows(numPrefix + numChangedRows, numChangedModelRows - numChangedRows);
+  else
+  {
+    for(int row = numPrefix + numChangedModelRows; row < numPrefix + numChangedRows; row++)
+      model->insertRow(row, createModelRow());
+  }
 
-  QList<QStandardItem *> itemRow;
-  for(int i = rc::FIRST_COLUMN; i <= rc::LAST_COLUMN; i++)
-    itemRow.append(nullptr);
+  // ILS for approach runway is loaded once when needed
+  QVector<map::MapIls> ilsByAirportAndRunway;
+  bool ilsLoaded = false;
 
-  for(int i = 0; i < route.size(); i++)
+  // Update texts and icons in the changed range ===================================
+  for(int row = numPrefix; row < numPrefix + numChangedRows; row++)
   {
-    const RouteLeg& leg = route.value(i);
+    const RouteLeg& leg = route.value(row);
+
+    // Distance, course, time and fuel are left empty and are filled by updateModelRouteDistance
+    // and updateModelRouteTimeFuel
+    QStringList texts;
+    for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; col++)
+      texts.append(QString());
 
     // Ident ===========================================
-    QString identStr;
     if(leg.isAnyProcedure())
       // Get ident with IAF, FAF or other indication
-      identStr = proc::procedureLegFixStr(leg.getProcedureLeg());
+      texts[rc::IDENT] = proc::procedureLegFixStr(leg.getProcedureLeg());
     else
-      identStr = leg.getIdent();
-
-    QStandardItem *ident =
-      new QStandardItem(iconForLeg(leg, view->verticalHeader()->defaultSectionSize() - 2), identStr);
-    QFont f = ident->font();
-    f.setBold(true);
-    ident->setFont(f);
-    ident->setTextAlignment(Qt::AlignRight);
-
-    itemRow[rc::IDENT] = ident;
+      texts[rc::IDENT] = leg.getIdent();
     // highlightProcedureItems() does error checking for IDENT
 
     // Region, navaid name, procedure type ===========================================
-    itemRow[rc::REGION] = new QStandardItem(leg.getRegion());
-    itemRow[rc::NAME] = new QStandardItem(leg.getName());
+    texts[rc::REGION] = leg.getRegion();
+    texts[rc::NAME] = leg.getName();
 
     if(leg.isAlternate())
-      itemRow[rc::PROCEDURE] = new QStandardItem(tr("Alternate"));
+      texts[rc::PROCEDURE] = tr("Alternate");
     else
-      itemRow[rc::PROCEDURE] = new QStandardItem(route.getProcedureLegText(leg.getProcedureType()));
+      texts[rc::PROCEDURE] = route.getProcedureLegText(leg.getProcedureType());
 
     // Airway or leg type and restriction ===========================================
     if(leg.isRoute())
     {
       // Airway ========================
-      itemRow[rc::AIRWAY_OR_LEGTYPE] = new QStandardItem(leg.getAirwayName());
+      texts[rc::AIRWAY_OR_LEGTYPE] = leg.getAirwayName();
       const map::MapAirway& airway = leg.getAirway();
       if(airway.isValid())
-        itemRow[rc::RESTRICTION] =
-          new QStandardItem(map::airwayAltTextShort(airway, false /* addUnit */, false /* narrow */));
+        texts[rc::RESTRICTION] = map::airwayAltTextShort(airway, false /* addUnit */, false /* narrow */);
       // highlightProcedureItems() does error checking
     }
     else
     {
       // Procedure ========================
-      itemRow[rc::AIRWAY_OR_LEGTYPE] = new QStandardItem(proc::procedureLegTypeStr(leg.getProcedureLegType()));
+      texts[rc::AIRWAY_OR_LEGTYPE] = proc::procedureLegTypeStr(leg.getProcedureLegType());
 
       QString restrictions;
       if(leg.getProcedureLegAltRestr().isValid())
@@ -3620,126 +4055,79 @@ void RouteController::updateTableModel()
       if(leg.getProcedureLeg().speedRestriction.isValid())
         restrictions.append(tr("/") + proc::speedRestrictionTextShort(leg.getProcedureLeg().speedRestriction));
 
-      itemRow[rc::RESTRICTION] = new QStandardItem(restrictions);
+      texts[rc::RESTRICTION] = restrictions;
     }
 
     // Get ILS for approach runway if it marks the end of an ILS or localizer approach procedure
-    QVector<map::MapIls> ilsByAirportAndRunway;
-    if(route.getApproachLegs().hasIlsGuidance() &&
-       leg.isAnyProcedure() && leg.getProcedureLeg().isApproach() && leg.getRunwayEnd().isValid())
+    bool ilsLeg = route.getApproachLegs().hasIlsGuidance() &&
+                  leg.isAnyProcedure() && leg.getProcedureLeg().isApproach() && leg.getRunwayEnd().isValid();
+    if(ilsLeg && !ilsLoaded)
+    {
       route.getApproachRunwayEndAndIls(ilsByAirportAndRunway);
+      ilsLoaded = true;
+    }
 
     // VOR/NDB type ===========================
     if(leg.getVor().isValid())
-      itemRow[rc::TYPE] = new QStandardItem(map::vorFullShortText(leg.getVor()));
+      texts[rc::TYPE] = map::vorFullShortText(leg.getVor());
     else if(leg.getNdb().isValid())
-      itemRow[rc::TYPE] = new QStandardItem(map::ndbFullShortText(leg.getNdb()));
-    else if(leg.isAnyProcedure() && !(leg.getProcedureLeg().isMissed()) &&
-            leg.getRunwayEnd().isValid())
+      texts[rc::TYPE] = map::ndbFullShortText(leg.getNdb());
+    else if(ilsLeg && !(leg.getProcedureLeg().isMissed()))
     {
       // Build string for ILS type
-      QSet<QString> texts;
+      QSet<QString> ilsTexts;
       for(const map::MapIls& ils : ilsByAirportAndRunway)
       {
         QStringList txt(ils.slope > 0.f ? tr("ILS") : tr("LOC"));
         if(ils.hasDme)
           txt.append("DME");
-        texts.insert(txt.join("/"));
+        ilsTexts.insert(txt.join("/"));
       }
 
-      itemRow[rc::TYPE] = new QStandardItem(texts.toList().join(","));
+      texts[rc::TYPE] = ilsTexts.toList().join(",");
     }
 
     // VOR/NDB frequency =====================
     if(leg.getVor().isValid())
     {
       if(leg.getVor().tacan)
-        itemRow[rc::FREQ] = new QStandardItem(leg.getVor().channel);
+        texts[rc::FREQ] = leg.getVor().channel;
       else
-        itemRow[rc::FREQ] = new QStandardItem(QLocale().toString(leg.getFrequency() / 1000.f, 'f', 2));
+        texts[rc::FREQ] = QLocale().toString(leg.getFrequency() / 1000.f, 'f', 2);
     }
     else if(leg.getNdb().isValid())
-      itemRow[rc::FREQ] = new QStandardItem(QLocale().toString(leg.getFrequency() / 100.f, 'f', 1));
-    else if(leg.isAnyProcedure() && !(leg.getProcedureLeg().isMissed()) &&
-            leg.getRunwayEnd().isValid())
+      texts[rc::FREQ] = QLocale().toString(leg.getFrequency() / 100.f, 'f', 1);
+    else if(ilsLeg && !(leg.getProcedureLeg().isMissed()))
     {
       // Add ILS frequencies
-      QSet<QString> texts;
+      QSet<QString> ilsTexts;
       for(const map::MapIls& ils : ilsByAirportAndRunway)
-        texts.insert(QLocale().toString(ils.frequency / 1000.f, 'f', 2));
+        ilsTexts.insert(QLocale().toString(ils.frequency / 1000.f, 'f', 2));
 
-      itemRow[rc::FREQ] = new QStandardItem(texts.toList().join(","));
+      texts[rc::FREQ] = ilsTexts.toList().join(",");
     }
 
     // VOR/NDB range =====================
     if(leg.getRange() > 0 && (leg.getVor().isValid() || leg.getNdb().isValid()))
-      itemRow[rc::RANGE] = new QStandardItem(Unit::distNm(leg.getRange(), false));
-
-    // Course =====================
-    bool afterArrivalAirport = route.isAirportAfterArrival(i);
-    if(row > 0 && !afterArrivalAirport && leg.getDistanceTo() < map::INVALID_DISTANCE_VALUE &&
-       leg.getDistanceTo() > 0.f)
-    {
-      if(leg.getCourseToMag() < map::INVALID_COURSE_VALUE)
-        itemRow[rc::COURSE] = new QStandardItem(QLocale().toString(leg.getCourseToMag(), 'f', 0));
-      if(leg.getCourseToRhumbMag() < map::INVALID_COURSE_VALUE)
-        itemRow[rc::DIRECT] = new QStandardItem(QLocale().toString(leg.getCourseToRhumbMag(), 'f', 0));
-      if(leg.getCourseToTrue() < map::INVALID_COURSE_VALUE)
-        itemRow[rc::COURSETRUE] = new QStandardItem(QLocale().toString(leg.getCourseToTrue(), 'f', 0));
-      if(leg.getCourseToRhumbTrue() < map::INVALID_COURSE_VALUE)
-        itemRow[rc::DIRECTTRUE] = new QStandardItem(QLocale().toString(leg.getCourseToRhumbTrue(), 'f', 0));
-    }
-
-    if(!afterArrivalAirport)
-    {
-      if(leg.getDistanceTo() < map::INVALID_DISTANCE_VALUE) // Distance =====================
-      {
-        cumulatedDistance += leg.getDistanceTo();
-        itemRow[rc::DIST] = new QStandardItem(Unit::distNm(leg.getDistanceTo(), false));
-
-        if(!leg.getProcedureLeg().isMissed() && !leg.isAlternate())
-        {
-          float remaining = totalDistance - cumulatedDistance;
-          if(remaining < 0.f)
-            remaining = 0.f; // Catch the -0 case due to rounding errors
-          itemRow[rc::REMAINING_DISTANCE] = new QStandardItem(Unit::distNm(remaining, false));
-        }
-      }
-    }
+      texts[rc::RANGE] = Unit::distNm(leg.getRange(), false);
 
     if(leg.isAnyProcedure())
-      itemRow[rc::REMARKS] = new QStandardItem(proc::procedureLegRemark(leg.getProcedureLeg()));
-
-    // Travel time, remaining fuel and ETA are updated in updateModelRouteTime
+      texts[rc::REMARKS] = proc::procedureLegRemark(leg.getProcedureLeg());
 
-    // Create empty items for missing fields
     for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; col++)
     {
-      if(itemRow[col] == nullptr)
-        itemRow[col] = new QStandardItem();
-      itemRow[col]->setFlags(itemRow[col]->flags() &
-                             ~(Qt::ItemIsEditable | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled));
+      if(col != rc::COURSE && col != rc::DIRECT && col != rc::COURSETRUE && col != rc::DIRECTTRUE &&
+         col != rc::DIST && col != rc::REMAINING_DISTANCE &&
+         col != rc::LEG_TIME && col != rc::ETA && col != rc::FUEL_WEIGHT && col != rc::FUEL_VOLUME)
+        setModelItemText(row, col, texts.at(col));
     }
 
-    // Align cells to the right - rest is aligned in updateModelRouteTimeFuel
-    itemRow[rc::REGION]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::REMAINING_DISTANCE]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::DIST]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::COURSE]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::DIRECT]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::COURSETRUE]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::DIRECTTRUE]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::RANGE]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::FREQ]->setTextAlignment(Qt::AlignRight);
-    itemRow[rc::RESTRICTION]->setTextAlignment(Qt::AlignRight);
-
-    model->appendRow(itemRow);
-
-    for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; col++)
-      itemRow[col] = nullptr;
-    row++;
+    QStandardItem *identItem = model->item(row, rc::IDENT);
+    identItem->setIcon(iconForLeg(leg, iconSize));
+    identItem->setData(rowKeys.at(row), Qt::UserRole);
   }
 
+  updateModelRouteDistance();
   updateModelRouteTimeFuel();
 
   Flightplan& flightplan = route.getFlightplan();
@@ -3766,13 +4154,71 @@ void RouteController::updateTableModel()
   updateWindowLabel();
 }
 
-/* Update travel times in table view model after speed change */
+/* Update distance and course columns of all rows. These depend on the previous leg and the total distance.
+ * Changes only the text of existing items. */
+void RouteController::updateModelRouteDistance()
+{
+  float totalDistance = route.getTotalDistance();
+  float cumulatedDistance = 0.f;
+
+  for(int row = 0; row < route.size() && row < model->rowCount(); row++)
+  {
+    const RouteLeg& leg = route.value(row);
+    QString course, direct, courseTrue, directTrue, distance, remainingDistance;
+
+    // Course =====================
+    bool afterArrivalAirport = route.isAirportAfterArrival(row);
+    if(row > 0 && !afterArrivalAirport && leg.getDistanceTo() < map::INVALID_DISTANCE_VALUE &&
+       leg.getDistanceTo() > 0.f)
+    {
+      if(leg.getCourseToMag() < map::INVALID_COURSE_VALUE)
+        course = QLocale().toString(leg.getCourseToMag(), 'f', 0);
+      if(leg.getCourseToRhumbMag() < map::INVALID_COURSE_VALUE)
+        direct = QLocale().toString(leg.getCourseToRhumbMag(), 'f', 0);
+      if(leg.getCourseToTrue() < map::INVALID_COURSE_VALUE)
+        courseTrue = QLocale().toString(leg.getCourseToTrue(), 'f', 0);
+      if(leg.getCourseToRhumbTrue() < map::INVALID_COURSE_VALUE)
+        directTrue = QLocale().toString(leg.getCourseToRhumbTrue(), 'f', 0);
+    }
+
+    if(!afterArrivalAirport)
+    {
+      if(leg.getDistanceTo() < map::INVALID_DISTANCE_VALUE) // Distance =====================
+      {
+        cumulatedDistance += leg.getDistanceTo();
+        distance = Unit::distNm(leg.getDistanceTo(), false);
+
+        if(!leg.getProcedureLeg().isMissed() && !leg.isAlternate())
+        {
+          float remaining = totalDistance - cumulatedDistance;
+          if(remaining < 0.f)
+            remaining = 0.f; // Catch the -0 case due to rounding errors
+          remainingDistance = Unit::distNm(remaining, false);
+        }
+      }
+    }
+
+    setModelItemText(row, rc::COURSE, course);
+    setModelItemText(row, rc::DIRECT, direct);
+    setModelItemText(row, rc::COURSETRUE, courseTrue);
+    setModelItemText(row, rc::DIRECTTRUE, directTrue);
+    setModelItemText(row, rc::DIST, distance);
+    setModelItemText(row, rc::REMAINING_DISTANCE, remainingDistance);
+  }
+}
+
+/* Update travel times in table view model after speed change. Changes only the text of existing items. */
 void RouteController::updateModelRouteTimeFuel()
 {
   using atools::fs::perf::AircraftPerf;
   const RouteAltitude& altitudeLegs = route.getAltitudeLegs();
   if(altitudeLegs.isEmpty())
+  {
+    // Clear values of reused rows
+    for(int row = 0; row < model->rowCount(); row++)
+      clearModelRouteTimeFuel(row);
     return;
+  }
 
   int row = 0;
   float cumulatedTravelTime = 0.f;
@@ -3799,10 +4245,7 @@ void RouteController::updateModelRouteTimeFuel()
     if(!setValues)
     {
       // Do not fill if collecting performance or route altitude is invalid
-      model->setItem(row, rc::LEG_TIME, new QStandardItem());
-      model->setItem(row, rc::ETA, new QStandardItem());
-      model->setItem(row, rc::FUEL_WEIGHT, new QStandardItem());
-      model->setItem(row, rc::FUEL_VOLUME, new QStandardItem());
+      clearModelRouteTimeFuel(row);
     }
     else if(!route.isAirportAfterArrival(row)) // Avoid airport after last procedure leg
     {
@@ -3811,16 +4254,14 @@ void RouteController::updateModelRouteTimeFuel()
       // Leg time =====================================================================
       float travelTime = altitudeLegs.value(i).getTime();
       if(row == 0 || !(travelTime < map::INVALID_TIME_VALUE) || leg.getProcedureLeg().isMissed())
-        model->setItem(row, rc::LEG_TIME, new QStandardItem());
+        setModelItemText(row, rc::LEG_TIME, QString());
       else
       {
         QString txt = formatter::formatMinutesHours(travelTime);
 #ifdef DEBUG_INFORMATION_LEGTIME
         txt += " [" + QString::number(travelTime * 3600., 'f', 0) + "]";
 #endif
-        QStandardItem *item = new QStandardItem(txt);
-        item->setTextAlignment(Qt::AlignRight);
-        model->setItem(row, rc::LEG_TIME, item);
+        setModelItemText(row, rc::LEG_TIME, txt);
       }
 
       if(!leg.getProcedureLeg().isMissed())
@@ -3835,9 +4276,7 @@ void RouteController::updateModelRouteTimeFuel()
 #ifdef DEBUG_INFORMATION_LEGTIME
         txt += " [" + QString::number(cumulatedTravelTime * 3600., 'f', 0) + "]";
 #endif
-        QStandardItem *item = new QStandardItem(txt);
-        item->setTextAlignment(Qt::AlignRight);
-        model->setItem(row, rc::ETA, item);
+        setModelItemText(row, rc::ETA, txt);
 
         // Fuel at leg =====================================================================
         if(!leg.isAlternate())
@@ -3866,17 +4305,20 @@ void RouteController::updateModelRouteTimeFuel()
           // Avoid -0 case
           weight = 0.f;
 
-        txt = perf.isFuelFlowValid() ? Unit::weightLbs(weight, false /* no unit */) : QString();
-        item = new QStandardItem(txt);
-        item->setTextAlignment(Qt::AlignRight);
-        model->setItem(row, rc::FUEL_WEIGHT, item);
-
-        txt = perf.isFuelFlowValid() ? Unit::volGallon(vol, false /* no unit */) : QString();
-        item = new QStandardItem(txt);
-        item->setTextAlignment(Qt::AlignRight);
-        model->setItem(row, rc::FUEL_VOLUME, item);
+        setModelItemText(row, rc::FUEL_WEIGHT,
+                         perf.isFuelFlowValid() ? Unit::weightLbs(weight, false /* no unit */) : QString());
+        setModelItemText(row, rc::FUEL_VOLUME,
+                         perf.isFuelFlowValid() ? Unit::volGallon(vol, false /* no unit */) : QString());
+      }
+      else
+      {
+        setModelItemText(row, rc::ETA, QString());
+        setModelItemText(row, rc::FUEL_WEIGHT, QString());
+        setModelItemText(row, rc::FUEL_VOLUME, QString());
       }
     } // else if(!route.isAirportAfterArrival(row))
+    else
+      clearModelRouteTimeFuel(row);
     row++;
   } // for(int i = 0; i < route.size(); i++)
 
@@ -3910,8 +4352,8 @@ void RouteController::disconnectedFromSimulator()
 
 void RouteController::simDataChanged(const atools::fs::sc::SimConnectData& simulatorData)
 {
-  if(!loadingDatabaseState && atools::almostNotEqual(QDateTime::currentDateTime().toMSecsSinceEpoch(),
-                                                     lastSimUpdate, static_cast<qint64>(MIN_SIM_UPDATE_TIME_MS)))
+  // Update rate is limited by the SimDataDispatcher subscription
+  if(!loadingDatabaseState)
   {
     if(simulatorData.isUserAircraftValid())
     {
@@ -3939,19 +4381,55 @@ void RouteController::simDataChanged(const atools::fs::sc::SimConnectData& simul
       else
         route.updateActivePos(position);
     }
-    lastSimUpdate = QDateTime::currentDateTime().toMSecsSinceEpoch();
   }
 }
 
 /* */
 void RouteController::highlightNextWaypoint(int nearestLegIndex)
 {
-  for(int row = 0; row < model->rowCount(); ++row)
+  // Reset only the previously highlighted row instead of the whole table
+  int previousLegIndex = highlightedLegIndex;
+  highlightedLegIndex = -1;
+  if(previousLegIndex >= 0 && previousLegIndex < model->rowCount())
+    updateModelRowBackground(previousLegIndex, false /* active */);
+
+  if(!route.isEmpty())
   {
-    for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; ++col)
+    if(nearestLegIndex >= 0 && nearestLegIndex < route.size() && nearestLegIndex < model->rowCount())
     {
-      QStandardItem *item = model->item(row, col);
-      if(item != nullptr)
+      updateModelRowBackground(nearestLegIndex, true /* active */);
+      highlightedLegIndex = nearestLegIndex;
+    }
+  }
+
+  // Restore fonts and colors for the two changed rows
+  if(previousLegIndex >= 0 && previousLegIndex < model->rowCount())
+    updateModelHighlightsRow(previousLegIndex);
+  if(highlightedLegIndex >= 0 && highlightedLegIndex != previousLegIndex)
+    updateModelHighlightsRow(highlightedLegIndex);
+}
+
+/* Set or remove background and bold font for the active leg row */
+void RouteController::updateModelRowBackground(int row, bool active)
+{
+  QColor color = NavApp::isCurrentGuiStyleNight() ? mapcolors::nextWaypointColorDark : mapcolors::nextWaypointColor;
+
+  for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; ++col)
+  {
+    QStandardItem *item = model->item(row, col);
+    if(item != nullptr)
+    {
+      if(active)
+      {
+        item->setBackground(color);
+        if(!item->font().bold())
+        {
+          QFont font = item->font();
+          font.setBold(true);
+          item->setFont(font);
+        }
+      }
+      else
       {
         item->setBackground(Qt::NoBrush);
         // Keep first column bold
@@ -3964,107 +4442,88 @@ void RouteController::highlightNextWaypoint(int nearestLegIndex)
       }
     }
   }
+}
 
-  if(!route.isEmpty())
+/* Set colors for procedures and missing objects like waypoints and airways */
+void RouteController::updateModelHighlights()
+{
+  for(int row = 0; row < model->rowCount(); ++row)
   {
-    if(nearestLegIndex >= 0 && nearestLegIndex < route.size())
-    {
-      QColor color = NavApp::isCurrentGuiStyleNight() ?
-                     mapcolors::nextWaypointColorDark : mapcolors::nextWaypointColor;
-
-      for(int col = rc::FIRST_COLUMN; col <= rc::LAST_COLUMN; ++col)
-      {
-        QStandardItem *item = model->item(nearestLegIndex, col);
-        if(item != nullptr)
-        {
-          item->setBackground(color);
-          if(!item->font().bold())
-          {
-            QFont font = item->font();
-            font.setBold(true);
-            item->setFont(font);
-          }
-        }
-      }
-    }
+    if(!updateModelHighlightsRow(row))
+      break;
   }
-  updateModelHighlights();
 }
 
-/* Set colors for procedures and missing objects like waypoints and airways */
-void RouteController::updateModelHighlights()
+bool RouteController::updateModelHighlightsRow(int row)
 {
   bool night = NavApp::isCurrentGuiStyleNight();
   const QColor defaultColor = QApplication::palette().color(QPalette::Normal, QPalette::Text);
   const QColor invalidColor = night ? mapcolors::routeInvalidTableColorDark : mapcolors::routeInvalidTableColor;
 
-  for(int row = 0; row < model->rowCount(); ++row)
+  const RouteLeg& leg = route.value(row);
+  if(!leg.isValid())
   {
-    const RouteLeg& leg = route.value(row);
-    if(!leg.isValid())
-    {
-      // Have to check here since sim updates can still happen while building the flight plan
-      qWarning() << Q_FUNC_INFO << "Invalid index" << row;
-      break;
-    }
+    // Have to check here since sim updates can still happen while building the flight plan
+    qWarning() << Q_FUNC_INFO << "Invalid index" << row;
+    return false;
+  }
 
-    for(int col = 0; col < model->columnCount(); ++col)
+  for(int col = 0; col < model->columnCount(); ++col)
+  {
+    QStandardItem *item = model->item(row, col);
+    if(item != nullptr)
     {
-      QStandardItem *item = model->item(row, col);
-      if(item != nullptr)
+      // Set default font color for all items ==============
+      item->setForeground(defaultColor);
+
+      if(leg.isAlternate())
+        item->setForeground(night ? mapcolors::routeAlternateTableColorDark : mapcolors::routeAlternateTableColor);
+      else if(leg.isAnyProcedure())
       {
-        // Set default font color for all items ==============
-        item->setForeground(defaultColor);
+        if(leg.getProcedureLeg().isMissed())
+          item->setForeground(
+            night ? mapcolors::routeProcedureMissedTableColorDark : mapcolors::routeProcedureMissedTableColor);
+        else
+          item->setForeground(night ? mapcolors::routeProcedureTableColorDark : mapcolors::routeProcedureTableColor);
+      }
 
-        if(leg.isAlternate())
-          item->setForeground(night ? mapcolors::routeAlternateTableColorDark : mapcolors::routeAlternateTableColor);
-        else if(leg.isAnyProcedure())
-        {
-          if(leg.getProcedureLeg().isMissed())
-            item->setForeground(
-              night ? mapcolors::routeProcedureMissedTableColorDark : mapcolors::routeProcedureMissedTableColor);
-          else
-            item->setForeground(night ? mapcolors::routeProcedureTableColorDark : mapcolors::routeProcedureTableColor);
-        }
+      // Ident column and active leg are always bold
+      bool bold = col == rc::IDENT || row == highlightedLegIndex;
+      QString tooltip;
 
-        // Ident colum ==========================================
-        if(col == rc::IDENT)
-        {
-          if(leg.getMapObjectType() == map::INVALID)
-          {
-            item->setForeground(invalidColor);
-            item->setToolTip(tr("Waypoint \"%1\" not found.").arg(leg.getIdent()));
-          }
-          else
-            item->setToolTip(QString());
-        }
+      // Ident colum ==========================================
+      if(col == rc::IDENT && leg.getMapObjectType() == map::INVALID)
+      {
+        item->setForeground(invalidColor);
+        tooltip = tr("Waypoint \"%1\" not found.").arg(leg.getIdent());
+      }
 
-        // Airway colum ==========================================
-        if(col == rc::AIRWAY_OR_LEGTYPE && leg.isRoute())
+      // Airway colum ==========================================
+      if(col == rc::AIRWAY_OR_LEGTYPE && leg.isRoute())
+      {
+        QStringList errors;
+        if(leg.isAirwaySetAndInvalid(route.getCruisingAltitudeFeet(), &errors))
         {
-          QStringList errors;
-          if(leg.isAirwaySetAndInvalid(route.getCruisingAltitudeFeet(), &errors))
-          {
-            // Has airway but errors
-            item->setForeground(invalidColor);
-            QFont font = item->font();
-            font.setBold(true);
-            item->setFont(font);
-            if(!errors.isEmpty())
-              item->setToolTip(errors.join(tr("\n")));
-          }
-          else
-          {
-            // No airway or no errors
-            QFont font = item->font();
-            font.setBold(false);
-            item->setFont(font);
-            item->setToolTip(QString());
-          }
+          // Has airway but errors
+          item->setForeground(invalidColor);
+          bold = true;
+          tooltip = errors.join(tr("\n"));
         }
       }
+
+      // Set font and tooltip for all columns since rows are reused for other legs ==============
+      if(item->font().bold() != bold)
+      {
+        QFont font = item->font();
+        font.setBold(bold);
+        item->setFont(font);
+      }
+
+      if(item->toolTip() != tooltip)
+        item->setToolTip(tooltip);
     }
   }
+  return true;
 }
 
 /* Update the dock window top level label */
@@ -20,12 +20,16 @@
 
 #include "route/routecommand.h"
 #include "route/route.h"
+#include "route/routenetwork.h"
 #include "common/tabindexes.h"
 
+#include <QFutureWatcher>
 #include <QIcon>
 #include <QObject>
 #include <QTimer>
 
+#include <atomic>
+
 namespace atools {
 namespace gui {
 class ItemViewZoomHandler;
@@ -47,12 +51,19 @@ class FlightplanEntry;
 }
 }
 
+namespace rf {
+struct RouteEntry;
+}
+
 class QMainWindow;
 class QTableView;
 class QStandardItemModel;
+class QStandardItem;
 class QItemSelection;
 class RouteNetwork;
 class RouteFinder;
+class RouteCalcRunner;
+class QProgressDialog;
 class FlightplanEntryBuilder;
 class SymbolPainter;
 class AirportQuery;
@@ -200,6 +211,10 @@ public:
   void calculateSetAlt(int fromIndex, int toIndex);
   void calculateSetAlt();
 
+  /* Calculate radionav, low, high and altitude variants concurrently in background and let
+   * the user choose from the ranked results. Can be cancelled. */
+  void calculateAlternatives();
+
   /* Reverse order of all waypoints, swap departure and destination and automatically
    * select a new start position (best runway) */
   void reverseRoute();
@@ -233,6 +248,9 @@ public:
 
   void disconnectedFromSimulator();
 
+  /* Do not update aircraft information more than every 0.1 seconds. Used for the SimDataDispatcher subscription. */
+  static Q_DECL_CONSTEXPR int SIM_UPDATE_INTERVAL_MS = 100;
+
   void simDataChanged(const atools::fs::sc::SimConnectData& simulatorData);
 
   void editUserWaypointName(int index);
@@ -313,11 +331,14 @@ private:
     MOVE_UP = -1
   };
 
-  /* Called by route command */
-  void changeRouteUndo(const atools::fs::pln::Flightplan& newFlightplan);
+  /* Called by route command. Replaces numRemove entries at index with the given entries and copies all other
+   * values from header. Index does not count procedure and alternate legs. */
+  void changeRouteUndo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                       const QList<atools::fs::pln::FlightplanEntry>& entries);
 
   /* Called by route command */
-  void changeRouteRedo(const atools::fs::pln::Flightplan& newFlightplan);
+  void changeRouteRedo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                       const QList<atools::fs::pln::FlightplanEntry>& entries);
 
   /* Called by route command */
   void undoMerge();
@@ -363,7 +384,19 @@ private:
   bool calculateRouteInternal(RouteFinder *routeFinder, atools::fs::pln::RouteType type,
                               const QString& commandName,
                               bool fetchAirways, bool useSetAltitude, int fromIndex, int toIndex);
-
+  void calculateRoutePositions(atools::geo::Pos& departurePos, atools::geo::Pos& destinationPos,
+                               int& fromIndex, int& toIndex) const;
+  bool applyCalculatedRoute(const QVector<rf::RouteEntry>& calculatedRoute, float distance,
+                            const atools::geo::Pos& departurePos, const atools::geo::Pos& destinationPos,
+                            atools::fs::pln::RouteType type, const QString& commandName,
+                            bool fetchAirways, bool useSetAltitude, int cruiseAltitudeFt, int fromIndex, int toIndex);
+
+  /* Background calculation of alternatives */
+  void routeCalcProgressed(int numFinished, int numTotal);
+  void routeCalcCancelled();
+  void routeCalcFinished();
+
+  void updateModelRouteDistance();
   void updateModelRouteTimeFuel();
 
   /* Assign type and altitude from GUI */
@@ -374,7 +407,13 @@ private:
   void assignAircraftPerformance(atools::fs::pln::Flightplan& flightplan);
 
   /* Used by undo/redo */
-  void changeRouteUndoRedo(const atools::fs::pln::Flightplan& newFlightplan);
+  void changeRouteUndoRedo(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                           const QList<atools::fs::pln::FlightplanEntry>& entries);
+
+  /* Apply the change to the current route and load only the new legs from the database.
+   * @return false if the change affects departure, destination, procedures or alternates and needs a full reload */
+  bool changeRouteUndoRedoPartial(const atools::fs::pln::Flightplan& header, int index, int numRemove,
+                                  const QList<atools::fs::pln::FlightplanEntry>& entries);
 
   void tableCopyClipboard();
 
@@ -396,11 +435,26 @@ private:
 
   void updateTableHeaders();
   void highlightNextWaypoint(int nearestLegIndex);
+  void updateModelRowBackground(int row, bool active);
   void updateModelHighlights();
+
+  /* Update colors and tooltips of one row. Returns false if the row has no valid leg. */
+  bool updateModelHighlightsRow(int row);
+
+  QString modelRowKey(const RouteLeg& leg, int iconSize) const;
+  QList<QStandardItem *> createModelRow() const;
+  void setModelItemText(int row, int col, const QString& text);
+  void clearModelRouteTimeFuel(int row);
   void loadProceduresFromFlightplan(bool clearOldProcedureProperties, bool quiet, QStringList *procedureLoadingErrors);
   void loadAlternateFromFlightplan(bool quiet);
 
   void beforeRouteCalc();
+  void preloadRouteNetworks();
+
+  /* Calculate missing landmark tables in background and assign them to the networks when done */
+  void startLandmarkCalculation(const QVector<RouteNetwork *>& networks);
+  void cancelLandmarkCalculation();
+  void landmarkCalculationFinished();
   void updateFlightplanEntryAirway(int airwayId, atools::fs::pln::FlightplanEntry& entry);
   QIcon iconForLeg(const RouteLeg& leg, int size) const;
 
@@ -427,6 +481,9 @@ private:
 
   static Q_DECL_CONSTEXPR int ROUTE_UNDO_LIMIT = 50;
 
+  /* Alternatives are calculated for cruise altitude and plus/minus this value */
+  static Q_DECL_CONSTEXPR int ALTERNATIVES_ALTITUDE_STEP_FT = 4000;
+
   atools::gui::ItemViewZoomHandler *zoomHandler = nullptr;
 
   /* Need a workaround since QUndoStack does not report current indices and clean state correctly */
@@ -434,9 +491,28 @@ private:
   /* Clean index of the undo stack or -1 if not clean state exists */
   int undoIndexClean = 0;
 
+  /* Table row which is currently highlighted as active leg or -1 if none */
+  int highlightedLegIndex = -1;
+
+  /* Part of the row keys. Increased to rebuild all rows after option changes. */
+  int modelRowKeyVersion = 0;
+
   /* Network cache for flight plan calculation */
   RouteNetwork *routeNetworkRadio = nullptr, *routeNetworkAirway = nullptr;
 
+  /* Finders are kept to reuse the search state arrays for repeated calculations */
+  RouteFinder *routeFinderRadio = nullptr, *routeFinderAirway = nullptr;
+
+  /* Background calculation of landmark tables. Networks must not change while running. */
+  QFutureWatcher<void> landmarkWatcher;
+  std::atomic_bool landmarkCancel;
+  QVector<RouteNetwork *> landmarkNetworks;
+  QVector<nw::LandmarkTables> landmarkTables;
+
+  /* Calculates alternatives in background */
+  RouteCalcRunner *routeCalcRunner = nullptr;
+  QProgressDialog *routeCalcProgress = nullptr;
+
   /* Flightplan and route objects */
   Route route; /* real route containing all segments */
 
@@ -456,12 +532,9 @@ private:
   FlightplanEntryBuilder *entryBuilder = nullptr;
   atools::fs::pln::FlightplanIO *flightplanIO = nullptr;
 
-  /* Do not update aircraft information more than every 0.1 seconds */
-  static Q_DECL_CONSTEXPR int MIN_SIM_UPDATE_TIME_MS = 100;
   static Q_DECL_CONSTEXPR int ROUTE_ALT_CHANGE_DELAY_MS = 500;
 
   bool loadingDatabaseState = false;
-  qint64 lastSimUpdate = 0;
   atools::fs::sc::SimConnectUserAircraft aircraft;
 
   SymbolPainter *symbolPainter = nullptr;
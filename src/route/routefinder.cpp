@@ -24,15 +24,8 @@ using nw::Edge;
 using atools::geo::Pos;
 
 RouteFinder::RouteFinder(RouteNetwork *routeNetwork)
-  : network(routeNetwork), openNodesHeap(5000)
+  : network(routeNetwork)
 {
-  closedNodes.reserve(10000);
-  nodeCosts.reserve(10000);
-  nodeAltRange.reserve(10000);
-  nodePredecessor.reserve(10000);
-  nodeAirwayId.reserve(10000);
-  nodeAirwayName.reserve(10000);
-
   successorNodes.reserve(500);
   successorEdges.reserve(500);
 }
@@ -51,19 +44,23 @@ bool RouteFinder::calculateRoute(const atools::geo::Pos& from, const atools::geo
 
   int numNodesTotal = network->getNumberOfNodesDatabase();
 
+  resetSearchState();
+
   if(startNode.edges.isEmpty())
     return false;
 
-  openNodesHeap.push(startNode, 0.f);
-  nodeCosts[startNode.id] = 0.f;
-  nodeAltRange[startNode.id] = std::make_pair(0, std::numeric_limits<int>::max());
+  rf::NodeState& startState = nodeState(startNode.index);
+  startState.costs = 0.f;
+  startState.altRange = std::make_pair(0, std::numeric_limits<int>::max());
+  openNodes[startNode.index] = startNode;
+  openNodesHeap.push(startNode.index, 0.f);
 
   Node currentNode;
   bool destinationFound = false;
   while(!openNodesHeap.isEmpty())
   {
     // Contains known nodes
-    openNodesHeap.pop(currentNode);
+    currentNode = openNodes.at(openNodesHeap.pop());
 
     if(currentNode.id == destNode.id)
     {
@@ -72,18 +69,23 @@ bool RouteFinder::calculateRoute(const atools::geo::Pos& from, const atools::geo
     }
 
     // Contains nodes with known shortest path
-    closedNodes.insert(currentNode.id);
+    nodeState(currentNode.index).closed = true;
+    numClosedNodes++;
 
-    if(closedNodes.size() > numNodesTotal / 2)
+    if(numClosedNodes > numNodesTotal / 2)
       // If we read too much nodes routing will fail
       break;
 
+    if(cancelFlag != nullptr && *cancelFlag)
+      // Cancelled from another thread
+      break;
+
     // Work on successors
     expandNode(currentNode, destNode);
   }
 
   qDebug() << "found" << destinationFound << "heap size" << openNodesHeap.size()
-           << "close nodes size" << closedNodes.size();
+           << "close nodes size" << numClosedNodes;
 
   qDebug() << "num nodes database" << network->getNumberOfNodesDatabase()
            << "num nodes cache" << network->getNumberOfNodesCache();
@@ -91,6 +93,60 @@ bool RouteFinder::calculateRoute(const atools::geo::Pos& from, const atools::geo
   return destinationFound;
 }
 
+void RouteFinder::resetSearchState()
+{
+  openNodesHeap.clear();
+  numClosedNodes = 0;
+
+  generation++;
+  if(generation == 0)
+  {
+    // Counter wrapped around - reset all states to avoid false matches
+    nodeStates.fill(rf::NodeState());
+    generation = 1;
+  }
+
+  // Grow arrays to the number of known nodes to avoid reallocations during search
+  int size = network->getNodeIndexCount();
+  if(size > nodeStates.size())
+  {
+    nodeStates.resize(size);
+    nodeAirwayName.resize(size);
+    openNodes.resize(size);
+  }
+  openNodesHeap.reserve(size);
+}
+
+rf::NodeState& RouteFinder::nodeState(int index)
+{
+  if(index >= nodeStates.size())
+  {
+    // Network fetched new nodes on demand
+    int size = std::max(index + 1, nodeStates.size() * 3 / 2);
+    nodeStates.resize(size);
+    nodeAirwayName.resize(size);
+    openNodes.resize(size);
+  }
+
+  rf::NodeState& state = nodeStates[index];
+  if(state.generation != generation)
+  {
+    // Outdated - reset
+    state = rf::NodeState();
+    state.generation = generation;
+    nodeAirwayName[index].clear();
+  }
+  return state;
+}
+
+rf::NodeState RouteFinder::nodeStateConst(int index) const
+{
+  if(index >= 0 && index < nodeStates.size() && nodeStates.at(index).generation == generation)
+    return nodeStates.at(index);
+  else
+    return rf::NodeState();
+}
+
 void RouteFinder::extractRoute(QVector<rf::RouteEntry>& route, float& distanceMeter)
 {
   distanceMeter = 0.f;
@@ -108,11 +164,13 @@ void RouteFinder::extractRoute(QVector<rf::RouteEntry>& route, float& distanceMe
     {
       rf::RouteEntry entry;
       entry.ref = {navId, toMapObjectType(type)};
-      entry.airwayId = nodeAirwayId.value(pred.id, -1);
+      entry.airwayId = nodeStateConst(pred.index).airwayId;
+      if(network->isAirwayRouting())
+        entry.airwayName = nodeAirwayName.value(pred.index);
       route.prepend(entry);
     }
 
-    nw::Node next = network->getNode(nodePredecessor.value(pred.id, -1));
+    nw::Node next = network->getNode(nodeStateConst(pred.index).predecessorId);
     if(next.pos.isValid())
       distanceMeter += pred.pos.distanceMeterTo(next.pos);
     pred = next;
@@ -128,13 +186,17 @@ void RouteFinder::expandNode(const nw::Node& currentNode, const nw::Node& destNo
 
   QString currentNodeAirway;
   if(network->isAirwayRouting())
-    currentNodeAirway = nodeAirwayName[currentNode.id];
+    currentNodeAirway = nodeAirwayName.at(currentNode.index);
+
+  // Copy since vector might grow when accessing successor states
+  const rf::NodeState currentState = nodeState(currentNode.index);
 
   for(int i = 0; i < successorNodes.size(); i++)
   {
     const Node& successor = successorNodes.at(i);
+    rf::NodeState& successorState = nodeState(successor.index);
 
-    if(closedNodes.contains(successor.id))
+    if(successorState.closed)
       // Already has a shortest path
       continue;
 
@@ -164,33 +226,37 @@ void RouteFinder::expandNode(const nw::Node& currentNode, const nw::Node& destNo
     if(!currentNodeAirway.isEmpty() && !edge.airwayName.isEmpty() && currentNodeAirway != edge.airwayName)
       successorEdgeCosts *= COST_FACTOR_AIRWAY_CHANGE;
 
-    float successorNodeCosts = nodeCosts.value(currentNode.id) + successorEdgeCosts;
+    float successorNodeCosts = currentState.costs + successorEdgeCosts;
 
-    if(successorNodeCosts >= nodeCosts.value(successor.id) && openNodesHeap.contains(successor))
+    bool successorOpen = openNodesHeap.contains(successor.index);
+    if(successorNodeCosts >= successorState.costs && successorOpen)
       // New path is not cheaper
       continue;
 
-    std::pair<int, int> successorNodeAltRange = nodeAltRange.value(currentNode.id);
+    std::pair<int, int> successorNodeAltRange = currentState.altRange;
 
     if(!combineRanges(successorNodeAltRange, edge.minAltFt, edge.maxAltFt))
       continue;
 
     // New path is cheaper - update node
-    nodeAirwayId[successor.id] = successorEdges.at(i).airwayId;
+    successorState.airwayId = edge.airwayId;
     if(network->isAirwayRouting())
-      nodeAirwayName[successor.id] = successorEdges.at(i).airwayName;
-    nodePredecessor[successor.id] = currentNode.id;
-    nodeCosts[successor.id] = successorNodeCosts;
-    nodeAltRange[successor.id] = successorNodeAltRange;
+      nodeAirwayName[successor.index] = edge.airwayName;
+    successorState.predecessorId = currentNode.id;
+    successorState.costs = successorNodeCosts;
+    successorState.altRange = successorNodeAltRange;
 
     // Costs from start to successor + estimate to destination = sort order in heap
     float totalCost = successorNodeCosts + costEstimate(successor, destNode);
 
-    if(openNodesHeap.contains(successor))
+    if(successorOpen)
       // Update node and resort heap
-      openNodesHeap.change(successor, totalCost);
+      openNodesHeap.change(successor.index, totalCost);
     else
-      openNodesHeap.push(successor, totalCost);
+    {
+      openNodes[successor.index] = successor;
+      openNodesHeap.push(successor.index, totalCost);
+    }
   }
 }
 
@@ -273,10 +339,15 @@ float RouteFinder::calculateEdgeCost(const nw::Node& currentNode, const nw::Node
   return costs;
 }
 
-/* GC distance in meter as costs between nodes */
+/* GC distance in meter as costs between nodes. Landmark distances give a tighter lower bound since they follow
+ * the network. Both are admissible since all cost factors are equal or greater than one. */
 float RouteFinder::costEstimate(const nw::Node& currentNode, const nw::Node& destNode)
 {
-  return currentNode.pos.distanceMeterTo(destNode.pos);
+  float estimate = currentNode.pos.distanceMeterTo(destNode.pos);
+
+  if(useLandmarks)
+    estimate = std::max(estimate, network->getLandmarkEstimate(currentNode.index));
+  return estimate;
 }
 
 /* Convert internal network type to MapObjectTypes for extract route */
@@ -18,22 +18,42 @@
 #ifndef LITTLENAVMAP_ROUTEFINDER_H
 #define LITTLENAVMAP_ROUTEFINDER_H
 
-#include "util/heap.h"
+#include "route/indexedheap.h"
 #include "route/routenetwork.h"
 
+#include <atomic>
+
 namespace rf {
 /* Used when fetching the route points after calculation. Adds airway id to node */
 struct RouteEntry
 {
   map::MapObjectRef ref;
   int airwayId;
+  QString airwayName; /* Only for airway networks */
+};
+
+/* Search state of a node. Only valid if generation matches the generation of the current search. */
+struct NodeState
+{
+  quint32 generation = 0;
+  bool closed = false; /* Node has a known shortest path */
+  float costs = 0.f; /* Costs from start to this node */
+  int predecessorId = -1; /* Predecessor node id */
+  int airwayId = -1; /* Airway id to the predecessor */
+  std::pair<int, int> altRange; /* Min and maximum altitude range of airways to this node so far */
 };
 
 }
 
+Q_DECLARE_TYPEINFO(rf::NodeState, Q_MOVABLE_TYPE);
+
 /*
  * Calculates flight plans within a route network which can be an airway or radio navaid network.
  * Use A* algorithm and several cost factor adjustments to get reasonable routes.
+ *
+ * Search state is kept in arrays addressed by the dense node index provided by the network.
+ * The arrays are kept between calculations and invalidated by increasing a generation counter.
+ * Therefore it is cheaper to keep a finder instance for repeated calculations.
  */
 class RouteFinder
 {
@@ -68,7 +88,35 @@ public:
     preferNdbToAirway = value;
   }
 
+  /* Use the landmark heuristic of the network if available. Otherwise great circle distance is used as
+   * cost estimate only. Default is true. */
+  void setUseLandmarks(bool value)
+  {
+    useLandmarks = value;
+  }
+
+  /* Calculation stops and returns "not found" once the flag is set. Can be set from another thread. */
+  void setCancelFlag(const std::atomic_bool *value)
+  {
+    cancelFlag = value;
+  }
+
+  /* Number of nodes expanded in the last calculation */
+  int getNumNodesExpanded() const
+  {
+    return numClosedNodes;
+  }
+
 private:
+  /* Get state for node index. Resets the state if it is from a previous search. */
+  rf::NodeState& nodeState(int index);
+
+  /* Get state for node index or an empty state if it is from a previous search */
+  rf::NodeState nodeStateConst(int index) const;
+
+  /* Start a new search. Invalidates all states and clears the open heap. */
+  void resetSearchState();
+
   void expandNode(const nw::Node& node, const nw::Node& destNode);
   float calculateEdgeCost(const nw::Node& node, const nw::Node& successorNode, int lengthMeter);
   float costEstimate(const nw::Node& currentNode, const nw::Node& destNode);
@@ -108,31 +156,32 @@ private:
 
   RouteNetwork *network;
 
-  /* Heap structure storing open nodes.
+  /* Heap structure storing indexes of open nodes.
    * Sort order is defined by costs from start to node + estimate to destination */
-  atools::util::Heap<nw::Node> openNodesHeap;
+  IndexedHeap openNodesHeap;
 
-  /* Nodes that have been processed already and have a known shortest path */
-  QSet<int> closedNodes;
+  /* Open nodes by index. Needed to get the node structure when popping an index from the heap. */
+  QVector<nw::Node> openNodes;
 
-  /* Costs from start to this node. Maps node id to costs. Costs are distance in meter
-   * adjusted by some factors. */
-  QHash<int, float> nodeCosts;
+  /* Search state by node index. Costs are distance in meter adjusted by some factors. */
+  QVector<rf::NodeState> nodeStates;
 
-  /* Min and maximum altitude range of airways to this node so far */
-  QHash<int, std::pair<int, int> > nodeAltRange;
+  /* Predecessor airway name by node index. Only valid if the state is valid. */
+  QVector<QString> nodeAirwayName;
 
-  /* Maps node id to predecessor node id */
-  QHash<int, int> nodePredecessor;
-  /* Maps node id to predecessor airway id */
-  QHash<int, int> nodeAirwayId;
-  QHash<int, QString> nodeAirwayName;
+  /* Current search generation. States having a different generation are outdated. */
+  quint32 generation = 0;
+
+  /* Number of nodes closed in the last search */
+  int numClosedNodes = 0;
 
   /* For RouteNetwork::getNeighbours to avoid instantiations */
   QVector<nw::Node> successorNodes;
   QVector<nw::Edge> successorEdges;
 
-  bool preferVorToAirway = false, preferNdbToAirway = false;
+  bool preferVorToAirway = false, preferNdbToAirway = false, useLandmarks = true;
+
+  const std::atomic_bool *cancelFlag = nullptr;
 };
 
 #endif // LITTLENAVMAP_ROUTEFINDER_H
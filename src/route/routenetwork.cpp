@@ -17,6 +17,7 @@
 
 #include "routenetwork.h"
 
+#include "route/indexedheap.h"
 #include "sql/sqldatabase.h"
 #include "sql/sqlquery.h"
 #include "sql/sqlrecord.h"
@@ -25,7 +26,12 @@
 #include "geo/pos.h"
 #include "geo/rect.h"
 
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
 #include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 
 using atools::sql::SqlDatabase;
 using atools::sql::SqlQuery;
@@ -35,6 +41,9 @@ using atools::geo::Rect;
 
 using namespace nw;
 
+/* Distance value for nodes that cannot be reached from a landmark */
+static const float LANDMARK_UNREACHABLE = std::numeric_limits<float>::max();
+
 RouteNetwork::RouteNetwork(atools::sql::SqlDatabase *sqlDb, const QString& nodeTableName,
                            const QString& edgeTableName, const QStringList& nodeExtraColumns,
                            const QStringList& edgeExtraColumns)
@@ -55,13 +64,16 @@ RouteNetwork::~RouteNetwork()
 int RouteNetwork::getNumberOfNodesDatabase()
 {
   if(numNodesDb == -1)
+  {
     numNodesDb = atools::sql::SqlUtil(db).rowCount(nodeTable);
+    numQueries++;
+  }
   return numNodesDb;
 }
 
 int RouteNetwork::getNumberOfNodesCache() const
 {
-  return nodeCache.size();
+  return nodeCache.size() + preloadNodes.size();
 }
 
 void RouteNetwork::setMode(nw::Modes routeMode)
@@ -76,7 +88,10 @@ void RouteNetwork::clearStartAndDestinationNodes()
   destinationPos = atools::geo::EMPTY_POS;
   nodeCache.clear();
   destinationNodePredecessors.clear();
+  landmarkTargetMin.clear();
+  landmarkTargetMax.clear();
   numNodesDb = -1;
+  nextNodeIndex = preloadNodes.size();
   nodeIndexesCreated = false;
   edgeIndexesCreated = false;
   nodeCache.reserve(60000);
@@ -86,21 +101,37 @@ void RouteNetwork::clearStartAndDestinationNodes()
 void RouteNetwork::getNeighbours(const nw::Node& from, QVector<nw::Node>& neighbours,
                                  QVector<Edge>& edges)
 {
-  for(const Edge& e : from.edges)
+  if(isPreloaded())
   {
-    bool add = false;
+    int index = preloadedIndex(from.id);
+    if(index != -1)
+    {
+      // Walk through the edge array of the preloaded network - no SQL queries needed
+      for(int i = preloadEdgeStart.at(index); i < preloadEdgeStart.at(index + 1); i++)
+      {
+        const EdgeCompact& e = preloadEdges.at(i);
+        if(testEdgeType(static_cast<nw::EdgeType>(e.type)) && testType(
+             static_cast<nw::NodeType>(preloadNodes.at(e.toIndex).type)))
+        {
+          neighbours.append(nodeFromPreloaded(e.toIndex));
+          edges.append(edgeFromPreloaded(e));
+        }
+      }
 
-    // Handle airways differently to keep cache for low and high alt routes together
-    if(e.type == AIRWAY_BOTH)
-      add = mode & ROUTE_JET || mode & ROUTE_VICTOR;
-    else if(e.type == AIRWAY_JET)
-      add = mode & ROUTE_JET;
-    else if(e.type == AIRWAY_VICTOR)
-      add = mode & ROUTE_VICTOR;
-    else
-      add = true;
+      if(destinationNodePredecessors.contains(from.id))
+      {
+        // Add virtual edge to destination
+        neighbours.append(nodeCache.value(DESTINATION_NODE_ID));
+        edges.append(Edge(DESTINATION_NODE_ID, static_cast<int>(from.pos.distanceMeterTo(destinationPos))));
+      }
+      return;
+    }
+    // else virtual departure node which is still kept in the cache
+  }
 
-    if(add)
+  for(const Edge& e : from.edges)
+  {
+    if(testEdgeType(e.type))
     {
       // Add nodes and edges only if they match airway mode
       neighbours.append(fetchNode(e.toNodeId));
@@ -109,6 +140,20 @@ void RouteNetwork::getNeighbours(const nw::Node& from, QVector<nw::Node>& neighb
   }
 }
 
+/* Check if the edge is usable for the current mode */
+bool RouteNetwork::testEdgeType(nw::EdgeType type) const
+{
+  // Handle airways differently to keep cache for low and high alt routes together
+  if(type == AIRWAY_BOTH)
+    return mode & ROUTE_JET || mode & ROUTE_VICTOR;
+  else if(type == AIRWAY_JET)
+    return mode & ROUTE_JET;
+  else if(type == AIRWAY_VICTOR)
+    return mode & ROUTE_VICTOR;
+  else
+    return true;
+}
+
 void RouteNetwork::addDepartureAndDestinationNodes(const atools::geo::Pos& from, const atools::geo::Pos& to)
 {
   qDebug() << "adding start and  destination to network";
@@ -132,6 +177,15 @@ void RouteNetwork::addDepartureAndDestinationNodes(const atools::geo::Pos& from,
     for(int id : nodeCache.keys())
       // Fill destination node predecessor index
       addDestNodeEdges(nodeCache[id]);
+
+    if(isPreloaded())
+    {
+      // Fill destination node predecessor index for the preloaded network
+      addDestNodeEdgesPreloaded();
+
+      // Landmark distances to the destination depend on the predecessors
+      updateLandmarkTargets();
+    }
   }
 
   if(departurePos != from)
@@ -182,7 +236,8 @@ void RouteNetwork::cleanDestNodeEdges()
       else
         edges.erase(it, edges.end());
     }
-    else
+    else if(preloadedIndex(i) == -1)
+      // Preloaded nodes do not keep the destination edge
       qWarning() << "No node destination found" << nodeCache.value(i).id;
   }
 
@@ -212,6 +267,7 @@ nw::Node RouteNetwork::fetchNodeByNavId(int id, nw::NodeType type)
   nodeByNavIdQuery->bindValue(":id", id);
   nodeByNavIdQuery->bindValue(":type", type);
   nodeByNavIdQuery->exec();
+  numQueries++;
 
   nw::Node node;
 
@@ -225,6 +281,7 @@ nw::Node RouteNetwork::fetchNodeByNavId(int id, nw::NodeType type)
       // Not found and is an airway - look for waypoints
       nodeByNavIdQuery->bindValue(":type", nw::WAYPOINT_BOTH);
       nodeByNavIdQuery->exec();
+      numQueries++;
       if(nodeByNavIdQuery->next())
         node = fetchNode(nodeByNavIdQuery->value("node_id").toInt());
     }
@@ -247,10 +304,31 @@ void RouteNetwork::getNavIdAndTypeForNode(int nodeId, int& navId, nw::NodeType&
     type = DESTINATION;
     navId = -1; // No database id available
   }
+  else if(isPreloaded())
+  {
+    int index = preloadedIndex(nodeId);
+    if(index != -1)
+    {
+      const NodeCompact& node = preloadNodes.at(index);
+      navId = node.navId;
+
+      if(airwayRouting)
+        // This is an airway network which has the type in the upper four bits
+        type = static_cast<nw::NodeType>(node.type >> 4);
+      else
+        type = static_cast<nw::NodeType>(node.type);
+    }
+    else
+    {
+      navId = -1;
+      type = nw::NONE;
+    }
+  }
   else
   {
     nodeNavIdAndTypeQuery->bindValue(":id", nodeId);
     nodeNavIdAndTypeQuery->exec();
+    numQueries++;
 
     if(nodeNavIdAndTypeQuery->next())
     {
@@ -276,6 +354,8 @@ void RouteNetwork::getNavIdAndTypeForNode(int nodeId, int& navId, nw::NodeType&
 /* Create a virtual node at the given coordinates with the given id */
 nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, int id)
 {
+  // Keep the dense index of a replaced virtual node - otherwise indexes grow with each calculation
+  int index = nodeCache.contains(id) ? nodeCache.value(id).index : nextNodeIndex++;
   nodeCache.remove(id);
 
   Node node;
@@ -301,17 +381,23 @@ nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, in
     QSet<Edge> tempEdges;
     tempEdges.reserve(1000);
 
-    for(const Rect& rect : queryRect.splitAtAntiMeridian())
+    if(isPreloaded())
+      nearestNodesPreloaded(tempEdges, node.pos, queryRect);
+    else
     {
-      bindCoordRect(rect, nearestNodesQuery);
-      nearestNodesQuery->exec();
-      while(nearestNodesQuery->next())
+      for(const Rect& rect : queryRect.splitAtAntiMeridian())
       {
-        int nodeId = nearestNodesQuery->value("node_id").toInt();
-        if(testType(static_cast<nw::NodeType>(nearestNodesQuery->value("type").toInt())))
+        bindCoordRect(rect, nearestNodesQuery);
+        nearestNodesQuery->exec();
+        numQueries++;
+        while(nearestNodesQuery->next())
         {
-          Pos otherPos(nearestNodesQuery->value("lonx").toFloat(), nearestNodesQuery->value("laty").toFloat());
-          tempEdges.insert(Edge(nodeId, static_cast<int>(node.pos.distanceMeterTo(otherPos))));
+          int nodeId = nearestNodesQuery->value("node_id").toInt();
+          if(testType(static_cast<nw::NodeType>(nearestNodesQuery->value("type").toInt())))
+          {
+            Pos otherPos(nearestNodesQuery->value("lonx").toFloat(), nearestNodesQuery->value("laty").toFloat());
+            tempEdges.insert(Edge(nodeId, static_cast<int>(node.pos.distanceMeterTo(otherPos))));
+          }
         }
       }
     }
@@ -321,6 +407,7 @@ nw::Node RouteNetwork::fetchNode(float lonx, float laty, bool loadSuccessors, in
     addDestNodeEdges(node);
   }
 
+  node.index = index;
   nodeCache.insert(node.id, node);
 
   return node;
@@ -332,8 +419,16 @@ nw::Node RouteNetwork::fetchNode(int id)
   if(nodeCache.contains(id))
     return nodeCache.value(id);
 
+  if(isPreloaded())
+  {
+    // Build node from preloaded network - edges are not attached
+    int index = preloadedIndex(id);
+    return index != -1 ? nodeFromPreloaded(index) : nw::Node();
+  }
+
   nodeByIdQuery->bindValue(":id", id);
   nodeByIdQuery->exec();
+  numQueries++;
   nw::Node node;
 
   if(nodeByIdQuery->next())
@@ -347,6 +442,7 @@ nw::Node RouteNetwork::fetchNode(int id)
     // Add ingoing edges
     edgeToQuery->bindValue(":id", id);
     edgeToQuery->exec();
+    numQueries++;
 
     while(edgeToQuery->next())
     {
@@ -358,6 +454,7 @@ nw::Node RouteNetwork::fetchNode(int id)
     // Add outgoing edges
     edgeFromQuery->bindValue(":id", id);
     edgeFromQuery->exec();
+    numQueries++;
 
     while(edgeFromQuery->next())
     {
@@ -369,6 +466,7 @@ nw::Node RouteNetwork::fetchNode(int id)
     node.edges = tempEdges.values().toVector();
     addDestNodeEdges(node);
 
+    node.index = nextNodeIndex++;
     nodeCache.insert(node.id, node);
   }
   nodeByIdQuery->finish();
@@ -413,6 +511,7 @@ void RouteNetwork::initQueries()
 
 void RouteNetwork::deInitQueries()
 {
+  clearPreloaded();
   clearStartAndDestinationNodes();
 
   delete nodeByNavIdQuery;
@@ -434,6 +533,558 @@ void RouteNetwork::deInitQueries()
   edgeFromQuery = nullptr;
 }
 
+void RouteNetwork::preloadNetwork()
+{
+  if(isPreloaded())
+    return;
+
+  qDebug() << Q_FUNC_INFO << nodeTable << edgeTable;
+
+  // Remove all on demand loaded nodes since their indexes would overlap with the preloaded ones
+  clearStartAndDestinationNodes();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Load nodes ==========================================================================
+  QString nodeCols = nodeExtraCols.join(",");
+  if(!nodeExtraCols.isEmpty())
+    nodeCols.append(", ");
+
+  SqlQuery nodeQuery("select " + nodeCols + " node_id, nav_id, type, lonx, laty from " + nodeTable +
+                     " order by node_id", db);
+  nodeQuery.exec();
+  numQueries++;
+
+  int maxNodeId = 0;
+  int rangeIndex = -1, nodeIdIndex = -1, navIdIndex = -1, typeIndex = -1, lonxIndex = -1, latyIndex = -1;
+  while(nodeQuery.next())
+  {
+    SqlRecord rec = nodeQuery.record();
+    if(nodeIdIndex == -1)
+    {
+      rangeIndex = rec.contains("range") ? rec.indexOf("range") : -1;
+      nodeIdIndex = rec.indexOf("node_id");
+      navIdIndex = rec.indexOf("nav_id");
+      typeIndex = rec.indexOf("type");
+      lonxIndex = rec.indexOf("lonx");
+      latyIndex = rec.indexOf("laty");
+    }
+
+    NodeCompact node;
+    node.id = rec.valueInt(nodeIdIndex);
+    node.navId = rec.valueInt(navIdIndex);
+    node.type = rec.valueInt(typeIndex);
+    node.range = rangeIndex != -1 ? rec.valueInt(rangeIndex) : 0;
+    node.lonx = rec.valueFloat(lonxIndex);
+    node.laty = rec.valueFloat(latyIndex);
+    preloadNodes.append(node);
+    maxNodeId = std::max(maxNodeId, node.id);
+  }
+
+  // Index from database id to array index
+  preloadIndexById.fill(-1, maxNodeId + 1);
+  for(int i = 0; i < preloadNodes.size(); i++)
+    preloadIndexById[preloadNodes.at(i).id] = i;
+
+  // Load edges ==========================================================================
+  // Temporary edge list which is sorted by source node before building the compressed arrays
+  struct EdgeLoad
+  {
+    int fromIndex;
+    bool reverse;
+    EdgeCompact edge;
+  };
+
+  QVector<EdgeLoad> loadEdges;
+  QHash<QString, int> airwayNameIndex;
+
+  QString edgeCols = edgeExtraCols.join(",");
+  if(!edgeExtraCols.isEmpty())
+    edgeCols.append(", ");
+
+  SqlQuery edgeQuery("select " + edgeCols + " from_node_id, to_node_id from " + edgeTable, db);
+  edgeQuery.exec();
+  numQueries++;
+
+  // Column layout differs from the on demand queries
+  edgeIndexesCreated = false;
+  while(edgeQuery.next())
+  {
+    SqlRecord rec = edgeQuery.record();
+    int fromIndex = preloadedIndex(rec.valueInt("from_node_id")), toIndex = preloadedIndex(rec.valueInt("to_node_id"));
+
+    if(fromIndex == -1 || toIndex == -1 || fromIndex == toIndex)
+      continue;
+
+    // Add edge for both directions like the on demand queries edgeToQuery and edgeFromQuery
+    for(bool reverse : {false, true})
+    {
+      Edge edge = createEdge(rec, -1, reverse);
+
+      EdgeCompact compact;
+      compact.toIndex = reverse ? fromIndex : toIndex;
+      compact.lengthMeter = edge.lengthMeter;
+      compact.minAltFt = edge.minAltFt;
+      compact.maxAltFt = edge.maxAltFt;
+      compact.airwayId = edge.airwayId;
+      compact.type = static_cast<qint8>(edge.type);
+      compact.direction = static_cast<qint8>(edge.direction);
+
+      if(compact.lengthMeter == 0)
+      {
+        // No distance given for airways - calculate once here instead of during routing
+        const NodeCompact& n1 = preloadNodes.at(fromIndex), n2 = preloadNodes.at(toIndex);
+        compact.lengthMeter = static_cast<int>(Pos(n1.lonx, n1.laty).distanceMeterTo(Pos(n2.lonx, n2.laty)));
+      }
+
+      // Intern airway names to avoid a string instance per edge
+      if(edge.airwayName.isEmpty())
+        compact.airwayNameIndex = -1;
+      else
+      {
+        auto it = airwayNameIndex.constFind(edge.airwayName);
+        if(it == airwayNameIndex.constEnd())
+        {
+          compact.airwayNameIndex = preloadAirwayNames.size();
+          airwayNameIndex.insert(edge.airwayName, compact.airwayNameIndex);
+          preloadAirwayNames.append(edge.airwayName);
+        }
+        else
+          compact.airwayNameIndex = it.value();
+      }
+
+      loadEdges.append({reverse ? toIndex : fromIndex, reverse, compact});
+    }
+  }
+  edgeIndexesCreated = false;
+
+  // Sort by source, target and type - forward edges first which take precedence like in fetchNode()
+  std::sort(loadEdges.begin(), loadEdges.end(), [](const EdgeLoad& e1, const EdgeLoad& e2) -> bool
+  {
+    if(e1.fromIndex != e2.fromIndex)
+      return e1.fromIndex < e2.fromIndex;
+    else if(e1.edge.toIndex != e2.edge.toIndex)
+      return e1.edge.toIndex < e2.edge.toIndex;
+    else if(e1.edge.type != e2.edge.type)
+      return e1.edge.type < e2.edge.type;
+    else
+      return e1.reverse < e2.reverse;
+  });
+
+  // Remove duplicates which have same source, target and type - same as de-duplication using QSet<Edge>
+  auto last = std::unique(loadEdges.begin(), loadEdges.end(), [](const EdgeLoad& e1, const EdgeLoad& e2) -> bool
+  {
+    return e1.fromIndex == e2.fromIndex && e1.edge.toIndex == e2.edge.toIndex && e1.edge.type == e2.edge.type;
+  });
+  loadEdges.erase(last, loadEdges.end());
+
+  // Build compressed sparse row arrays ==================================================
+  preloadEdges.reserve(loadEdges.size());
+  preloadEdgeStart.fill(0, preloadNodes.size() + 1);
+  for(const EdgeLoad& e : loadEdges)
+  {
+    preloadEdgeStart[e.fromIndex + 1]++;
+    preloadEdges.append(e.edge);
+  }
+
+  for(int i = 0; i < preloadNodes.size(); i++)
+    preloadEdgeStart[i + 1] += preloadEdgeStart.at(i);
+
+  numNodesDb = preloadNodes.size();
+  nextNodeIndex = preloadNodes.size();
+
+  qDebug() << Q_FUNC_INFO << "nodes" << preloadNodes.size() << "edges" << preloadEdges.size()
+           << "airway names" << preloadAirwayNames.size()
+           << "bytes" << preloadNodes.size() * static_cast<int>(sizeof(NodeCompact)) +
+    preloadEdges.size() * static_cast<int>(sizeof(EdgeCompact)) +
+    (preloadEdgeStart.size() + preloadIndexById.size()) * static_cast<int>(sizeof(int))
+           << "time" << timer.elapsed() << "ms";
+}
+
+void RouteNetwork::clearPreloaded()
+{
+  clearLandmarks();
+  preloadNodes.clear();
+  preloadNodes.squeeze();
+  preloadEdges.clear();
+  preloadEdges.squeeze();
+  preloadEdgeStart.clear();
+  preloadEdgeStart.squeeze();
+  preloadIndexById.clear();
+  preloadIndexById.squeeze();
+  preloadAirwayNames.clear();
+  preloadAirwayNames.squeeze();
+}
+
+/* Create node from preloaded network. Edges are not attached. */
+nw::Node RouteNetwork::nodeFromPreloaded(int index) const
+{
+  const NodeCompact& compact = preloadNodes.at(index);
+  Node node;
+  node.id = compact.id;
+  node.index = index;
+  node.range = compact.range;
+  node.pos = Pos(compact.lonx, compact.laty);
+
+  if(airwayRouting)
+  {
+    node.type = static_cast<nw::NodeType>(compact.type >> 4);
+    node.subtype = static_cast<nw::NodeType>(compact.type & 0x0f);
+  }
+  else
+    node.type = static_cast<nw::NodeType>(compact.type);
+  return node;
+}
+
+/* Create edge from preloaded network. Airway name is a shared copy of the interned name. */
+nw::Edge RouteNetwork::edgeFromPreloaded(const nw::EdgeCompact& compact) const
+{
+  Edge edge(preloadNodes.at(compact.toIndex).id, compact.lengthMeter);
+  edge.minAltFt = compact.minAltFt;
+  edge.maxAltFt = compact.maxAltFt;
+  edge.airwayId = compact.airwayId;
+  edge.type = static_cast<nw::EdgeType>(compact.type);
+  edge.direction = static_cast<nw::EdgeDirection>(compact.direction);
+  if(compact.airwayNameIndex != -1)
+    edge.airwayName = preloadAirwayNames.at(compact.airwayNameIndex);
+  return edge;
+}
+
+/* Collect virtual edges to all nodes within the rectangle. Same as nearestNodesQuery for the preloaded network. */
+void RouteNetwork::nearestNodesPreloaded(QSet<nw::Edge>& edges, const atools::geo::Pos& pos,
+                                         const atools::geo::Rect& queryRect)
+{
+  for(const Rect& rect : queryRect.splitAtAntiMeridian())
+  {
+    float west = rect.getWest(), east = rect.getEast(), south = rect.getSouth(), north = rect.getNorth();
+
+    for(const NodeCompact& node : preloadNodes)
+    {
+      if(node.lonx >= west && node.lonx <= east && node.laty >= south && node.laty <= north &&
+         testType(static_cast<nw::NodeType>(node.type)))
+        edges.insert(Edge(node.id, static_cast<int>(pos.distanceMeterTo(Pos(node.lonx, node.laty)))));
+    }
+  }
+}
+
+/* Fill destination predecessor index for all preloaded nodes inside the destination rectangle.
+ * The virtual edges are created on the fly in getNeighbours() */
+void RouteNetwork::addDestNodeEdgesPreloaded()
+{
+  for(const NodeCompact& node : preloadNodes)
+  {
+    if(destinationNodeRect.contains(Pos(node.lonx, node.laty)))
+      destinationNodePredecessors.insert(node.id);
+  }
+}
+
+/* Load landmark tables or calculate and save them if missing or outdated */
+void RouteNetwork::loadLandmarks()
+{
+  if(!isPreloaded() || hasLandmarks())
+    return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  if(!readLandmarks())
+  {
+    nw::LandmarkTables tables;
+    calculateLandmarks(tables);
+    setLandmarks(tables);
+  }
+
+  qDebug() << Q_FUNC_INFO << "landmarks" << numLandmarks << "time" << timer.elapsed() << "ms";
+}
+
+bool RouteNetwork::readLandmarks()
+{
+  if(!isPreloaded())
+    return false;
+
+  QString filename = landmarkFilename();
+  if(readLandmarks(filename))
+  {
+    // Forces calculation of destination landmark distances on next search
+    clearStartAndDestinationNodes();
+
+    qDebug() << Q_FUNC_INFO << filename << "landmarks" << numLandmarks
+             << "bytes" << landmarkDistances.size() * static_cast<int>(sizeof(float));
+    return true;
+  }
+  return false;
+}
+
+void RouteNetwork::setLandmarks(const nw::LandmarkTables& tables)
+{
+  int num = tables.indexes.size();
+  if(num == 0 || tables.distances.size() != num * preloadNodes.size())
+  {
+    qWarning() << Q_FUNC_INFO << "Landmark tables do not fit network" << num << tables.distances.size();
+    return;
+  }
+
+  clearLandmarks();
+  numLandmarks = num;
+  landmarkIndexes = tables.indexes;
+  landmarkDistances = tables.distances;
+  writeLandmarks(landmarkFilename());
+
+  // Forces calculation of destination landmark distances on next search
+  clearStartAndDestinationNodes();
+
+  qDebug() << Q_FUNC_INFO << "landmarks" << numLandmarks
+           << "bytes" << landmarkDistances.size() * static_cast<int>(sizeof(float));
+}
+
+float RouteNetwork::getLandmarkEstimate(int index) const
+{
+  if(landmarkTargetMin.isEmpty() || index < 0 || index >= preloadNodes.size())
+    return 0.f;
+
+  // Triangle inequality in both directions for each landmark L and node v:
+  // d(v, dest) >= d(L, dest) - d(L, v) and d(v, dest) >= d(L, v) - d(L, dest)
+  const float *distances = landmarkDistances.constData() + index * numLandmarks;
+  float estimate = 0.f;
+  for(int k = 0; k < numLandmarks; k++)
+  {
+    float dist = distances[k];
+    if(dist < LANDMARK_UNREACHABLE && landmarkTargetMin.at(k) < LANDMARK_UNREACHABLE)
+      estimate = std::max(estimate, std::max(landmarkTargetMin.at(k) - dist, dist - landmarkTargetMax.at(k)));
+  }
+  return estimate;
+}
+
+/* Calculate landmark distances to the virtual destination node. Destination is connected to all predecessor
+ * nodes by virtual edges. Using the smallest and largest values over all predecessors keeps the estimate
+ * a lower bound regardless of the predecessor that is used to reach the destination. */
+void RouteNetwork::updateLandmarkTargets()
+{
+  landmarkTargetMin.clear();
+  landmarkTargetMax.clear();
+
+  if(!hasLandmarks() || destinationNodePredecessors.isEmpty())
+    return;
+
+  landmarkTargetMin.fill(LANDMARK_UNREACHABLE, numLandmarks);
+  landmarkTargetMax.fill(-LANDMARK_UNREACHABLE, numLandmarks);
+
+  for(int id : destinationNodePredecessors)
+  {
+    int index = preloadedIndex(id);
+    if(index == -1)
+      continue;
+
+    // Same length as the virtual edge created in getNeighbours()
+    const NodeCompact& node = preloadNodes.at(index);
+    float lengthMeter = static_cast<int>(Pos(node.lonx, node.laty).distanceMeterTo(destinationPos));
+
+    const float *distances = landmarkDistances.constData() + index * numLandmarks;
+    for(int k = 0; k < numLandmarks; k++)
+    {
+      if(distances[k] < LANDMARK_UNREACHABLE)
+      {
+        landmarkTargetMin[k] = std::min(landmarkTargetMin.at(k), distances[k] + lengthMeter);
+        landmarkTargetMax[k] = std::max(landmarkTargetMax.at(k), distances[k] - lengthMeter);
+      }
+    }
+  }
+}
+
+/* Select landmarks using farthest point selection and calculate the distance tables.
+ * Distances ignore edge types, directions and altitude restrictions which makes them a lower bound
+ * for all routing modes. */
+void RouteNetwork::calculateLandmarks(nw::LandmarkTables& tables, const std::atomic_bool *cancel) const
+{
+  tables = nw::LandmarkTables();
+
+  int numNodes = preloadNodes.size();
+  if(numNodes == 0)
+    return;
+
+  // Start with the best connected node which is most likely part of the main network
+  int seedIndex = 0, maxDegree = -1;
+  for(int i = 0; i < numNodes; i++)
+  {
+    int degree = preloadEdgeStart.at(i + 1) - preloadEdgeStart.at(i);
+    if(degree > maxDegree)
+    {
+      maxDegree = degree;
+      seedIndex = i;
+    }
+  }
+
+  // Smallest distance of each node to all landmarks selected so far including the seed node
+  QVector<float> minDistances;
+  if(!distancesPreloaded(seedIndex, minDistances, cancel))
+    return;
+
+  QVector<int> landmarks;
+  QVector<QVector<float> > distancesByLandmark;
+  QVector<float> distances;
+  for(int k = 0; k < NUM_LANDMARKS; k++)
+  {
+    // Next landmark is the reachable node farthest away from all others
+    int nextIndex = -1;
+    float maxDistance = 0.f;
+    for(int i = 0; i < numNodes; i++)
+    {
+      float dist = minDistances.at(i);
+      if(dist < LANDMARK_UNREACHABLE && dist > maxDistance)
+      {
+        maxDistance = dist;
+        nextIndex = i;
+      }
+    }
+
+    if(nextIndex == -1)
+      // Network too small
+      break;
+
+    if(!distancesPreloaded(nextIndex, distances, cancel))
+      return;
+
+    for(int i = 0; i < numNodes; i++)
+      minDistances[i] = std::min(minDistances.at(i), distances.at(i));
+
+    landmarks.append(nextIndex);
+    distancesByLandmark.append(distances);
+  }
+
+  // Copy into node major layout to have all values for a node in one cache line
+  int num = landmarks.size();
+  tables.indexes = landmarks;
+  tables.distances.resize(numNodes * num);
+  for(int k = 0; k < num; k++)
+  {
+    const QVector<float>& dist = distancesByLandmark.at(k);
+    for(int i = 0; i < numNodes; i++)
+      tables.distances[i * num + k] = dist.at(i);
+  }
+}
+
+/* Dijkstra search on the whole preloaded network. Fills distances in meter for all nodes.
+ * Returns false if cancelled. */
+bool RouteNetwork::distancesPreloaded(int sourceIndex, QVector<float>& distances,
+                                      const std::atomic_bool *cancel) const
+{
+  distances.fill(LANDMARK_UNREACHABLE, preloadNodes.size());
+
+  IndexedHeap heap(preloadNodes.size());
+  distances[sourceIndex] = 0.f;
+  heap.push(sourceIndex, 0.f);
+
+  int numPopped = 0;
+  while(!heap.isEmpty())
+  {
+    if(cancel != nullptr && (++numPopped % 1024) == 0 && *cancel)
+      return false;
+
+    int index = heap.pop();
+    float dist = distances.at(index);
+
+    for(int i = preloadEdgeStart.at(index); i < preloadEdgeStart.at(index + 1); i++)
+    {
+      const EdgeCompact& edge = preloadEdges.at(i);
+      float successorDist = dist + edge.lengthMeter;
+
+      // Closed nodes are never updated since lengths are not negative
+      if(successorDist < distances.at(edge.toIndex))
+      {
+        distances[edge.toIndex] = successorDist;
+        if(heap.contains(edge.toIndex))
+          heap.change(edge.toIndex, successorDist);
+        else
+          heap.push(edge.toIndex, successorDist);
+      }
+    }
+  }
+  return true;
+}
+
+/* Landmark file is stored next to the database file and has to be recreated if the database changes */
+QString RouteNetwork::landmarkFilename() const
+{
+  QFileInfo dbInfo(db->databaseName());
+  QString dir = landmarkDirectory.isEmpty() ? dbInfo.absolutePath() : landmarkDirectory;
+  return dir + QDir::separator() + dbInfo.completeBaseName() + "_" + nodeTable + ".landmarks";
+}
+
+bool RouteNetwork::readLandmarks(const QString& filename)
+{
+  QFile file(filename);
+  if(!file.exists())
+    return false;
+
+  if(file.open(QIODevice::ReadOnly))
+  {
+    QFileInfo dbInfo(db->databaseName());
+    quint32 magic = 0, version = 0;
+    qint32 numNodes = 0, numEdges = 0, num = 0;
+    qint64 dbSize = 0, dbModified = 0;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_5);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    in >> magic >> version >> numNodes >> numEdges >> dbSize >> dbModified;
+
+    if(magic == LANDMARK_FILE_MAGIC_NUMBER && version == LANDMARK_FILE_VERSION &&
+       numNodes == preloadNodes.size() && numEdges == preloadEdges.size() &&
+       dbSize == dbInfo.size() && dbModified == dbInfo.lastModified().toMSecsSinceEpoch())
+    {
+      in >> num >> landmarkIndexes >> landmarkDistances;
+
+      if(in.status() == QDataStream::Ok && num > 0 && landmarkIndexes.size() == num &&
+         landmarkDistances.size() == num * preloadNodes.size())
+      {
+        numLandmarks = num;
+        return true;
+      }
+      else
+      {
+        qWarning() << Q_FUNC_INFO << "Landmark file" << filename << "is damaged";
+        clearLandmarks();
+      }
+    }
+    else
+      qInfo() << Q_FUNC_INFO << "Landmark file" << filename << "is outdated";
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "Cannot open landmark file" << filename << file.errorString();
+  return false;
+}
+
+void RouteNetwork::writeLandmarks(const QString& filename) const
+{
+  QFile file(filename);
+  if(file.open(QIODevice::WriteOnly))
+  {
+    QFileInfo dbInfo(db->databaseName());
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_5);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << LANDMARK_FILE_MAGIC_NUMBER << LANDMARK_FILE_VERSION
+        << static_cast<qint32>(preloadNodes.size()) << static_cast<qint32>(preloadEdges.size())
+        << static_cast<qint64>(dbInfo.size()) << static_cast<qint64>(dbInfo.lastModified().toMSecsSinceEpoch())
+        << static_cast<qint32>(numLandmarks) << landmarkIndexes << landmarkDistances;
+    file.close();
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "Cannot write landmark file" << filename << file.errorString();
+}
+
+void RouteNetwork::clearLandmarks()
+{
+  numLandmarks = 0;
+  landmarkIndexes.clear();
+  landmarkDistances.clear();
+  landmarkDistances.squeeze();
+  landmarkTargetMin.clear();
+  landmarkTargetMax.clear();
+}
+
 /* Create node from SQL record */
 nw::Node RouteNetwork::createNode(const SqlRecord& rec)
 {
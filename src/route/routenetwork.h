@@ -24,6 +24,8 @@
 #include <QHash>
 #include <QVector>
 
+#include <atomic>
+
 namespace  atools {
 namespace sql {
 class SqlDatabase;
@@ -138,6 +140,7 @@ struct Node
   }
 
   int id = -1; /* Database id ("node_id") */
+  int index = -1; /* Dense index assigned by the network. Used by RouteFinder to address search state arrays. */
   int range; /* Range for a radio navaid or 0 if not applicable */
   QVector<Edge> edges; /* Attached edges leading to adjacent nodes */
   atools::geo::Pos pos;
@@ -162,14 +165,42 @@ inline int qHash(const nw::Node& node)
   return node.id;
 }
 
+/* Compact node as used by the preloaded network. Edges are kept in a separate array (compressed sparse row). */
+struct NodeCompact
+{
+  float lonx, laty;
+  int id /* database "node_id" */, navId, range;
+  int type; /* Raw type value from the database. Contains subtype in the lower four bits for airway networks. */
+};
+
+/* Compact edge as used by the preloaded network. Airway names are interned and referenced by index. */
+struct EdgeCompact
+{
+  int toIndex /* Index into node array and not database id */, lengthMeter, minAltFt, maxAltFt, airwayId,
+      airwayNameIndex /* -1 if no airway */;
+  qint8 type /* nw::EdgeType */, direction /* nw::EdgeDirection */;
+};
+
+/* Landmark distance tables as calculated by RouteNetwork::calculateLandmarks() */
+struct LandmarkTables
+{
+  QVector<int> indexes; /* Dense node index of each landmark */
+  QVector<float> distances; /* Node major layout - see RouteNetwork::landmarkDistances */
+};
+
 }
 
 Q_DECLARE_TYPEINFO(nw::Node, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(nw::Edge, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(nw::NodeCompact, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(nw::EdgeCompact, Q_PRIMITIVE_TYPE);
 
 /*
  * Routing network that loads and caches nodes and edges from the database.
  * Allows to resolve relations between objects and walk through the network.
+ *
+ * Nodes are either fetched on demand using SQL queries or the whole network is loaded into
+ * compact arrays by calling preloadNetwork(). No SQL queries are needed for routing in the latter case.
  */
 class RouteNetwork
 {
@@ -193,9 +224,52 @@ public:
   /* Set up and prepare all queries */
   void initQueries();
 
-  /* Disconnect queries from database and remove departure and destination nodes */
+  /* Disconnect queries from database and remove departure and destination nodes. Clears preloaded network. */
   void deInitQueries();
 
+  /* Load all nodes and edges into memory using a compressed sparse row layout.
+   * Does nothing if the network is already loaded. Call initQueries() before. */
+  void preloadNetwork();
+
+  /* true if preloadNetwork() was called successfully */
+  bool isPreloaded() const
+  {
+    return !preloadNodes.isEmpty();
+  }
+
+  /* Load landmark distance tables from the landmark file or calculate and save them if the file
+   * is missing or outdated. Needs a preloaded network. Blocks while calculating. */
+  void loadLandmarks();
+
+  /* Load landmark distance tables from the landmark file. Needs a preloaded network.
+   * Returns false if the file is missing or outdated. */
+  bool readLandmarks();
+
+  /* Select landmarks and calculate their distance tables without changing the network. Only reads the preloaded
+   * network and can run in a background thread as long as the network is not changed or cleared.
+   * Returns empty tables if cancel is set while calculating. */
+  void calculateLandmarks(nw::LandmarkTables& tables, const std::atomic_bool *cancel = nullptr) const;
+
+  /* Use tables from calculateLandmarks() and save them to the landmark file. Ignored if tables do not fit the
+   * network. */
+  void setLandmarks(const nw::LandmarkTables& tables);
+
+  /* Directory for landmark files. Default is empty which uses the directory of the database. */
+  void setLandmarkDirectory(const QString& value)
+  {
+    landmarkDirectory = value;
+  }
+
+  /* true if loadLandmarks() was called successfully */
+  bool hasLandmarks() const
+  {
+    return numLandmarks > 0;
+  }
+
+  /* Lower bound of the distance in meter from the node with the given dense index to the destination.
+   * Uses the triangle inequality on the landmark distances. Returns 0 if no bound is available for the node. */
+  float getLandmarkEstimate(int index) const;
+
   /* Get all adjacent nodes and attached edges for the given node */
   void getNeighbours(const nw::Node& from, QVector<nw::Node>& neighbours, QVector<nw::Edge>& edges);
 
@@ -214,9 +288,26 @@ public:
   /* Number of nodes in the database */
   int getNumberOfNodesDatabase();
 
-  /* Number of nodes in the memory cache */
+  /* Number of nodes in the memory cache or number of preloaded nodes */
   int getNumberOfNodesCache() const;
 
+  /* Number of SQL queries executed since creation or last call of resetNumberOfQueries() */
+  int getNumberOfQueries() const
+  {
+    return numQueries;
+  }
+
+  void resetNumberOfQueries()
+  {
+    numQueries = 0;
+  }
+
+  /* All nodes returned by the network have a dense index smaller than this value. Grows when nodes are fetched. */
+  int getNodeIndexCount() const
+  {
+    return nextNodeIndex;
+  }
+
   /* true if mode is either ROUTE_VICTOR, ROUTE_JET  or both flags */
   bool isAirwayRouting() const
   {
@@ -236,8 +327,30 @@ private:
   void addDestNodeEdges(nw::Node& node);
   void cleanDestNodeEdges();
 
+  /* Methods for preloaded network */
+  nw::Node nodeFromPreloaded(int index) const;
+  nw::Edge edgeFromPreloaded(const nw::EdgeCompact& edge) const;
+  void nearestNodesPreloaded(QSet<nw::Edge>& edges, const atools::geo::Pos& pos, const atools::geo::Rect& queryRect);
+  void addDestNodeEdgesPreloaded();
+  void clearPreloaded();
+
+  /* Methods for landmark heuristic */
+  bool distancesPreloaded(int sourceIndex, QVector<float>& distances, const std::atomic_bool *cancel) const;
+  bool readLandmarks(const QString& filename);
+  void writeLandmarks(const QString& filename) const;
+  QString landmarkFilename() const;
+  void updateLandmarkTargets();
+  void clearLandmarks();
+
+  /* Get index in preloaded node array or -1 if not found */
+  int preloadedIndex(int nodeId) const
+  {
+    return nodeId >= 0 && nodeId < preloadIndexById.size() ? preloadIndexById.at(nodeId) : -1;
+  }
+
   void bindCoordRect(const atools::geo::Rect& rect, atools::sql::SqlQuery *query);
   bool testType(nw::NodeType type);
+  bool testEdgeType(nw::EdgeType type) const;
   nw::Node createNode(const atools::sql::SqlRecord& rec);
   nw::Edge createEdge(const atools::sql::SqlRecord& rec, int toNodeId, bool reverseDirection);
 
@@ -255,6 +368,12 @@ private:
   /* Cache the number of nodes in the database */
   int numNodesDb = -1;
 
+  /* Statistics counter for executed SQL queries */
+  int numQueries = 0;
+
+  /* Next dense index for nodes added to the cache. Starts after preloaded nodes. */
+  int nextNodeIndex = 0;
+
   atools::sql::SqlQuery *nodeByNavIdQuery = nullptr, *nodeNavIdAndTypeQuery = nullptr,
                         *nearestNodesQuery = nullptr, *nodeByIdQuery = nullptr, *edgeToQuery = nullptr,
                         *edgeFromQuery = nullptr;
@@ -269,9 +388,42 @@ private:
   atools::sql::SqlDatabase *db;
   nw::Modes mode;
 
-  /* Cache for nodes (also containing edges) for the whole network. Filled on demand. */
+  /* Cache for nodes (also containing edges) for the whole network. Filled on demand.
+   * Contains only the virtual departure and destination nodes if network is preloaded. */
   QHash<int, nw::Node> nodeCache;
 
+  /* Preloaded network in compressed sparse row layout. Edges for node at index i are
+   * preloadEdges[preloadEdgeStart[i]] to preloadEdges[preloadEdgeStart[i + 1] - 1] */
+  QVector<nw::NodeCompact> preloadNodes;
+  QVector<nw::EdgeCompact> preloadEdges;
+  QVector<int> preloadEdgeStart;
+
+  /* Maps database node_id to index in preloadNodes. -1 if not used. */
+  QVector<int> preloadIndexById;
+
+  /* Interned airway names referenced by nw::EdgeCompact::airwayNameIndex */
+  QVector<QString> preloadAirwayNames;
+
+  /* Number of landmarks to select. Each one needs four bytes per preloaded node. */
+  static Q_DECL_CONSTEXPR int NUM_LANDMARKS = 12;
+
+  /* Increase when changing landmark file layout or selection */
+  static Q_DECL_CONSTEXPR quint32 LANDMARK_FILE_MAGIC_NUMBER = 0x4C4D4B31;
+  static Q_DECL_CONSTEXPR quint32 LANDMARK_FILE_VERSION = 1;
+
+  /* Landmark tables. Distances are stored node by node, i.e. distance from landmark k to node i is
+   * landmarkDistances[i * numLandmarks + k]. Unreachable nodes have a distance of float max. */
+  int numLandmarks = 0;
+  QVector<int> landmarkIndexes;
+  QVector<float> landmarkDistances;
+
+  /* Smallest and largest landmark distance to the destination calculated using all predecessors for the
+   * current destination. Empty if not valid. */
+  QVector<float> landmarkTargetMin, landmarkTargetMax;
+
+  /* Landmark file directory or empty to use the directory of the database */
+  QString landmarkDirectory;
+
   /* Database tables and extra columns */
   QString nodeTable, edgeTable;
   QStringList nodeExtraCols, edgeExtraCols;
@@ -0,0 +1,194 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "route/routebenchmark.h"
+#include "sql/sqldatabase.h"
+#include "exception.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QRegExp>
+#include <QStandardPaths>
+#include <QTextStream>
+
+using atools::sql::SqlDatabase;
+
+/* Read airport ident pairs separated by space from file. Empty lines and lines starting with "#" are ignored. */
+static bool readAirportPairs(const QString& filename, QVector<std::pair<QString, QString> >& pairs)
+{
+  QFile file(filename);
+  if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+  {
+    qCritical() << "Cannot open" << filename << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  while(!stream.atEnd())
+  {
+    QString line = stream.readLine().trimmed();
+    if(line.isEmpty() || line.startsWith("#"))
+      continue;
+
+    QStringList idents = line.split(QRegExp("[\\s,;-]+"), QString::SkipEmptyParts);
+    if(idents.size() == 2)
+      pairs.append(std::make_pair(idents.at(0).toUpper(), idents.at(1).toUpper()));
+    else
+      qWarning() << "Ignoring invalid line" << line;
+  }
+  return true;
+}
+
+/*
+ * Headless route calculation benchmark. Opens a navdata database read-only, calculates routes for a list of
+ * airport pairs in all network modes and prints wall time, expanded nodes, SQL queries, cache size
+ * and route distance as JSON.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("routebench");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Calculates flight plans for a list of airport pairs and prints results as JSON.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("database", "Navdata SQLite database file. Opened read-only.");
+
+  QCommandLineOption pairsOpt({"p", "pairs"},
+                              "File containing one airport ident pair per line like \"EDDF LIRF\". "
+                              "Default is a built-in list of city pairs.", "file");
+  QCommandLineOption modesOpt({"m", "modes"},
+                              "Comma separated list of modes: radionav, victor, jet, both. "
+                              "Default is \"radionav,victor,jet\".", "modes");
+  QCommandLineOption noPreloadOpt("no-preload", "Fetch nodes on demand using SQL queries instead of "
+                                                "loading the whole network into memory.");
+  QCommandLineOption noLandmarksOpt("no-landmarks", "Do not calculate routes a second time using "
+                                                    "the landmark heuristic.");
+  QCommandLineOption landmarkDirOpt({"l", "landmark-dir"},
+                                    "Directory to read and write landmark files. Default is the "
+                                    "cache directory of the user since the database is opened read-only.", "dir");
+  QCommandLineOption outputOpt({"o", "output"}, "Write JSON to file instead of standard output.", "file");
+  QCommandLineOption verboseOpt({"v", "verbose"}, "Print debug messages to standard error.");
+
+  parser.addOptions({pairsOpt, modesOpt, noPreloadOpt, noLandmarksOpt, landmarkDirOpt, outputOpt, verboseOpt});
+  parser.process(app);
+
+  if(parser.positionalArguments().size() != 1)
+    parser.showHelp(1);
+
+  if(!parser.isSet(verboseOpt))
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+  QString dbFile = parser.positionalArguments().first();
+  if(!QFile::exists(dbFile))
+  {
+    qCritical() << "Database" << dbFile << "not found";
+    return 1;
+  }
+
+  QVector<std::pair<QString, QString> > pairs = RouteBenchmark::defaultAirportPairs();
+  if(parser.isSet(pairsOpt))
+  {
+    pairs.clear();
+    if(!readAirportPairs(parser.value(pairsOpt), pairs))
+      return 1;
+  }
+
+  QVector<nw::Modes> modes;
+  if(parser.isSet(modesOpt))
+  {
+    for(const QString& name : parser.value(modesOpt).split(",", QString::SkipEmptyParts))
+    {
+      nw::Modes mode = RouteBenchmark::modeFromName(name);
+      if(mode == nw::ROUTE_NONE)
+      {
+        qCritical() << "Invalid mode" << name;
+        return 1;
+      }
+      modes.append(mode);
+    }
+  }
+
+  QString landmarkDir = parser.isSet(landmarkDirOpt) ?
+                        parser.value(landmarkDirOpt) :
+                        QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if(landmarkDir.isEmpty())
+    landmarkDir = QDir::tempPath();
+  if(!QDir().mkpath(landmarkDir))
+  {
+    qCritical() << "Cannot create landmark directory" << landmarkDir;
+    return 1;
+  }
+
+  int retval = 0;
+  const QString connectionName("ROUTEBENCH");
+  SqlDatabase::addDatabase("QSQLITE", connectionName);
+  {
+    SqlDatabase db(connectionName);
+    try
+    {
+      db.setDatabaseName(dbFile);
+      db.setReadonly();
+      db.open({"PRAGMA cache_size=-20000", "PRAGMA foreign_keys = OFF"});
+
+      RouteBenchmark benchmark(&db);
+      benchmark.setAirportPairs(pairs);
+      if(!modes.isEmpty())
+        benchmark.setModes(modes);
+      benchmark.setPreload(!parser.isSet(noPreloadOpt));
+      benchmark.setLandmarks(!parser.isSet(noLandmarksOpt));
+      benchmark.setLandmarkDirectory(landmarkDir);
+      benchmark.run();
+      benchmark.logResults();
+
+      if(parser.isSet(outputOpt))
+      {
+        QFile outFile(parser.value(outputOpt));
+        if(outFile.open(QIODevice::WriteOnly))
+          outFile.write(benchmark.toJson());
+        else
+        {
+          qCritical() << "Cannot write" << outFile.fileName() << outFile.errorString();
+          retval = 1;
+        }
+      }
+      else
+        QTextStream(stdout) << benchmark.toJson();
+    }
+    catch(atools::Exception& e)
+    {
+      qCritical() << "Caught exception" << e.what();
+      retval = 1;
+    }
+    catch(...)
+    {
+      qCritical() << "Caught unknown exception";
+      retval = 1;
+    }
+
+    if(db.isOpen())
+      db.close();
+  }
+  SqlDatabase::removeDatabase(connectionName);
+
+  return retval;
+}
@@ -152,12 +152,12 @@ AirportSearch::AirportSearch(QMainWindow *parent, QTableView *tableView, si::Tab
   append(Column("distance", tr("Distance\n%dist%")).distanceCol()).
   append(Column("heading", tr("Heading\n°T")).distanceCol()).
   append(Column("ident", ui->lineEditAirportIcaoSearch, tr("ICAO")).filter().defaultSort().
-         override ().minOverrideLength(3)).
-  append(Column("name", ui->lineEditAirportNameSearch, tr("Name")).filter()).
+         override ().minOverrideLength(3).searchIndex()).
+  append(Column("name", ui->lineEditAirportNameSearch, tr("Name")).filter().searchIndex()).
 
-  append(Column("city", ui->lineEditAirportCitySearch, tr("City")).filter()).
-  append(Column("state", ui->lineEditAirportStateSearch, tr("State")).filter()).
-  append(Column("country", ui->lineEditAirportCountrySearch, tr("Country or\nArea Code")).filter()).
+  append(Column("city", ui->lineEditAirportCitySearch, tr("City")).filter().searchIndex()).
+  append(Column("state", ui->lineEditAirportStateSearch, tr("State")).filter().searchIndex()).
+  append(Column("country", ui->lineEditAirportCountrySearch, tr("Country or\nArea Code")).filter().searchIndex()).
 
   append(Column("rating", ui->comboBoxAirportRatingSearch, tr("Rating")).includesName().indexCondMap(ratingCondMap)).
 
@@ -120,6 +120,12 @@ Column& Column::convertFunc(std::function<float(float)> unitConvertFunc)
   return *this;
 }
 
+Column& Column::searchIndex()
+{
+  colIsSearchIndex = true;
+  return *this;
+}
+
 Column& Column::defaultSortOrder(Qt::SortOrder order)
 {
   colDefaultSortOrd = order;
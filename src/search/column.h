@@ -96,6 +96,9 @@ public:
 
   Column& convertFunc(std::function<float(float value)> unitConvertFunc);
 
+  /* Text filters for this column can use the full text search index of the table */
+  Column& searchIndex();
+
   bool isFilter() const
   {
     return colCanBeFiltered;
@@ -242,6 +245,11 @@ public:
     return colMinOverrideLength;
   }
 
+  bool isSearchIndex() const
+  {
+    return colIsSearchIndex;
+  }
+
 private:
   friend class ColumnList;
 
@@ -277,6 +285,7 @@ private:
   bool colIsHiddenColumn = false;
   bool colQueryIncludesName = false;
   bool colIsDistance = false;
+  bool colIsSearchIndex = false;
 
   Qt::SortOrder colDefaultSortOrd = Qt::SortOrder::AscendingOrder;
 };
@@ -136,14 +136,14 @@ NavSearch::NavSearch(QMainWindow *parent, QTableView *tableView, si::TabSearchId
   append(Column("nav_search_id").hidden()).
   append(Column("distance", tr("Distance\n%dist%")).distanceCol()).
   append(Column("heading", tr("Heading\n°T")).distanceCol()).
-  append(Column("ident", ui->lineEditNavIcaoSearch, tr("ICAO")).filter().defaultSort()).
+  append(Column("ident", ui->lineEditNavIcaoSearch, tr("ICAO")).filter().defaultSort().searchIndex()).
 
   append(Column("nav_type", ui->comboBoxNavNavAidSearch, tr("Navaid\nType")).
          indexCondMap(navTypeCondMap).includesName()).
 
   append(Column("type", ui->comboBoxNavTypeSearch, tr("Type")).indexCondMap(typeCondMap).includesName()).
-  append(Column("name", ui->lineEditNavNameSearch, tr("Name")).filter()).
-  append(Column("region", ui->lineEditNavRegionSearch, tr("Region")).filter()).
+  append(Column("name", ui->lineEditNavNameSearch, tr("Name")).filter().searchIndex()).
+  append(Column("region", ui->lineEditNavRegionSearch, tr("Region")).filter().searchIndex()).
   append(Column("airport_ident", ui->lineEditNavAirportIcaoSearch, tr("Airport\nICAO")).filter()).
   append(Column("frequency", tr("Frequency\nkHz/MHz"))).
   append(Column("channel", tr("Channel"))).
@@ -739,7 +739,7 @@ void SearchBaseTable::loadAllRowsIntoView()
     // if(allSelected)
     // view->selectAll();
 
-    NavApp::setStatusMessage(tr("All entries read."));
+    NavApp::setStatusMessage(tr("Reading all entries."));
   }
 }
 
@@ -1491,5 +1491,5 @@ QString SearchBaseTable::formatModelData(const Column *col, const QVariant& disp
 
 void SearchBaseTable::selectAll()
 {
-  view->selectAll();
+  controller->selectAllRows();
 }
@@ -0,0 +1,143 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "search/searchindex.h"
+
+#include "common/constants.h"
+#include "exception.h"
+#include "search/column.h"
+#include "search/columnlist.h"
+#include "settings/settings.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlrecord.h"
+#include "sql/sqlutil.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+
+using atools::sql::SqlQuery;
+using atools::sql::SqlUtil;
+
+SearchIndex::SearchIndex(const ColumnList *columnList)
+  : columns(columnList)
+{
+  indexTable = "temp." + columns->getTablename() + "_search_index";
+  enabled = atools::settings::Settings::instance().getAndStoreValue(lnm::SETTINGS_DATABASE + "SearchIndex",
+                                                                    true).toBool();
+}
+
+SearchIndex::~SearchIndex()
+{
+  // Index table is dropped automatically with the connection
+}
+
+void SearchIndex::build(atools::sql::SqlDatabase *db)
+{
+  invalidate();
+
+  if(!enabled || !trigramAvailable || db == nullptr || !db->isOpen())
+    return;
+
+  QString table = columns->getTablename();
+  if(!SqlUtil(db).hasTable(table))
+    return;
+
+  // Collect all indexed columns which exist in this database version
+  QStringList cols;
+  atools::sql::SqlRecord tableCols = db->record(table);
+  for(const Column *col : columns->getColumns())
+  {
+    if(col->isSearchIndex() && tableCols.contains(col->getColumnName()))
+      cols.append(col->getColumnName());
+  }
+
+  if(cols.isEmpty())
+    return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QString colStr = cols.join(", ");
+  SqlQuery query(db);
+
+  try
+  {
+    query.exec("drop table if exists " + indexTable);
+    query.exec("create virtual table " + indexTable + " using fts5(" + colStr + ", tokenize = 'trigram')");
+  }
+  catch(atools::Exception& e)
+  {
+    // FTS5 or trigram tokenizer not compiled in - use plain like queries
+    qWarning() << Q_FUNC_INFO << "Search index not available" << e.what();
+    trigramAvailable = false;
+    return;
+  }
+
+  try
+  {
+    query.exec("insert into " + indexTable + "(rowid, " + colStr + ") select " + columns->getIdColumnName() + ", " +
+               colStr + " from " + table);
+
+    QMutexLocker locker(&mutex);
+    indexColumns = cols;
+    valid = true;
+  }
+  catch(atools::Exception& e)
+  {
+    qWarning() << Q_FUNC_INFO << "Error building search index" << e.what();
+  }
+
+  qDebug() << Q_FUNC_INFO << indexTable << "built in" << timer.elapsed() << "ms";
+}
+
+void SearchIndex::invalidate()
+{
+  QMutexLocker locker(&mutex);
+  indexColumns.clear();
+  valid = false;
+}
+
+bool SearchIndex::isValid() const
+{
+  QMutexLocker locker(&mutex);
+  return valid;
+}
+
+QString SearchIndex::buildCondition(const Column *col, const QString& oper, const QString& value) const
+{
+  // Trigram tokenizer can only use the index if the pattern has a run of at least three characters without
+  // wildcards. Shorter terms are faster using the normal table indexes.
+  const static QRegularExpression TRIGRAM_MATCH("[^%_]{3,}");
+
+  if(!col->isSearchIndex() || oper.trimmed().compare("like", Qt::CaseInsensitive) != 0 ||
+     !TRIGRAM_MATCH.match(value).hasMatch())
+    return QString();
+
+  QMutexLocker locker(&mutex);
+  if(!valid)
+    return QString();
+
+  if(!indexColumns.contains(col->getColumnName()))
+    return QString();
+
+  // Same semantics as the plain like condition on the table
+  return columns->getIdColumnName() + " in (select rowid from " + indexTable + " where " +
+         col->getColumnName() + " like '" + QString(value).replace("'", "''") + "')";
+}
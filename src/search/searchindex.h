@@ -0,0 +1,81 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_SEARCHINDEX_H
+#define LITTLENAVMAP_SEARCHINDEX_H
+
+#include <QMutex>
+#include <QStringList>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+}
+}
+
+class Column;
+class ColumnList;
+
+/*
+ * Full text search index for the text columns of a search table. Uses a SQLite FTS5 table with trigram tokenizer
+ * in the temporary schema of a connection which allows to answer "like" queries with three or more characters
+ * without a full table scan. Columns are enabled by Column::searchIndex().
+ *
+ * The index is built by the search query worker on its own connection. Queries using the index condition
+ * are only valid for this connection.
+ * buildCondition() can be called from the GUI thread while the worker builds the index.
+ *
+ * The index is not available if the SQLite library does not support the trigram tokenizer. Callers fall back
+ * to plain "like" queries in this case.
+ */
+class SearchIndex
+{
+public:
+  SearchIndex(const ColumnList *columnList);
+  virtual ~SearchIndex();
+
+  /* Drop and create the index table from the database. Call in the thread owning the connection. */
+  void build(atools::sql::SqlDatabase *db);
+
+  /* Connection was closed which also removes the temporary index table */
+  void invalidate();
+
+  /* true if the index is built and can be used in queries */
+  bool isValid() const;
+
+  /* Get a where condition for the column using the index or an empty string if the index cannot be used
+   * for this value. Operator is as built by the SQL model, value is the SQL value including "%" placeholders. */
+  QString buildCondition(const Column *col, const QString& oper, const QString& value) const;
+
+private:
+  const ColumnList *columns;
+
+  /* Name of the FTS table in the temp schema */
+  QString indexTable;
+
+  /* Table columns that are part of the index. Only filled if built. */
+  QStringList indexColumns;
+
+  bool valid = false, enabled = true,
+       trigramAvailable = true /* Set to false if table creation fails */;
+
+  /* Guards valid and indexColumns */
+  mutable QMutex mutex;
+};
+
+#endif // LITTLENAVMAP_SEARCHINDEX_H
@@ -20,6 +20,7 @@
 #include "geo/calculations.h"
 #include "search/column.h"
 #include "search/columnlist.h"
+#include "search/sqlqueryworker.h"
 #include "sql/sqlrecord.h"
 
 #include <QTableView>
@@ -33,6 +34,8 @@ using atools::sql::SqlDatabase;
 SqlController::SqlController(atools::sql::SqlDatabase *sqlDb, ColumnList *cols, QTableView *tableView)
   : db(sqlDb), view(tableView), columns(cols)
 {
+  worker = new SqlQueryWorker(columns);
+  worker->open(db->databaseName(), !db->isReadonly());
 }
 
 SqlController::~SqlController()
@@ -48,6 +51,9 @@ SqlController::~SqlController()
     model->clear();
   delete model;
   model = nullptr;
+
+  delete worker;
+  worker = nullptr;
 }
 
 void SqlController::preDatabaseLoad()
@@ -56,6 +62,11 @@ void SqlController::preDatabaseLoad()
 
   if(model != nullptr)
     model->clear();
+  clearPending();
+  view->unsetCursor();
+
+  // Release the database file
+  worker->close();
 }
 
 void SqlController::postDatabaseLoad()
@@ -64,6 +75,10 @@ void SqlController::postDatabaseLoad()
     viewSetModel(proxyModel);
   else
     viewSetModel(model);
+
+  // Search index is built by the worker after the first query
+  worker->open(db->databaseName(), !db->isReadonly());
+
   model->updateSqlQuery();
   model->resetSqlQuery();
   model->fillHeaderData();
@@ -86,40 +101,78 @@ void SqlController::refreshData(bool loadAll, bool keepSelection)
     }
   }
 
+  // Update search index for changed data before running the query again
+  worker->refresh();
+
   // Reload query model
   model->refreshData();
 
   if(loadAll)
-  {
-    while(model->canFetchMore())
-      model->fetchMore(QModelIndex());
-  }
+    model->loadAllRows();
 
-  // Selection changes when updating model
-  sm = view->selectionModel();
+  // Selected again in modelFetchedMore() once the new result covers the highest selected row
+  clearPending();
+  pendingSelectionRows = rows;
+  pendingSelectionMaxRow = maxRow;
+  pendingGeneration = model->getQueryGeneration();
+  updateBusyCursor();
+}
 
-  if(sm != nullptr && keepSelection)
+void SqlController::modelFetchedMore()
+{
+  if(pendingGeneration != model->getQueryGeneration())
+    // User started another query - selection is not valid anymore
+    clearPending();
+  else if(model->hasCurrentRows())
   {
-    int visibleRowCount = getVisibleRowCount();
-
-    // Check if selected rows have to be loaded
-    if(maxRow >= visibleRowCount)
+    if(!pendingSelectionRows.isEmpty())
     {
-      // Load until done or highest selected row is covered
-      while(model->canFetchMore() && getVisibleRowCount() < maxRow)
+      if(model->rowCount() <= pendingSelectionMaxRow && model->canFetchMore(QModelIndex()))
+        // Need more pages - ignored if a fetch is already pending
         model->fetchMore(QModelIndex());
+      else
+      {
+        // Update selection in new data result set
+        QItemSelectionModel *sm = view->selectionModel();
+        if(sm != nullptr)
+        {
+          int totalRowCount = getTotalRowCount();
+          sm->blockSignals(true);
+          for(int row : pendingSelectionRows)
+          {
+            if(row < totalRowCount)
+              sm->select(model->index(row, 0), QItemSelectionModel::Select | QItemSelectionModel::Rows);
+          }
+          sm->blockSignals(false);
+        }
+        pendingSelectionRows.clear();
+      }
     }
 
-    // Update selection in new data result set
-    int totalRowCount = getTotalRowCount();
-    sm->blockSignals(true);
-    for(int row : rows)
+    if(pendingSelectAll)
     {
-      if(row < totalRowCount)
-        sm->select(model->index(row, 0), QItemSelectionModel::Select | QItemSelectionModel::Rows);
+      pendingSelectAll = false;
+      view->selectAll();
     }
-    sm->blockSignals(false);
   }
+
+  updateBusyCursor();
+}
+
+void SqlController::clearPending()
+{
+  pendingSelectionRows.clear();
+  pendingSelectionMaxRow = 0;
+  pendingGeneration = -1;
+  pendingSelectAll = false;
+}
+
+void SqlController::updateBusyCursor()
+{
+  if(model->isLoadingAllRows() || !pendingSelectionRows.isEmpty() || pendingSelectAll)
+    view->setCursor(Qt::BusyCursor);
+  else
+    view->unsetCursor();
 }
 
 void SqlController::refreshView()
@@ -325,7 +378,18 @@ void SqlController::viewSetModel(QAbstractItemModel *newModel)
 void SqlController::selectAllRows()
 {
   Q_ASSERT(view->selectionModel() != nullptr);
-  view->selectAll();
+
+  if(model->hasCurrentRows())
+    view->selectAll();
+  else
+  {
+    // Select when the first page of the running query arrives - otherwise the model reset drops the selection
+    if(pendingGeneration != model->getQueryGeneration())
+      clearPending();
+    pendingSelectAll = true;
+    pendingGeneration = model->getQueryGeneration();
+    updateBusyCursor();
+  }
 }
 
 void SqlController::selectNoRows()
@@ -519,7 +583,13 @@ void SqlController::updateHeaderData()
 
 void SqlController::prepareModel()
 {
-  model = new SqlModel(parentWidget, db, columns);
+  model = new SqlModel(parentWidget, db, columns, worker);
+
+  // Connected before the search tables so these see the restored selection
+  QObject::connect(model, &SqlModel::fetchedMore, model, [ = ]()
+  {
+    modelFetchedMore();
+  });
 
   viewSetModel(model);
 
@@ -531,19 +601,15 @@ void SqlController::loadAllRowsForDistanceSearch()
 {
   if(searchParamsChanged && proxyModel != nullptr)
   {
-    QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-
     // Run query again
     model->resetSqlQuery();
 
     // Let proxy know that filter parameters have changed
     proxyModel->invalidate();
 
-    while(model->canFetchMore())
-      // Fetch as long as we can
-      model->fetchMore(QModelIndex());
-
-    QGuiApplication::restoreOverrideCursor();
+    // Fetch all rows from the worker - proxy filters them as they are added
+    model->loadAllRows();
+    updateBusyCursor();
     searchParamsChanged = false;
   }
 }
@@ -556,8 +622,6 @@ void SqlController::setDataCallback(const SqlModel::DataFunctionType& value,
 
 void SqlController::loadAllRows()
 {
-  QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-
   if(proxyModel != nullptr)
   {
     // Run query again
@@ -567,10 +631,8 @@ void SqlController::loadAllRows()
     proxyModel->invalidate();
   }
 
-  while(model->canFetchMore())
-    model->fetchMore(QModelIndex());
-
-  QGuiApplication::restoreOverrideCursor();
+  model->loadAllRows();
+  updateBusyCursor();
 }
 
 QVector<const Column *> SqlController::getCurrentColumns() const
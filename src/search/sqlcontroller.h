@@ -21,6 +21,8 @@
 #include "search/sqlmodel.h"
 #include "search/sqlproxymodel.h"
 
+#include <QSet>
+
 namespace atools {
 namespace geo {
 class Pos;
@@ -33,6 +35,7 @@ class SqlDatabase;
 class QWidget;
 class QTableView;
 class ColumnList;
+class SqlQueryWorker;
 
 /*
  * Combines all functionality around the table SQL model, view, view header and
@@ -47,7 +50,7 @@ public:
   /* Create a new SqlModel, build and execute a query */
   void prepareModel();
 
-  /* Load all rows into the view */
+  /* Request all rows for the view. Rows are added later while a busy cursor is shown. */
   void loadAllRows();
 
   /* Restore columns ordering, sorting and column widths to default */
@@ -140,7 +143,7 @@ public:
   /* Update distance search for changed values from spin box widgets */
   void filterByDistanceUpdate(sqlproxymodel::SearchDirection dir, float minDistance, float maxDistance);
 
-  /* Load all rows if a distance search is active. */
+  /* Request all rows if a distance search is active. Proxy filters rows as they arrive. */
   void loadAllRowsForDistanceSearch();
 
   /* True if distance search is active */
@@ -173,7 +176,8 @@ public:
 
   void updateHeaderData();
 
-  /* Update query on changes in the database. Loads all data needed to restore selection if keepSelection is true */
+  /* Update query on changes in the database. Selection is restored once the new query delivers the rows
+   * if keepSelection is true */
   void refreshData(bool loadAll, bool keepSelection);
 
   /* Update view only */
@@ -188,6 +192,11 @@ public:
 private:
   void viewSetModel(QAbstractItemModel *newModel);
 
+  /* Called when the model got more rows. Applies pending selections and updates the busy cursor. */
+  void modelFetchedMore();
+  void clearPending();
+  void updateBusyCursor();
+
   /* Adapt columns to query change */
   void processViewColumns();
 
@@ -203,6 +212,10 @@ private:
   SqlProxyModel *proxyModel = nullptr;
 
   SqlModel *model = nullptr;
+
+  /* Runs the model queries in a background thread */
+  SqlQueryWorker *worker = nullptr;
+
   QWidget *parentWidget = nullptr;
   atools::sql::SqlDatabase *db = nullptr;
   QTableView *view = nullptr;
@@ -213,6 +226,12 @@ private:
    * are indicated by this bool */
   bool searchParamsChanged = false;
   atools::geo::Pos currentDistanceCenter;
+
+  /* Selection to apply when the query of pendingGeneration delivers its rows.
+   * Dropped if the user starts another query in the meantime. */
+  QSet<int> pendingSelectionRows;
+  int pendingSelectionMaxRow = 0, pendingGeneration = -1;
+  bool pendingSelectAll = false;
 };
 
 #endif // LITTLENAVMAP_CONTROLLER_H
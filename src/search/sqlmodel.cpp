@@ -21,25 +21,33 @@
 #include "gui/errorhandler.h"
 #include "search/columnlist.h"
 #include "sql/sqldatabase.h"
-#include "sql/sqlquery.h"
-#include "exception.h"
 #include "search/column.h"
+#include "search/searchindex.h"
 #include "sql/sqlrecord.h"
 
 #include <QLineEdit>
 #include <QCheckBox>
 #include <QSqlError>
+#include <QSqlField>
 #include <QRegularExpression>
 #include <QComboBox>
 
-using atools::sql::SqlQuery;
 using atools::sql::SqlDatabase;
 using atools::gui::ErrorHandler;
 using atools::sql::SqlRecord;
 
-SqlModel::SqlModel(QWidget *parent, SqlDatabase *sqlDb, const ColumnList *columnList)
-  : QSqlQueryModel(parent), db(sqlDb), columns(columnList), parentWidget(parent)
+/* Number of count results to remember */
+const static int TOTAL_COUNT_CACHE_SIZE = 200;
+
+SqlModel::SqlModel(QWidget *parent, SqlDatabase *sqlDb, const ColumnList *columnList, SqlQueryWorker *queryWorker)
+  : QAbstractTableModel(parent), db(sqlDb), columns(columnList), worker(queryWorker), parentWidget(parent)
 {
+  totalCountCache.setMaxCost(TOTAL_COUNT_CACHE_SIZE);
+
+  // Results are sent from the worker thread
+  connect(worker, &SqlQueryWorker::pageFetched, this, &SqlModel::pageFetched, Qt::QueuedConnection);
+  connect(worker, &SqlQueryWorker::totalCountFetched, this, &SqlModel::totalCountFetched, Qt::QueuedConnection);
+
   // Set default handler
   setDataCallback(nullptr, QSet<Qt::ItemDataRole>());
 
@@ -78,7 +86,7 @@ void SqlModel::filterByRecord(const atools::sql::SqlRecord& record)
 void SqlModel::filterBy(QModelIndex index, bool exclude)
 {
   QString whereCol = getSqlRecord().fieldName(index.column());
-  filterBy(exclude, whereCol, QSqlQueryModel::data(index));
+  filterBy(exclude, whereCol, getRawData(index.row(), index.column()));
 }
 
 /* Simple include/exclude filter. Updates the attached search widgets */
@@ -375,9 +383,10 @@ void SqlModel::sort(int column, Qt::SortOrder order)
 }
 
 /* Build full list of columns to query */
-QString SqlModel::buildColumnList(const atools::sql::SqlRecord& tableCols)
+QString SqlModel::buildColumnList(const atools::sql::SqlRecord& tableCols, QSqlRecord& queryRec)
 {
   QVector<QString> colNames;
+  queryRec.clear();
   for(const Column *col : columns->getColumns())
   {
     if(!col->isDistance() && !tableCols.contains(col->getColumnName()))
@@ -388,10 +397,16 @@ QString SqlModel::buildColumnList(const atools::sql::SqlRecord& tableCols)
     }
 
     if(col->isDistance())
+    {
       // Add null for special distance columns
       colNames.append("null as " + col->getColumnName());
+      queryRec.append(QSqlField(col->getColumnName()));
+    }
     else
+    {
       colNames.append(col->getColumnName());
+      queryRec.append(QSqlField(col->getColumnName(), tableCols.fieldType(tableCols.indexOf(col->getColumnName()))));
+    }
   }
 
   // Concatenate to one string
@@ -412,10 +427,23 @@ QString SqlModel::buildColumnList(const atools::sql::SqlRecord& tableCols)
 void SqlModel::buildQuery()
 {
   atools::sql::SqlRecord tableCols = db->record(columns->getTablename());
-  QString queryCols = buildColumnList(tableCols);
+  QSqlRecord queryRec;
+  QString queryCols = buildColumnList(tableCols, queryRec);
+
+  if(queryRec != queryRecord)
+  {
+    // Columns changed - rows and header data are not valid anymore
+    beginResetModel();
+    queryRecord = queryRec;
+    rows.clear();
+    headers.clear();
+    rowsGeneration = -1;
+    endResetModel();
+  }
 
-  QVector<const Column *> overrideColumns;
-  QString queryWhere = buildWhere(tableCols, overrideColumns);
+  QVector<const Column *> overrideColumns, overrideColumnsWorker;
+  QString queryWhere = buildWhere(tableCols, overrideColumns, false /* useIndex */);
+  QString queryWhereWorker = buildWhere(tableCols, overrideColumnsWorker, true /* useIndex */);
 
   QString queryOrder;
   const Column *col = columns->getColumn(orderByCol);
@@ -445,13 +473,14 @@ void SqlModel::buildQuery()
 
   currentSqlQuery = "select " + queryCols + " from " + columns->getTablename() +
                     " " + queryWhere + " " + queryOrder;
+  currentWorkerSqlQuery = "select " + queryCols + " from " + columns->getTablename() +
+                          " " + queryWhereWorker + " " + queryOrder;
 
-  // Build a query to find the total row count of the result
-  totalRowCount = 0;
-  currentSqlCountQuery = "select count(1) from " + columns->getTablename() + " " + queryWhere;
+  // Query which is stepped through by the worker to count the rows of the result
+  currentWorkerSqlCountQuery = "select 1 from " + columns->getTablename() + " " + queryWhereWorker;
 
 #ifdef DEBUG_INFORMATION
-  qDebug() << Q_FUNC_INFO << currentSqlQuery;
+  qDebug() << Q_FUNC_INFO << currentWorkerSqlQuery;
 #endif
 
   QStringList overrideColumnTitles;
@@ -462,42 +491,14 @@ void SqlModel::buildQuery()
   }
   emit overrideMode(overrideColumnTitles);
 
-  try
-  {
-    // Count total rows
-    updateTotalCount();
-
-    if(!boundingRect.isValid())
-      // Delay query for bounding rectangle query with proxy model
-      resetSqlQuery();
-  }
-  catch(atools::Exception& e)
-  {
-    ATOOLS_HANDLE_EXCEPTION(e);
-  }
-  catch(...)
-  {
-    ATOOLS_HANDLE_UNKNOWN_EXCEPTION;
-  }
-}
-
-void SqlModel::updateTotalCount()
-{
-  if(!currentSqlCountQuery.isEmpty())
-  {
-    SqlQuery countStmt(db);
-    countStmt.exec(currentSqlCountQuery);
-    if(countStmt.next())
-      totalRowCount = countStmt.value(0).toInt();
-    else
-      totalRowCount = 0;
-  }
-  else
-    totalRowCount = 0;
+  if(!boundingRect.isValid())
+    // Delay query for bounding rectangle query with proxy model
+    resetSqlQuery();
 }
 
 /* Build where statement */
-QString SqlModel::buildWhere(const atools::sql::SqlRecord& tableCols, QVector<const Column *>& overrideColumns)
+QString SqlModel::buildWhere(const atools::sql::SqlRecord& tableCols, QVector<const Column *>& overrideColumns,
+                             bool useIndex)
 {
   const static QRegularExpression REQUIRED_COL_MATCH(".*/\\*([A-Za-z0-9_]+)\\*/.*");
   QString queryWhere;
@@ -567,13 +568,20 @@ QString SqlModel::buildWhere(const atools::sql::SqlRecord& tableCols, QVector<co
     if(numCond++ > 0)
       queryWhere += " " + WHERE_OPERATOR + " ";
 
-    if(cond.col->isIncludesName())
+    // Use full text search index for text conditions if possible
+    QString indexCond;
+    if(useIndex && cond.valueSql.type() == QVariant::String)
+      indexCond = worker->getSearchIndex()->buildCondition(cond.col, cond.oper, cond.valueSql.toString());
+
+    if(!indexCond.isEmpty())
+      queryWhere += indexCond;
+    else if(cond.col->isIncludesName())
       // Condition includes column name
       queryWhere += " " + cond.oper + " ";
     else
       queryWhere += cond.col->getColumnName() + " " + cond.oper + " ";
 
-    if(!cond.valueSql.isNull())
+    if(indexCond.isEmpty() && !cond.valueSql.isNull())
       queryWhere += buildWhereValue(cond);
   }
 
@@ -634,16 +642,112 @@ QString SqlModel::buildWhereValue(const WhereCondition& cond)
 
 void SqlModel::refreshData()
 {
+  totalCountCache.clear();
   resetSqlQuery();
-  updateTotalCount();
 }
 
 void SqlModel::resetSqlQuery()
 {
-  QSqlQueryModel::setQuery(currentSqlQuery, db->getQSqlDatabase());
+  // Use cached count if available - otherwise let the worker count after sending the first rows
+  queryCountKey = currentWorkerSqlCountQuery;
+  bool countCached = totalCountCache.contains(queryCountKey);
+  if(countCached)
+    totalRowCount = *totalCountCache.object(queryCountKey);
+
+  // Cancels any running query
+  queryGeneration = worker->startQuery(currentWorkerSqlQuery, countCached ? QString() : queryCountKey);
+  fetchPending = false;
+  loadAll = false;
+}
+
+void SqlModel::clear()
+{
+  worker->cancel();
+
+  beginResetModel();
+  queryRecord.clear();
+  rows.clear();
+  headers.clear();
+  queryGeneration = rowsGeneration = -1;
+  atEnd = true;
+  fetchPending = false;
+  loadAll = false;
+  totalRowCount = 0;
+  endResetModel();
+}
+
+/* Called by the worker thread using a queued connection */
+void SqlModel::pageFetched(const sqlquery::Page& page)
+{
+  if(page.generation != queryGeneration)
+    // Outdated query
+    return;
+
+  if(page.firstRow == 0 && rowsGeneration != queryGeneration)
+  {
+    // First page of a new query - replace the old result
+    beginResetModel();
+    rows = page.rows;
+    rowsGeneration = queryGeneration;
+    atEnd = page.atEnd;
+    endResetModel();
+  }
+  else if(rowsGeneration == queryGeneration && page.firstRow == rows.size())
+  {
+    // Next page
+    if(!page.rows.isEmpty())
+    {
+      beginInsertRows(QModelIndex(), rows.size(), rows.size() + page.rows.size() - 1);
+      rows.append(page.rows);
+      endInsertRows();
+    }
+    atEnd = page.atEnd;
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "Unexpected page" << page.firstRow << "rows" << rows.size();
+
+  fetchPending = false;
+
+  if(!page.error.isEmpty())
+  {
+    atEnd = true;
+    atools::gui::ErrorHandler(parentWidget).handleSqlError(QSqlError(QString(), page.error,
+                                                                     QSqlError::StatementError));
+  }
+  else if(loadAll && hasCurrentRows() && !atEnd)
+  {
+    // Get the rest in one page
+    fetchPending = true;
+    worker->fetchAll(queryGeneration);
+  }
+
+  emit fetchedMore();
+}
+
+/* Called by the worker thread using a queued connection */
+void SqlModel::totalCountFetched(int generation, int count)
+{
+  if(generation != queryGeneration)
+    return;
 
-  if(lastError().isValid())
-    atools::gui::ErrorHandler(parentWidget).handleSqlError(lastError());
+  totalRowCount = count;
+  totalCountCache.insert(queryCountKey, new int(count));
+  emit fetchedMore();
+}
+
+void SqlModel::loadAllRows()
+{
+  if(queryGeneration == -1)
+    return;
+
+  loadAll = true;
+
+  // Otherwise requested by pageFetched once the first or pending page arrives
+  if(hasCurrentRows() && !atEnd && !fetchPending)
+  {
+    fetchPending = true;
+    worker->fetchAll(queryGeneration);
+  }
 }
 
 Qt::SortOrder SqlModel::getSortOrder() const
@@ -673,14 +777,16 @@ QVariant SqlModel::data(const QModelIndex& index, int role) const
   Qt::ItemDataRole dataRole = static_cast<Qt::ItemDataRole>(role);
 
   // Get the default value for this role. Can be a font, color, etc.
-  QVariant roleValue = QSqlQueryModel::data(index, role);
+  QVariant roleValue;
+  if(role == Qt::DisplayRole || role == Qt::EditRole)
+    roleValue = getRawData(index.row(), index.column());
 
   if(handlerRoles.contains(dataRole))
   {
     // Callback wants to be called for this role
 
     // Get data to display
-    QVariant dataValue = QSqlQueryModel::data(index, Qt::DisplayRole);
+    QVariant dataValue = getRawData(index.row(), index.column());
     QString col = getSqlRecord().fieldName(index.column());
     const Column *column = columns->getColumn(col);
 
@@ -698,8 +804,59 @@ QVariant SqlModel::data(const QModelIndex& index, int role) const
 
 void SqlModel::fetchMore(const QModelIndex& parent)
 {
-  QSqlQueryModel::fetchMore(parent);
-  emit fetchedMore();
+  if(canFetchMore(parent) && !fetchPending)
+  {
+    fetchPending = true;
+    worker->fetchMore(queryGeneration);
+  }
+}
+
+bool SqlModel::canFetchMore(const QModelIndex& parent) const
+{
+  // Wait for the first page before requesting more
+  return !parent.isValid() && rowsGeneration == queryGeneration && !atEnd;
+}
+
+int SqlModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : rows.size();
+}
+
+int SqlModel::columnCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : queryRecord.count();
+}
+
+QVariant SqlModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if(orientation == Qt::Horizontal)
+  {
+    // Same behavior as QSqlQueryModel
+    QHash<int, QVariant> sectionHeaders = headers.value(section);
+    QVariant value = sectionHeaders.value(role);
+    if(role == Qt::DisplayRole && !value.isValid())
+      value = sectionHeaders.value(Qt::EditRole);
+
+    if(value.isValid())
+      return value;
+
+    if(role == Qt::DisplayRole && section < queryRecord.count())
+      return queryRecord.fieldName(section);
+  }
+  return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+bool SqlModel::setHeaderData(int section, Qt::Orientation orientation, const QVariant& value, int role)
+{
+  if(orientation != Qt::Horizontal || section < 0 || section >= columnCount())
+    return false;
+
+  if(headers.size() <= section)
+    headers.resize(section + 1);
+  headers[section][role] = value;
+
+  emit headerDataChanged(orientation, section, section);
+  return true;
 }
 
 QVariant SqlModel::getRawData(int row, const QString& colname) const
@@ -709,12 +866,16 @@ QVariant SqlModel::getRawData(int row, const QString& colname) const
 
 void SqlModel::updateSqlQuery()
 {
+  totalCountCache.clear();
   buildQuery();
 }
 
 QVariant SqlModel::getRawData(int row, int col) const
 {
-  return QSqlQueryModel::data(createIndex(row, col));
+  if(row >= 0 && row < rows.size())
+    return rows.at(row).value(col);
+  else
+    return QVariant();
 }
 
 QString SqlModel::getColumnName(int col) const
@@ -729,10 +890,13 @@ QVariant SqlModel::getFormattedFieldData(const QModelIndex& index) const
 
 atools::sql::SqlRecord SqlModel::getSqlRecord() const
 {
-  return atools::sql::SqlRecord(record(), currentSqlQuery);
+  return atools::sql::SqlRecord(queryRecord, currentSqlQuery);
 }
 
 atools::sql::SqlRecord SqlModel::getSqlRecord(int row) const
 {
-  return atools::sql::SqlRecord(record(row), currentSqlQuery);
+  QSqlRecord rec(queryRecord);
+  for(int i = 0; i < rec.count(); i++)
+    rec.setValue(i, getRawData(row, i));
+  return atools::sql::SqlRecord(rec, currentSqlQuery);
 }
@@ -19,10 +19,13 @@
 #define LITTLENAVMAP_SQLMODEL_H
 
 #include "geo/rect.h"
+#include "search/sqlqueryworker.h"
 
 #include <functional>
 
-#include <QSqlQueryModel>
+#include <QAbstractTableModel>
+#include <QCache>
+#include <QSqlRecord>
 
 namespace atools {
 namespace sql {
@@ -36,10 +39,14 @@ class Column;
 class ColumnList;
 
 /*
- * Extends the QSqlQueryModel and adds query building based on filters and ordering.
+ * Table model which builds queries based on filters and ordering. Queries are executed by a
+ * SqlQueryWorker in a background thread and the rows are added in pages like QSqlQueryModel does.
+ *
+ * The previous result stays visible until the first page of a new query arrives.
+ * Nothing blocks on the worker. Wait for signal fetchedMore where the result is needed.
  */
 class SqlModel :
-  public QSqlQueryModel
+  public QAbstractTableModel
 {
   Q_OBJECT
 
@@ -48,8 +55,10 @@ public:
    * @param parent parent widget
    * @param sqlDb database to use
    * @param columnList column descriptors that will be used to build the SQL queries
+   * @param queryWorker executes the queries. Not owned.
    */
-  SqlModel(QWidget *parent, atools::sql::SqlDatabase *sqlDb, const ColumnList *columnList);
+  SqlModel(QWidget *parent, atools::sql::SqlDatabase *sqlDb, const ColumnList *columnList,
+           SqlQueryWorker *queryWorker);
   virtual ~SqlModel();
 
   /* Creates an include filer for value at index in the table */
@@ -99,19 +108,53 @@ public:
     return totalRowCount;
   }
 
+  /* Query for the current result which does not depend on the worker connection and can be used for export */
   QString getCurrentSqlQuery() const
   {
     return currentSqlQuery;
   }
 
-  /* Fetch more data and emit signal fetchedMore */
+  /* Request more data from the worker. Signal fetchedMore is emitted once the rows arrived. */
   virtual void fetchMore(const QModelIndex& parent) override;
+  virtual bool canFetchMore(const QModelIndex& parent) const override;
+
+  /* Request all remaining rows of the current query. Rows are added later and signal fetchedMore is emitted.
+   * Reset when a new query is started. */
+  void loadAllRows();
+
+  /* True if loadAllRows was called and rows are still missing */
+  bool isLoadingAllRows() const
+  {
+    return loadAll && !(hasCurrentRows() && atEnd);
+  }
+
+  /* True if the loaded rows belong to the last started query */
+  bool hasCurrentRows() const
+  {
+    return queryGeneration != -1 && rowsGeneration == queryGeneration;
+  }
+
+  /* Generation of the last started query. Changes with each new query. */
+  int getQueryGeneration() const
+  {
+    return queryGeneration;
+  }
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  virtual int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+  virtual bool setHeaderData(int section, Qt::Orientation orientation, const QVariant& value,
+                             int role = Qt::EditRole) override;
+
+  /* Cancel query and remove all rows and columns */
+  void clear();
 
   /* Get unformatted data from the model */
   QVariant getRawData(int row, int col) const;
   QVariant getRawData(int row, const QString& colname) const;
 
-  /* Sets the SQL query into the model. This will start the query and fetch data from the database. */
+  /* Sets the SQL query into the model. This will start the query in the worker which sends the data later. */
   void updateSqlQuery();
   void resetSqlQuery();
 
@@ -164,16 +207,13 @@ public:
   void refreshData();
 
 signals:
-  /* Emitted when more data was fetched */
+  /* Emitted when more data was fetched or the total row count is known */
   void fetchedMore();
 
   /* One or more columns overrides all other search options */
   void overrideMode(const QStringList& overrideColumnTitles);
 
 private:
-  // Hide the record method
-  using QSqlQueryModel::record;
-
   struct WhereCondition
   {
     QString oper; /* operator (like, not like) */
@@ -185,8 +225,11 @@ private:
   virtual void sort(int column, Qt::SortOrder order) override;
 
   void filterBy(bool exclude, QString whereCol, QVariant whereValue);
-  QString buildColumnList(const atools::sql::SqlRecord& tableCols);
-  QString buildWhere(const atools::sql::SqlRecord& tableCols, QVector<const Column *>& overrideColumns);
+  QString buildColumnList(const atools::sql::SqlRecord& tableCols, QSqlRecord& queryRec);
+
+  /* Builds the where clause. Text conditions use the search index of the worker connection if useIndex is true. */
+  QString buildWhere(const atools::sql::SqlRecord& tableCols, QVector<const Column *>& overrideColumns,
+                     bool useIndex);
   QString buildWhereValue(const WhereCondition& cond);
   void buildQuery();
   void clearWhereConditions();
@@ -194,7 +237,11 @@ private:
   QString  sortOrderToSql(Qt::SortOrder order);
   QVariant defaultDataHandler(int colIndex, int rowIndex, const Column *col, const QVariant& roleValue,
                               const QVariant& displayRoleValue, Qt::ItemDataRole role) const;
-  void updateTotalCount();
+
+  /* Connected to the worker */
+  void pageFetched(const sqlquery::Page& page);
+  void totalCountFetched(int generation, int count);
+
   void buildSqlWhereValue(QVariant& whereValue) const;
   void buildSqlWhereValue(QString& whereValue) const;
 
@@ -204,7 +251,11 @@ private:
   QString orderByCol /* Order by column name */, orderByOrder /* "asc" or "desc" */;
   int orderByColIndex = 0;
 
-  QString currentSqlQuery, currentSqlCountQuery;
+  /* Query for the GUI connection */
+  QString currentSqlQuery;
+
+  /* Result and count queries using the search index which is only available on the worker connection */
+  QString currentWorkerSqlQuery, currentWorkerSqlCountQuery;
 
   /* Data callback */
   DataFunctionType dataFunction = nullptr;
@@ -222,6 +273,34 @@ private:
   /* List of column descriptors */
   const ColumnList *columns;
 
+  SqlQueryWorker *worker;
+
+  /* Maps count query to total row count to avoid counting again when going back to a previous
+   * search, e.g. when deleting characters. Cleared on data changes. */
+  QCache<QString, int> totalCountCache;
+
+  /* Columns of the query and loaded rows */
+  QSqlRecord queryRecord;
+  QVector<QVector<QVariant> > rows;
+
+  /* Header data by column and role */
+  QVector<QHash<int, QVariant> > headers;
+
+  /* Generation of the last started query and of the query the rows belong to */
+  int queryGeneration = -1, rowsGeneration = -1;
+
+  /* Count query used for the last started query. Used as key for the count cache. */
+  QString queryCountKey;
+
+  /* All rows of the query are loaded */
+  bool atEnd = true;
+
+  /* Waiting for rows requested by fetchMore or loadAllRows */
+  bool fetchPending = false;
+
+  /* Load all rows of the current query as soon as the first page arrives */
+  bool loadAll = false;
+
   QWidget *parentWidget;
   int totalRowCount = 0;
 
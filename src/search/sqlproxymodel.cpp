@@ -110,11 +110,8 @@ void SqlProxyModel::sort(int column, Qt::SortOrder order)
   // Update query in underlying SQL model
   sourceSqlModel->setSort(sourceSqlModel->getColumnName(column), order);
 
-  // Fetch all data and set wait cursor
-  QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-  while(canFetchMore(QModelIndex()))
-    fetchMore(QModelIndex());
-  QGuiApplication::restoreOverrideCursor();
+  // Fetch all data - rows are sorted into the proxy as they arrive
+  sourceSqlModel->loadAllRows();
 }
 
 QVariant SqlProxyModel::headerData(int section, Qt::Orientation orientation, int role) const
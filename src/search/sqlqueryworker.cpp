@@ -0,0 +1,455 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "search/sqlqueryworker.h"
+
+#include "db/databasemanager.h"
+#include "exception.h"
+#include "search/columnlist.h"
+#include "search/searchindex.h"
+#include "sql/sqldatabase.h"
+#include "sql/sqlquery.h"
+#include "sql/sqlrecord.h"
+
+#include <QDebug>
+#include <QThread>
+
+#ifdef SQLITE_INTERRUPT
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <sqlite3.h>
+#endif
+
+#include <algorithm>
+
+using atools::sql::SqlQuery;
+
+/* Number of rows read for each fetch. Same as QSqlQueryModel. */
+const static int PAGE_SIZE = 256;
+
+class SqlQueryWorker::RunningStatement
+{
+public:
+  RunningStatement(SqlQueryWorker *queryWorker, int generation)
+    : worker(queryWorker)
+  {
+    QMutexLocker locker(&worker->interruptMutex);
+    worker->runningGeneration = generation;
+  }
+
+  ~RunningStatement()
+  {
+    QMutexLocker locker(&worker->interruptMutex);
+    worker->runningGeneration = -1;
+  }
+
+private:
+  SqlQueryWorker *worker;
+};
+
+SqlQueryWorker::SqlQueryWorker(const ColumnList *columnList)
+  : columns(columnList)
+{
+  latestGeneration = -1;
+  qRegisterMetaType<sqlquery::Page>();
+
+  // Connection names have to be unique for all tables and instances
+  static int connectionId = 0;
+  connectionName = QString("LNMSEARCH%1%2").arg(columns->getTablename().toUpper()).arg(connectionId++);
+
+  searchIndex = new SearchIndex(columns);
+
+  thread = new QThread();
+  thread->setObjectName("SqlQueryWorker " + columns->getTablename());
+  moveToThread(thread);
+  thread->start();
+}
+
+SqlQueryWorker::~SqlQueryWorker()
+{
+  // Close connection in the thread which opened it
+  close();
+
+  thread->quit();
+  thread->wait();
+  delete thread;
+
+  delete searchIndex;
+}
+
+// Called in GUI thread =================================================================
+void SqlQueryWorker::open(const QString& databaseFile, bool writeable)
+{
+  QMetaObject::invokeMethod(this, "openInternal", Qt::QueuedConnection,
+                            Q_ARG(QString, databaseFile), Q_ARG(bool, writeable));
+}
+
+void SqlQueryWorker::close()
+{
+  // Stops a running query or count
+  cancel();
+  QMetaObject::invokeMethod(this, "closeInternal", Qt::BlockingQueuedConnection);
+}
+
+void SqlQueryWorker::refresh()
+{
+  QMetaObject::invokeMethod(this, "refreshInternal", Qt::QueuedConnection);
+}
+
+int SqlQueryWorker::startQuery(const QString& sql, const QString& countSql)
+{
+  int generation = nextGeneration++;
+  latestGeneration = generation;
+  interruptOutdated();
+
+  QMetaObject::invokeMethod(this, "executeQuery", Qt::QueuedConnection,
+                            Q_ARG(int, generation), Q_ARG(QString, sql), Q_ARG(QString, countSql));
+  return generation;
+}
+
+void SqlQueryWorker::fetchMore(int generation)
+{
+  QMetaObject::invokeMethod(this, "fetchRows", Qt::QueuedConnection, Q_ARG(int, generation), Q_ARG(int, PAGE_SIZE));
+}
+
+void SqlQueryWorker::fetchAll(int generation)
+{
+  QMetaObject::invokeMethod(this, "fetchRows", Qt::QueuedConnection, Q_ARG(int, generation), Q_ARG(int, -1));
+}
+
+void SqlQueryWorker::cancel()
+{
+  // Use a generation which is never used by a query
+  latestGeneration = nextGeneration++;
+  interruptOutdated();
+}
+
+void SqlQueryWorker::interruptOutdated()
+{
+#ifdef SQLITE_INTERRUPT
+  // Index build and other statements without generation are never interrupted
+  QMutexLocker locker(&interruptMutex);
+  if(sqliteHandle != nullptr && runningGeneration != -1 && isCancelled(runningGeneration))
+    sqlite3_interrupt(sqliteHandle);
+#endif
+}
+
+// Called in worker thread =================================================================
+void SqlQueryWorker::openInternal(QString databaseFile, bool writeable)
+{
+  closeDatabase();
+  dbFile = databaseFile;
+  dbWriteable = writeable;
+}
+
+void SqlQueryWorker::closeInternal()
+{
+  closeDatabase();
+  dbFile.clear();
+}
+
+void SqlQueryWorker::refreshInternal()
+{
+  if(db != nullptr)
+  {
+    searchIndex->build(db);
+    indexBuilt = true;
+  }
+}
+
+void SqlQueryWorker::executeQuery(int generation, QString sql, QString countSql)
+{
+  // Skip if user changed the search in the meantime
+  if(isCancelled(generation))
+    return;
+
+  finishQuery();
+  bufferedRows.clear();
+  queryGeneration = generation;
+  rowsRead = 0;
+  numColumns = 0;
+  queryAtEnd = false;
+  countGeneration = -1;
+  countQuerySql.clear();
+
+  if(dbFile.isEmpty())
+  {
+    // Closed while database is changed - send empty result
+    queryAtEnd = true;
+    sqlquery::Page page;
+    page.generation = generation;
+    page.atEnd = true;
+    emit pageFetched(page);
+    return;
+  }
+
+  try
+  {
+    openDatabase();
+
+    RunningStatement running(this, generation);
+    query = new SqlQuery(db);
+    query->exec(sql);
+    numColumns = query->record().count();
+
+    if(dbWriteable)
+    {
+      // Read everything to release the lock on the database
+      while(query->next())
+      {
+        if(isCancelled(generation))
+        {
+          finishQuery();
+          return;
+        }
+        bufferedRows.append(readRow());
+      }
+      finishQuery();
+    }
+
+    sqlquery::Page page = readPage(generation, PAGE_SIZE);
+    if(isCancelled(generation))
+      return;
+    emit pageFetched(page);
+
+    // Count rows ===================================
+    if(page.atEnd)
+      emit totalCountFetched(generation, page.rows.size());
+    else if(dbWriteable)
+      emit totalCountFetched(generation, bufferedRows.size());
+    else if(!countSql.isEmpty())
+    {
+      // Count after all fetch requests which are already waiting in the queue
+      countGeneration = generation;
+      countQuerySql = countSql;
+      QMetaObject::invokeMethod(this, "countRows", Qt::QueuedConnection, Q_ARG(int, generation));
+    }
+
+    // Build index after the first query to show results as soon as possible after loading
+    // Queue it behind pending fetch requests so these do not wait for the build
+    if(!indexBuilt)
+    {
+      indexBuilt = true;
+      QMetaObject::invokeMethod(this, "refreshInternal", Qt::QueuedConnection);
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    finishQuery();
+    if(!isCancelled(generation))
+      sendError(generation, e.what());
+  }
+  catch(...)
+  {
+    finishQuery();
+    if(!isCancelled(generation))
+      sendError(generation, tr("Unknown error"));
+  }
+}
+
+void SqlQueryWorker::fetchRows(int generation, int numRows)
+{
+  if(generation != queryGeneration || isCancelled(generation))
+    return;
+
+  try
+  {
+    RunningStatement running(this, generation);
+    sqlquery::Page page = readPage(generation, numRows);
+    if(isCancelled(generation))
+      return;
+    emit pageFetched(page);
+
+    if(page.atEnd && countGeneration == generation)
+    {
+      // All rows read - no need to count
+      countGeneration = -1;
+      emit totalCountFetched(generation, rowsRead);
+    }
+  }
+  catch(atools::Exception& e)
+  {
+    finishQuery();
+    if(!isCancelled(generation))
+      sendError(generation, e.what());
+  }
+  catch(...)
+  {
+    finishQuery();
+    if(!isCancelled(generation))
+      sendError(generation, tr("Unknown error"));
+  }
+}
+
+void SqlQueryWorker::countRows(int generation)
+{
+  if(generation != countGeneration || isCancelled(generation) || db == nullptr)
+    return;
+
+  try
+  {
+    RunningStatement running(this, generation);
+    SqlQuery countQuery(db);
+    int count = 0;
+
+#ifdef SQLITE_INTERRUPT
+    // Outdated counts are interrupted by startQuery() or cancel()
+    countQuery.exec("select count(1) from (" + countQuerySql + ")");
+    if(countQuery.next())
+      count = countQuery.value(0).toInt();
+#else
+    // Step through the rows instead of using count(1) which cannot be stopped once started
+    countQuery.exec(countQuerySql);
+    while(countQuery.next())
+    {
+      if(isCancelled(generation))
+        return;
+      count++;
+    }
+#endif
+
+    countGeneration = -1;
+    if(!isCancelled(generation))
+      emit totalCountFetched(generation, count);
+  }
+  catch(atools::Exception& e)
+  {
+    if(!isCancelled(generation))
+      qWarning() << Q_FUNC_INFO << columns->getTablename() << e.what();
+    countGeneration = -1;
+  }
+  catch(...)
+  {
+    if(!isCancelled(generation))
+      qWarning() << Q_FUNC_INFO << columns->getTablename() << "Unknown error";
+    countGeneration = -1;
+  }
+}
+
+sqlquery::Page SqlQueryWorker::readPage(int generation, int numRows)
+{
+  sqlquery::Page page;
+  page.generation = generation;
+  page.firstRow = rowsRead;
+
+  if(dbWriteable)
+  {
+    int end = numRows < 0 ? bufferedRows.size() : std::min(rowsRead + numRows, bufferedRows.size());
+    page.rows = bufferedRows.mid(rowsRead, end - rowsRead);
+    queryAtEnd = end >= bufferedRows.size();
+  }
+  else if(query != nullptr)
+  {
+    while(numRows < 0 || page.rows.size() < numRows)
+    {
+      if(isCancelled(generation))
+        break;
+
+      if(!query->next())
+      {
+        queryAtEnd = true;
+        finishQuery();
+        break;
+      }
+      page.rows.append(readRow());
+    }
+  }
+  else
+    queryAtEnd = true;
+
+  rowsRead += page.rows.size();
+  page.atEnd = queryAtEnd;
+  return page;
+}
+
+QVector<QVariant> SqlQueryWorker::readRow() const
+{
+  QVector<QVariant> row;
+  row.reserve(numColumns);
+  for(int i = 0; i < numColumns; i++)
+    row.append(query->value(i));
+  return row;
+}
+
+void SqlQueryWorker::sendError(int generation, const QString& message)
+{
+  qWarning() << Q_FUNC_INFO << columns->getTablename() << message;
+
+  queryAtEnd = true;
+  sqlquery::Page page;
+  page.generation = generation;
+  page.atEnd = true;
+  page.error = message;
+  emit pageFetched(page);
+}
+
+void SqlQueryWorker::openDatabase()
+{
+  if(db == nullptr)
+  {
+    db = DatabaseManager::openThreadDatabase(connectionName, dbFile);
+
+    if(dbWriteable)
+      // Wait for writes from the GUI or the online data thread
+      SqlQuery(db).exec("PRAGMA busy_timeout=2000");
+
+#ifdef SQLITE_INTERRUPT
+    // Qt's SQLite driver wraps the connection as "sqlite3*"
+    QVariant handle = db->getQSqlDatabase().driver()->handle();
+    if(handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0)
+    {
+      QMutexLocker locker(&interruptMutex);
+      sqliteHandle = *static_cast<sqlite3 **>(handle.data());
+    }
+#endif
+  }
+}
+
+void SqlQueryWorker::closeDatabase()
+{
+  finishQuery();
+  bufferedRows.clear();
+  queryAtEnd = true;
+  countGeneration = -1;
+
+  // Temporary index table is dropped with the connection
+  searchIndex->invalidate();
+  indexBuilt = false;
+
+  if(db != nullptr)
+  {
+#ifdef SQLITE_INTERRUPT
+    {
+      QMutexLocker locker(&interruptMutex);
+      sqliteHandle = nullptr;
+    }
+#endif
+    DatabaseManager::closeThreadDatabase(db, connectionName);
+    db = nullptr;
+  }
+}
+
+void SqlQueryWorker::finishQuery()
+{
+  if(query != nullptr)
+  {
+    query->finish();
+    delete query;
+    query = nullptr;
+  }
+}
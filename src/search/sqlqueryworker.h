@@ -0,0 +1,192 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LITTLENAVMAP_SQLQUERYWORKER_H
+#define LITTLENAVMAP_SQLQUERYWORKER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QVariant>
+
+#include <atomic>
+
+namespace atools {
+namespace sql {
+class SqlDatabase;
+class SqlQuery;
+}
+}
+
+#ifdef SQLITE_INTERRUPT
+struct sqlite3;
+#endif
+
+class ColumnList;
+class SearchIndex;
+class QThread;
+
+namespace sqlquery {
+
+/* Rows read by the worker for one query. Sent to the model in the GUI thread. */
+struct Page
+{
+  int generation = -1; /* Query this page belongs to */
+  int firstRow = 0; /* Index of the first row in the whole result */
+  QVector<QVector<QVariant> > rows;
+  bool atEnd = false; /* No more rows available */
+  QString error; /* Error message if query failed */
+};
+
+}
+
+Q_DECLARE_METATYPE(sqlquery::Page)
+
+/*
+ * Executes the search queries of one table in a background thread using an own readonly database connection.
+ *
+ * Each query gets a generation number. Starting a new query cancels all older ones which are skipped
+ * if still waiting in the queue or stopped between reading rows if already running.
+ * Running statements are interrupted on the SQLite connection if the build defines SQLITE_INTERRUPT.
+ * Rows are read in pages on request like QSqlQueryModel does.
+ *
+ * Queries on writeable databases like userpoints are read completely into memory to release the read lock
+ * immediately. Otherwise the GUI could not write while a result set is open.
+ *
+ * The worker also owns the full text search index which is built on its connection.
+ *
+ * All public methods have to be called from the GUI thread.
+ */
+class SqlQueryWorker :
+  public QObject
+{
+  Q_OBJECT
+
+public:
+  SqlQueryWorker(const ColumnList *columnList);
+  virtual ~SqlQueryWorker() override;
+
+  /* Use the database file for the next queries. Opens the connection on first query.
+   * @param writeable true if the GUI can change the database. Results are read into memory in this case. */
+  void open(const QString& databaseFile, bool writeable);
+
+  /* Cancels all queries and closes the connection. Blocks until done. Call before the database file changes. */
+  void close();
+
+  /* Data in the table was changed. Rebuilds the search index. */
+  void refresh();
+
+  /* Start a query and cancel all older ones. Results are sent by pageFetched and totalCountFetched.
+   * @param countSql Query returning one row for each result row. Used as subquery of count(1) or stepped through
+   * if statements cannot be interrupted. No count is sent if empty.
+   * @return generation of the new query */
+  int startQuery(const QString& sql, const QString& countSql);
+
+  /* Read the next page of the query if generation is still current. Result is sent by pageFetched. */
+  void fetchMore(int generation);
+
+  /* Read all remaining rows of the query if generation is still current. Result is sent as one page. */
+  void fetchAll(int generation);
+
+  /* Cancel the current query. Pages which are already sent have to be ignored by the receiver. */
+  void cancel();
+
+  /* Index used by the queries. Use only to build conditions. */
+  const SearchIndex *getSearchIndex() const
+  {
+    return searchIndex;
+  }
+
+signals:
+  /* Rows of the first page after starting a query or requested by fetchMore */
+  void pageFetched(const sqlquery::Page& page);
+
+  /* Total number of rows for the query */
+  void totalCountFetched(int generation, int count);
+
+private slots:
+  /* All slots run in the worker thread */
+  void openInternal(QString databaseFile, bool writeable);
+  void closeInternal();
+  void refreshInternal();
+  void executeQuery(int generation, QString sql, QString countSql);
+  void fetchRows(int generation, int numRows);
+  void countRows(int generation);
+
+private:
+  /* Marks statements of a generation as running while in scope */
+  class RunningStatement;
+
+  /* Interrupt a running statement if it belongs to an outdated generation. Called in GUI thread. */
+  void interruptOutdated();
+
+  /* Open connection if not already done. Throws an exception on error. */
+  void openDatabase();
+  void closeDatabase();
+  void finishQuery();
+
+  /* Read up to numRows (-1 for all) from the result set or buffer */
+  sqlquery::Page readPage(int generation, int numRows);
+  QVector<QVariant> readRow() const;
+  void sendError(int generation, const QString& message);
+
+  bool isCancelled(int generation) const
+  {
+    return generation != latestGeneration;
+  }
+
+  const ColumnList *columns;
+  SearchIndex *searchIndex = nullptr;
+  QThread *thread = nullptr;
+
+  /* Last generation given out by startQuery. Everything else is outdated. */
+  std::atomic_int latestGeneration;
+
+  /* Guards runningGeneration and sqliteHandle which are used by GUI and worker thread */
+  QMutex interruptMutex;
+
+  /* Generation of the statement running in the worker thread or -1 */
+  int runningGeneration = -1;
+
+#ifdef SQLITE_INTERRUPT
+  /* Driver handle of the worker connection */
+  sqlite3 *sqliteHandle = nullptr;
+#endif
+
+  /* Used in GUI thread only */
+  int nextGeneration = 0;
+
+  /* State below is used in the worker thread only */
+  atools::sql::SqlDatabase *db = nullptr;
+  QString connectionName, dbFile;
+  bool dbWriteable = false, indexBuilt = false;
+
+  /* Result set of the current query. Null if finished or buffered. */
+  atools::sql::SqlQuery *query = nullptr;
+  int queryGeneration = -1, rowsRead = 0, numColumns = 0;
+  bool queryAtEnd = true;
+
+  /* Count which is still to be done for the current query. countGeneration is -1 if nothing is pending. */
+  int countGeneration = -1;
+  QString countQuerySql;
+
+  /* Complete result for writeable databases */
+  QVector<QVector<QVariant> > bufferedRows;
+};
+
+#endif // LITTLENAVMAP_SQLQUERYWORKER_H
@@ -71,11 +71,11 @@ UserdataSearch::UserdataSearch(QMainWindow *parent, QTableView *tableView, si::T
   append(Column("userdata_id").hidden()).
   append(Column("type", ui->comboBoxUserdataType, tr("Type")).filter()).
   append(Column("last_edit_timestamp", tr("Last Change")).defaultSort().defaultSortOrder(Qt::DescendingOrder)).
-  append(Column("ident", ui->lineEditUserdataIdent, tr("Ident")).filter()).
-  append(Column("region", ui->lineEditUserdataRegion, tr("Region")).filter()).
-  append(Column("name", ui->lineEditUserdataName, tr("Name")).filter()).
-  append(Column("tags", ui->lineEditUserdataTags, tr("Tags")).filter()).
-  append(Column("description", ui->lineEditUserdataDescription, tr("Description")).filter()).
+  append(Column("ident", ui->lineEditUserdataIdent, tr("Ident")).filter().searchIndex()).
+  append(Column("region", ui->lineEditUserdataRegion, tr("Region")).filter().searchIndex()).
+  append(Column("name", ui->lineEditUserdataName, tr("Name")).filter().searchIndex()).
+  append(Column("tags", ui->lineEditUserdataTags, tr("Tags")).filter().searchIndex()).
+  append(Column("description", ui->lineEditUserdataDescription, tr("Description")).filter().searchIndex()).
   append(Column("temp").hidden()).
 
   append(Column("visible_from", tr("Visible from\n%dist%")).convertFunc(Unit::distNmF)).
@@ -28,6 +28,7 @@
 #include "web/webmapcontroller.h"
 #include "web/webtools.h"
 #include "web/webapp.h"
+#include "web/webtilecache.h"
 #include "common/mapcolors.h"
 #include "geo/calculations.h"
 #include "common/htmlinfobuilder.h"
@@ -45,7 +46,8 @@ using namespace stefanfrings;
 
 RequestHandler::RequestHandler(QObject *parent, WebMapController *webMapController,
                                HtmlInfoBuilder *htmlInfoBuilderParam, bool verboseParam)
-  : HttpRequestHandler(parent), htmlInfoBuilder(htmlInfoBuilderParam), verbose(verboseParam)
+  : HttpRequestHandler(parent), mapController(webMapController), htmlInfoBuilder(htmlInfoBuilderParam),
+  verbose(verboseParam)
 {
   qDebug() << Q_FUNC_INFO;
 
@@ -64,13 +66,7 @@ RequestHandler::RequestHandler(QObject *parent, WebMapController *webMapControll
   connect(this, &RequestHandler::getCurrentMapWidgetPos,
           NavApp::getMapPaintWidget(), &MapPaintWidget::getCurrentViewCenterPos, Qt::BlockingQueuedConnection);
 
-  connect(this, &RequestHandler::getPixmap, webMapController, &WebMapController::getPixmap,
-          Qt::BlockingQueuedConnection);
-  connect(this, &RequestHandler::getPixmapObject, webMapController, &WebMapController::getPixmapObject,
-          Qt::BlockingQueuedConnection);
-  connect(this, &RequestHandler::getPixmapPosDistance, webMapController, &WebMapController::getPixmapPosDistance,
-          Qt::BlockingQueuedConnection);
-  connect(this, &RequestHandler::getPixmapRect, webMapController, &WebMapController::getPixmapRect,
+  connect(this, &RequestHandler::getTileState, webMapController, &WebMapController::getTileState,
           Qt::BlockingQueuedConnection);
 }
 
@@ -99,6 +95,10 @@ void RequestHandler::service(HttpRequest& request, HttpResponse& response)
     // ===========================================================================
     // Requests for map images only - either with or without session
     handleMapImage(request, response);
+  else if(path == "/maptile")
+    // ===========================================================================
+    // Requests for slippy map tiles - stateless
+    handleMapTile(request, response);
   else
   {
     HttpSession session = getSession(request, response);
@@ -324,13 +324,13 @@ void RequestHandler::handleMapImage(HttpRequest& request, HttpResponse& response
 
       if(mapcmd == "user")
         // Show user aircraft
-        mapPixmap = emit getPixmapObject(width, height, web::USER_AIRCRAFT, QString(), requestedDistanceKm);
+        mapPixmap = getPixmapObject(width, height, web::USER_AIRCRAFT, QString(), requestedDistanceKm);
       else if(mapcmd == "route")
         // Center flight plan
-        mapPixmap = emit getPixmapObject(width, height, web::ROUTE, QString(), requestedDistanceKm);
+        mapPixmap = getPixmapObject(width, height, web::ROUTE, QString(), requestedDistanceKm);
       else if(mapcmd == "airport")
         // Show an airport by ident
-        mapPixmap = emit getPixmapObject(width, height, web::AIRPORT, params.asStr(
+        mapPixmap = getPixmapObject(width, height, web::AIRPORT, params.asStr(
                                            "airport").toUpper(), requestedDistanceKm);
       else
       {
@@ -339,7 +339,7 @@ void RequestHandler::handleMapImage(HttpRequest& request, HttpResponse& response
                          session.get("corrected_distance").toFloat() : session.get("requested_distance").toFloat();
 
         // Zoom or move map
-        mapPixmap = emit getPixmapPosDistance(width, height,
+        mapPixmap = getPixmapPosDistance(width, height,
                                               atools::geo::Pos(session.get("lon").toFloat(),
                                                                session.get("lat").toFloat()),
                                               distance, mapcmd);
@@ -361,19 +361,19 @@ void RequestHandler::handleMapImage(HttpRequest& request, HttpResponse& response
   // Session-less / state-less calls ============================================
   else if(params.has("user"))
     // User aircraft =======================
-    mapPixmap = emit getPixmapObject(width, height, web::USER_AIRCRAFT, QString(), requestedDistanceKm);
+    mapPixmap = getPixmapObject(width, height, web::USER_AIRCRAFT, QString(), requestedDistanceKm);
   else if(params.has("route"))
     // Center flight plan =======================
-    mapPixmap = emit getPixmapObject(width, height, web::ROUTE, QString(), requestedDistanceKm);
+    mapPixmap = getPixmapObject(width, height, web::ROUTE, QString(), requestedDistanceKm);
   else if(params.has("airport"))
     // Show airport =======================
-    mapPixmap = emit getPixmapObject(width, height, web::AIRPORT, params.asStr("airport"), requestedDistanceKm);
+    mapPixmap = getPixmapObject(width, height, web::AIRPORT, params.asStr("airport"), requestedDistanceKm);
   else if(params.has("leftlon") && params.has("toplat") && params.has("rightlon") && params.has("bottomlat"))
   {
     // Show rectangle =======================
     atools::geo::Rect rect(params.asFloat("leftlon"), params.asFloat("toplat"),
                            params.asFloat("rightlon"), params.asFloat("bottomlat"));
-    mapPixmap = emit getPixmapRect(width, height, rect);
+    mapPixmap = getPixmapRect(width, height, rect);
   }
   else if(params.has("distance") || (params.has("lon") && params.has("lat")))
   {
@@ -385,11 +385,11 @@ void RequestHandler::handleMapImage(HttpRequest& request, HttpResponse& response
       pos.setLatY(params.asFloat("lat"));
     }
 
-    mapPixmap = emit getPixmapPosDistance(width, height, pos, requestedDistanceKm, QString());
+    mapPixmap = getPixmapPosDistance(width, height, pos, requestedDistanceKm, QString());
   }
   else
     // Show current map view =======================
-    mapPixmap = emit getPixmap(width, height);
+    mapPixmap = getPixmap(width, height);
 
   if(mapPixmap.isValid() && !mapPixmap.hasError())
   {
@@ -420,6 +420,211 @@ void RequestHandler::handleMapImage(HttpRequest& request, HttpResponse& response
     showErrorPixmap(response, width, height, 404, mapPixmap.error);
 }
 
+MapPixmap RequestHandler::getPixmap(int width, int height)
+{
+  return mapController->queueRender("current", QSize(width, height), [ = ]() -> MapPixmap
+  {
+    return mapController->getPixmap(width, height);
+  });
+}
+
+MapPixmap RequestHandler::getPixmapObject(int width, int height, web::ObjectType type, const QString& ident,
+                                          float distanceKm)
+{
+  QString key = QString("object/%1/%2/%3").arg(type).arg(ident).arg(distanceKm);
+  return mapController->queueRender(key, QSize(width, height), [ = ]() -> MapPixmap
+  {
+    return mapController->getPixmapObject(width, height, type, ident, distanceKm);
+  });
+}
+
+MapPixmap RequestHandler::getPixmapPosDistance(int width, int height, const atools::geo::Pos& pos, float distanceKm,
+                                               const QString& mapCommand)
+{
+  QString key = QString("pos/%1/%2/%3/%4").arg(pos.getLonX()).arg(pos.getLatY()).arg(distanceKm).arg(mapCommand);
+  return mapController->queueRender(key, QSize(width, height), [ = ]() -> MapPixmap
+  {
+    return mapController->getPixmapPosDistance(width, height, pos, distanceKm, mapCommand);
+  });
+}
+
+MapPixmap RequestHandler::getPixmapRect(int width, int height, const atools::geo::Rect& rect)
+{
+  QString key = QString("rect/%1/%2/%3/%4").
+                arg(rect.getWest()).arg(rect.getNorth()).arg(rect.getEast()).arg(rect.getSouth());
+  return mapController->queueRender(key, QSize(width, height), [ = ]() -> MapPixmap
+  {
+    return mapController->getPixmapRect(width, height, rect);
+  });
+}
+
+MapPixmap RequestHandler::getPixmapTile(int z, int x, int y)
+{
+  const int size = WebTileCache::TILE_SIZE;
+  return mapController->queueRender(QString("tile/%1/%2/%3").arg(z).arg(x).arg(y), QSize(size, size),
+                                    [ = ]() -> MapPixmap
+  {
+    return mapController->getPixmapTile(z, x, y);
+  });
+}
+
+void RequestHandler::handleMapTile(HttpRequest& request, HttpResponse& response)
+{
+  Parameter params(request);
+
+  int z = params.asInt("z", -1);
+  int x = params.asInt("x", -1);
+  int y = params.asInt("y", -1);
+
+  // Image format, png is default and only jpg and png allowed ===========================================
+  QString format = params.asEnum("format", "png", {"jpg", "png"});
+
+  const int size = WebTileCache::TILE_SIZE;
+  if(!WebTileCache::isValidTile(z, x, y))
+  {
+    showErrorPixmap(response, size, size, 404, tr("Invalid tile"));
+    return;
+  }
+
+  // Get cache key and dynamic objects from main thread - cheap compared to rendering
+  MapTileState state = emit getTileState(z, x, y);
+
+  WebTileCache *tileCache = WebApp::getTileCache();
+  QImage image = tileCache->getTile(z, x, y, state.signature);
+
+  if(image.isNull())
+  {
+    // Not cached - render tile without dynamic objects in main thread
+    MapPixmap mapPixmap = getPixmapTile(z, x, y);
+
+    if(!mapPixmap.isValid() || mapPixmap.hasError())
+    {
+      showErrorPixmap(response, size, size, 404, mapPixmap.error);
+      return;
+    }
+
+    image = mapPixmap.pixmap.toImage();
+    tileCache->insertTile(z, x, y, state.signature, image);
+  }
+  else if(verbose)
+    qDebug() << Q_FUNC_INFO << "tile cache hit" << z << x << y;
+
+  if(!state.routeLine.isEmpty() || !state.aircraft.isEmpty())
+    // Detaches image from cache
+    drawTileOverlay(image, z, x, y, state);
+
+  // ===========================================================================
+  // Write image
+  QByteArray bytes;
+  QBuffer buffer(&bytes);
+  buffer.open(QIODevice::WriteOnly);
+
+  if(format == "jpg")
+  {
+    response.setHeader("Content-Type", "image/jpeg");
+    image.save(&buffer, "JPG", params.asInt("quality", -1));
+  }
+  else
+  {
+    response.setHeader("Content-Type", "image/png");
+    image.save(&buffer, "PNG", params.asInt("quality", -1));
+  }
+
+  // Overlays change - do not let the browser keep the tile
+  response.setHeader("Cache-Control", "no-cache");
+  response.write(bytes);
+}
+
+void RequestHandler::drawTileOverlay(QImage& image, int z, int x, int y, const MapTileState& state) const
+{
+  // World width in pixel to unwrap lines crossing the anti-meridian
+  const double worldSize = static_cast<double>(WebTileCache::TILE_SIZE) * (1 << z);
+
+  // Interpolate great circle legs in steps of this length
+  const float stepMeter = atools::geo::nmToMeter(50.f);
+
+  if(image.format() != QImage::Format_ARGB32_Premultiplied)
+    image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+  // Flight plan ===========================================================
+  if(state.routeLine.size() > 1)
+  {
+    QPolygonF polygon;
+    QPointF last;
+    for(int i = 1; i < state.routeLine.size(); i++)
+    {
+      const atools::geo::Pos& pos1 = state.routeLine.at(i - 1);
+      const atools::geo::Pos& pos2 = state.routeLine.at(i);
+      float distanceMeter = pos1.distanceMeterTo(pos2);
+      int steps = std::min(std::max(static_cast<int>(distanceMeter / stepMeter), 1), 100);
+
+      for(int step = i == 1 ? 0 : 1; step <= steps; step++)
+      {
+        QPointF pt = WebTileCache::tilePixel(z, x, y, pos1.interpolate(pos2, distanceMeter,
+                                                                       static_cast<float>(step) / steps));
+
+        // Keep line continuous when crossing the anti-meridian
+        if(!polygon.isEmpty())
+        {
+          while(pt.x() - last.x() > worldSize / 2.)
+            pt.rx() -= worldSize;
+          while(last.x() - pt.x() > worldSize / 2.)
+            pt.rx() += worldSize;
+        }
+        polygon.append(pt);
+        last = pt;
+      }
+    }
+
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(QPen(state.routeOutlineColor, state.routeOutlineWidth, Qt::SolidLine, Qt::RoundCap,
+                        Qt::RoundJoin));
+    painter.drawPolyline(polygon);
+    painter.setPen(QPen(state.routeColor, state.routeWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    painter.drawPolyline(polygon);
+  }
+
+  // User aircraft track ===========================================================
+  if(!state.trackLines.isEmpty())
+  {
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(state.trackPen);
+    for(const atools::geo::LineString& line : state.trackLines)
+    {
+      QPolygonF polygon;
+      for(const atools::geo::Pos& pos : line)
+      {
+        QPointF pt = WebTileCache::tilePixel(z, x, y, pos);
+
+        // Keep line continuous when crossing the anti-meridian
+        if(!polygon.isEmpty())
+        {
+          while(pt.x() - polygon.last().x() > worldSize / 2.)
+            pt.rx() -= worldSize;
+          while(polygon.last().x() - pt.x() > worldSize / 2.)
+            pt.rx() += worldSize;
+        }
+        polygon.append(pt);
+      }
+      painter.drawPolyline(polygon);
+    }
+  }
+
+  // Aircraft ===========================================================
+  for(const MapTileAircraft& aircraft : state.aircraft)
+  {
+    QPointF pt = WebTileCache::tilePixel(z, x, y, aircraft.pos);
+    painter.translate(pt);
+    painter.rotate(aircraft.headingTrue);
+    painter.drawImage(QPointF(-aircraft.symbol.width() / 2., -aircraft.symbol.height() / 2.), aircraft.symbol);
+    painter.resetTransform();
+  }
+}
+
 void RequestHandler::showErrorPixmap(HttpResponse& response, int width, int height, int status, const QString& text)
 {
   qWarning() << Q_FUNC_INFO << "Error" << status << text;
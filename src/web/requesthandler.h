@@ -59,13 +59,10 @@ public:
   void service(stefanfrings::HttpRequest& request, stefanfrings::HttpResponse& response) override;
 
 signals:
-  /* Calls to the MapPaintWidget have to run in the main event queue and thread.
+  /* Calls to the main window objects have to run in the main event queue and thread.
    * Therefore, it is necessary to use queued signals to separate
    * a thread from the HTTP server.*/
-  MapPixmap getPixmap(int width, int height);
-  MapPixmap getPixmapObject(int width, int height, web::ObjectType type, QString ident, float distanceKm);
-  MapPixmap getPixmapPosDistance(int width, int height, atools::geo::Pos pos, float distanceKm, QString mapCommand);
-  MapPixmap getPixmapRect(int width, int height, atools::geo::Rect rect);
+  MapTileState getTileState(int z, int x, int y);
 
   atools::fs::sc::SimConnectUserAircraft getUserAircraft();
   Route getRoute();
@@ -74,6 +71,14 @@ signals:
   atools::geo::Pos getCurrentMapWidgetPos();
 
 private:
+  /* Map images are rendered through the render queue of WebMapController. These wait for the result. */
+  MapPixmap getPixmap(int width, int height);
+  MapPixmap getPixmapObject(int width, int height, web::ObjectType type, const QString& ident, float distanceKm);
+  MapPixmap getPixmapPosDistance(int width, int height, const atools::geo::Pos& pos, float distanceKm,
+                                 const QString& mapCommand);
+  MapPixmap getPixmapRect(int width, int height, const atools::geo::Rect& rect);
+  MapPixmap getPixmapTile(int z, int x, int y);
+
   /* fetch parameters as a string map from request */
   QHash<QString, QString> parameters(stefanfrings::HttpRequest& request) const;
 
@@ -87,12 +92,20 @@ private:
   /* Handle stateful and stateless map image requests. */
   void handleMapImage(stefanfrings::HttpRequest& request, stefanfrings::HttpResponse& response);
 
+  /* Handle slippy map tile requests. Tiles are rendered once and cached. Flight plan and aircraft are drawn
+   * on top for each request. */
+  void handleMapTile(stefanfrings::HttpRequest& request, stefanfrings::HttpResponse& response);
+
+  /* Draw flight plan and aircraft on top of a cached tile */
+  void drawTileOverlay(QImage& image, int z, int x, int y, const MapTileState& state) const;
+
   /* Build the select dropdown box HTML code with the default value pre-selected. */
   QString buildRefreshSelect(int defaultValue);
 
   /* Create and prepare a session and set the cookie or return current session */
   stefanfrings::HttpSession getSession(stefanfrings::HttpRequest& request, stefanfrings::HttpResponse& response);
 
+  WebMapController *mapController;
   HtmlInfoBuilder *htmlInfoBuilder;
 
   bool verbose = false;
@@ -22,14 +22,18 @@
 #include "httpserver/httpsessionstore.h"
 #include "templateengine/templatecache.h"
 #include "httpserver/staticfilecontroller.h"
+#include "web/webtilecache.h"
 
 stefanfrings::TemplateCache *WebApp::templateCache = nullptr;
 stefanfrings::HttpSessionStore *WebApp::sessionStore = nullptr;
 stefanfrings::StaticFileController *WebApp::staticFileController = nullptr;
+WebTileCache *WebApp::tileCache = nullptr;
 
 atools::io::IniKeyValues WebApp::templateCacheSettings;
 atools::io::IniKeyValues WebApp::sessionSettings;
 atools::io::IniKeyValues WebApp::staticFileControllerSettings;
+atools::io::IniKeyValues WebApp::tileCacheSettings;
+atools::io::IniKeyValues WebApp::rendererSettings;
 
 QString WebApp::documentRoot;
 QString WebApp::htmlExtension = ".html";
@@ -63,9 +67,20 @@ void WebApp::init(QObject *parent, const QString& configFileName, const QString&
     staticFileControllerSettings.insert("path", docrootParam);
   staticFileControllerSettings.insert("filename", configFileName);
   staticFileController = new stefanfrings::StaticFileController(staticFileControllerSettings, parent);
+
+  // Configure cache for rendered map tiles
+  tileCacheSettings = reader.getKeyValuePairs("tilecache");
+  delete tileCache;
+  tileCache = new WebTileCache(tileCacheSettings);
+
+  // Map renderer pool and queue - used by WebMapController
+  rendererSettings = reader.getKeyValuePairs("renderer");
 }
 
 void WebApp::deinit()
 {
   qDebug() << Q_FUNC_INFO;
+
+  delete tileCache;
+  tileCache = nullptr;
 }
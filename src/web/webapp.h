@@ -30,6 +30,7 @@ class StaticFileController;
 class QSettings;
 class QString;
 class QObject;
+class WebTileCache;
 
 /*
  * Keeps global settings and caches for listener and file controllers and handlers.
@@ -56,6 +57,17 @@ public:
     return staticFileController;
   }
 
+  static WebTileCache *getTileCache()
+  {
+    return tileCache;
+  }
+
+  /* Settings for the pool of map renderers */
+  static const atools::io::IniKeyValues& getRendererSettings()
+  {
+    return rendererSettings;
+  }
+
   static const QString& getDocroot()
   {
     return documentRoot;
@@ -80,7 +92,11 @@ private:
   /* Controller for static files */
   static stefanfrings::StaticFileController *staticFileController;
 
-  static atools::io::IniKeyValues templateCacheSettings, sessionSettings, staticFileControllerSettings;
+  /* Rendered map tiles for the tile endpoint */
+  static WebTileCache *tileCache;
+
+  static atools::io::IniKeyValues templateCacheSettings, sessionSettings, staticFileControllerSettings,
+                                  tileCacheSettings, rendererSettings;
 
   static QString documentRoot, htmlExtension;
 };
@@ -21,6 +21,7 @@
 #include "web/requesthandler.h"
 #include "web/webmapcontroller.h"
 #include "web/webapp.h"
+#include "web/webtilecache.h"
 #include "gui/helphandler.h"
 
 #include "templateengine/templatecache.h"
@@ -252,6 +253,12 @@ void WebController::optionsChanged()
     restartServer(true);
 }
 
+void WebController::clearTileCache()
+{
+  if(WebApp::getTileCache() != nullptr)
+    WebApp::getTileCache()->clear();
+}
+
 bool WebController::updateSettings()
 {
   bool changed = false;
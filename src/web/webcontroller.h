@@ -73,6 +73,9 @@ public:
   /* Update settings and probably restart server. */
   void optionsChanged();
 
+  /* Remove all rendered map tiles. Called after changes which are not covered by the tile cache key. */
+  void clearTileCache();
+
   /* Update settings from option data but do not restart. Returns true if any changes. */
   bool updateSettings();
 
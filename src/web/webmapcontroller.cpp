@@ -20,16 +20,73 @@
 #include <navapp.h>
 
 #include "mapgui/mappaintwidget.h"
+#include "mapgui/mapscreenindex.h"
 #include "mapgui/mapwidget.h"
 #include "navapp.h"
-
+#include "airspace/airspacecontroller.h"
+#include "common/aircrafttrack.h"
+#include "common/mapcolors.h"
+#include "common/trafficindex.h"
+#include "common/vehicleicons.h"
+#include "geo/calculations.h"
+#include "online/onlinedatacontroller.h"
+#include "options/optiondata.h"
+#include "route/route.h"
+#include "userdata/userdatacontroller.h"
+#include "web/webapp.h"
+#include "web/webtilecache.h"
+
+#include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QPixmap>
 
+#include <marble/GeoDataLatLonBox.h>
+
+#include <cmath>
+
+/* Objects which change often and are composited on top of cached tiles for each request */
+const static map::MapObjectTypes TILE_DYNAMIC_TYPES(map::AIRCRAFT_ALL | map::AIRCRAFT_TRACK | map::FLIGHTPLAN);
+const static map::MapObjectDisplayTypes TILE_DYNAMIC_DISPLAY_TYPES(map::WIND_BARBS_ROUTE);
+
+/* Tiles showing weather, sun shading or online centers are rendered again after this time */
+const static qint64 TILE_TIME_SLOT_SECONDS = 600L;
+
+/* Do not show AI and online aircraft on tiles below this zoom level to avoid clutter */
+const static int TILE_MIN_ZOOM_AI = 6;
+
+/* Get true heading or calculate it from magnetic heading. Returns INVALID_COURSE_VALUE if not available. */
+static float aircraftHeadingTrue(const atools::fs::sc::SimConnectAircraft& aircraft)
+{
+  if(aircraft.getHeadingDegTrue() < atools::fs::sc::SC_INVALID_FLOAT)
+    return atools::geo::normalizeCourse(aircraft.getHeadingDegTrue());
+  else if(aircraft.getHeadingDegMag() < atools::fs::sc::SC_INVALID_FLOAT)
+    return atools::geo::normalizeCourse(aircraft.getHeadingDegMag() + NavApp::getMagVar(aircraft.getPosition()));
+  else
+    return map::INVALID_COURSE_VALUE;
+}
+
+/* Job for the render queue. Shared between the main thread and all HTTP threads waiting for it. */
+struct WebMapController::RenderJob
+{
+  QString key;
+  QSize size;
+  std::function<MapPixmap()> func;
+  MapPixmap result;
+
+  /* Number of threads waiting for the result. Job is skipped if all ran into a timeout. */
+  int waiting = 0;
+  bool done = false;
+};
+
 WebMapController::WebMapController(QWidget *parent, bool verboseParam)
   : QObject(parent), parentWidget(parent), verbose(verboseParam)
 {
   qDebug() << Q_FUNC_INFO;
+
+  // Execute jobs in the main thread from the event loop
+  connect(this, &WebMapController::renderJobQueued, this, &WebMapController::processRenderQueue,
+          Qt::QueuedConnection);
 }
 
 WebMapController::~WebMapController()
@@ -44,19 +101,167 @@ void WebMapController::init()
 
   deInit();
 
-  // Create a map widget clone with the desired resolution
-  mapPaintWidget = new MapPaintWidget(parentWidget, false /* no real widget - hidden */);
+  const atools::io::IniKeyValues& settings = WebApp::getRendererSettings();
+  poolSize = std::max(settings.value("poolSize", 2).toInt(), 1);
+  maxQueueSize = std::max(settings.value("queueSize", 32).toInt(), 1);
+  timeoutMs = std::max(settings.value("timeout", 30000).toInt(), 1000);
 
-  // Activate painting
-  mapPaintWidget->setActive();
+  qDebug() << Q_FUNC_INFO << "poolSize" << poolSize << "queueSize" << maxQueueSize << "timeoutMs" << timeoutMs;
+
+  QMutexLocker locker(&queueMutex);
+  acceptJobs = true;
 }
 
 void WebMapController::deInit()
 {
   qDebug() << Q_FUNC_INFO;
 
-  delete mapPaintWidget;
+  {
+    // Release all waiting threads
+    QMutexLocker locker(&queueMutex);
+    acceptJobs = false;
+    for(const QSharedPointer<RenderJob>& job : renderQueue)
+    {
+      job->result.error = tr("Web server stopped");
+      job->done = true;
+    }
+    renderQueue.clear();
+    queueCondition.wakeAll();
+  }
+
+  qDeleteAll(renderers);
+  renderers.clear();
+  rendererSizes.clear();
+  rendererLastUse.clear();
+  mapPaintWidget = nullptr;
+}
+
+MapPixmap WebMapController::queueRender(const QString& key, const QSize& size,
+                                        const std::function<MapPixmap()>& func)
+{
+  MapPixmap mapPixmap;
+  QMutexLocker locker(&queueMutex);
+
+  if(!acceptJobs)
+  {
+    mapPixmap.error = tr("Web server stopped");
+    return mapPixmap;
+  }
+
+  // Look for an equal job not yet started ============================
+  QSharedPointer<RenderJob> job;
+  for(const QSharedPointer<RenderJob>& queuedJob : renderQueue)
+  {
+    if(queuedJob->key == key && queuedJob->size == size)
+    {
+      job = queuedJob;
+      break;
+    }
+  }
+
+  if(job.isNull())
+  {
+    if(renderQueue.size() >= maxQueueSize)
+    {
+      qWarning() << Q_FUNC_INFO << "Render queue full" << renderQueue.size();
+      mapPixmap.error = tr("Too many map requests");
+      return mapPixmap;
+    }
+
+    job = QSharedPointer<RenderJob>::create();
+    job->key = key;
+    job->size = size;
+    job->func = func;
+    renderQueue.append(job);
+
+    // Posts an event into the main thread queue
+    emit renderJobQueued();
+  }
+  else if(verbose)
+    qDebug() << Q_FUNC_INFO << "merged with queued job" << key << size;
+
+  // Wait for main thread ============================
+  job->waiting++;
+  QElapsedTimer timer;
+  timer.start();
+  while(!job->done)
+  {
+    qint64 remaining = timeoutMs - timer.elapsed();
+    if(remaining <= 0 || !queueCondition.wait(&queueMutex, static_cast<unsigned long>(remaining)))
+      break;
+  }
+  job->waiting--;
+
+  if(job->done)
+    return job->result;
+  else
+  {
+    qWarning() << Q_FUNC_INFO << "Timeout for" << key << size;
+    mapPixmap.error = tr("Timeout while drawing map");
+    return mapPixmap;
+  }
+}
+
+void WebMapController::processRenderQueue()
+{
+  // Called once for each queued job - take the next one not abandoned by all waiting threads
+  QSharedPointer<RenderJob> job;
+  {
+    QMutexLocker locker(&queueMutex);
+    while(!renderQueue.isEmpty() && job.isNull())
+    {
+      job = renderQueue.takeFirst();
+      if(job->waiting == 0)
+        job.reset();
+    }
+  }
+
+  if(job.isNull())
+    return;
+
+  if(verbose)
+    qDebug() << Q_FUNC_INFO << job->key << job->size;
+
+  // Run job on renderer outside of lock
+  mapPaintWidget = rendererForSize(job->size);
+  MapPixmap result = job->func();
   mapPaintWidget = nullptr;
+
+  QMutexLocker locker(&queueMutex);
+  job->result = result;
+  job->done = true;
+  queueCondition.wakeAll();
+}
+
+MapPaintWidget *WebMapController::rendererForSize(const QSize& size)
+{
+  // Prefer a renderer having the same size to avoid resizing
+  int index = rendererSizes.indexOf(size);
+
+  if(index == -1)
+  {
+    if(renderers.size() < poolSize)
+    {
+      // Create a map widget clone
+      MapPaintWidget *renderer = new MapPaintWidget(parentWidget, false /* no real widget - hidden */);
+
+      // Activate painting
+      renderer->setActive();
+
+      renderers.append(renderer);
+      rendererSizes.append(QSize());
+      rendererLastUse.append(0);
+      index = renderers.size() - 1;
+    }
+    else
+      // Use least recently used
+      index = static_cast<int>(std::min_element(rendererLastUse.begin(), rendererLastUse.end()) -
+                               rendererLastUse.begin());
+  }
+
+  rendererSizes[index] = size;
+  rendererLastUse[index] = ++renderCounter;
+  return renderers.at(index);
 }
 
 MapPixmap WebMapController::getPixmap(int width, int height)
@@ -230,3 +435,222 @@ MapPixmap WebMapController::getPixmapRect(int width, int height, atools::geo::Re
     qWarning() << Q_FUNC_INFO << "mapPaintWidget is null";
   return mapPixmap;
 }
+
+MapPixmap WebMapController::getPixmapTile(int z, int x, int y)
+{
+  if(verbose)
+    qDebug() << Q_FUNC_INFO << "z" << z << "x" << x << "y" << y;
+
+  MapPixmap mapPixmap;
+  if(mapPaintWidget != nullptr)
+  {
+    if(WebTileCache::isValidTile(z, x, y))
+    {
+      const int size = WebTileCache::TILE_SIZE;
+
+      // Copy all map settings and remove all objects which are composited for each request
+      mapPaintWidget->copySettings(*NavApp::getMapWidget());
+      mapPaintWidget->setShowMapFeatures(TILE_DYNAMIC_TYPES, false);
+      mapPaintWidget->setShowMapFeaturesDisplay(TILE_DYNAMIC_DISPLAY_TYPES, false);
+      mapPaintWidget->getScreenIndex()->clearUserMarksAndHighlights();
+
+      // Slippy map tiles always use Mercator - will be reset by copySettings() for other requests
+      mapPaintWidget->setProjection(Marble::Mercator);
+
+      // Prepare marble for drawing by issuing a dummy paint event
+      mapPaintWidget->prepareDraw(size, size);
+
+      // Do not center world rectangle when resizing
+      mapPaintWidget->setKeepWorldRect(false);
+
+      // World width of the Marble Mercator projection is four times the radius
+      mapPaintWidget->setRadius(size * (1 << z) / 4);
+
+      atools::geo::Pos center = WebTileCache::tileCenter(z, x, y);
+      mapPaintWidget->centerOn(static_cast<double>(center.getLonX()), static_cast<double>(center.getLatY()));
+
+      mapPixmap.correctedDistanceKm = mapPixmap.requestedDistanceKm = static_cast<float>(mapPaintWidget->distance());
+      mapPixmap.pixmap = mapPaintWidget->getPixmap(size, size);
+      mapPixmap.pos = center;
+      mapPixmap.rect = WebTileCache::tileRect(z, x, y);
+    }
+    else
+    {
+      qWarning() << Q_FUNC_INFO << "invalid tile" << z << x << y;
+      mapPixmap.error = tr("Invalid tile");
+    }
+  }
+  else
+    qWarning() << Q_FUNC_INFO << "mapPaintWidget is null";
+  return mapPixmap;
+}
+
+MapTileState WebMapController::getTileState(int z, int x, int y)
+{
+  if(verbose)
+    qDebug() << Q_FUNC_INFO << "z" << z << "x" << x << "y" << y;
+
+  MapTileState state;
+  if(!WebTileCache::isValidTile(z, x, y))
+    return state;
+
+  state.signature = tileSignature();
+
+  const MapWidget *mapWidget = NavApp::getMapWidget();
+  const OptionData& od = OptionData::instance();
+  map::MapObjectTypes types = mapWidget->getShownMapFeatures();
+
+  // Flight plan ===========================================================
+  if(types.testFlag(map::FLIGHTPLAN))
+  {
+    const Route& route = NavApp::getRouteConst();
+    for(int i = 0; i < route.getSizeWithoutAlternates(); i++)
+      state.routeLine.append(route.value(i).getPosition());
+
+    float thickness = od.getDisplayThicknessFlightplan() / 100.f;
+    state.routeColor = od.getFlightplanColor();
+    state.routeOutlineColor = mapcolors::routeOutlineColor;
+    state.routeWidth = static_cast<int>(std::round(thickness * 4.f));
+    state.routeOutlineWidth = static_cast<int>(std::round(thickness * 7.f));
+  }
+
+  // Aircraft ===========================================================
+  VehicleIcons *icons = NavApp::getVehicleIcons();
+
+  // Convert each symbol only once - pixmaps are cached by VehicleIcons
+  QHash<const QPixmap *, QImage> symbols;
+  auto addAircraft = [&state, &symbols, icons](const atools::fs::sc::SimConnectAircraft& aircraft, int size)
+  {
+    float heading = aircraftHeadingTrue(aircraft);
+    if(heading < map::INVALID_COURSE_VALUE)
+    {
+      const QPixmap *pixmap = icons->pixmapFromCache(aircraft, size, 0);
+      if(!symbols.contains(pixmap))
+        symbols.insert(pixmap, pixmap->toImage());
+      state.aircraft.append({aircraft.getPosition(), heading, symbols.value(pixmap)});
+    }
+  };
+
+  // Enlarge tile rectangle by a quarter to catch symbols overlapping the border
+  atools::geo::Rect rect = WebTileCache::tileRect(z, x, y);
+  float inflateLon = rect.getWidthDegree() / 4.f, inflateLat = rect.getHeightDegree() / 4.f;
+  float west = rect.getWest() - inflateLon, east = rect.getEast() + inflateLon;
+  Marble::GeoDataLatLonBox box(std::min(rect.getNorth() + inflateLat, 90.f),
+                               std::max(rect.getSouth() - inflateLat, -90.f),
+                               east > 180.f ? east - 360.f : east,
+                               west < -180.f ? west + 360.f : west, Marble::GeoDataCoordinates::Degree);
+
+  // User aircraft track ===========================================================
+  const AircraftTrack& aircraftTrack = mapWidget->getAircraftTrack();
+  if(types.testFlag(map::AIRCRAFT_TRACK) && aircraftTrack.size() > 1)
+  {
+    // Simplify the track to about one pixel at the tile zoom
+    QVector<int> indexes;
+    aircraftTrack.getSimplifiedIndexes(indexes, atools::geo::nmToMeter(rect.getHeightDegree() * 60.f) /
+                                       WebTileCache::TILE_SIZE);
+
+    atools::geo::Rect trackRect(rect);
+    trackRect.inflate(inflateLon, inflateLat);
+
+    // Copy only segments touching the tile
+    atools::geo::LineString line;
+    for(int i = 1; i < indexes.size(); i++)
+    {
+      const atools::geo::Pos& pos1 = aircraftTrack.at(indexes.at(i - 1)).pos;
+      const atools::geo::Pos& pos2 = aircraftTrack.at(indexes.at(i)).pos;
+      atools::geo::Rect segmentRect(pos1);
+      segmentRect.extend(pos2);
+
+      if(segmentRect.overlaps(trackRect))
+      {
+        if(line.isEmpty())
+          line.append(pos1);
+        line.append(pos2);
+      }
+      else if(!line.isEmpty())
+      {
+        state.trackLines.append(line);
+        line.clear();
+      }
+    }
+
+    if(!line.isEmpty())
+      state.trackLines.append(line);
+    state.trackPen = mapcolors::aircraftTrailPen(od.getDisplayThicknessTrail() / 100.f * 2.f);
+  }
+
+  if(z >= TILE_MIN_ZOOM_AI)
+  {
+    int aiSize = static_cast<int>(std::round(od.getDisplaySymbolSizeAircraftAi() / 100.f * 32.f));
+    int boatSize = static_cast<int>(std::round(od.getDisplaySymbolSizeAircraftAi() / 100.f * 28.f));
+
+    // Simulator AI aircraft and ships
+    if(types & (map::AIRCRAFT_AI | map::AIRCRAFT_AI_SHIP))
+    {
+      const QVector<atools::fs::sc::SimConnectAircraft>& aiAircraft = mapWidget->getAiAircraft();
+      mapWidget->getAiAircraftIndex().queryRect(box, [&](int index)
+      {
+        const atools::fs::sc::SimConnectAircraft& aircraft = aiAircraft.at(index);
+        bool boat = aircraft.getCategory() == atools::fs::sc::BOAT;
+        if(boat && types.testFlag(map::AIRCRAFT_AI_SHIP))
+          addAircraft(aircraft, boatSize);
+        else if(!boat && types.testFlag(map::AIRCRAFT_AI))
+          addAircraft(aircraft, aiSize);
+      });
+    }
+
+    // Online aircraft from the last map query - aircraft outside of the visible map are not covered
+    if(types.testFlag(map::AIRCRAFT_ONLINE))
+    {
+      OnlinedataController *onlineController = NavApp::getOnlinedataController();
+      const QList<atools::fs::sc::SimConnectAircraft> *onlineAircraft = onlineController->getAircraftFromCache();
+      onlineController->getAircraftIndexFromCache().queryRect(box, [&](int index)
+      {
+        addAircraft(onlineAircraft->at(index), aiSize);
+      });
+    }
+  }
+
+  // User aircraft last to draw it on top
+  const atools::fs::sc::SimConnectUserAircraft& userAircraft = mapWidget->getUserAircraft();
+  if(types.testFlag(map::AIRCRAFT) && userAircraft.getPosition().isValid() &&
+     box.contains(Marble::GeoDataCoordinates(userAircraft.getPosition().getLonX(),
+                                             userAircraft.getPosition().getLatY(), 0.,
+                                             Marble::GeoDataCoordinates::Degree)))
+    addAircraft(userAircraft, static_cast<int>(std::round(od.getDisplaySymbolSizeAircraftUser() / 100.f * 32.f)));
+
+  return state;
+}
+
+QString WebMapController::tileSignature() const
+{
+  const MapWidget *mapWidget = NavApp::getMapWidget();
+  map::MapAirspaceFilter airspaces = mapWidget->getShownAirspaces();
+  map::MapAirspaceSources airspaceSources = NavApp::getAirspaceController()->getAirspaceSources();
+  map::MapObjectTypes types = mapWidget->getShownMapFeatures() & ~TILE_DYNAMIC_TYPES;
+  map::MapObjectDisplayTypes displayTypes = mapWidget->getShownMapFeaturesDisplay() & ~TILE_DYNAMIC_DISPLAY_TYPES;
+
+  QStringList signature;
+  signature << mapWidget->mapThemeId()
+            << QString::number(static_cast<uint>(types), 16)
+            << QString::number(static_cast<uint>(displayTypes), 16)
+            << QString::number(static_cast<uint>(airspaces.types), 16)
+            << QString::number(static_cast<uint>(airspaces.flags), 16)
+            << QString::number(static_cast<uint>(airspaceSources), 16)
+            << QString::number(mapWidget->showSunShading()) + QString::number(mapWidget->showGrid()) +
+    QString::number(mapWidget->showPlaces()) + QString::number(mapWidget->showCities()) +
+    QString::number(mapWidget->showTerrain()) + QString::number(mapWidget->showOtherPlaces()) +
+    QString::number(mapWidget->showIceLayer())
+            << NavApp::getUserdataController()->getSelectedTypes().join(",")
+            << NavApp::getCurrentSimulatorShortName()
+            << NavApp::getDatabaseAiracCycleSim()
+            << NavApp::getDatabaseAiracCycleNav()
+            << (NavApp::isCurrentGuiStyleNight() ? "night" : "day");
+
+  // Add a time slot for objects which change over time to render tiles again after a while
+  if(displayTypes & (map::AIRPORT_WEATHER | map::WIND_BARBS) || mapWidget->showSunShading() ||
+     (types.testFlag(map::AIRSPACE) && airspaceSources.testFlag(map::AIRSPACE_SRC_ONLINE)))
+    signature << QString::number(QDateTime::currentSecsSinceEpoch() / TILE_TIME_SLOT_SECONDS);
+
+  return signature.join(";");
+}
@@ -21,7 +21,18 @@
 #include "web/webflags.h"
 
 #include "geo/rect.h"
+#include "geo/linestring.h"
+
+#include <QColor>
+#include <QImage>
+#include <QMutex>
+#include <QPen>
 #include <QPixmap>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <functional>
 
 class QPixmap;
 class MapPaintWidget;
@@ -53,13 +64,48 @@ struct MapPixmap
 };
 
 /*
- * Wraps the MapPaintWidget and provides methods to retreive map images.
+ * Aircraft symbol for compositing on top of cached map tiles.
+ */
+struct MapTileAircraft
+{
+  atools::geo::Pos pos;
+  float headingTrue;
+  QImage symbol; /* Not rotated. Implicitly shared between aircraft of the same type. */
+};
+
+/*
+ * Map state needed to fetch and composite map tiles. Filled in the main thread and used in the HTTP threads.
+ */
+struct MapTileState
+{
+  /* Covers theme, shown features, style and database. Used as key for cached tiles. */
+  QString signature;
+
+  /* Flight plan positions without alternates. Empty if flight plan is not shown. */
+  atools::geo::LineString routeLine;
+  QColor routeColor, routeOutlineColor;
+  int routeWidth = 0, routeOutlineWidth = 0;
+
+  /* Simplified user aircraft track. Split into several lines where the track leaves the tile. */
+  QVector<atools::geo::LineString> trackLines;
+  QPen trackPen;
+
+  /* AI, online and user aircraft touching the tile. User aircraft is last to draw it on top. */
+  QVector<MapTileAircraft> aircraft;
+};
+
+/*
+ * Wraps a pool of MapPaintWidget renderers and provides methods to retreive map images.
  *
- * The map widget has a state, i.e. it remains in the last shown position and zoom value.
+ * Each renderer has a state, i.e. it remains in the last shown position, zoom value and size.
  * Settings are copied from normal visible map window before rendering.
  *
- * This has to run in the main thread and event queue. Therefore, it is necessary to use queued signals to separate
- * a thread from the HTTP server.
+ * Rendering has to run in the main thread and event queue. HTTP server threads use queueRender() which adds a job
+ * to a queue and waits for the result. Jobs are executed one by one from the main event loop which allows the
+ * user interface to process input between renderings. Equal jobs waiting in the queue are rendered only once.
+ *
+ * Jobs are distributed to the renderer having the same size or the least recently used one. This avoids
+ * costly resizing when requests for map tiles and map images of different size alternate.
  *
  * All methods avoid a blurry map by zoomin out to the next best level. This can result in different distances
  * than expected.
@@ -73,10 +119,18 @@ public:
   explicit WebMapController(QWidget *parent, bool verboseParam);
   virtual ~WebMapController() override;
 
-  /* Create or delete the map paint widget */
+  /* Read renderer settings and start accepting render jobs. Call after WebApp::init(). */
   void init();
+
+  /* Delete all renderers and return an error for all waiting jobs */
   void deInit();
 
+  /* Called from the HTTP threads. Queues func to be run in the main thread on a renderer for the given
+   * size and waits for the result. Jobs with equal key and size waiting in the queue are merged.
+   * Returns a pixmap with error if the queue is full, the server is stopping or on timeout.
+   * The methods below can be called in func. */
+  MapPixmap queueRender(const QString& key, const QSize& size, const std::function<MapPixmap()>& func);
+
   /* Get pixmap with given width and height from current position. */
   MapPixmap getPixmap(int width, int height);
 
@@ -90,8 +144,47 @@ public:
   /* Zoom to rectangel on map. */
   MapPixmap getPixmapRect(int width, int height, atools::geo::Rect rect);
 
+  /* Get slippy map tile in Mercator projection. Aircraft, flight plan, user marks and highlights are not drawn
+   * since these are composited for each request. */
+  MapPixmap getPixmapTile(int z, int x, int y);
+
+  /* Get tile signature for the cache and all dynamic objects touching the tile. */
+  MapTileState getTileState(int z, int x, int y);
+
+signals:
+  /* Sent from the HTTP threads for each new job. Connected queued to processRenderQueue(). */
+  void renderJobQueued();
+
 private:
+  struct RenderJob;
+
+  /* Run the first job from the queue in the main thread */
+  void processRenderQueue();
+
+  /* Get or create renderer for the size */
+  MapPaintWidget *rendererForSize(const QSize& size);
+
+  /* Build cache key from all visible map settings */
+  QString tileSignature() const;
+
+  /* Renderer for the job currently executed in processRenderQueue() */
   MapPaintWidget *mapPaintWidget = nullptr;
+
+  /* Pool of renderers created on demand. Size of last job and counter of last use for each renderer. */
+  QVector<MapPaintWidget *> renderers;
+  QVector<QSize> rendererSizes;
+  QVector<quint32> rendererLastUse;
+  quint32 renderCounter = 0;
+
+  /* Configuration from section "renderer" in webserver.cfg */
+  int poolSize = 2, maxQueueSize = 32, timeoutMs = 30000;
+
+  /* Pending jobs and state are shared with the HTTP threads and protected by the mutex */
+  QMutex queueMutex;
+  QWaitCondition queueCondition;
+  QList<QSharedPointer<RenderJob> > renderQueue;
+  bool acceptJobs = false;
+
   QWidget *parentWidget;
   bool verbose = false;
 };
@@ -0,0 +1,240 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "web/webtilecache.h"
+
+#include "atools.h"
+#include "geo/calculations.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <cmath>
+#include <limits>
+
+/* Convert fractional tile numbers to degrees */
+static float tileXToLon(double x, int z)
+{
+  return static_cast<float>(x / (1 << z) * 360. - 180.);
+}
+
+static float tileYToLat(double y, int z)
+{
+  return static_cast<float>(atools::geo::toDegree(std::atan(std::sinh(M_PI * (1. - 2. * y / (1 << z))))));
+}
+
+/* Remove all numeric generation directories below the given generation. Other files are not touched. */
+static void removeGenerations(const QString& path, int belowGeneration)
+{
+  const QFileInfoList dirs = QDir(path).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for(const QFileInfo& dir : dirs)
+  {
+    bool ok;
+    int gen = dir.fileName().toInt(&ok);
+    if(ok && gen < belowGeneration)
+      QDir(dir.absoluteFilePath()).removeRecursively();
+  }
+}
+
+WebTileCache::WebTileCache(const atools::io::IniKeyValues& settings)
+{
+  // Memory size in kB - default is 64 MB which covers about 250 tiles
+  memoryCache.setMaxCost(settings.value("memorySize", 65536).toInt());
+
+  if(settings.value("disk", false).toBool())
+  {
+    maxDiskSize = settings.value("diskSize", 1024).toLongLong() * 1024L * 1024L;
+    diskPath = settings.value("path").toString();
+    if(diskPath.isEmpty())
+      diskPath = atools::buildPath({QStandardPaths::writableLocation(QStandardPaths::CacheLocation), "webtiles"});
+    else
+      // Use a dedicated folder since the configured one might contain other files
+      diskPath = atools::buildPath({diskPath, "lnmwebtiles"});
+
+    // Remove tiles from last session since options or map data might have changed in the meantime
+    removeGenerations(diskPath, std::numeric_limits<int>::max());
+
+    if(!QDir().mkpath(diskPath))
+    {
+      qWarning() << Q_FUNC_INFO << "Cannot create tile cache directory" << diskPath;
+      diskPath.clear();
+    }
+  }
+
+  qDebug() << Q_FUNC_INFO << "memory kB" << memoryCache.maxCost() << "disk" << diskPath << "max size" << maxDiskSize;
+}
+
+WebTileCache::~WebTileCache()
+{
+  qDebug() << Q_FUNC_INFO;
+  removeFuture.waitForFinished();
+}
+
+QImage WebTileCache::getTile(int z, int x, int y, const QString& signature)
+{
+  QString key = tileKey(z, x, y, signature);
+  {
+    QMutexLocker locker(&mutex);
+    QImage *image = memoryCache.object(key);
+    if(image != nullptr)
+      return *image;
+  }
+
+  if(!diskPath.isEmpty())
+  {
+    // Load from disk outside of the lock - QImage is thread safe
+    QString filename = tileFilename(z, x, y, signature);
+    if(QFile::exists(filename))
+    {
+      QImage image(filename, "PNG");
+      if(!image.isNull())
+      {
+        QMutexLocker locker(&mutex);
+        memoryCache.insert(key, new QImage(image), std::max(1, image.byteCount() / 1024));
+        return image;
+      }
+    }
+  }
+  return QImage();
+}
+
+void WebTileCache::insertTile(int z, int x, int y, const QString& signature, const QImage& image)
+{
+  if(image.isNull())
+    return;
+
+  {
+    QMutexLocker locker(&mutex);
+    memoryCache.insert(tileKey(z, x, y, signature), new QImage(image), std::max(1, image.byteCount() / 1024));
+  }
+
+  if(!diskPath.isEmpty())
+  {
+    QString filename = tileFilename(z, x, y, signature);
+    QDir().mkpath(QFileInfo(filename).path());
+
+    // Write to a temporary file and rename to avoid other threads reading incomplete files
+    QSaveFile file(filename);
+    if(file.open(QIODevice::WriteOnly))
+    {
+      if(image.save(&file, "PNG"))
+      {
+        qint64 fileSize = file.size();
+        if(file.commit())
+        {
+          bool full;
+          {
+            QMutexLocker locker(&mutex);
+            diskSize += fileSize;
+            full = diskSize > maxDiskSize;
+          }
+
+          if(full)
+          {
+            qDebug() << Q_FUNC_INFO << "Disk cache full" << maxDiskSize;
+            clearDisk();
+          }
+        }
+        else
+          qWarning() << Q_FUNC_INFO << "Cannot write tile" << filename << file.errorString();
+      }
+      else
+        qWarning() << Q_FUNC_INFO << "Cannot write tile" << filename << file.errorString();
+    }
+    else
+      qWarning() << Q_FUNC_INFO << "Cannot open tile" << filename << file.errorString();
+  }
+}
+
+void WebTileCache::clear()
+{
+  {
+    QMutexLocker locker(&mutex);
+    memoryCache.clear();
+  }
+
+  if(!diskPath.isEmpty())
+    clearDisk();
+}
+
+void WebTileCache::clearDisk()
+{
+  QMutexLocker locker(&mutex);
+  generation++;
+  diskSize = 0L;
+
+  // Remove all older generations including directories which were created by late writes after the last removal
+  // An earlier removal might still run which does no harm
+  QString path = diskPath;
+  int currentGeneration = generation;
+  removeFuture = QtConcurrent::run([path, currentGeneration]() -> void
+  {
+    removeGenerations(path, currentGeneration);
+  });
+}
+
+QString WebTileCache::tileKey(int z, int x, int y, const QString& signature)
+{
+  return QString("%1/%2/%3/%4").arg(signature).arg(z).arg(x).arg(y);
+}
+
+QString WebTileCache::tileFilename(int z, int x, int y, const QString& signature)
+{
+  int gen;
+  {
+    QMutexLocker locker(&mutex);
+    gen = generation;
+  }
+
+  QString hash = QString::fromLatin1(QCryptographicHash::hash(signature.toUtf8(), QCryptographicHash::Md5).toHex());
+  return atools::buildPath({diskPath, QString::number(gen), hash, QString::number(z), QString::number(x),
+                            QString::number(y) + ".png"});
+}
+
+bool WebTileCache::isValidTile(int z, int x, int y)
+{
+  return z >= 0 && z <= MAX_ZOOM && x >= 0 && y >= 0 && x < (1 << z) && y < (1 << z);
+}
+
+atools::geo::Rect WebTileCache::tileRect(int z, int x, int y)
+{
+  return atools::geo::Rect(tileXToLon(x, z), tileYToLat(y, z), tileXToLon(x + 1., z), tileYToLat(y + 1., z));
+}
+
+atools::geo::Pos WebTileCache::tileCenter(int z, int x, int y)
+{
+  return atools::geo::Pos(tileXToLon(x + 0.5, z), tileYToLat(y + 0.5, z));
+}
+
+QPointF WebTileCache::tilePixel(int z, int x, int y, const atools::geo::Pos& pos)
+{
+  // World size in pixel for this zoom level
+  double worldSize = static_cast<double>(TILE_SIZE) * (1 << z);
+  double latRad = atools::geo::toRadians(static_cast<double>(pos.getLatY()));
+
+  double worldX = (pos.getLonX() + 180.) / 360. * worldSize;
+  double worldY = (1. - std::log(std::tan(latRad) + 1. / std::cos(latRad)) / M_PI) / 2. * worldSize;
+
+  return QPointF(worldX - x * TILE_SIZE, worldY - y * TILE_SIZE);
+}
@@ -0,0 +1,102 @@
+/*****************************************************************************
+* Copyright 2015-2019 Alexander Barthel alex@littlenavmap.org
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef LNM_WEBTILECACHE_H
+#define LNM_WEBTILECACHE_H
+
+#include "io/inireader.h"
+#include "geo/rect.h"
+
+#include <QCache>
+#include <QFuture>
+#include <QImage>
+#include <QMutex>
+#include <QPointF>
+
+/*
+ * Least recently used cache for rendered map tiles of the web server tile endpoint.
+ * Tiles are kept in memory and optionally saved as PNG files on disk.
+ *
+ * The key is built from zoom, x, y and a signature which covers map theme, shown layers, style and database.
+ * A change in map settings results in a different signature and tiles are rendered again.
+ * The disk cache is emptied on creation, i.e. on each start of the web server. Files of older generations are
+ * deleted in background after clear() and the disk cache starts over when exceeding the size limit.
+ *
+ * All methods are thread safe and can be called from the HTTP server threads.
+ */
+class WebTileCache
+{
+public:
+  /* Reads the keys "memorySize" (kB), "disk" (bool), "diskSize" (MB) and "path" from the settings */
+  explicit WebTileCache(const atools::io::IniKeyValues& settings);
+  ~WebTileCache();
+
+  /* Get tile from memory or disk. Returns a null image if not found. */
+  QImage getTile(int z, int x, int y, const QString& signature);
+
+  /* Add tile to memory and disk cache */
+  void insertTile(int z, int x, int y, const QString& signature, const QImage& image);
+
+  /* Remove all tiles from memory and ignore all files on disk. Called if options change which are not
+   * covered by the signature. */
+  void clear();
+
+  /* Tile size in pixel and maximum zoom level for slippy map tiles */
+  static const int TILE_SIZE = 256;
+  static const int MAX_ZOOM = 20;
+
+  /* true if zoom is within range and x and y are valid tile numbers for the zoom level */
+  static bool isValidTile(int z, int x, int y);
+
+  /* Geographic bounding rectangle of the tile in web Mercator projection */
+  static atools::geo::Rect tileRect(int z, int x, int y);
+
+  /* Center of the tile in pixel coordinates which differs from the center latitude of the rectangle */
+  static atools::geo::Pos tileCenter(int z, int x, int y);
+
+  /* Pixel position of pos relative to the top left corner of the tile. Can be outside of the tile. */
+  static QPointF tilePixel(int z, int x, int y, const atools::geo::Pos& pos);
+
+private:
+  static QString tileKey(int z, int x, int y, const QString& signature);
+
+  /* Start a new generation on disk and remove all older ones in background */
+  void clearDisk();
+
+  /* Path of PNG file for tile. Generation and hashed signature are used for the first directory levels. */
+  QString tileFilename(int z, int x, int y, const QString& signature);
+
+  QMutex mutex;
+
+  /* Key is built by tileKey() and cost is the image size in kB */
+  QCache<QString, QImage> memoryCache;
+
+  /* Empty if disk cache is disabled */
+  QString diskPath;
+
+  /* Incremented by clear() to separate files on disk from older ones */
+  int generation = 0;
+
+  /* Bytes written for the current generation and limit */
+  qint64 diskSize = 0L, maxDiskSize = 0L;
+
+  /* Deletes old generation directories */
+  QFuture<void> removeFuture;
+};
+
+#endif // LNM_WEBTILECACHE_H